@@ -0,0 +1,369 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerEntrySearch.h"
+#include "vtkPathExplorerTriangleBVH.h"
+
+// VTK includes
+#include <vtkMath.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Distance (mm) between an entry point and the surface before it, below
+// which the surface is considered to be the one of the entry point.
+const double EntryVisibilityTolerance = 1e-3;
+
+//----------------------------------------------------------------------------
+// Candidate entry points sampled on triangles (9 coordinates each): the
+// centroids of the sub-triangles obtained by splitting the edges in pieces
+// shorter than spacing. Candidates farther than maximumLength from the
+// target are dropped.
+void SampleEntryCandidates(const std::vector<double>& vertices,
+                           const std::vector<vtkIdType>& triangleIds,
+                           const double target[3], double spacing,
+                           double maximumLength, std::vector<double>& positions,
+                           std::vector<double>& normals,
+                           std::vector<vtkIdType>& triangles)
+{
+  double maximumLength2 = maximumLength * maximumLength;
+  for (size_t triangle = 0; triangle < triangleIds.size(); ++triangle)
+    {
+    const double* a = &vertices[9 * triangle];
+    double ab[3] = { a[3] - a[0], a[4] - a[1], a[5] - a[2] };
+    double ac[3] = { a[6] - a[0], a[7] - a[1], a[8] - a[2] };
+    double bc[3] = { ac[0] - ab[0], ac[1] - ab[1], ac[2] - ab[2] };
+    double normal[3];
+    vtkMath::Cross(ab, ac, normal);
+    if (vtkMath::Normalize(normal) == 0.0)
+      {
+      continue;
+      }
+    double maximumEdge = sqrt(std::max(vtkMath::Dot(ab, ab),
+                                       std::max(vtkMath::Dot(ac, ac), vtkMath::Dot(bc, bc))));
+    int divisions = std::max(1, static_cast<int>(ceil(maximumEdge / spacing)));
+
+    // Sub-triangle (i, j) has its centroid at (i + 1/3, j + 1/3) / divisions
+    // in the (ab, ac) frame, the flipped one between them at (i + 2/3, j + 2/3)
+    for (int i = 0; i < divisions; ++i)
+      {
+      for (int j = 0; i + j < divisions; ++j)
+        {
+        for (int flipped = 0; flipped < 2; ++flipped)
+          {
+          if (flipped && i + j == divisions - 1)
+            {
+            break;
+            }
+          double u = (i + (flipped ? 2.0 : 1.0) / 3.0) / divisions;
+          double v = (j + (flipped ? 2.0 : 1.0) / 3.0) / divisions;
+          double position[3];
+          for (int k = 0; k < 3; ++k)
+            {
+            position[k] = a[k] + u * ab[k] + v * ac[k];
+            }
+          if (vtkMath::Distance2BetweenPoints(position, target) > maximumLength2)
+            {
+            continue;
+            }
+          positions.insert(positions.end(), position, position + 3);
+          normals.insert(normals.end(), normal, normal + 3);
+          triangles.push_back(triangleIds[triangle]);
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Keep the first candidate in each cube of side spacing, so that the
+// density of the candidates doesn't depend on the size of the triangles.
+// Cubes are indexed relative to the target, within maximumLength.
+void ThinEntryCandidates(const double target[3], double spacing, double maximumLength,
+                         std::vector<double>& positions, std::vector<double>& normals,
+                         std::vector<vtkIdType>& triangles)
+{
+  typedef std::pair<vtkTypeInt64, size_t> CellCandidate;
+  const vtkTypeInt64 offset = static_cast<vtkTypeInt64>(ceil(maximumLength / spacing)) + 1;
+  const vtkTypeInt64 size = 2 * offset + 1;
+  size_t numberOfCandidates = triangles.size();
+  std::vector<CellCandidate> cells(numberOfCandidates);
+  for (size_t candidate = 0; candidate < numberOfCandidates; ++candidate)
+    {
+    vtkTypeInt64 cell = 0;
+    for (int i = 0; i < 3; ++i)
+      {
+      vtkTypeInt64 index = static_cast<vtkTypeInt64>(
+        floor((positions[3 * candidate + i] - target[i]) / spacing)) + offset;
+      cell = cell * size + std::max<vtkTypeInt64>(0, std::min(size - 1, index));
+      }
+    cells[candidate] = CellCandidate(cell, candidate);
+    }
+  std::sort(cells.begin(), cells.end());
+
+  size_t kept = 0;
+  for (size_t i = 0; i < numberOfCandidates; ++i)
+    {
+    if (i > 0 && cells[i].first == cells[i - 1].first)
+      {
+      continue;
+      }
+    size_t candidate = cells[i].second;
+    std::copy(&positions[3 * candidate], &positions[3 * candidate] + 3, &positions[3 * kept]);
+    std::copy(&normals[3 * candidate], &normals[3 * candidate] + 3, &normals[3 * kept]);
+    triangles[kept] = triangles[candidate];
+    ++kept;
+    }
+  positions.resize(3 * kept);
+  normals.resize(3 * kept);
+  triangles.resize(kept);
+}
+
+//----------------------------------------------------------------------------
+// Fewer crossed labels first, then lower costs
+struct EntryPointLess
+{
+  bool operator()(const vtkPathExplorerEntrySearch::EntryPoint& a,
+                  const vtkPathExplorerEntrySearch::EntryPoint& b) const
+    {
+    if (a.NumberOfCrossedLabels != b.NumberOfCrossedLabels)
+      {
+      return a.NumberOfCrossedLabels < b.NumberOfCrossedLabels;
+      }
+    return a.Cost < b.Cost;
+    }
+};
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerEntrySearch::vtkPathExplorerEntrySearch()
+  : Spacing(1.0), MaximumLength(150.0), MaximumAngle(60.0), ClearanceMargin(10.0),
+    MinimumSeparation(5.0), Surface(0)
+{
+  std::fill(this->Weights, this->Weights + 3, 1.0);
+  std::fill(this->Target, this->Target + 3, 0.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetSpacing(double spacing)
+{
+  this->Spacing = spacing;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerEntrySearch::GetSpacing() const
+{
+  return this->Spacing;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetMaximumLength(double maximumLength)
+{
+  this->MaximumLength = maximumLength;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerEntrySearch::GetMaximumLength() const
+{
+  return this->MaximumLength;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetMaximumAngle(double maximumAngle)
+{
+  this->MaximumAngle = maximumAngle;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerEntrySearch::GetMaximumAngle() const
+{
+  return this->MaximumAngle;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetClearanceMargin(double clearanceMargin)
+{
+  this->ClearanceMargin = clearanceMargin;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerEntrySearch::GetClearanceMargin() const
+{
+  return this->ClearanceMargin;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetWeights(const double weights[3])
+{
+  std::copy(weights, weights + 3, this->Weights);
+}
+
+//----------------------------------------------------------------------------
+const double* vtkPathExplorerEntrySearch::GetWeights() const
+{
+  return this->Weights;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SetMinimumSeparation(double minimumSeparation)
+{
+  this->MinimumSeparation = minimumSeparation;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerEntrySearch::GetMinimumSeparation() const
+{
+  return this->MinimumSeparation;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::GenerateCandidates(const double target[3],
+                                                    const vtkPathExplorerTriangleBVH* surface)
+{
+  std::copy(target, target + 3, this->Target);
+  this->Surface = surface;
+  this->Positions.clear();
+  this->Normals.clear();
+  this->Triangles.clear();
+  if (!surface || this->Spacing <= 0 || this->MaximumLength <= 0)
+    {
+    return;
+    }
+
+  // Reachable patch of the surface
+  std::vector<double> vertices;
+  std::vector<vtkIdType> triangles;
+  surface->FindTrianglesInSphere(target, this->MaximumLength, vertices, triangles);
+  SampleEntryCandidates(vertices, triangles, target, this->Spacing, this->MaximumLength,
+                        this->Positions, this->Normals, this->Triangles);
+  ThinEntryCandidates(target, this->Spacing, this->MaximumLength,
+                      this->Positions, this->Normals, this->Triangles);
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerEntrySearch::GetNumberOfCandidates() const
+{
+  return static_cast<int>(this->Triangles.size());
+}
+
+//----------------------------------------------------------------------------
+const double* vtkPathExplorerEntrySearch::GetTarget() const
+{
+  return this->Target;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerEntrySearch::EvaluateCandidate(int candidate,
+                                                   EntryPoint& entryPoint) const
+{
+  const double* entry = &this->Positions[3 * candidate];
+  const double* normal = &this->Normals[3 * candidate];
+  std::copy(entry, entry + 3, entryPoint.Position);
+  entryPoint.Angle = std::numeric_limits<double>::quiet_NaN();
+  entryPoint.Clearance = std::numeric_limits<double>::quiet_NaN();
+  entryPoint.NumberOfCrossedLabels = 0;
+  entryPoint.Cost = std::numeric_limits<double>::quiet_NaN();
+
+  double direction[3] =
+    { this->Target[0] - entry[0], this->Target[1] - entry[1], this->Target[2] - entry[2] };
+  entryPoint.Length = vtkMath::Norm(direction);
+  if (entryPoint.Length == 0.0 || entryPoint.Length > this->MaximumLength)
+    {
+    return false;
+    }
+  double cosine = std::min(1.0, fabs(vtkMath::Dot(direction, normal)) / entryPoint.Length);
+  entryPoint.Angle = vtkMath::DegreesFromRadians(acos(cosine));
+  if (entryPoint.Angle > this->MaximumAngle)
+    {
+    return false;
+    }
+
+  // The first surface crossed from the target must be the entry point
+  double t;
+  vtkIdType triangle;
+  if (this->Surface->IntersectSegment(this->Target, entry, t, triangle) &&
+      triangle != this->Triangles[candidate] &&
+      (1.0 - t) * entryPoint.Length > EntryVisibilityTolerance)
+    {
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::ComputeCost(EntryPoint& entryPoint) const
+{
+  double clearanceCost = 0.0;
+  if (this->ClearanceMargin > 0 && !vtkMath::IsNan(entryPoint.Clearance))
+    {
+    clearanceCost = std::max(0.0, 1.0 - entryPoint.Clearance / this->ClearanceMargin);
+    }
+  entryPoint.Cost =
+    this->Weights[0] * entryPoint.Length / this->MaximumLength +
+    this->Weights[1] * (this->MaximumAngle > 0 ? entryPoint.Angle / this->MaximumAngle : 0.0) +
+    this->Weights[2] * clearanceCost;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerEntrySearch::SelectEntryPoints(const EntryPointList& candidates,
+                                                   int numberOfEntryPoints,
+                                                   EntryPointList& entryPoints) const
+{
+  entryPoints.clear();
+  EntryPointList accepted;
+  for (EntryPointList::const_iterator candidate = candidates.begin();
+       candidate != candidates.end(); ++candidate)
+    {
+    if (!vtkMath::IsNan(candidate->Cost))
+      {
+      accepted.push_back(*candidate);
+      }
+    }
+  std::stable_sort(accepted.begin(), accepted.end(), EntryPointLess());
+
+  // Best candidates, away from the ones already selected
+  double separation = std::max(0.0, this->MinimumSeparation);
+  double separation2 = separation * separation;
+  for (EntryPointList::const_iterator candidate = accepted.begin();
+       candidate != accepted.end() &&
+         static_cast<int>(entryPoints.size()) < numberOfEntryPoints; ++candidate)
+    {
+    bool separated = true;
+    for (EntryPointList::const_iterator selected = entryPoints.begin();
+         separated && selected != entryPoints.end(); ++selected)
+      {
+      separated = vtkMath::Distance2BetweenPoints(candidate->Position,
+                                                  selected->Position) >= separation2;
+      }
+    if (separated)
+      {
+      entryPoints.push_back(*candidate);
+      }
+    }
+}
@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerEntrySearch_h
+#define __vtkPathExplorerEntrySearch_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <vector>
+
+class vtkPathExplorerTriangleBVH;
+
+/// \brief Search of the entry points of a target on a surface.
+///
+/// Candidates are sampled on the triangles of the surface within reach of
+/// the target, about Spacing mm apart. Each candidate is then evaluated
+/// independently, in any order and by several threads at once: its
+/// trajectory is rejected if it is too long, too oblique or if it crosses
+/// the surface before the candidate; the clearance and the labels crossed,
+/// computed by the caller, complete its cost. The best candidates are
+/// selected last.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerEntrySearch
+{
+public:
+  // Description:
+  // Entry point found for a target, with the properties of its trajectory.
+  // Angle is between the trajectory and the surface normal, in degrees.
+  // Clearance is NaN without critical structures.
+  struct EntryPoint
+    {
+    double Position[3];
+    double Length;
+    double Angle;
+    double Clearance;
+    int NumberOfCrossedLabels;
+    double Cost;
+    };
+  typedef std::vector<EntryPoint> EntryPointList;
+
+  vtkPathExplorerEntrySearch();
+
+  // Description:
+  // Candidates are spaced by about Spacing mm on the surface (1 by
+  // default). Trajectories longer than MaximumLength mm (150) or making
+  // more than MaximumAngle degrees (60) with the surface normal are
+  // rejected. The cost of a trajectory adds its length, its angle and its
+  // lack of clearance (below ClearanceMargin mm, 10), each normalized to
+  // [0, 1] for the acceptable values and weighted by Weights (length,
+  // angle, clearance, 1 each). Entry points selected are at least
+  // MinimumSeparation mm apart (5).
+  void SetSpacing(double spacing);
+  double GetSpacing() const;
+  void SetMaximumLength(double maximumLength);
+  double GetMaximumLength() const;
+  void SetMaximumAngle(double maximumAngle);
+  double GetMaximumAngle() const;
+  void SetClearanceMargin(double clearanceMargin);
+  double GetClearanceMargin() const;
+  void SetWeights(const double weights[3]);
+  const double* GetWeights() const;
+  void SetMinimumSeparation(double minimumSeparation);
+  double GetMinimumSeparation() const;
+
+  // Description:
+  // Sample the candidates of a target on a surface, in world coordinates.
+  // The surface is read until the candidates are evaluated.
+  void GenerateCandidates(const double target[3], const vtkPathExplorerTriangleBVH* surface);
+  int GetNumberOfCandidates() const;
+  const double* GetTarget() const;
+
+  // Description:
+  // Initialize the entry point of a candidate and check its trajectory:
+  // length, angle and visibility of the target. Return false, with a NaN
+  // cost, if it is rejected.
+  bool EvaluateCandidate(int candidate, EntryPoint& entryPoint) const;
+
+  // Description:
+  // Cost of an accepted entry point, from its length, angle and clearance.
+  void ComputeCost(EntryPoint& entryPoint) const;
+
+  // Description:
+  // Select the best entry points, at most numberOfEntryPoints, in order:
+  // fewer crossed labels first, then lower costs. Entry points with a NaN
+  // cost (rejected) are skipped.
+  void SelectEntryPoints(const EntryPointList& candidates, int numberOfEntryPoints,
+                         EntryPointList& entryPoints) const;
+
+protected:
+  double Spacing;
+  double MaximumLength;
+  double MaximumAngle;
+  double ClearanceMargin;
+  double Weights[3];
+  double MinimumSeparation;
+
+  double Target[3];
+  const vtkPathExplorerTriangleBVH* Surface;
+  // Candidates: position, normal and triangle of the surface
+  std::vector<double> Positions;
+  std::vector<double> Normals;
+  std::vector<vtkIdType> Triangles;
+};
+
+#endif
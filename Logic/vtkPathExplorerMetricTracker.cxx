@@ -0,0 +1,207 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerMetricTracker.h"
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerMetricTracker::TrackMetric(const char* name, int type,
+                                               const char* inputNodeID)
+{
+  Metric* metric = this->FindMetric(name);
+  if (!metric)
+    {
+    this->Metrics.push_back(Metric());
+    metric = &this->Metrics.back();
+    metric->Name = name;
+    metric->InputVersion = 0;
+    }
+  else if (metric->Type == type && metric->InputNodeID == inputNodeID)
+    {
+    return false;
+    }
+
+  // New input: all the values are invalid
+  metric->Type = type;
+  metric->InputNodeID = inputNodeID;
+  ++metric->InputVersion;
+  for (std::map<int, Trajectory>::iterator it = this->Trajectories.begin();
+       it != this->Trajectories.end(); ++it)
+    {
+    metric->InvalidUIDs.insert(it->first);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerMetricTracker::UntrackMetric(const char* name)
+{
+  for (std::vector<Metric>::iterator it = this->Metrics.begin();
+       it != this->Metrics.end(); ++it)
+    {
+    if (it->Name == name)
+      {
+      this->Metrics.erase(it);
+      return;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerMetricTracker::GetNumberOfMetrics() const
+{
+  return static_cast<int>(this->Metrics.size());
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerMetricTracker::Metric* vtkPathExplorerMetricTracker::GetMetric(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Metrics.size()))
+    {
+    return 0;
+    }
+  return &this->Metrics[index];
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerMetricTracker::Metric* vtkPathExplorerMetricTracker::FindMetric(const char* name)
+{
+  for (size_t i = 0; i < this->Metrics.size(); ++i)
+    {
+    if (this->Metrics[i].Name == name)
+      {
+      return &this->Metrics[i];
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerMetricTracker::InvalidateInput(const char* inputNodeID)
+{
+  bool invalidated = false;
+  for (size_t i = 0; i < this->Metrics.size(); ++i)
+    {
+    Metric& metric = this->Metrics[i];
+    if (metric.InputNodeID != inputNodeID)
+      {
+      continue;
+      }
+    ++metric.InputVersion;
+    for (std::map<int, Trajectory>::iterator it = this->Trajectories.begin();
+         it != this->Trajectories.end(); ++it)
+      {
+      metric.InvalidUIDs.insert(it->first);
+      }
+    invalidated = true;
+    }
+  return invalidated;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerMetricTracker::GetInputNodeIDs(std::set<std::string>& inputNodeIDs) const
+{
+  for (size_t i = 0; i < this->Metrics.size(); ++i)
+    {
+    inputNodeIDs.insert(this->Metrics[i].InputNodeID);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerMetricTracker::InvalidateValue(Metric& metric, int uid)
+{
+  if (this->Trajectories.count(uid))
+    {
+    metric.InvalidUIDs.insert(uid);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerMetricTracker::HasInvalidValues() const
+{
+  for (size_t i = 0; i < this->Metrics.size(); ++i)
+    {
+    if (!this->Metrics[i].InvalidUIDs.empty())
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerMetricTracker::SetTrajectory(int uid, const double entry[3],
+                                                 const double target[3])
+{
+  std::map<int, Trajectory>::iterator it = this->Trajectories.find(uid);
+  if (it == this->Trajectories.end())
+    {
+    Trajectory trajectory;
+    std::copy(entry, entry + 3, trajectory.Entry);
+    std::copy(target, target + 3, trajectory.Target);
+    trajectory.Version = 0;
+    it = this->Trajectories.insert(std::make_pair(uid, trajectory)).first;
+    }
+  else if (std::equal(entry, entry + 3, it->second.Entry) &&
+           std::equal(target, target + 3, it->second.Target))
+    {
+    return false;
+    }
+  std::copy(entry, entry + 3, it->second.Entry);
+  std::copy(target, target + 3, it->second.Target);
+  ++it->second.Version;
+  for (size_t i = 0; i < this->Metrics.size(); ++i)
+    {
+    this->Metrics[i].InvalidUIDs.insert(uid);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const vtkPathExplorerMetricTracker::Trajectory*
+vtkPathExplorerMetricTracker::GetTrajectory(int uid) const
+{
+  std::map<int, Trajectory>::const_iterator it = this->Trajectories.find(uid);
+  return it == this->Trajectories.end() ? 0 : &it->second;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerMetricTracker::RemoveOtherTrajectories(const std::set<int>& uids)
+{
+  std::map<int, Trajectory>::iterator it = this->Trajectories.begin();
+  while (it != this->Trajectories.end())
+    {
+    if (uids.count(it->first))
+      {
+      ++it;
+      continue;
+      }
+    for (size_t i = 0; i < this->Metrics.size(); ++i)
+      {
+      this->Metrics[i].InvalidUIDs.erase(it->first);
+      }
+    this->Trajectories.erase(it++);
+    }
+}
@@ -0,0 +1,98 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerMetricTracker_h
+#define __vtkPathExplorerMetricTracker_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// STD includes
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/// \brief Validity of the tracked metric values of a trajectory list.
+///
+/// A tracked metric is derived from one input node. Its values are
+/// identified by the UID of their trajectory: a trajectory added or moved
+/// only invalidates its own values, an input modified only invalidates the
+/// values of the metrics derived from it. Versions tell apart the values
+/// computed from positions or inputs replaced meanwhile. The tracker
+/// doesn't access MRML: the logic reports the positions of the
+/// trajectories and the modifications of the inputs.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerMetricTracker
+{
+public:
+  struct Metric
+    {
+    std::string Name;
+    int Type;
+    std::string InputNodeID;
+    // Incremented when the input is modified
+    unsigned long InputVersion;
+    // UIDs of the trajectories to recompute
+    std::set<int> InvalidUIDs;
+    };
+  struct Trajectory
+    {
+    double Entry[3];
+    double Target[3];
+    // Incremented when the trajectory moves
+    unsigned long Version;
+    };
+
+  // Description:
+  // Track a metric derived from an input. Return false if the metric is
+  // already tracked with this type and input, otherwise all its values are
+  // invalid.
+  bool TrackMetric(const char* name, int type, const char* inputNodeID);
+  void UntrackMetric(const char* name);
+  int GetNumberOfMetrics() const;
+  Metric* GetMetric(int index);
+  Metric* FindMetric(const char* name);
+
+  // Description:
+  // Input modified: all the values of the metrics derived from it are
+  // invalid. Return false if no metric uses it.
+  bool InvalidateInput(const char* inputNodeID);
+  void GetInputNodeIDs(std::set<std::string>& inputNodeIDs) const;
+
+  // Description:
+  // Invalidate a value again, unless its trajectory was removed.
+  void InvalidateValue(Metric& metric, int uid);
+  bool HasInvalidValues() const;
+
+  // Description:
+  // Position of a trajectory: a new or moved trajectory invalidates its
+  // values. Return false if it didn't move.
+  bool SetTrajectory(int uid, const double entry[3], const double target[3]);
+  const Trajectory* GetTrajectory(int uid) const;
+  // Remove the trajectories that are not in uids, and their values
+  void RemoveOtherTrajectories(const std::set<int>& uids);
+
+protected:
+  std::vector<Metric> Metrics;
+  std::map<int, Trajectory> Trajectories;
+};
+
+#endif
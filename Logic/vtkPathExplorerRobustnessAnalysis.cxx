@@ -0,0 +1,295 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerRobustnessAnalysis.h"
+
+// VTK includes
+#include <vtkMath.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Philox4x32-10 counter-based random number generator (Salmon et al.,
+// "Parallel random numbers: as easy as 1, 2, 3"): 4 random words for each
+// counter, without state shared between the threads.
+void Philox4x32(const vtkTypeUInt32 counter[4], const vtkTypeUInt32 key[2],
+                vtkTypeUInt32 random[4])
+{
+  vtkTypeUInt32 c[4] = { counter[0], counter[1], counter[2], counter[3] };
+  vtkTypeUInt32 k[2] = { key[0], key[1] };
+  for (int round = 0; round < 10; ++round)
+    {
+    vtkTypeUInt64 p0 = static_cast<vtkTypeUInt64>(0xD2511F53u) * c[0];
+    vtkTypeUInt64 p1 = static_cast<vtkTypeUInt64>(0xCD9E8D57u) * c[2];
+    vtkTypeUInt32 c1 = c[1];
+    vtkTypeUInt32 c3 = c[3];
+    c[0] = static_cast<vtkTypeUInt32>(p1 >> 32) ^ c1 ^ k[0];
+    c[1] = static_cast<vtkTypeUInt32>(p1);
+    c[2] = static_cast<vtkTypeUInt32>(p0 >> 32) ^ c3 ^ k[1];
+    c[3] = static_cast<vtkTypeUInt32>(p0);
+    k[0] += 0x9E3779B9u;
+    k[1] += 0xBB67AE85u;
+    }
+  std::copy(c, c + 4, random);
+}
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerRobustnessAnalysis::Statistics::Statistics()
+{
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis::Statistics::Initialize()
+{
+  this->NumberOfSamples = 0;
+  this->NumberOfCollisions = 0;
+  this->Hits.clear();
+  this->Clearances.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis::Statistics
+::AddSample(double clearance, const std::vector<int>& labels)
+{
+  ++this->NumberOfSamples;
+  if (!vtkMath::IsNan(clearance))
+    {
+    this->Clearances.push_back(clearance);
+    }
+  if (labels.empty())
+    {
+    return;
+    }
+  ++this->NumberOfCollisions;
+
+  // Each label counts once per trajectory
+  this->SampleLabels = labels;
+  std::sort(this->SampleLabels.begin(), this->SampleLabels.end());
+  this->SampleLabels.erase(std::unique(this->SampleLabels.begin(), this->SampleLabels.end()),
+                           this->SampleLabels.end());
+  for (size_t i = 0; i < this->SampleLabels.size(); ++i)
+    {
+    size_t hit = 0;
+    while (hit < this->Hits.size() && this->Hits[hit].first != this->SampleLabels[i])
+      {
+      ++hit;
+      }
+    if (hit == this->Hits.size())
+      {
+      this->Hits.push_back(std::make_pair(this->SampleLabels[i], 0));
+      }
+    ++this->Hits[hit].second;
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerRobustnessAnalysis::Statistics::GetNumberOfSamples() const
+{
+  return this->NumberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis::Statistics
+::GetRobustness(TrajectoryRobustness& robustness)
+{
+  double numberOfSamples = std::max(1, this->NumberOfSamples);
+  robustness.CollisionProbability = this->NumberOfCollisions / numberOfSamples;
+  std::sort(this->Hits.begin(), this->Hits.end());
+  robustness.HitProbabilities.clear();
+  for (size_t hit = 0; hit < this->Hits.size(); ++hit)
+    {
+    robustness.HitProbabilities.push_back(
+      std::make_pair(this->Hits[hit].first, this->Hits[hit].second / numberOfSamples));
+    }
+
+  robustness.MeanClearance = std::numeric_limits<double>::quiet_NaN();
+  robustness.RobustClearance = std::numeric_limits<double>::quiet_NaN();
+  if (this->Clearances.empty())
+    {
+    return;
+    }
+  double sum = 0.0;
+  for (size_t i = 0; i < this->Clearances.size(); ++i)
+    {
+    sum += this->Clearances[i];
+    }
+  robustness.MeanClearance = sum / this->Clearances.size();
+  std::vector<double>::iterator percentile = this->Clearances.begin() +
+    static_cast<size_t>(0.05 * (this->Clearances.size() - 1));
+  std::nth_element(this->Clearances.begin(), percentile, this->Clearances.end());
+  robustness.RobustClearance = *percentile;
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerRobustnessAnalysis::vtkPathExplorerRobustnessAnalysis()
+  : NumberOfSamples(1000), Seed(0)
+{
+  std::fill(this->EntryFactor, this->EntryFactor + 9, 0.0);
+  std::fill(this->TargetFactor, this->TargetFactor + 9, 0.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis::SetNumberOfSamples(int numberOfSamples)
+{
+  this->NumberOfSamples = numberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerRobustnessAnalysis::GetNumberOfSamples() const
+{
+  return this->NumberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis::SetSeed(unsigned int seed)
+{
+  this->Seed = static_cast<vtkTypeUInt32>(seed);
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPathExplorerRobustnessAnalysis::GetSeed() const
+{
+  return this->Seed;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerRobustnessAnalysis::SetEntryErrorCovariance(const double covariance[9])
+{
+  double factor[9];
+  if (!FactorCovariance(covariance, factor))
+    {
+    return false;
+    }
+  std::copy(factor, factor + 9, this->EntryFactor);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerRobustnessAnalysis::SetTargetErrorCovariance(const double covariance[9])
+{
+  double factor[9];
+  if (!FactorCovariance(covariance, factor))
+    {
+    return false;
+    }
+  std::copy(factor, factor + 9, this->TargetFactor);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis
+::GetPerturbedTrajectory(unsigned int stream, int sample,
+                         const double entry[3], const double target[3],
+                         double perturbedEntry[3], double perturbedTarget[3]) const
+{
+  double normals[6];
+  GetNormalSamples(this->Seed, static_cast<vtkTypeUInt32>(stream),
+                   static_cast<vtkTypeUInt32>(sample), normals);
+  for (int i = 0; i < 3; ++i)
+    {
+    perturbedEntry[i] = entry[i];
+    perturbedTarget[i] = target[i];
+    for (int j = 0; j <= i; ++j)
+      {
+      perturbedEntry[i] += this->EntryFactor[3 * i + j] * normals[j];
+      perturbedTarget[i] += this->TargetFactor[3 * i + j] * normals[3 + j];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerRobustnessAnalysis
+::GetNormalSamples(vtkTypeUInt32 seed, vtkTypeUInt32 stream, vtkTypeUInt32 sample,
+                   double normals[6])
+{
+  const vtkTypeUInt32 key[2] = { seed, 0x50454C58u };
+  vtkTypeUInt32 random[8];
+  for (vtkTypeUInt32 block = 0; block < 2; ++block)
+    {
+    const vtkTypeUInt32 counter[4] = { sample, stream, block, 0 };
+    Philox4x32(counter, key, random + 4 * block);
+    }
+  for (int i = 0; i < 3; ++i)
+    {
+    // Uniform in (0, 1)
+    double u1 = (random[2 * i] + 0.5) / 4294967296.0;
+    double u2 = (random[2 * i + 1] + 0.5) / 4294967296.0;
+    double radius = sqrt(-2.0 * log(u1));
+    normals[2 * i] = radius * cos(2.0 * vtkMath::Pi() * u2);
+    normals[2 * i + 1] = radius * sin(2.0 * vtkMath::Pi() * u2);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerRobustnessAnalysis
+::FactorCovariance(const double covariance[9], double factor[9])
+{
+  double scale = 0.0;
+  for (int i = 0; i < 9; ++i)
+    {
+    scale = std::max(scale, fabs(covariance[i]));
+    }
+  const double tolerance = 1e-12 * scale;
+  std::fill(factor, factor + 9, 0.0);
+  for (int j = 0; j < 3; ++j)
+    {
+    for (int i = j; i < 3; ++i)
+      {
+      if (fabs(covariance[3 * i + j] - covariance[3 * j + i]) > 1e-9 * scale)
+        {
+        return false;
+        }
+      double sum = covariance[3 * i + j];
+      for (int k = 0; k < j; ++k)
+        {
+        sum -= factor[3 * i + k] * factor[3 * j + k];
+        }
+      if (i == j)
+        {
+        if (sum < -tolerance)
+          {
+          return false;
+          }
+        factor[3 * j + j] = sum > tolerance ? sqrt(sum) : 0.0;
+        }
+      else if (factor[3 * j + j] > 0.0)
+        {
+        factor[3 * i + j] = sum / factor[3 * j + j];
+        }
+      else if (fabs(sum) > tolerance)
+        {
+        // Degenerate direction with a non-zero covariance
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
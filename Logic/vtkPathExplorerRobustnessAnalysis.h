@@ -0,0 +1,125 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerRobustnessAnalysis_h
+#define __vtkPathExplorerRobustnessAnalysis_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <utility>
+#include <vector>
+
+/// \brief Monte Carlo sampling of the positioning errors of trajectories.
+///
+/// Entry and target positions are perturbed by Gaussian errors of given
+/// covariances. Perturbations are drawn from a counter-based random number
+/// generator (Philox4x32-10) indexed by the seed, a stream (the trajectory
+/// UID) and the sample number: they don't depend on the order in which the
+/// samples are drawn, hence on the number of threads. The perturbed
+/// trajectories of a trajectory are summarized by a Statistics.
+/// Const methods can run in several threads.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerRobustnessAnalysis
+{
+public:
+  // Description:
+  // Robustness of a trajectory to the positioning errors. Probabilities are
+  // the fractions of the perturbed trajectories crossing a label:
+  // HitProbabilities gives them per label (sorted by label, labels never
+  // hit are omitted) and CollisionProbability for any label. Clearances of
+  // the perturbed trajectories are summarized by their mean and their 5th
+  // percentile (RobustClearance), NaN if none is known.
+  struct TrajectoryRobustness
+    {
+    double CollisionProbability;
+    std::vector<std::pair<int, double> > HitProbabilities;
+    double MeanClearance;
+    double RobustClearance;
+    };
+
+  // Description:
+  // Outcome of the perturbed trajectories of a trajectory, added one by
+  // one: clearance (NaN if unknown) and labels crossed (in any order,
+  // repeated or not).
+  class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT Statistics
+  {
+  public:
+    Statistics();
+    void Initialize();
+    void AddSample(double clearance, const std::vector<int>& labels);
+    int GetNumberOfSamples() const;
+    void GetRobustness(TrajectoryRobustness& robustness);
+
+  protected:
+    int NumberOfSamples;
+    int NumberOfCollisions;
+    // Hit counts by label
+    std::vector<std::pair<int, int> > Hits;
+    std::vector<double> Clearances;
+    std::vector<int> SampleLabels;
+  };
+
+  vtkPathExplorerRobustnessAnalysis();
+
+  // Description:
+  // Number of perturbed trajectories per trajectory (1000 by default) and
+  // seed of the perturbations (0 by default).
+  void SetNumberOfSamples(int numberOfSamples);
+  int GetNumberOfSamples() const;
+  void SetSeed(unsigned int seed);
+  unsigned int GetSeed() const;
+
+  // Description:
+  // Covariances of the entry and target errors (3x3, row major, in mm^2),
+  // 0 by default. Return false and leave the covariance unchanged if it
+  // isn't symmetric positive semi-definite.
+  bool SetEntryErrorCovariance(const double covariance[9]);
+  bool SetTargetErrorCovariance(const double covariance[9]);
+
+  // Description:
+  // Entry and target of a perturbed trajectory: sample of the stream.
+  void GetPerturbedTrajectory(unsigned int stream, int sample,
+                              const double entry[3], const double target[3],
+                              double perturbedEntry[3], double perturbedTarget[3]) const;
+
+  // Description:
+  // 6 standard normal values (Box-Muller) for a sample of a stream.
+  static void GetNormalSamples(vtkTypeUInt32 seed, vtkTypeUInt32 stream,
+                               vtkTypeUInt32 sample, double normals[6]);
+
+  // Description:
+  // Lower triangular L such that L L^T = covariance (3x3, row major).
+  // Return false if the covariance isn't symmetric positive semi-definite.
+  static bool FactorCovariance(const double covariance[9], double factor[9]);
+
+protected:
+  int NumberOfSamples;
+  vtkTypeUInt32 Seed;
+  // Factors of the covariances
+  double EntryFactor[9];
+  double TargetFactor[9];
+};
+
+#endif
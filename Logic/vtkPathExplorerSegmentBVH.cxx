@@ -0,0 +1,414 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerSegmentBVH.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Median splits bound the depth by log2 of the number of leaves
+const int StackSize = 96;
+const int BlockSize = 6 * vtkPathExplorerSegmentBVH::MaximumLeafSize;
+
+//----------------------------------------------------------------------------
+inline double Clamp(double value, double minimum, double maximum)
+{
+  return std::min(std::max(value, minimum), maximum);
+}
+
+//----------------------------------------------------------------------------
+void ResetBounds(double minimum[3], double maximum[3])
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < 3; ++i)
+    {
+    minimum[i] = infinity;
+    maximum[i] = -infinity;
+    }
+}
+
+//----------------------------------------------------------------------------
+void AddBounds(const double pointMinimum[3], const double pointMaximum[3],
+               double minimum[3], double maximum[3])
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    minimum[i] = std::min(minimum[i], pointMinimum[i]);
+    maximum[i] = std::max(maximum[i], pointMaximum[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Squared distance between two boxes, 0 if they overlap.
+double BoxBoxDistance2(const double minimum1[3], const double maximum1[3],
+                       const double minimum2[3], const double maximum2[3])
+{
+  double distance2 = 0.0;
+  for (int i = 0; i < 3; ++i)
+    {
+    double d = std::max(0.0, std::max(minimum1[i] - maximum2[i],
+                                      minimum2[i] - maximum1[i]));
+    distance2 += d * d;
+    }
+  return distance2;
+}
+
+//----------------------------------------------------------------------------
+struct CenterLess
+{
+  CenterLess(int axis) : Axis(axis) {}
+  template <class T>
+  bool operator()(const T& a, const T& b) const
+    {
+    return a.Center[this->Axis] < b.Center[this->Axis];
+    }
+  int Axis;
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+struct vtkPathExplorerSegmentBVH::BuildSegment
+{
+  double Points[6];
+  double Minimum[3];
+  double Maximum[3];
+  double Center[3];
+  vtkIdType Id;
+};
+
+//----------------------------------------------------------------------------
+vtkPathExplorerSegmentBVH::vtkPathExplorerSegmentBVH()
+{
+  this->NumberOfSegments = 0;
+  this->Depth = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerSegmentBVH::Initialize()
+{
+  std::vector<Node>().swap(this->Nodes);
+  std::vector<double>().swap(this->Coordinates);
+  std::vector<vtkIdType>().swap(this->SegmentIds);
+  this->NumberOfSegments = 0;
+  this->Depth = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerSegmentBVH::Build(const double* startPoints,
+                                      const double* endPoints,
+                                      vtkIdType numberOfSegments)
+{
+  this->Initialize();
+  if (!startPoints || !endPoints || numberOfSegments <= 0)
+    {
+    return;
+    }
+
+  std::vector<BuildSegment> buildSegments(numberOfSegments);
+  for (vtkIdType id = 0; id < numberOfSegments; ++id)
+    {
+    BuildSegment& segment = buildSegments[id];
+    segment.Id = id;
+    std::copy(startPoints + 3 * id, startPoints + 3 * id + 3, segment.Points);
+    std::copy(endPoints + 3 * id, endPoints + 3 * id + 3, segment.Points + 3);
+    ResetBounds(segment.Minimum, segment.Maximum);
+    AddBounds(segment.Points, segment.Points, segment.Minimum, segment.Maximum);
+    AddBounds(segment.Points + 3, segment.Points + 3, segment.Minimum, segment.Maximum);
+    for (int i = 0; i < 3; ++i)
+      {
+      segment.Center[i] = 0.5 * (segment.Minimum[i] + segment.Maximum[i]);
+      }
+    }
+
+  // About 2 n / MaximumLeafSize nodes
+  vtkIdType numberOfLeaves = 2 * numberOfSegments / MaximumLeafSize + 1;
+  this->Nodes.reserve(2 * numberOfLeaves);
+  this->Coordinates.reserve(BlockSize * numberOfLeaves);
+  this->SegmentIds.reserve(MaximumLeafSize * numberOfLeaves);
+  this->NumberOfSegments = numberOfSegments;
+  this->BuildNode(buildSegments, 0, static_cast<int>(numberOfSegments), 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerSegmentBVH::BuildNode(std::vector<BuildSegment>& segments,
+                                         int first, int last, int depth)
+{
+  int nodeIndex = static_cast<int>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+  this->Depth = std::max(this->Depth, depth + 1);
+
+  double minimum[3];
+  double maximum[3];
+  double centerMinimum[3];
+  double centerMaximum[3];
+  ResetBounds(minimum, maximum);
+  ResetBounds(centerMinimum, centerMaximum);
+  for (int i = first; i < last; ++i)
+    {
+    AddBounds(segments[i].Minimum, segments[i].Maximum, minimum, maximum);
+    AddBounds(segments[i].Center, segments[i].Center, centerMinimum, centerMaximum);
+    }
+  std::copy(minimum, minimum + 3, this->Nodes[nodeIndex].Minimum);
+  std::copy(maximum, maximum + 3, this->Nodes[nodeIndex].Maximum);
+  this->Nodes[nodeIndex].Padding[0] = 0;
+  this->Nodes[nodeIndex].Padding[1] = 0;
+
+  int count = last - first;
+  if (count <= MaximumLeafSize)
+    {
+    // Unused slots repeat the first segment of the leaf
+    Node& leaf = this->Nodes[nodeIndex];
+    leaf.Index = static_cast<int>(this->SegmentIds.size() / MaximumLeafSize);
+    leaf.Count = count;
+    size_t block = this->Coordinates.size();
+    this->Coordinates.resize(block + BlockSize);
+    for (int slot = 0; slot < MaximumLeafSize; ++slot)
+      {
+      const BuildSegment& segment = segments[slot < count ? first + slot : first];
+      for (int component = 0; component < 6; ++component)
+        {
+        this->Coordinates[block + component * MaximumLeafSize + slot] =
+          segment.Points[component];
+        }
+      this->SegmentIds.push_back(slot < count ? segment.Id : -1);
+      }
+    return nodeIndex;
+    }
+
+  int splitAxis = 0;
+  for (int i = 1; i < 3; ++i)
+    {
+    if (centerMaximum[i] - centerMinimum[i] >
+        centerMaximum[splitAxis] - centerMinimum[splitAxis])
+      {
+      splitAxis = i;
+      }
+    }
+  int middle = first + count / 2;
+  std::nth_element(segments.begin() + first, segments.begin() + middle,
+                   segments.begin() + last, CenterLess(splitAxis));
+
+  // First child follows its parent
+  this->BuildNode(segments, first, middle, depth + 1);
+  int secondChild = this->BuildNode(segments, middle, last, depth + 1);
+  Node& node = this->Nodes[nodeIndex];
+  node.Index = secondChild;
+  node.Count = 0;
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkPathExplorerSegmentBVH::GetNumberOfSegments() const
+{
+  return this->NumberOfSegments;
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerSegmentBVH::GetNumberOfNodes() const
+{
+  return static_cast<int>(this->Nodes.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerSegmentBVH::GetDepth() const
+{
+  return this->Depth;
+}
+
+//----------------------------------------------------------------------------
+// Squared distances between the segment p0 p1 and the segments of a leaf
+// (Ericson, 5.1.9), without branches: s is computed for the closest points
+// of the lines, t for s and clamped, then s again for the clamped t.
+// Parallel and degenerate segments use a tiny denominator instead of a
+// branch: s is then 0 or 1, and the last two steps still find the closest
+// points.
+void vtkPathExplorerSegmentBVH::GetLeafDistances2(const Node& leaf, const double p0[3],
+                                                  const double p1[3],
+                                                  double distances2[MaximumLeafSize]) const
+{
+  const double tiny = std::numeric_limits<double>::min();
+  const double* block = &this->Coordinates[leaf.Index * BlockSize];
+  const double* x0 = block;
+  const double* y0 = block + MaximumLeafSize;
+  const double* z0 = block + 2 * MaximumLeafSize;
+  const double* x1 = block + 3 * MaximumLeafSize;
+  const double* y1 = block + 4 * MaximumLeafSize;
+  const double* z1 = block + 5 * MaximumLeafSize;
+
+  const double d1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+  const double a = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2];
+  const double inverseA = 1.0 / std::max(a, tiny);
+  for (int k = 0; k < MaximumLeafSize; ++k)
+    {
+    double d2x = x1[k] - x0[k];
+    double d2y = y1[k] - y0[k];
+    double d2z = z1[k] - z0[k];
+    double rx = p0[0] - x0[k];
+    double ry = p0[1] - y0[k];
+    double rz = p0[2] - z0[k];
+    double b = d1[0] * d2x + d1[1] * d2y + d1[2] * d2z;
+    double c = d1[0] * rx + d1[1] * ry + d1[2] * rz;
+    double e = d2x * d2x + d2y * d2y + d2z * d2z;
+    double f = d2x * rx + d2y * ry + d2z * rz;
+    double denominator = std::max(a * e - b * b, tiny);
+    double s = Clamp((b * f - c * e) / denominator, 0.0, 1.0);
+    double t = Clamp((b * s + f) / std::max(e, tiny), 0.0, 1.0);
+    s = Clamp((b * t - c) * inverseA, 0.0, 1.0);
+    double dx = rx + d1[0] * s - d2x * t;
+    double dy = ry + d1[1] * s - d2y * t;
+    double dz = rz + d1[2] * s - d2z * t;
+    distances2[k] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerSegmentBVH::FindClosestSegment(const double p0[3], const double p1[3],
+                                                     vtkIdType excludedSegment,
+                                                     double maximumDistance,
+                                                     vtkIdType& segment) const
+{
+  segment = -1;
+  if (this->Nodes.empty())
+    {
+    return maximumDistance;
+    }
+
+  double minimum[3];
+  double maximum[3];
+  ResetBounds(minimum, maximum);
+  AddBounds(p0, p0, minimum, maximum);
+  AddBounds(p1, p1, minimum, maximum);
+
+  // Nodes are visited closest first, and skipped when their box is farther
+  // from the segment box than the closest segment so far
+  double closest2 = maximumDistance * maximumDistance;
+  int stack[StackSize];
+  double stackDistances2[StackSize];
+  int stackSize = 0;
+  stack[stackSize] = 0;
+  stackDistances2[stackSize++] = BoxBoxDistance2(
+    this->Nodes[0].Minimum, this->Nodes[0].Maximum, minimum, maximum);
+  while (stackSize > 0)
+    {
+    --stackSize;
+    if (stackDistances2[stackSize] >= closest2)
+      {
+      continue;
+      }
+    const Node& node = this->Nodes[stack[stackSize]];
+    if (node.Count > 0)
+      {
+      double distances2[MaximumLeafSize];
+      this->GetLeafDistances2(node, p0, p1, distances2);
+      const vtkIdType* ids = &this->SegmentIds[node.Index * MaximumLeafSize];
+      for (int k = 0; k < node.Count; ++k)
+        {
+        if (distances2[k] < closest2 && ids[k] != excludedSegment)
+          {
+          closest2 = distances2[k];
+          segment = ids[k];
+          }
+        }
+      continue;
+      }
+
+    int nearChild = static_cast<int>(&node - &this->Nodes[0]) + 1;
+    int farChild = node.Index;
+    double nearDistance2 = BoxBoxDistance2(
+      this->Nodes[nearChild].Minimum, this->Nodes[nearChild].Maximum, minimum, maximum);
+    double farDistance2 = BoxBoxDistance2(
+      this->Nodes[farChild].Minimum, this->Nodes[farChild].Maximum, minimum, maximum);
+    if (farDistance2 < nearDistance2)
+      {
+      std::swap(nearChild, farChild);
+      std::swap(nearDistance2, farDistance2);
+      }
+    if (farDistance2 < closest2)
+      {
+      stack[stackSize] = farChild;
+      stackDistances2[stackSize++] = farDistance2;
+      }
+    if (nearDistance2 < closest2)
+      {
+      stack[stackSize] = nearChild;
+      stackDistances2[stackSize++] = nearDistance2;
+      }
+    }
+  return segment >= 0 ? sqrt(closest2) : maximumDistance;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerSegmentBVH::FindSegmentsWithinDistance(const double p0[3],
+                                                           const double p1[3],
+                                                           vtkIdType excludedSegment,
+                                                           double distance,
+                                                           std::vector<vtkIdType>& segments,
+                                                           std::vector<double>& distances) const
+{
+  if (this->Nodes.empty() || distance <= 0)
+    {
+    return;
+    }
+
+  double minimum[3];
+  double maximum[3];
+  ResetBounds(minimum, maximum);
+  AddBounds(p0, p0, minimum, maximum);
+  AddBounds(p1, p1, minimum, maximum);
+
+  double distance2 = distance * distance;
+  int stack[StackSize];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (BoxBoxDistance2(node.Minimum, node.Maximum, minimum, maximum) >= distance2)
+      {
+      continue;
+      }
+    if (node.Count > 0)
+      {
+      double distances2[MaximumLeafSize];
+      this->GetLeafDistances2(node, p0, p1, distances2);
+      const vtkIdType* ids = &this->SegmentIds[node.Index * MaximumLeafSize];
+      for (int k = 0; k < node.Count; ++k)
+        {
+        if (distances2[k] < distance2 && ids[k] != excludedSegment)
+          {
+          segments.push_back(ids[k]);
+          distances.push_back(sqrt(distances2[k]));
+          }
+        }
+      continue;
+      }
+    stack[stackSize++] = node.Index;
+    stack[stackSize++] = static_cast<int>(&node - &this->Nodes[0]) + 1;
+    }
+}
@@ -0,0 +1,112 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerSegmentBVH_h
+#define __vtkPathExplorerSegmentBVH_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <vector>
+
+/// \brief Bounding volume hierarchy over segments for proximity queries.
+///
+/// The hierarchy is built top-down by median splits along the largest
+/// extent of the segment centers, and flattened depth-first like
+/// vtkPathExplorerTriangleBVH. Leaves store up to MaximumLeafSize segments
+/// with their coordinates in structure of arrays order (padded with the
+/// first segment of the leaf): the closed form distances from a segment to
+/// all the segments of a leaf are computed by a single loop without
+/// branches over contiguous coordinates, which compilers can vectorize.
+/// Queries don't modify the hierarchy and can run in several threads.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerSegmentBVH
+{
+public:
+  enum
+    {
+    MaximumLeafSize = 4
+    };
+
+  vtkPathExplorerSegmentBVH();
+
+  // Description:
+  // Build the hierarchy over segments going from startPoints to endPoints
+  // (3 coordinates per point). Segments are identified by their index in
+  // these arrays in the query results.
+  void Build(const double* startPoints, const double* endPoints,
+             vtkIdType numberOfSegments);
+  void Initialize();
+
+  vtkIdType GetNumberOfSegments() const;
+  int GetNumberOfNodes() const;
+  int GetDepth() const;
+
+  // Description:
+  // Distance from the segment p0 p1 to the closest segment other than
+  // excludedSegment (-1 to search all the segments). Segments farther than
+  // maximumDistance are not searched: maximumDistance is returned and
+  // segment is -1 if none is closer.
+  double FindClosestSegment(const double p0[3], const double p1[3],
+                            vtkIdType excludedSegment, double maximumDistance,
+                            vtkIdType& segment) const;
+
+  // Description:
+  // Segments other than excludedSegment whose distance to the segment p0 p1
+  // is less than distance: their indices and distances are appended to the
+  // vectors, in no particular order.
+  void FindSegmentsWithinDistance(const double p0[3], const double p1[3],
+                                  vtkIdType excludedSegment, double distance,
+                                  std::vector<vtkIdType>& segments,
+                                  std::vector<double>& distances) const;
+
+protected:
+  struct Node
+    {
+    double Minimum[3];
+    double Maximum[3];
+    // Leaf: index of its block of segments and number of segments.
+    // Interior node: index of the second child, Count is 0.
+    int Index;
+    int Count;
+    int Padding[2];
+    };
+
+  struct BuildSegment;
+  int BuildNode(std::vector<BuildSegment>& segments, int first, int last, int depth);
+
+  // Distances from the segment p0 p1 to the segments of a leaf
+  void GetLeafDistances2(const Node& leaf, const double p0[3], const double p1[3],
+                         double distances2[MaximumLeafSize]) const;
+
+  std::vector<Node> Nodes;
+  // One block per leaf: 6 coordinates (start x y z, end x y z) of
+  // MaximumLeafSize segments, component-major, and the segment indices
+  std::vector<double> Coordinates;
+  std::vector<vtkIdType> SegmentIds;
+  vtkIdType NumberOfSegments;
+  int Depth;
+};
+
+#endif
@@ -0,0 +1,379 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTaskScheduler.h"
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTask::vtkPathExplorerTask()
+{
+  this->Canceled = false;
+  this->Progress = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTask::~vtkPathExplorerTask()
+{
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerTask::IsCanceled()
+{
+  this->Lock.Lock();
+  bool canceled = this->Canceled;
+  this->Lock.Unlock();
+  return canceled;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTask::Cancel()
+{
+  this->Lock.Lock();
+  this->Canceled = true;
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTask::GetProgress()
+{
+  this->Lock.Lock();
+  double progress = this->Progress;
+  this->Lock.Unlock();
+  return progress;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTask::SetProgress(double progress)
+{
+  this->Lock.Lock();
+  this->Progress = std::max(0.0, std::min(1.0, progress));
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTaskScheduler::vtkPathExplorerTaskScheduler()
+{
+  this->NumberOfWorkers = 2;
+  this->Threader = vtkMultiThreader::New();
+  this->Stopping = false;
+  this->NextTaskID = 0;
+  this->FinishedCallback = 0;
+  this->FinishedCallbackData = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTaskScheduler::~vtkPathExplorerTaskScheduler()
+{
+  this->SetTaskFinishedCallback(0, 0);
+  this->CancelAll();
+  this->Lock.Lock();
+  this->Stopping = true;
+  this->TaskQueued.Broadcast();
+  this->Lock.Unlock();
+
+  // Running tasks return early once canceled
+  for (size_t i = 0; i < this->WorkerThreadIDs.size(); ++i)
+    {
+    this->Threader->TerminateThread(this->WorkerThreadIDs[i]);
+    }
+  this->Threader->Delete();
+
+  for (std::map<int, TaskEntry>::iterator it = this->Tasks.begin();
+       it != this->Tasks.end(); ++it)
+    {
+    delete it->second.Task;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::SetNumberOfWorkers(int numberOfWorkers)
+{
+  if (this->WorkerThreadIDs.empty())
+    {
+    this->NumberOfWorkers = std::max(1, numberOfWorkers);
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTaskScheduler::GetNumberOfWorkers()
+{
+  return this->NumberOfWorkers;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::StartWorkers()
+{
+  for (int i = 0; i < this->NumberOfWorkers; ++i)
+    {
+    this->WorkerThreadIDs.push_back(
+      this->Threader->SpawnThread(vtkPathExplorerTaskScheduler::WorkerThread, this));
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTaskScheduler::Submit(vtkPathExplorerTask* task, const char* key)
+{
+  if (!task)
+    {
+    return -1;
+    }
+  if (this->WorkerThreadIDs.empty())
+    {
+    this->StartWorkers();
+    }
+
+  this->Lock.Lock();
+  // Superseded tasks
+  if (key)
+    {
+    for (std::map<int, TaskEntry>::iterator it = this->Tasks.begin();
+         it != this->Tasks.end(); ++it)
+      {
+      if (it->second.Key == key)
+        {
+        this->CancelEntry(it->first, it->second);
+        }
+      }
+    }
+  int taskID = this->NextTaskID++;
+  TaskEntry& entry = this->Tasks[taskID];
+  entry.Task = task;
+  entry.Key = key ? key : "";
+  entry.State = Queued;
+  this->Queue.push_back(taskID);
+  this->TaskQueued.Signal();
+  this->Lock.Unlock();
+  return taskID;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::CancelEntry(int taskID, TaskEntry& entry)
+{
+  entry.Task->Cancel();
+  if (entry.State == Queued)
+    {
+    this->Queue.erase(std::find(this->Queue.begin(), this->Queue.end(), taskID));
+    this->TaskDone(taskID, entry);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::TaskDone(int taskID, TaskEntry& entry)
+{
+  entry.State = Done;
+  this->FinishedTaskIDs.push_back(taskID);
+  this->TaskReturned.Broadcast();
+  if (this->FinishedCallback)
+    {
+    this->FinishedCallback(this->FinishedCallbackData);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::Cancel(int taskID)
+{
+  this->Lock.Lock();
+  std::map<int, TaskEntry>::iterator it = this->Tasks.find(taskID);
+  if (it != this->Tasks.end())
+    {
+    this->CancelEntry(it->first, it->second);
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::Cancel(const char* key)
+{
+  if (!key)
+    {
+    return;
+    }
+  this->Lock.Lock();
+  for (std::map<int, TaskEntry>::iterator it = this->Tasks.begin();
+       it != this->Tasks.end(); ++it)
+    {
+    if (it->second.Key == key)
+      {
+      this->CancelEntry(it->first, it->second);
+      }
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::CancelAll()
+{
+  this->Lock.Lock();
+  for (std::map<int, TaskEntry>::iterator it = this->Tasks.begin();
+       it != this->Tasks.end(); ++it)
+    {
+    this->CancelEntry(it->first, it->second);
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerTaskScheduler::IsPending(int taskID)
+{
+  this->Lock.Lock();
+  bool pending = this->Tasks.count(taskID) != 0;
+  this->Lock.Unlock();
+  return pending;
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTaskScheduler::GetNumberOfPendingTasks()
+{
+  this->Lock.Lock();
+  int numberOfTasks = static_cast<int>(this->Tasks.size());
+  this->Lock.Unlock();
+  return numberOfTasks;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTaskScheduler::GetProgress(int taskID)
+{
+  double progress = -1.0;
+  this->Lock.Lock();
+  std::map<int, TaskEntry>::iterator it = this->Tasks.find(taskID);
+  if (it != this->Tasks.end())
+    {
+    progress = it->second.State == Done ? 1.0 : it->second.Task->GetProgress();
+    }
+  this->Lock.Unlock();
+  return progress;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTaskScheduler::GetProgress()
+{
+  double progress = 0.0;
+  this->Lock.Lock();
+  for (std::map<int, TaskEntry>::iterator it = this->Tasks.begin();
+       it != this->Tasks.end(); ++it)
+    {
+    progress += it->second.State == Done ? 1.0 : it->second.Task->GetProgress();
+    }
+  progress = this->Tasks.empty() ? 1.0 : progress / this->Tasks.size();
+  this->Lock.Unlock();
+  return progress;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::Wait(int taskID)
+{
+  this->Lock.Lock();
+  std::map<int, TaskEntry>::iterator it = this->Tasks.find(taskID);
+  while (it != this->Tasks.end() && it->second.State != Done)
+    {
+    this->TaskReturned.Wait(this->Lock);
+    it = this->Tasks.find(taskID);
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::WaitAll()
+{
+  this->Lock.Lock();
+  while (this->FinishedTaskIDs.size() < this->Tasks.size())
+    {
+    this->TaskReturned.Wait(this->Lock);
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTaskScheduler::ProcessFinishedTasks()
+{
+  std::vector<vtkPathExplorerTask*> tasks;
+  this->Lock.Lock();
+  for (size_t i = 0; i < this->FinishedTaskIDs.size(); ++i)
+    {
+    std::map<int, TaskEntry>::iterator it = this->Tasks.find(this->FinishedTaskIDs[i]);
+    tasks.push_back(it->second.Task);
+    this->Tasks.erase(it);
+    }
+  this->FinishedTaskIDs.clear();
+  this->Lock.Unlock();
+
+  // Finish may submit new tasks
+  for (size_t i = 0; i < tasks.size(); ++i)
+    {
+    tasks[i]->Finish();
+    delete tasks[i];
+    }
+  return static_cast<int>(tasks.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler
+::SetTaskFinishedCallback(TaskFinishedCallback callback, void* clientData)
+{
+  this->Lock.Lock();
+  this->FinishedCallback = callback;
+  this->FinishedCallbackData = clientData;
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTaskScheduler::RunWorker()
+{
+  this->Lock.Lock();
+  for (;;)
+    {
+    while (!this->Stopping && this->Queue.empty())
+      {
+      this->TaskQueued.Wait(this->Lock);
+      }
+    if (this->Stopping)
+      {
+      break;
+      }
+    int taskID = this->Queue.front();
+    this->Queue.pop_front();
+    TaskEntry& entry = this->Tasks[taskID];
+    entry.State = Running;
+    vtkPathExplorerTask* task = entry.Task;
+    this->Lock.Unlock();
+
+    task->Run();
+
+    // Entries are only erased once done: the reference is still valid
+    this->Lock.Lock();
+    this->TaskDone(taskID, entry);
+    }
+  this->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkPathExplorerTaskScheduler::WorkerThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<vtkPathExplorerTaskScheduler*>(info->UserData)->RunWorker();
+  return VTK_THREAD_RETURN_VALUE;
+}
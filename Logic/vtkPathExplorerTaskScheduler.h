@@ -0,0 +1,179 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+
+#ifndef __vtkPathExplorerTaskScheduler_h
+#define __vtkPathExplorerTaskScheduler_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkConditionVariable.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+
+// STD includes
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/// \brief Computation run by a vtkPathExplorerTaskScheduler worker.
+///
+/// Run is called in a worker thread: it must not access MRML, and should
+/// return early once IsCanceled is true. Finish is called in the thread
+/// processing the finished tasks (the main thread), canceled or not.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerTask
+{
+public:
+  vtkPathExplorerTask();
+  virtual ~vtkPathExplorerTask();
+
+  virtual void Run() = 0;
+  virtual void Finish() {}
+
+  // Description:
+  // Cancellation token, set by the scheduler when the task is canceled or
+  // superseded.
+  bool IsCanceled();
+  void Cancel();
+
+  // Description:
+  // Progress in [0, 1], reported by Run.
+  double GetProgress();
+  void SetProgress(double progress);
+
+protected:
+  vtkSimpleMutexLock Lock;
+  bool Canceled;
+  double Progress;
+
+private:
+  vtkPathExplorerTask(const vtkPathExplorerTask&);
+  void operator=(const vtkPathExplorerTask&);
+};
+
+/// \brief Fixed pool of worker threads running vtkPathExplorerTask.
+///
+/// Tasks are queued in submission order and run by the first free worker.
+/// A task submitted with a key supersedes the pending tasks with the same
+/// key: they are canceled. Finished tasks are kept until
+/// ProcessFinishedTasks calls their Finish and deletes them, so that their
+/// results are published in the thread of the caller. The task finished
+/// callback is called by the worker (or by Cancel) each time a task is
+/// ready to be processed: it must only notify the processing thread (e.g.
+/// with a queued Qt signal).
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerTaskScheduler
+{
+public:
+  typedef void (*TaskFinishedCallback)(void* clientData);
+
+  vtkPathExplorerTaskScheduler();
+  // Cancel the tasks and wait for the workers. Tasks not processed yet are
+  // deleted without Finish.
+  ~vtkPathExplorerTaskScheduler();
+
+  // Description:
+  // Number of worker threads, 2 by default. Workers are started by the
+  // first submission: the number can't change afterwards. Tasks parallelize
+  // their own work, workers only keep it off the main thread.
+  void SetNumberOfWorkers(int numberOfWorkers);
+  int GetNumberOfWorkers();
+
+  // Description:
+  // Queue a task, owned by the scheduler from now on. Return the task ID.
+  int Submit(vtkPathExplorerTask* task, const char* key = 0);
+
+  // Description:
+  // Cancel a task (by ID), the tasks with a key, or all the tasks. Queued
+  // tasks are finished at once, running tasks once Run returns.
+  void Cancel(int taskID);
+  void Cancel(const char* key);
+  void CancelAll();
+
+  // Description:
+  // A task is pending until ProcessFinishedTasks finishes it.
+  bool IsPending(int taskID);
+  int GetNumberOfPendingTasks();
+
+  // Description:
+  // Progress of a task, 1 once it is finished and -1 for an unknown ID.
+  // The overall progress is the mean progress of the pending tasks, 1 if
+  // there is none.
+  double GetProgress(int taskID);
+  double GetProgress();
+
+  // Description:
+  // Wait until the task (or all the tasks) returned from Run. Their Finish
+  // is still left to ProcessFinishedTasks.
+  void Wait(int taskID);
+  void WaitAll();
+
+  // Description:
+  // Finish and delete the tasks that returned from Run, in the order they
+  // returned. Return the number of tasks processed.
+  int ProcessFinishedTasks();
+
+  void SetTaskFinishedCallback(TaskFinishedCallback callback, void* clientData);
+
+protected:
+  enum TaskState
+    {
+    Queued,
+    Running,
+    Done
+    };
+  struct TaskEntry
+    {
+    vtkPathExplorerTask* Task;
+    std::string Key;
+    TaskState State;
+    };
+
+  void StartWorkers();
+  void CancelEntry(int taskID, TaskEntry& entry);
+  void TaskDone(int taskID, TaskEntry& entry);
+  void RunWorker();
+  static VTK_THREAD_RETURN_TYPE WorkerThread(void* arg);
+
+  int NumberOfWorkers;
+  vtkMultiThreader* Threader;
+  std::vector<int> WorkerThreadIDs;
+
+  // All the members below are protected by Lock
+  vtkSimpleMutexLock Lock;
+  vtkSimpleConditionVariable TaskQueued;
+  vtkSimpleConditionVariable TaskReturned;
+  bool Stopping;
+  int NextTaskID;
+  std::map<int, TaskEntry> Tasks;
+  std::deque<int> Queue;
+  std::vector<int> FinishedTaskIDs;
+  TaskFinishedCallback FinishedCallback;
+  void* FinishedCallbackData;
+
+private:
+  vtkPathExplorerTaskScheduler(const vtkPathExplorerTaskScheduler&);
+  void operator=(const vtkPathExplorerTaskScheduler&);
+};
+
+#endif
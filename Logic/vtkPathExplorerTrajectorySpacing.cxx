@@ -0,0 +1,165 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTrajectorySpacing.h"
+
+// STD includes
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------
+struct TrajectoryPairLess
+{
+  bool operator()(const vtkPathExplorerTrajectorySpacing::TrajectoryPair& a,
+                  const vtkPathExplorerTrajectorySpacing::TrajectoryPair& b) const
+    {
+    return a.Row1 < b.Row1 || (a.Row1 == b.Row1 && a.Row2 < b.Row2);
+    }
+};
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTrajectorySpacing::vtkPathExplorerTrajectorySpacing()
+  : MinimumSpacing(3.0), EntryPositions(0), TargetPositions(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrajectorySpacing::SetMinimumSpacing(double minimumSpacing)
+{
+  this->MinimumSpacing = minimumSpacing;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTrajectorySpacing::GetMinimumSpacing() const
+{
+  return this->MinimumSpacing;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrajectorySpacing::Build(const double* entryPositions,
+                                             const double* targetPositions,
+                                             int numberOfTrajectories)
+{
+  this->EntryPositions = entryPositions;
+  this->TargetPositions = targetPositions;
+  this->Hierarchy.Build(entryPositions, targetPositions, numberOfTrajectories);
+  this->Spacings.assign(numberOfTrajectories, std::numeric_limits<double>::quiet_NaN());
+  this->ViolationRows.assign(numberOfTrajectories, std::vector<vtkIdType>());
+  this->ViolationDistances.assign(numberOfTrajectories, std::vector<double>());
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTrajectorySpacing::GetNumberOfTrajectories() const
+{
+  return static_cast<int>(this->Spacings.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrajectorySpacing::ComputeTrajectory(int row)
+{
+  const double* entry = this->EntryPositions + 3 * row;
+  const double* target = this->TargetPositions + 3 * row;
+  std::vector<vtkIdType>& rows = this->ViolationRows[row];
+  std::vector<double>& distances = this->ViolationDistances[row];
+  rows.clear();
+  distances.clear();
+  this->Hierarchy.FindSegmentsWithinDistance(entry, target, row, this->MinimumSpacing,
+                                             rows, distances);
+  // The closest trajectory is one of the violations, if any
+  if (!distances.empty())
+    {
+    this->Spacings[row] = *std::min_element(distances.begin(), distances.end());
+    return;
+    }
+  vtkIdType closest = -1;
+  double spacing = this->Hierarchy.FindClosestSegment(
+    entry, target, row, std::numeric_limits<double>::infinity(), closest);
+  this->Spacings[row] = closest >= 0 ? spacing : std::numeric_limits<double>::quiet_NaN();
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTrajectorySpacing::GetSpacing(int row) const
+{
+  return this->Spacings[row];
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrajectorySpacing
+::GetViolations(TrajectoryPairList& violations, std::vector<int>& violationCounts) const
+{
+  int numberOfTrajectories = this->GetNumberOfTrajectories();
+  violations.clear();
+  violationCounts.assign(numberOfTrajectories, 0);
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    for (size_t i = 0; i < this->ViolationRows[row].size(); ++i)
+      {
+      if (this->ViolationRows[row][i] > row)
+        {
+        TrajectoryPair pair;
+        pair.Row1 = row;
+        pair.Row2 = static_cast<int>(this->ViolationRows[row][i]);
+        pair.Distance = this->ViolationDistances[row][i];
+        violations.push_back(pair);
+        ++violationCounts[pair.Row1];
+        ++violationCounts[pair.Row2];
+        }
+      }
+    }
+  std::sort(violations.begin(), violations.end(), TrajectoryPairLess());
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrajectorySpacing
+::WritePairs(std::ostream& os, const TrajectoryPairList& pairs,
+             const std::vector<std::string>& names)
+{
+  int numberOfTrajectories = static_cast<int>(names.size());
+  os << "Trajectory1,Trajectory2,Distance\n";
+  os.precision(std::numeric_limits<double>::digits10);
+  for (TrajectoryPairList::const_iterator pair = pairs.begin(); pair != pairs.end(); ++pair)
+    {
+    if (pair->Row1 < 0 || pair->Row1 >= numberOfTrajectories ||
+        pair->Row2 < 0 || pair->Row2 >= numberOfTrajectories)
+      {
+      continue;
+      }
+    os << QuoteCSVField(names[pair->Row1].c_str()) << ","
+       << QuoteCSVField(names[pair->Row2].c_str()) << ","
+       << pair->Distance << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPathExplorerTrajectorySpacing::QuoteCSVField(const char* value)
+{
+  std::string field("\"");
+  for (const char* c = value; c && *c; ++c)
+    {
+    field += (*c == '"') ? "\"\"" : std::string(1, *c);
+    }
+  return field + "\"";
+}
@@ -0,0 +1,108 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerTrajectorySpacing_h
+#define __vtkPathExplorerTrajectorySpacing_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerSegmentBVH.h"
+
+// STD includes
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// \brief Spacing between the trajectories of a list.
+///
+/// The trajectories are searched in a vtkPathExplorerSegmentBVH: only the
+/// pairs closer than the minimum spacing are computed, not the N^2
+/// distances. Trajectories are computed independently, in any order and
+/// by several threads at once, then the pairs are gathered.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerTrajectorySpacing
+{
+public:
+  // Description:
+  // Two trajectories (rows, Row1 < Row2) and the distance between them.
+  struct TrajectoryPair
+    {
+    int Row1;
+    int Row2;
+    double Distance;
+    };
+  typedef std::vector<TrajectoryPair> TrajectoryPairList;
+
+  vtkPathExplorerTrajectorySpacing();
+
+  // Description:
+  // Minimum distance required between any two trajectories, in mm (3 mm
+  // by default).
+  void SetMinimumSpacing(double minimumSpacing);
+  double GetMinimumSpacing() const;
+
+  // Description:
+  // Build the hierarchy over the trajectories going from entryPositions to
+  // targetPositions (3 coordinates per point), identified by their row.
+  // The positions are read until the rows are computed.
+  void Build(const double* entryPositions, const double* targetPositions,
+             int numberOfTrajectories);
+  int GetNumberOfTrajectories() const;
+
+  // Description:
+  // Compute the distance of a trajectory to the closest other one (NaN if
+  // there is none) and the trajectories closer than the minimum spacing.
+  // Different rows can be computed at the same time.
+  void ComputeTrajectory(int row);
+  double GetSpacing(int row) const;
+
+  // Description:
+  // Once all the rows are computed: the pairs closer than the minimum
+  // spacing, sorted by rows, and the number of pairs of each row. Each
+  // pair is found from both of its trajectories: it is kept from its first
+  // row so that the pairs and the counts agree at the threshold.
+  void GetViolations(TrajectoryPairList& violations,
+                     std::vector<int>& violationCounts) const;
+
+  // Description:
+  // Write pairs in a comma separated file, with the quoted names of the
+  // trajectories (names[row]). Pairs of unknown rows are skipped.
+  static void WritePairs(std::ostream& os, const TrajectoryPairList& pairs,
+                         const std::vector<std::string>& names);
+
+  // Description:
+  // Quoted CSV field (RFC 4180): names may contain commas, quotes or new
+  // lines.
+  static std::string QuoteCSVField(const char* value);
+
+protected:
+  double MinimumSpacing;
+  vtkPathExplorerSegmentBVH Hierarchy;
+  const double* EntryPositions;
+  const double* TargetPositions;
+  std::vector<double> Spacings;
+  // Rows closer than the minimum spacing, and their distances
+  std::vector<std::vector<vtkIdType> > ViolationRows;
+  std::vector<std::vector<double> > ViolationDistances;
+};
+
+#endif
@@ -0,0 +1,914 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTriangleBVH.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Below this depth, nodes are split at the median triangle instead of the
+// best SAH plane, which bounds the depth (and the traversal stacks).
+const int MedianSplitDepth = 56;
+const int StackSize = 96;
+
+//----------------------------------------------------------------------------
+inline double Dot(const double a[3], const double b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+//----------------------------------------------------------------------------
+inline void Cross(const double a[3], const double b[3], double c[3])
+{
+  c[0] = a[1] * b[2] - a[2] * b[1];
+  c[1] = a[2] * b[0] - a[0] * b[2];
+  c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+//----------------------------------------------------------------------------
+inline void Subtract(const double a[3], const double b[3], double c[3])
+{
+  c[0] = a[0] - b[0];
+  c[1] = a[1] - b[1];
+  c[2] = a[2] - b[2];
+}
+
+//----------------------------------------------------------------------------
+inline double Distance2(const double a[3], const double b[3])
+{
+  double d[3];
+  Subtract(a, b, d);
+  return Dot(d, d);
+}
+
+//----------------------------------------------------------------------------
+inline double Clamp(double value, double minimum, double maximum)
+{
+  return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+//----------------------------------------------------------------------------
+double SurfaceArea(const double minimum[3], const double maximum[3])
+{
+  double d[3];
+  Subtract(maximum, minimum, d);
+  if (d[0] < 0 || d[1] < 0 || d[2] < 0)
+    {
+    return 0.0;
+    }
+  return 2.0 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+//----------------------------------------------------------------------------
+void ResetBounds(double minimum[3], double maximum[3])
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < 3; ++i)
+    {
+    minimum[i] = infinity;
+    maximum[i] = -infinity;
+    }
+}
+
+//----------------------------------------------------------------------------
+void AddBounds(const double pointMinimum[3], const double pointMaximum[3],
+               double minimum[3], double maximum[3])
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    minimum[i] = std::min(minimum[i], pointMinimum[i]);
+    maximum[i] = std::max(maximum[i], pointMaximum[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Slab test of the segment origin + t * direction, t in [0, tMaximum],
+// against the box grown by margin on each side.
+bool SegmentHitsBox(const double minimum[3], const double maximum[3],
+                    const double origin[3], const double direction[3],
+                    const double inverseDirection[3], double tMaximum,
+                    double margin)
+{
+  double tEnter = 0.0;
+  double tExit = tMaximum;
+  for (int i = 0; i < 3; ++i)
+    {
+    double lower = minimum[i] - margin;
+    double upper = maximum[i] + margin;
+    if (direction[i] == 0.0)
+      {
+      if (origin[i] < lower || origin[i] > upper)
+        {
+        return false;
+        }
+      continue;
+      }
+    double t0 = (lower - origin[i]) * inverseDirection[i];
+    double t1 = (upper - origin[i]) * inverseDirection[i];
+    if (t0 > t1)
+      {
+      std::swap(t0, t1);
+      }
+    tEnter = std::max(tEnter, t0);
+    tExit = std::min(tExit, t1);
+    if (tEnter > tExit)
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Squared distance from a point to a box, 0 inside.
+double PointBoxDistance2(const double minimum[3], const double maximum[3],
+                         const double p[3])
+{
+  double distance2 = 0.0;
+  for (int i = 0; i < 3; ++i)
+    {
+    double d = std::max(0.0, std::max(minimum[i] - p[i], p[i] - maximum[i]));
+    distance2 += d * d;
+    }
+  return distance2;
+}
+
+//----------------------------------------------------------------------------
+// Squared distance between the segment origin + t * direction, t in [0, 1],
+// and a box. The squared distance to the box along the segment is convex
+// and quadratic between the times the segment crosses the box planes: it
+// is minimized on each of these intervals.
+double SegmentBoxDistance2(const double minimum[3], const double maximum[3],
+                           const double origin[3], const double direction[3],
+                           const double inverseDirection[3])
+{
+  double times[8];
+  int numberOfTimes = 0;
+  times[numberOfTimes++] = 0.0;
+  times[numberOfTimes++] = 1.0;
+  for (int i = 0; i < 3; ++i)
+    {
+    if (direction[i] == 0.0)
+      {
+      continue;
+      }
+    double t0 = (minimum[i] - origin[i]) * inverseDirection[i];
+    double t1 = (maximum[i] - origin[i]) * inverseDirection[i];
+    if (t0 > 0.0 && t0 < 1.0)
+      {
+      times[numberOfTimes++] = t0;
+      }
+    if (t1 > 0.0 && t1 < 1.0)
+      {
+      times[numberOfTimes++] = t1;
+      }
+    }
+  // Insertion sort of at most 8 times
+  for (int i = 1; i < numberOfTimes; ++i)
+    {
+    double time = times[i];
+    int j = i;
+    for (; j > 0 && times[j - 1] > time; --j)
+      {
+      times[j] = times[j - 1];
+      }
+    times[j] = time;
+    }
+
+  double closest2 = std::numeric_limits<double>::infinity();
+  for (int interval = 0; interval + 1 < numberOfTimes; ++interval)
+    {
+    double tBegin = times[interval];
+    double tEnd = times[interval + 1];
+    double tMiddle = 0.5 * (tBegin + tEnd);
+    // Sum over the axes where the segment is outside the box slab of
+    // (offset + t * direction)^2 = a t^2 + 2 b t + c
+    double a = 0.0;
+    double b = 0.0;
+    double c = 0.0;
+    for (int i = 0; i < 3; ++i)
+      {
+      double x = origin[i] + tMiddle * direction[i];
+      double offset;
+      if (x < minimum[i])
+        {
+        offset = origin[i] - minimum[i];
+        }
+      else if (x > maximum[i])
+        {
+        offset = origin[i] - maximum[i];
+        }
+      else
+        {
+        continue;
+        }
+      a += direction[i] * direction[i];
+      b += offset * direction[i];
+      c += offset * offset;
+      }
+    double t = a > 0.0 ? Clamp(-b / a, tBegin, tEnd) : tBegin;
+    closest2 = std::min(closest2, std::max(0.0, (a * t + 2.0 * b) * t + c));
+    if (closest2 == 0.0)
+      {
+      break;
+      }
+    }
+  return closest2;
+}
+
+//----------------------------------------------------------------------------
+// Moller-Trumbore intersection of origin + t * direction, t in
+// [0, tMaximum], with the triangle abc. Segments in the triangle plane
+// don't intersect it.
+bool IntersectTriangle(const double origin[3], const double direction[3],
+                       const double* a, const double* b, const double* c,
+                       double tMaximum, double& t)
+{
+  double edge1[3];
+  double edge2[3];
+  Subtract(b, a, edge1);
+  Subtract(c, a, edge2);
+  double p[3];
+  Cross(direction, edge2, p);
+  double determinant = Dot(edge1, p);
+  if (determinant == 0.0)
+    {
+    return false;
+    }
+  double inverseDeterminant = 1.0 / determinant;
+  double s[3];
+  Subtract(origin, a, s);
+  double u = Dot(s, p) * inverseDeterminant;
+  if (u < 0.0 || u > 1.0)
+    {
+    return false;
+    }
+  double q[3];
+  Cross(s, edge1, q);
+  double v = Dot(direction, q) * inverseDeterminant;
+  if (v < 0.0 || u + v > 1.0)
+    {
+    return false;
+    }
+  double tTriangle = Dot(edge2, q) * inverseDeterminant;
+  if (tTriangle < 0.0 || tTriangle > tMaximum)
+    {
+    return false;
+    }
+  t = tTriangle;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Closest point of the triangle abc to p (Ericson, Real-Time Collision
+// Detection, 5.1.5).
+void ClosestPointOnTriangle(const double p[3], const double* a, const double* b,
+                            const double* c, double closest[3])
+{
+  double ab[3];
+  double ac[3];
+  double ap[3];
+  Subtract(b, a, ab);
+  Subtract(c, a, ac);
+  Subtract(p, a, ap);
+  double d1 = Dot(ab, ap);
+  double d2 = Dot(ac, ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+    {
+    std::copy(a, a + 3, closest);
+    return;
+    }
+
+  double bp[3];
+  Subtract(p, b, bp);
+  double d3 = Dot(ab, bp);
+  double d4 = Dot(ac, bp);
+  if (d3 >= 0.0 && d4 <= d3)
+    {
+    std::copy(b, b + 3, closest);
+    return;
+    }
+
+  double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+    double v = d1 / (d1 - d3);
+    for (int i = 0; i < 3; ++i)
+      {
+      closest[i] = a[i] + v * ab[i];
+      }
+    return;
+    }
+
+  double cp[3];
+  Subtract(p, c, cp);
+  double d5 = Dot(ab, cp);
+  double d6 = Dot(ac, cp);
+  if (d6 >= 0.0 && d5 <= d6)
+    {
+    std::copy(c, c + 3, closest);
+    return;
+    }
+
+  double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+    double w = d2 / (d2 - d6);
+    for (int i = 0; i < 3; ++i)
+      {
+      closest[i] = a[i] + w * ac[i];
+      }
+    return;
+    }
+
+  double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+    double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    for (int i = 0; i < 3; ++i)
+      {
+      closest[i] = b[i] + w * (c[i] - b[i]);
+      }
+    return;
+    }
+
+  double denominator = 1.0 / (va + vb + vc);
+  double v = vb * denominator;
+  double w = vc * denominator;
+  for (int i = 0; i < 3; ++i)
+    {
+    closest[i] = a[i] + ab[i] * v + ac[i] * w;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Squared distance between the segments p1 q1 and p2 q2 (Ericson, 5.1.9).
+double SegmentSegmentDistance2(const double* p1, const double* q1,
+                               const double* p2, const double* q2)
+{
+  double d1[3];
+  double d2[3];
+  double r[3];
+  Subtract(q1, p1, d1);
+  Subtract(q2, p2, d2);
+  Subtract(p1, p2, r);
+  double a = Dot(d1, d1);
+  double e = Dot(d2, d2);
+  double f = Dot(d2, r);
+
+  double s = 0.0;
+  double t = 0.0;
+  if (a == 0.0 && e == 0.0)
+    {
+    return Dot(r, r);
+    }
+  if (a == 0.0)
+    {
+    t = Clamp(f / e, 0.0, 1.0);
+    }
+  else
+    {
+    double c = Dot(d1, r);
+    if (e == 0.0)
+      {
+      s = Clamp(-c / a, 0.0, 1.0);
+      }
+    else
+      {
+      double b = Dot(d1, d2);
+      double denominator = a * e - b * b;
+      s = denominator != 0.0 ? Clamp((b * f - c * e) / denominator, 0.0, 1.0) : 0.0;
+      t = (b * s + f) / e;
+      if (t < 0.0)
+        {
+        t = 0.0;
+        s = Clamp(-c / a, 0.0, 1.0);
+        }
+      else if (t > 1.0)
+        {
+        t = 1.0;
+        s = Clamp((b - c) / a, 0.0, 1.0);
+        }
+      }
+    }
+
+  double c1[3];
+  double c2[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    c1[i] = p1[i] + d1[i] * s;
+    c2[i] = p2[i] + d2[i] * t;
+    }
+  return Distance2(c1, c2);
+}
+
+//----------------------------------------------------------------------------
+// Squared distance between the segment p0 p1 and the triangle abc: 0 if
+// they intersect, else reached at an end of the segment or on an edge.
+double SegmentTriangleDistance2(const double p0[3], const double p1[3],
+                                const double direction[3], const double* triangle)
+{
+  const double* a = triangle;
+  const double* b = triangle + 3;
+  const double* c = triangle + 6;
+  double t;
+  if (IntersectTriangle(p0, direction, a, b, c, 1.0, t))
+    {
+    return 0.0;
+    }
+
+  double closest[3];
+  ClosestPointOnTriangle(p0, a, b, c, closest);
+  double distance2 = Distance2(p0, closest);
+  ClosestPointOnTriangle(p1, a, b, c, closest);
+  distance2 = std::min(distance2, Distance2(p1, closest));
+  distance2 = std::min(distance2, SegmentSegmentDistance2(p0, p1, a, b));
+  distance2 = std::min(distance2, SegmentSegmentDistance2(p0, p1, b, c));
+  distance2 = std::min(distance2, SegmentSegmentDistance2(p0, p1, c, a));
+  return distance2;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+struct vtkPathExplorerTriangleBVH::BuildTriangle
+{
+  double Vertices[9];
+  double Minimum[3];
+  double Maximum[3];
+  double Centroid[3];
+  vtkIdType Id;
+};
+
+//----------------------------------------------------------------------------
+namespace
+{
+struct CentroidLess
+{
+  CentroidLess(int axis) : Axis(axis) {}
+  template <class T>
+  bool operator()(const T& a, const T& b) const
+    {
+    return a.Centroid[this->Axis] < b.Centroid[this->Axis];
+    }
+  int Axis;
+};
+
+struct InBins
+{
+  InBins(int axis, double minimum, double scale, int bins)
+    : Axis(axis), Minimum(minimum), Scale(scale), Bins(bins) {}
+  template <class T>
+  bool operator()(const T& triangle) const
+    {
+    int bin = static_cast<int>((triangle.Centroid[this->Axis] - this->Minimum) * this->Scale);
+    return std::min(bin, vtkPathExplorerTriangleBVH::NumberOfBins - 1) < this->Bins;
+    }
+  int Axis;
+  double Minimum;
+  double Scale;
+  int Bins;
+};
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTriangleBVH::vtkPathExplorerTriangleBVH()
+{
+  this->Depth = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTriangleBVH::Initialize()
+{
+  std::vector<Node>().swap(this->Nodes);
+  std::vector<double>().swap(this->Vertices);
+  std::vector<vtkIdType>().swap(this->TriangleIds);
+  this->Depth = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTriangleBVH::Build(const double* points,
+                                       const vtkIdType* triangles,
+                                       vtkIdType numberOfTriangles)
+{
+  this->Initialize();
+  if (!points || !triangles || numberOfTriangles <= 0)
+    {
+    return;
+    }
+
+  std::vector<BuildTriangle> buildTriangles(numberOfTriangles);
+  for (vtkIdType id = 0; id < numberOfTriangles; ++id)
+    {
+    BuildTriangle& triangle = buildTriangles[id];
+    triangle.Id = id;
+    ResetBounds(triangle.Minimum, triangle.Maximum);
+    for (int vertex = 0; vertex < 3; ++vertex)
+      {
+      const double* point = points + 3 * triangles[3 * id + vertex];
+      std::copy(point, point + 3, triangle.Vertices + 3 * vertex);
+      AddBounds(point, point, triangle.Minimum, triangle.Maximum);
+      }
+    for (int i = 0; i < 3; ++i)
+      {
+      triangle.Centroid[i] = 0.5 * (triangle.Minimum[i] + triangle.Maximum[i]);
+      }
+    }
+
+  // About 2 n / MaximumLeafSize nodes
+  this->Nodes.reserve(2 * numberOfTriangles / MaximumLeafSize + 1);
+  this->Vertices.reserve(9 * numberOfTriangles);
+  this->TriangleIds.reserve(numberOfTriangles);
+  this->BuildNode(buildTriangles, 0, static_cast<int>(numberOfTriangles), 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTriangleBVH::BuildNode(std::vector<BuildTriangle>& triangles,
+                                          int first, int last, int depth)
+{
+  int nodeIndex = static_cast<int>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+  this->Depth = std::max(this->Depth, depth + 1);
+
+  double minimum[3];
+  double maximum[3];
+  double centroidMinimum[3];
+  double centroidMaximum[3];
+  ResetBounds(minimum, maximum);
+  ResetBounds(centroidMinimum, centroidMaximum);
+  for (int i = first; i < last; ++i)
+    {
+    AddBounds(triangles[i].Minimum, triangles[i].Maximum, minimum, maximum);
+    AddBounds(triangles[i].Centroid, triangles[i].Centroid,
+              centroidMinimum, centroidMaximum);
+    }
+  std::copy(minimum, minimum + 3, this->Nodes[nodeIndex].Minimum);
+  std::copy(maximum, maximum + 3, this->Nodes[nodeIndex].Maximum);
+
+  int count = last - first;
+  if (count <= MaximumLeafSize)
+    {
+    Node& leaf = this->Nodes[nodeIndex];
+    leaf.Index = static_cast<int>(this->TriangleIds.size());
+    leaf.Count = count;
+    leaf.Axis = 0;
+    leaf.Padding = 0;
+    for (int i = first; i < last; ++i)
+      {
+      this->Vertices.insert(this->Vertices.end(),
+                            triangles[i].Vertices, triangles[i].Vertices + 9);
+      this->TriangleIds.push_back(triangles[i].Id);
+      }
+    return nodeIndex;
+    }
+
+  int splitAxis = 0;
+  for (int i = 1; i < 3; ++i)
+    {
+    if (centroidMaximum[i] - centroidMinimum[i] >
+        centroidMaximum[splitAxis] - centroidMinimum[splitAxis])
+      {
+      splitAxis = i;
+      }
+    }
+
+  // Binned SAH: cost of a split is the sum over the children of their
+  // number of triangles weighted by their surface area
+  int middle = first;
+  if (depth < MedianSplitDepth)
+    {
+    double bestCost = std::numeric_limits<double>::infinity();
+    int bestAxis = -1;
+    int bestBins = 0;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      double extent = centroidMaximum[axis] - centroidMinimum[axis];
+      if (extent <= 0.0)
+        {
+        continue;
+        }
+      double scale = NumberOfBins / extent;
+      int binCounts[NumberOfBins];
+      double binMinimum[NumberOfBins][3];
+      double binMaximum[NumberOfBins][3];
+      for (int bin = 0; bin < NumberOfBins; ++bin)
+        {
+        binCounts[bin] = 0;
+        ResetBounds(binMinimum[bin], binMaximum[bin]);
+        }
+      for (int i = first; i < last; ++i)
+        {
+        int bin = std::min(NumberOfBins - 1, static_cast<int>(
+          (triangles[i].Centroid[axis] - centroidMinimum[axis]) * scale));
+        ++binCounts[bin];
+        AddBounds(triangles[i].Minimum, triangles[i].Maximum,
+                  binMinimum[bin], binMaximum[bin]);
+        }
+
+      // Right side costs, then sweep from the left
+      double rightCosts[NumberOfBins];
+      double sweepMinimum[3];
+      double sweepMaximum[3];
+      ResetBounds(sweepMinimum, sweepMaximum);
+      int sweepCount = 0;
+      for (int bin = NumberOfBins - 1; bin > 0; --bin)
+        {
+        AddBounds(binMinimum[bin], binMaximum[bin], sweepMinimum, sweepMaximum);
+        sweepCount += binCounts[bin];
+        rightCosts[bin] = sweepCount * SurfaceArea(sweepMinimum, sweepMaximum);
+        }
+      ResetBounds(sweepMinimum, sweepMaximum);
+      sweepCount = 0;
+      for (int bin = 0; bin < NumberOfBins - 1; ++bin)
+        {
+        AddBounds(binMinimum[bin], binMaximum[bin], sweepMinimum, sweepMaximum);
+        sweepCount += binCounts[bin];
+        if (sweepCount == 0 || sweepCount == count)
+          {
+          continue;
+          }
+        double cost = sweepCount * SurfaceArea(sweepMinimum, sweepMaximum) +
+                      rightCosts[bin + 1];
+        if (cost < bestCost)
+          {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBins = bin + 1;
+          }
+        }
+      }
+
+    if (bestAxis >= 0)
+      {
+      splitAxis = bestAxis;
+      double scale = NumberOfBins / (centroidMaximum[bestAxis] - centroidMinimum[bestAxis]);
+      middle = static_cast<int>(
+        std::partition(triangles.begin() + first, triangles.begin() + last,
+                       InBins(bestAxis, centroidMinimum[bestAxis], scale, bestBins)) -
+        triangles.begin());
+      }
+    }
+
+  // Deep nodes, identical centroids: split in two halves
+  if (middle <= first || middle >= last)
+    {
+    middle = first + count / 2;
+    std::nth_element(triangles.begin() + first, triangles.begin() + middle,
+                     triangles.begin() + last, CentroidLess(splitAxis));
+    }
+
+  // First child follows its parent
+  this->BuildNode(triangles, first, middle, depth + 1);
+  int secondChild = this->BuildNode(triangles, middle, last, depth + 1);
+  Node& node = this->Nodes[nodeIndex];
+  node.Index = secondChild;
+  node.Count = 0;
+  node.Axis = splitAxis;
+  node.Padding = 0;
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkPathExplorerTriangleBVH::GetNumberOfTriangles() const
+{
+  return static_cast<vtkIdType>(this->TriangleIds.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTriangleBVH::GetNumberOfNodes() const
+{
+  return static_cast<int>(this->Nodes.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTriangleBVH::GetDepth() const
+{
+  return this->Depth;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerTriangleBVH::GetBounds(double bounds[6]) const
+{
+  if (this->Nodes.empty())
+    {
+    return false;
+    }
+  for (int i = 0; i < 3; ++i)
+    {
+    bounds[2 * i] = this->Nodes[0].Minimum[i];
+    bounds[2 * i + 1] = this->Nodes[0].Maximum[i];
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathExplorerTriangleBVH::IntersectSegment(const double p0[3], const double p1[3],
+                                                  double& t, vtkIdType& triangle) const
+{
+  if (this->Nodes.empty())
+    {
+    return false;
+    }
+
+  double direction[3];
+  double inverseDirection[3];
+  Subtract(p1, p0, direction);
+  for (int i = 0; i < 3; ++i)
+    {
+    inverseDirection[i] = direction[i] != 0.0 ? 1.0 / direction[i] : 0.0;
+    }
+
+  // Nodes are visited front to back, the segment is shortened at each hit
+  double tClosest = 1.0;
+  bool found = false;
+  int stack[StackSize];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (!SegmentHitsBox(node.Minimum, node.Maximum, p0, direction,
+                        inverseDirection, tClosest, 0.0))
+      {
+      continue;
+      }
+    if (node.Count > 0)
+      {
+      for (int i = node.Index; i < node.Index + node.Count; ++i)
+        {
+        const double* vertices = &this->Vertices[9 * i];
+        double tTriangle;
+        if (IntersectTriangle(p0, direction, vertices, vertices + 3, vertices + 6,
+                              tClosest, tTriangle))
+          {
+          tClosest = tTriangle;
+          triangle = this->TriangleIds[i];
+          found = true;
+          }
+        }
+      continue;
+      }
+
+    int nearChild = static_cast<int>(&node - &this->Nodes[0]) + 1;
+    int farChild = node.Index;
+    if (direction[node.Axis] < 0)
+      {
+      std::swap(nearChild, farChild);
+      }
+    stack[stackSize++] = farChild;
+    stack[stackSize++] = nearChild;
+    }
+
+  if (found)
+    {
+    t = tClosest;
+    }
+  return found;
+}
+
+//----------------------------------------------------------------------------
+double vtkPathExplorerTriangleBVH::GetSegmentDistance(const double p0[3], const double p1[3],
+                                                      double maximumDistance,
+                                                      vtkIdType& triangle) const
+{
+  triangle = -1;
+  if (this->Nodes.empty())
+    {
+    return maximumDistance;
+    }
+
+  double direction[3];
+  double inverseDirection[3];
+  Subtract(p1, p0, direction);
+  for (int i = 0; i < 3; ++i)
+    {
+    inverseDirection[i] = direction[i] != 0.0 ? 1.0 / direction[i] : 0.0;
+    }
+
+  // Nodes are visited closest first, and skipped when their box is farther
+  // from the segment than the closest triangle so far
+  double closest2 = maximumDistance * maximumDistance;
+  int stack[StackSize];
+  double stackDistances2[StackSize];
+  int stackSize = 0;
+  stack[stackSize] = 0;
+  stackDistances2[stackSize++] = SegmentBoxDistance2(
+    this->Nodes[0].Minimum, this->Nodes[0].Maximum, p0, direction, inverseDirection);
+  while (stackSize > 0)
+    {
+    --stackSize;
+    if (stackDistances2[stackSize] >= closest2)
+      {
+      continue;
+      }
+    const Node& node = this->Nodes[stack[stackSize]];
+    if (node.Count > 0)
+      {
+      for (int i = node.Index; i < node.Index + node.Count; ++i)
+        {
+        double distance2 = SegmentTriangleDistance2(p0, p1, direction, &this->Vertices[9 * i]);
+        if (distance2 < closest2)
+          {
+          closest2 = distance2;
+          triangle = this->TriangleIds[i];
+          if (closest2 == 0.0)
+            {
+            return 0.0;
+            }
+          }
+        }
+      continue;
+      }
+
+    int nearChild = static_cast<int>(&node - &this->Nodes[0]) + 1;
+    int farChild = node.Index;
+    double nearDistance2 = SegmentBoxDistance2(
+      this->Nodes[nearChild].Minimum, this->Nodes[nearChild].Maximum,
+      p0, direction, inverseDirection);
+    double farDistance2 = SegmentBoxDistance2(
+      this->Nodes[farChild].Minimum, this->Nodes[farChild].Maximum,
+      p0, direction, inverseDirection);
+    if (farDistance2 < nearDistance2)
+      {
+      std::swap(nearChild, farChild);
+      std::swap(nearDistance2, farDistance2);
+      }
+    if (farDistance2 < closest2)
+      {
+      stack[stackSize] = farChild;
+      stackDistances2[stackSize++] = farDistance2;
+      }
+    if (nearDistance2 < closest2)
+      {
+      stack[stackSize] = nearChild;
+      stackDistances2[stackSize++] = nearDistance2;
+      }
+    }
+  return triangle >= 0 ? sqrt(closest2) : maximumDistance;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTriangleBVH::FindTrianglesInSphere(const double center[3], double radius,
+                                                       std::vector<double>& vertices,
+                                                       std::vector<vtkIdType>& triangles) const
+{
+  if (this->Nodes.empty() || radius < 0)
+    {
+    return;
+    }
+
+  double radius2 = radius * radius;
+  int stack[StackSize];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+    {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (PointBoxDistance2(node.Minimum, node.Maximum, center) > radius2)
+      {
+      continue;
+      }
+    if (node.Count > 0)
+      {
+      for (int i = node.Index; i < node.Index + node.Count; ++i)
+        {
+        const double* triangle = &this->Vertices[9 * i];
+        double closest[3];
+        ClosestPointOnTriangle(center, triangle, triangle + 3, triangle + 6, closest);
+        if (Distance2(center, closest) <= radius2)
+          {
+          vertices.insert(vertices.end(), triangle, triangle + 9);
+          triangles.push_back(this->TriangleIds[i]);
+          }
+        }
+      continue;
+      }
+    stack[stackSize++] = node.Index;
+    stack[stackSize++] = static_cast<int>(&node - &this->Nodes[0]) + 1;
+    }
+}
@@ -0,0 +1,116 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerTriangleBVH_h
+#define __vtkPathExplorerTriangleBVH_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <vector>
+
+/// \brief Bounding volume hierarchy over triangles for segment queries.
+///
+/// The hierarchy is built top-down with the surface area heuristic (SAH,
+/// evaluated on binned centroids) and flattened depth-first in an array of
+/// 64 byte nodes: the first child of a node follows it, the node stores the
+/// index of its second child. Triangle vertices are copied in leaf order so
+/// that a leaf reads contiguous memory.
+/// Queries don't modify the hierarchy and can run in several threads.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerTriangleBVH
+{
+public:
+  enum
+    {
+    MaximumLeafSize = 4,
+    NumberOfBins = 16
+    };
+
+  vtkPathExplorerTriangleBVH();
+
+  // Description:
+  // Build the hierarchy over triangles given by the indices of their 3
+  // points (3 coordinates per point). Triangles are identified by their
+  // index in this array in the query results.
+  void Build(const double* points, const vtkIdType* triangles,
+             vtkIdType numberOfTriangles);
+  void Initialize();
+
+  vtkIdType GetNumberOfTriangles() const;
+  int GetNumberOfNodes() const;
+  int GetDepth() const;
+
+  // Description:
+  // Bounds of the triangles (xmin, xmax, ymin, ymax, zmin, zmax).
+  // Return false if there is no triangle.
+  bool GetBounds(double bounds[6]) const;
+
+  // Description:
+  // First intersection of the segment from p0 to p1 with the triangles:
+  // t is the position of the intersection along the segment (0 at p0, 1 at
+  // p1). Return false if the segment doesn't cross any triangle.
+  bool IntersectSegment(const double p0[3], const double p1[3],
+                        double& t, vtkIdType& triangle) const;
+
+  // Description:
+  // Distance from the segment p0 p1 to the closest triangle, 0 if the
+  // segment crosses a triangle. Triangles farther than maximumDistance are
+  // not searched: maximumDistance is returned and triangle is -1 if none is
+  // closer.
+  double GetSegmentDistance(const double p0[3], const double p1[3],
+                            double maximumDistance, vtkIdType& triangle) const;
+
+  // Description:
+  // Triangles closer than radius to center: their vertices (9 coordinates
+  // per triangle) and their indices are appended to the vectors.
+  void FindTrianglesInSphere(const double center[3], double radius,
+                             std::vector<double>& vertices,
+                             std::vector<vtkIdType>& triangles) const;
+
+protected:
+  struct Node
+    {
+    double Minimum[3];
+    double Maximum[3];
+    // Leaf: first triangle (in leaf order) and number of triangles.
+    // Interior node: index of the second child, Count is 0.
+    int Index;
+    int Count;
+    // Interior node: axis along which the children were split
+    int Axis;
+    int Padding;
+    };
+
+  struct BuildTriangle;
+  int BuildNode(std::vector<BuildTriangle>& triangles, int first, int last, int depth);
+
+  std::vector<Node> Nodes;
+  // 9 coordinates per triangle, in leaf order, and the triangle indices
+  std::vector<double> Vertices;
+  std::vector<vtkIdType> TriangleIds;
+  int Depth;
+};
+
+#endif
@@ -0,0 +1,513 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTrilinearInterpolation.h"
+
+// VTK includes
+#include <vtkSetGet.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// x86 SIMD kernels are compiled with per-function target attributes, so the
+// module runs on any CPU and only uses what the CPU supports.
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define PATHEXPLORER_X86_SIMD
+# define PATHEXPLORER_TARGET(isa) __attribute__((target(isa)))
+# include <cpuid.h>
+# include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1800 && (defined(_M_X64) || defined(_M_IX86))
+# define PATHEXPLORER_X86_SIMD
+# define PATHEXPLORER_TARGET(isa)
+# include <intrin.h>
+# include <immintrin.h>
+#endif
+
+namespace
+{
+const int BlockSize = vtkPathExplorerTrilinearInterpolation::BlockSize;
+
+//----------------------------------------------------------------------------
+int DetectInstructionSet()
+{
+  int instructionSet = vtkPathExplorerTrilinearInterpolation::Scalar;
+#ifdef PATHEXPLORER_X86_SIMD
+  unsigned int regs1[4] = { 0, 0, 0, 0 };
+  unsigned int regs7[4] = { 0, 0, 0, 0 };
+  unsigned int maxLeaf = 0;
+  unsigned long long xcr0 = 0;
+# if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  maxLeaf = info[0];
+  __cpuid(info, 1);
+  regs1[2] = info[2];
+  if (maxLeaf >= 7)
+    {
+    __cpuidex(info, 7, 0);
+    regs7[1] = info[1];
+    }
+  if (regs1[2] & (1u << 27))
+    {
+    xcr0 = _xgetbv(0);
+    }
+# else
+  maxLeaf = __get_cpuid_max(0, 0);
+  if (maxLeaf >= 1)
+    {
+    __cpuid(1, regs1[0], regs1[1], regs1[2], regs1[3]);
+    }
+  if (maxLeaf >= 7)
+    {
+    __cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+    }
+  if (regs1[2] & (1u << 27))
+    {
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+    }
+# endif
+  if (regs1[2] & (1u << 19))
+    {
+    instructionSet = vtkPathExplorerTrilinearInterpolation::SSE41;
+    }
+  // AVX2 also needs the OS to save the YMM registers
+  bool osSavesYMM = (regs1[2] & (1u << 27)) && (xcr0 & 6) == 6;
+  if (osSavesYMM && (regs1[2] & (1u << 28)) && (regs7[1] & (1u << 5)))
+    {
+    instructionSet = vtkPathExplorerTrilinearInterpolation::AVX2;
+    }
+#endif
+  return instructionSet;
+}
+
+const int SupportedInstructionSet = DetectInstructionSet();
+int CurrentInstructionSet = SupportedInstructionSet;
+
+//----------------------------------------------------------------------------
+// Block of points being interpolated. Corners are indexed by
+// dx + 2 * dy + 4 * dz, lanes by point.
+struct Block
+{
+  double X[BlockSize];
+  double Y[BlockSize];
+  double Z[BlockSize];
+  double I[BlockSize];
+  double J[BlockSize];
+  double K[BlockSize];
+  double FX[BlockSize];
+  double FY[BlockSize];
+  double FZ[BlockSize];
+  double Inside[BlockSize];
+  double Corners[8][BlockSize];
+  double Values[BlockSize];
+};
+
+//----------------------------------------------------------------------------
+// Cell, weights and inside test of the points (NaN coordinates are outside).
+// Blend the corners with the weights. Operation order is the same in all
+// instruction sets so the results are identical.
+struct ScalarPolicy
+{
+  static void Prepare(Block& b, const double max[3])
+    {
+    for (int p = 0; p < BlockSize; ++p)
+      {
+      bool inside = b.X[p] >= 0 && b.Y[p] >= 0 && b.Z[p] >= 0 &&
+        b.X[p] <= max[0] && b.Y[p] <= max[1] && b.Z[p] <= max[2];
+      b.Inside[p] = inside ? 1.0 : 0.0;
+      b.I[p] = inside ? floor(b.X[p]) : 0.0;
+      b.J[p] = inside ? floor(b.Y[p]) : 0.0;
+      b.K[p] = inside ? floor(b.Z[p]) : 0.0;
+      b.FX[p] = b.X[p] - b.I[p];
+      b.FY[p] = b.Y[p] - b.J[p];
+      b.FZ[p] = b.Z[p] - b.K[p];
+      }
+    }
+
+  static void Blend(Block& b)
+    {
+    for (int p = 0; p < BlockSize; ++p)
+      {
+      const double fx = b.FX[p];
+      double v00 = b.Corners[0][p] + fx * (b.Corners[1][p] - b.Corners[0][p]);
+      double v10 = b.Corners[2][p] + fx * (b.Corners[3][p] - b.Corners[2][p]);
+      double v01 = b.Corners[4][p] + fx * (b.Corners[5][p] - b.Corners[4][p]);
+      double v11 = b.Corners[6][p] + fx * (b.Corners[7][p] - b.Corners[6][p]);
+      double v0 = v00 + b.FY[p] * (v10 - v00);
+      double v1 = v01 + b.FY[p] * (v11 - v01);
+      b.Values[p] = v0 + b.FZ[p] * (v1 - v0);
+      }
+    }
+};
+
+#ifdef PATHEXPLORER_X86_SIMD
+//----------------------------------------------------------------------------
+struct SSE41Policy
+{
+  PATHEXPLORER_TARGET("sse4.1")
+  static void Prepare(Block& b, const double max[3])
+    {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d maxX = _mm_set1_pd(max[0]);
+    const __m128d maxY = _mm_set1_pd(max[1]);
+    const __m128d maxZ = _mm_set1_pd(max[2]);
+    for (int p = 0; p < BlockSize; p += 2)
+      {
+      __m128d x = _mm_loadu_pd(b.X + p);
+      __m128d y = _mm_loadu_pd(b.Y + p);
+      __m128d z = _mm_loadu_pd(b.Z + p);
+      __m128d inside = _mm_and_pd(
+        _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(x, zero), _mm_cmpge_pd(y, zero)),
+                   _mm_and_pd(_mm_cmpge_pd(z, zero), _mm_cmple_pd(x, maxX))),
+        _mm_and_pd(_mm_cmple_pd(y, maxY), _mm_cmple_pd(z, maxZ)));
+      __m128d i = _mm_and_pd(_mm_floor_pd(x), inside);
+      __m128d j = _mm_and_pd(_mm_floor_pd(y), inside);
+      __m128d k = _mm_and_pd(_mm_floor_pd(z), inside);
+      _mm_storeu_pd(b.Inside + p, _mm_and_pd(inside, one));
+      _mm_storeu_pd(b.I + p, i);
+      _mm_storeu_pd(b.J + p, j);
+      _mm_storeu_pd(b.K + p, k);
+      _mm_storeu_pd(b.FX + p, _mm_sub_pd(x, i));
+      _mm_storeu_pd(b.FY + p, _mm_sub_pd(y, j));
+      _mm_storeu_pd(b.FZ + p, _mm_sub_pd(z, k));
+      }
+    }
+
+  PATHEXPLORER_TARGET("sse4.1")
+  static __m128d Lerp(__m128d a, __m128d b, __m128d f)
+    {
+    return _mm_add_pd(a, _mm_mul_pd(f, _mm_sub_pd(b, a)));
+    }
+
+  PATHEXPLORER_TARGET("sse4.1")
+  static void Blend(Block& b)
+    {
+    for (int p = 0; p < BlockSize; p += 2)
+      {
+      __m128d fx = _mm_loadu_pd(b.FX + p);
+      __m128d fy = _mm_loadu_pd(b.FY + p);
+      __m128d fz = _mm_loadu_pd(b.FZ + p);
+      __m128d v00 = Lerp(_mm_loadu_pd(b.Corners[0] + p), _mm_loadu_pd(b.Corners[1] + p), fx);
+      __m128d v10 = Lerp(_mm_loadu_pd(b.Corners[2] + p), _mm_loadu_pd(b.Corners[3] + p), fx);
+      __m128d v01 = Lerp(_mm_loadu_pd(b.Corners[4] + p), _mm_loadu_pd(b.Corners[5] + p), fx);
+      __m128d v11 = Lerp(_mm_loadu_pd(b.Corners[6] + p), _mm_loadu_pd(b.Corners[7] + p), fx);
+      _mm_storeu_pd(b.Values + p, Lerp(Lerp(v00, v10, fy), Lerp(v01, v11, fy), fz));
+      }
+    }
+};
+
+//----------------------------------------------------------------------------
+struct AVX2Policy
+{
+  PATHEXPLORER_TARGET("avx2")
+  static void Prepare(Block& b, const double max[3])
+    {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d maxX = _mm256_set1_pd(max[0]);
+    const __m256d maxY = _mm256_set1_pd(max[1]);
+    const __m256d maxZ = _mm256_set1_pd(max[2]);
+    for (int p = 0; p < BlockSize; p += 4)
+      {
+      __m256d x = _mm256_loadu_pd(b.X + p);
+      __m256d y = _mm256_loadu_pd(b.Y + p);
+      __m256d z = _mm256_loadu_pd(b.Z + p);
+      __m256d inside = _mm256_and_pd(
+        _mm256_and_pd(
+          _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GE_OQ), _mm256_cmp_pd(y, zero, _CMP_GE_OQ)),
+          _mm256_and_pd(_mm256_cmp_pd(z, zero, _CMP_GE_OQ), _mm256_cmp_pd(x, maxX, _CMP_LE_OQ))),
+        _mm256_and_pd(_mm256_cmp_pd(y, maxY, _CMP_LE_OQ), _mm256_cmp_pd(z, maxZ, _CMP_LE_OQ)));
+      __m256d i = _mm256_and_pd(_mm256_floor_pd(x), inside);
+      __m256d j = _mm256_and_pd(_mm256_floor_pd(y), inside);
+      __m256d k = _mm256_and_pd(_mm256_floor_pd(z), inside);
+      _mm256_storeu_pd(b.Inside + p, _mm256_and_pd(inside, one));
+      _mm256_storeu_pd(b.I + p, i);
+      _mm256_storeu_pd(b.J + p, j);
+      _mm256_storeu_pd(b.K + p, k);
+      _mm256_storeu_pd(b.FX + p, _mm256_sub_pd(x, i));
+      _mm256_storeu_pd(b.FY + p, _mm256_sub_pd(y, j));
+      _mm256_storeu_pd(b.FZ + p, _mm256_sub_pd(z, k));
+      }
+    }
+
+  PATHEXPLORER_TARGET("avx2")
+  static __m256d Lerp(__m256d a, __m256d b, __m256d f)
+    {
+    return _mm256_add_pd(a, _mm256_mul_pd(f, _mm256_sub_pd(b, a)));
+    }
+
+  PATHEXPLORER_TARGET("avx2")
+  static void Blend(Block& b)
+    {
+    for (int p = 0; p < BlockSize; p += 4)
+      {
+      __m256d fx = _mm256_loadu_pd(b.FX + p);
+      __m256d fy = _mm256_loadu_pd(b.FY + p);
+      __m256d fz = _mm256_loadu_pd(b.FZ + p);
+      __m256d v00 = Lerp(_mm256_loadu_pd(b.Corners[0] + p), _mm256_loadu_pd(b.Corners[1] + p), fx);
+      __m256d v10 = Lerp(_mm256_loadu_pd(b.Corners[2] + p), _mm256_loadu_pd(b.Corners[3] + p), fx);
+      __m256d v01 = Lerp(_mm256_loadu_pd(b.Corners[4] + p), _mm256_loadu_pd(b.Corners[5] + p), fx);
+      __m256d v11 = Lerp(_mm256_loadu_pd(b.Corners[6] + p), _mm256_loadu_pd(b.Corners[7] + p), fx);
+      _mm256_storeu_pd(b.Values + p, Lerp(Lerp(v00, v10, fy), Lerp(v01, v11, fy), fz));
+      }
+    }
+};
+#endif
+
+//----------------------------------------------------------------------------
+// Read the 8 corners of the cells of the points inside the volume.
+// On the last voxel of an axis, the neighbor is the voxel itself.
+template <class T>
+void GatherCorners(const vtkPathExplorerTrilinearInterpolation::Volume& volume,
+                   Block& b, int count)
+{
+  const T* scalars = static_cast<const T*>(volume.Scalars);
+  const vtkIdType* increments = volume.Increments;
+  for (int p = 0; p < count; ++p)
+    {
+    if (b.Inside[p] == 0.0)
+      {
+      for (int c = 0; c < 8; ++c)
+        {
+        b.Corners[c][p] = 0.0;
+        }
+      continue;
+      }
+    int i0 = static_cast<int>(b.I[p]);
+    int j0 = static_cast<int>(b.J[p]);
+    int k0 = static_cast<int>(b.K[p]);
+    vtkIdType di = i0 + 1 < volume.Dimensions[0] ? increments[0] : 0;
+    vtkIdType dj = j0 + 1 < volume.Dimensions[1] ? increments[1] : 0;
+    vtkIdType dk = k0 + 1 < volume.Dimensions[2] ? increments[2] : 0;
+    const T* v = scalars + i0 * increments[0] + j0 * increments[1] + k0 * increments[2];
+    b.Corners[0][p] = static_cast<double>(v[0]);
+    b.Corners[1][p] = static_cast<double>(v[di]);
+    b.Corners[2][p] = static_cast<double>(v[dj]);
+    b.Corners[3][p] = static_cast<double>(v[di + dj]);
+    b.Corners[4][p] = static_cast<double>(v[dk]);
+    b.Corners[5][p] = static_cast<double>(v[di + dk]);
+    b.Corners[6][p] = static_cast<double>(v[dj + dk]);
+    b.Corners[7][p] = static_cast<double>(v[di + dj + dk]);
+    }
+  for (int p = count; p < BlockSize; ++p)
+    {
+    for (int c = 0; c < 8; ++c)
+      {
+      b.Corners[c][p] = 0.0;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Coordinates of the points of a block
+struct LinePoints
+{
+  const double* Start;
+  const double* Step;
+  void Get(int first, int count, Block& b) const
+    {
+    for (int p = 0; p < count; ++p)
+      {
+      double k = first + p;
+      b.X[p] = this->Start[0] + k * this->Step[0];
+      b.Y[p] = this->Start[1] + k * this->Step[1];
+      b.Z[p] = this->Start[2] + k * this->Step[2];
+      }
+    }
+};
+
+struct ArrayPoints
+{
+  const double* Points;
+  void Get(int first, int count, Block& b) const
+    {
+    const double* point = this->Points + 3 * first;
+    for (int p = 0; p < count; ++p, point += 3)
+      {
+      b.X[p] = point[0];
+      b.Y[p] = point[1];
+      b.Z[p] = point[2];
+      }
+    }
+};
+
+//----------------------------------------------------------------------------
+template <class T, class Policy, class Points>
+void Interpolate(const vtkPathExplorerTrilinearInterpolation::Volume& volume,
+                 const Points& points, int numberOfPoints, double* values, int stride)
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double max[3] = { volume.Dimensions[0] - 1.0,
+                          volume.Dimensions[1] - 1.0,
+                          volume.Dimensions[2] - 1.0 };
+  Block b;
+  for (int first = 0; first < numberOfPoints; first += BlockSize)
+    {
+    int count = std::min(static_cast<int>(BlockSize), numberOfPoints - first);
+    // Unused lanes are outside
+    for (int p = count; p < BlockSize; ++p)
+      {
+      b.X[p] = b.Y[p] = b.Z[p] = -1.0;
+      }
+    points.Get(first, count, b);
+    Policy::Prepare(b, max);
+    GatherCorners<T>(volume, b, count);
+    Policy::Blend(b);
+    for (int p = 0; p < count; ++p, values += stride)
+      {
+      *values = b.Inside[p] != 0.0 ? b.Values[p] : nan;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T, class Policy>
+void InterpolateLineKernel(const vtkPathExplorerTrilinearInterpolation::Volume& volume,
+                           const double start[3], const double step[3],
+                           int numberOfPoints, double* values, int stride)
+{
+  LinePoints points;
+  points.Start = start;
+  points.Step = step;
+  Interpolate<T, Policy>(volume, points, numberOfPoints, values, stride);
+}
+
+//----------------------------------------------------------------------------
+template <class T, class Points>
+void InterpolateWithInstructionSet(const vtkPathExplorerTrilinearInterpolation::Volume& volume,
+                                   const Points& points, int numberOfPoints,
+                                   double* values, int stride)
+{
+  switch (CurrentInstructionSet)
+    {
+#ifdef PATHEXPLORER_X86_SIMD
+    case vtkPathExplorerTrilinearInterpolation::AVX2:
+      Interpolate<T, AVX2Policy>(volume, points, numberOfPoints, values, stride);
+      break;
+    case vtkPathExplorerTrilinearInterpolation::SSE41:
+      Interpolate<T, SSE41Policy>(volume, points, numberOfPoints, values, stride);
+      break;
+#endif
+    default:
+      Interpolate<T, ScalarPolicy>(volume, points, numberOfPoints, values, stride);
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+vtkPathExplorerTrilinearInterpolation::LineKernel SelectLineKernel(T*)
+{
+  switch (CurrentInstructionSet)
+    {
+#ifdef PATHEXPLORER_X86_SIMD
+    case vtkPathExplorerTrilinearInterpolation::AVX2:
+      return &InterpolateLineKernel<T, AVX2Policy>;
+    case vtkPathExplorerTrilinearInterpolation::SSE41:
+      return &InterpolateLineKernel<T, SSE41Policy>;
+#endif
+    default:
+      return &InterpolateLineKernel<T, ScalarPolicy>;
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTrilinearInterpolation::GetSupportedInstructionSet()
+{
+  return SupportedInstructionSet;
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTrilinearInterpolation::GetInstructionSet()
+{
+  return CurrentInstructionSet;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrilinearInterpolation::SetMaximumInstructionSet(int instructionSet)
+{
+  CurrentInstructionSet =
+    std::max(static_cast<int>(Scalar), std::min(instructionSet, SupportedInstructionSet));
+}
+
+//----------------------------------------------------------------------------
+const char* vtkPathExplorerTrilinearInterpolation::GetInstructionSetName(int instructionSet)
+{
+  switch (instructionSet)
+    {
+    case AVX2:
+      return "AVX2";
+    case SSE41:
+      return "SSE4.1";
+    default:
+      return "Scalar";
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkPathExplorerTrilinearInterpolation::LineKernel
+vtkPathExplorerTrilinearInterpolation::GetLineKernel(int scalarType)
+{
+  switch (scalarType)
+    {
+    vtkTemplateMacro(return SelectLineKernel(static_cast<VTK_TT*>(0)));
+    default:
+      return 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrilinearInterpolation
+::InterpolateLine(const Volume& volume, const double start[3], const double step[3],
+                  int numberOfPoints, double* values, int stride)
+{
+  LineKernel kernel = GetLineKernel(volume.ScalarType);
+  if (kernel)
+    {
+    kernel(volume, start, step, numberOfPoints, values, stride);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkPathExplorerTrilinearInterpolation
+::InterpolatePoints(const Volume& volume, const double* points,
+                    int numberOfPoints, double* values)
+{
+  ArrayPoints arrayPoints;
+  arrayPoints.Points = points;
+  switch (volume.ScalarType)
+    {
+    vtkTemplateMacro(
+      InterpolateWithInstructionSet<VTK_TT>(volume, arrayPoints, numberOfPoints, values, 1));
+    default:
+      break;
+    }
+}
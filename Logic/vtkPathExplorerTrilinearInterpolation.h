@@ -0,0 +1,97 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerTrilinearInterpolation_h
+#define __vtkPathExplorerTrilinearInterpolation_h
+
+#include "vtkSlicerPathExplorerModuleLogicExport.h"
+
+// VTK includes
+#include <vtkType.h>
+
+/// \brief Trilinear interpolation kernels sampling volumes along trajectories.
+///
+/// Points are interpolated by blocks of BlockSize: cell coordinates and
+/// weights are computed and blended with AVX2 or SSE4.1 when the CPU
+/// supports them, and the voxels are read by a kernel specialized for the
+/// scalar type. The instruction set is detected once per process, the
+/// kernel is selected once per volume with GetLineKernel.
+/// All instruction sets give the same results.
+class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkPathExplorerTrilinearInterpolation
+{
+public:
+  enum
+    {
+    BlockSize = 8
+    };
+
+  enum InstructionSet
+    {
+    Scalar = 0,
+    SSE41,
+    AVX2
+    };
+
+  // Description:
+  // Best instruction set supported by the CPU and the compiler, and the
+  // one used by the kernels. SetMaximumInstructionSet limits the latter
+  // (e.g. to compare the kernels); kernels already selected are not changed.
+  static int GetSupportedInstructionSet();
+  static int GetInstructionSet();
+  static void SetMaximumInstructionSet(int instructionSet);
+  static const char* GetInstructionSetName(int instructionSet);
+
+  // Description:
+  // Scalars of the volume to interpolate. Only the first component is
+  // interpolated; increments are in scalars.
+  struct Volume
+    {
+    const void* Scalars;
+    int ScalarType;
+    int Dimensions[3];
+    vtkIdType Increments[3];
+    };
+
+  // Description:
+  // Interpolate the volume at start + k * step (IJK coordinates) for k in
+  // [0, numberOfPoints). Values are written every stride doubles and are
+  // NaN outside the volume.
+  typedef void (*LineKernel)(const Volume& volume,
+                             const double start[3], const double step[3],
+                             int numberOfPoints, double* values, int stride);
+
+  // Description:
+  // Kernel for a scalar type with the current instruction set,
+  // NULL if the type is not supported.
+  static LineKernel GetLineKernel(int scalarType);
+
+  // Description:
+  // Interpolate along a line or at arbitrary points (3 IJK coordinates per
+  // point). The kernel is selected at each call.
+  static void InterpolateLine(const Volume& volume,
+                              const double start[3], const double step[3],
+                              int numberOfPoints, double* values, int stride);
+  static void InterpolatePoints(const Volume& volume, const double* points,
+                                int numberOfPoints, double* values);
+};
+
+#endif
@@ -20,45 +20,3595 @@
  
 ==============================================================================*/
 
+#include "vtkSlicerVersionConfigure.h"
+
 // PathExplorer Logic includes
+#include "vtkPathExplorerEntrySearch.h"
+#include "vtkPathExplorerRobustnessAnalysis.h"
+#include "vtkPathExplorerTaskScheduler.h"
+#include "vtkPathExplorerTrajectorySpacing.h"
+#include "vtkPathExplorerTrilinearInterpolation.h"
 #include "vtkSlicerPathExplorerLogic.h"
 
-// MRML includes
-#include "vtkMRMLPathPlannerTrajectoryNode.h"
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include "vtkMRMLPathPlannerTrajectoryStorageNode.h"
+#include <vtkMRMLAnnotationFiducialNode.h>
+#if !(Slicer_VERSION_MAJOR == 4 && Slicer_VERSION_MINOR <= 4)
+#include <vtkMRMLLabelMapVolumeNode.h>
+#endif
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
+#include <vtkMRMLTransformableNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkCollection.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Volume prepared for sampling: RAS to IJK matrix (including the parent
+// transform), scalars and interpolation kernel for their type.
+struct SamplingVolume
+{
+  double RASToIJK[3][4];
+  vtkPathExplorerTrilinearInterpolation::Volume Data;
+  vtkPathExplorerTrilinearInterpolation::LineKernel Kernel;
+};
+
+//----------------------------------------------------------------------------
+// Work split in items processed independently by RunParallelJob.
+// Items are handed out to the threads by chunks of ChunkSize items.
+// A job run by a scheduler task stops handing out chunks once the task is
+// canceled, and reports its progress from ProgressStart to ProgressEnd.
+struct ParallelJob
+{
+  ParallelJob() : NumberOfItems(0), ChunkSize(1), Task(0), ProgressStart(0.0),
+                  ProgressEnd(1.0), NextItem(0), ProcessedItems(0) {}
+  virtual ~ParallelJob() {}
+  virtual void ProcessItem(int item) = 0;
+
+  int NumberOfItems;
+  int ChunkSize;
+  vtkPathExplorerTask* Task;
+  double ProgressStart;
+  double ProgressEnd;
+  // First item of the next chunk and number of items processed, protected
+  // by Lock
+  int NextItem;
+  int ProcessedItems;
+  vtkSimpleMutexLock Lock;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ParallelJobThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ParallelJob* job = static_cast<ParallelJob*>(info->UserData);
+
+  for (;;)
+    {
+    job->Lock.Lock();
+    int firstItem = job->NextItem;
+    job->NextItem += job->ChunkSize;
+    job->Lock.Unlock();
+
+    if (firstItem >= job->NumberOfItems || (job->Task && job->Task->IsCanceled()))
+      {
+      break;
+      }
+    int lastItem = std::min(firstItem + job->ChunkSize, job->NumberOfItems);
+    for (int item = firstItem; item < lastItem; ++item)
+      {
+      job->ProcessItem(item);
+      }
+    if (job->Task)
+      {
+      job->Lock.Lock();
+      job->ProcessedItems += lastItem - firstItem;
+      job->Task->SetProgress(job->ProgressStart + (job->ProgressEnd - job->ProgressStart) *
+                             job->ProcessedItems / job->NumberOfItems);
+      job->Lock.Unlock();
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Threads pull chunks of items until all are processed.
+// numberOfThreads <= 0 uses the vtkMultiThreader default.
+void RunParallelJob(ParallelJob& job, int numberOfThreads)
+{
+  job.NextItem = 0;
+  job.ProcessedItems = 0;
+  vtkNew<vtkMultiThreader> threader;
+  if (numberOfThreads > 0)
+    {
+    threader->SetNumberOfThreads(numberOfThreads);
+    }
+  threader->SetSingleMethod(ParallelJobThread, &job);
+  threader->SingleMethodExecute();
+}
+
+//----------------------------------------------------------------------------
+// Work done independently on each trajectory (row) of a list.
+// Trajectories are handed out to the threads by chunks of this many rows.
+const int TrajectoryChunkSize = 64;
+
+struct TrajectoryJob : public ParallelJob
+{
+  TrajectoryJob() : EntryPositions(0), TargetPositions(0)
+    {
+    this->ChunkSize = TrajectoryChunkSize;
+    }
+  virtual void ProcessItem(int row) { this->ProcessTrajectory(row); }
+  virtual void ProcessTrajectory(int row) = 0;
+
+  const double* EntryPositions;
+  const double* TargetPositions;
+};
+
+struct SamplingJob : public TrajectoryJob
+{
+  virtual void ProcessTrajectory(int row);
+
+  double Step;
+  std::vector<SamplingVolume> Volumes;
+  // One profile per row, NumberOfSamples x Volumes.size() values
+  std::vector<std::vector<double> > Profiles;
+};
+
+//----------------------------------------------------------------------------
+void SetVolumeData(SamplingVolume& volume, const void* scalars, int scalarType,
+                   const int dimensions[3], int numberOfComponents)
+{
+  vtkPathExplorerTrilinearInterpolation::Volume& data = volume.Data;
+  for (int i = 0; i < 3; ++i)
+    {
+    data.Dimensions[i] = dimensions[i];
+    }
+  data.Increments[0] = numberOfComponents;
+  data.Increments[1] = data.Increments[0] * data.Dimensions[0];
+  data.Increments[2] = data.Increments[1] * data.Dimensions[1];
+  data.ScalarType = scalarType;
+  data.Scalars = scalars;
+  volume.Kernel = vtkPathExplorerTrilinearInterpolation::GetLineKernel(scalarType);
+}
+
+//----------------------------------------------------------------------------
+bool PrepareSamplingVolume(vtkMRMLVolumeNode* volumeNode, SamplingVolume& volume)
+{
+  vtkImageData* image = volumeNode ? volumeNode->GetImageData() : 0;
+  if (!image || !image->GetScalarPointer())
+    {
+    return false;
+    }
+
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+  vtkMRMLTransformNode* transformNode = volumeNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    if (!transformNode->IsTransformToWorldLinear())
+      {
+      return false;
+      }
+    vtkNew<vtkMatrix4x4> worldToRAS;
+    transformNode->GetMatrixTransformToWorld(worldToRAS.GetPointer());
+    worldToRAS->Invert();
+    vtkMatrix4x4::Multiply4x4(rasToIJK.GetPointer(), worldToRAS.GetPointer(),
+                              rasToIJK.GetPointer());
+    }
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 4; ++j)
+      {
+      volume.RASToIJK[i][j] = rasToIJK->GetElement(i, j);
+      }
+    }
+
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  SetVolumeData(volume, image->GetScalarPointer(), image->GetScalarType(),
+                dimensions, image->GetNumberOfScalarComponents());
+  return volume.Kernel != 0;
+}
+
+//----------------------------------------------------------------------------
+// Number of samples every stepLength mm from entry to target, and first
+// sample and step between samples in the IJK space of the volume (samples
+// are evenly spaced in IJK as well).
+int GetSamplingLine(const double entry[3], const double target[3],
+                    double stepLength, const SamplingVolume& volume,
+                    double start[3], double step[3])
+{
+  double direction[3] =
+    { target[0] - entry[0], target[1] - entry[1], target[2] - entry[2] };
+  double length = sqrt(direction[0] * direction[0] +
+                       direction[1] * direction[1] +
+                       direction[2] * direction[2]);
+  double stepRAS[3] = { 0.0, 0.0, 0.0 };
+  if (length > 0)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      stepRAS[i] = direction[i] * stepLength / length;
+      }
+    }
+
+  for (int i = 0; i < 3; ++i)
+    {
+    const double* m = volume.RASToIJK[i];
+    start[i] = m[0] * entry[0] + m[1] * entry[1] + m[2] * entry[2] + m[3];
+    step[i] = m[0] * stepRAS[0] + m[1] * stepRAS[1] + m[2] * stepRAS[2];
+    }
+  return static_cast<int>(floor(length / stepLength)) + 1;
+}
+
+//----------------------------------------------------------------------------
+void SamplingJob::ProcessTrajectory(int row)
+{
+  const double* entry = this->EntryPositions + 3 * row;
+  const double* target = this->TargetPositions + 3 * row;
+  int numberOfVolumes = static_cast<int>(this->Volumes.size());
+  std::vector<double>& profile = this->Profiles[row];
+  for (int v = 0; v < numberOfVolumes; ++v)
+    {
+    const SamplingVolume& volume = this->Volumes[v];
+    double start[3];
+    double step[3];
+    int numberOfSamples =
+      GetSamplingLine(entry, target, this->Step, volume, start, step);
+    profile.resize(numberOfSamples * numberOfVolumes);
+    volume.Kernel(volume.Data, start, step, numberOfSamples,
+                  &profile[v], numberOfVolumes);
+    }
+}
+
+//----------------------------------------------------------------------------
+struct LabelJob : public TrajectoryJob
+{
+  virtual void ProcessTrajectory(int row);
+
+  SamplingVolume LabelMap;
+  std::vector<vtkSlicerPathExplorerLogic::LabelIntervalList>* Intervals;
+};
+
+//----------------------------------------------------------------------------
+void AddLabelInterval(vtkSlicerPathExplorerLogic::LabelIntervalList& intervals,
+                      int label, double enter, double exit)
+{
+  if (!intervals.empty() &&
+      intervals.back().Label == label && intervals.back().Exit == enter)
+    {
+    intervals.back().Exit = exit;
+    return;
+    }
+  vtkSlicerPathExplorerLogic::LabelInterval interval;
+  interval.Label = label;
+  interval.Enter = enter;
+  interval.Exit = exit;
+  intervals.push_back(interval);
+}
+
+//----------------------------------------------------------------------------
+// Amanatides-Woo traversal of the voxels crossed by the segment from start
+// to end (IJK), voxel i covering [i - 0.5, i + 0.5]. t goes from 0 at start
+// to 1 at end, length is the segment length in mm.
+template <class T>
+void TraverseLabels(const vtkPathExplorerTrilinearInterpolation::Volume& volume,
+                    const double start[3], const double end[3], double length,
+                    vtkSlicerPathExplorerLogic::LabelIntervalList& intervals)
+{
+  const T* scalars = static_cast<const T*>(volume.Scalars);
+  const double infinity = std::numeric_limits<double>::infinity();
+  double direction[3] =
+    { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+
+  // Clip the segment to the volume
+  double tEnter = 0.0;
+  double tExit = 1.0;
+  for (int i = 0; i < 3; ++i)
+    {
+    double lower = -0.5;
+    double upper = volume.Dimensions[i] - 0.5;
+    if (direction[i] == 0.0)
+      {
+      if (start[i] < lower || start[i] >= upper)
+        {
+        return;
+        }
+      continue;
+      }
+    double t0 = (lower - start[i]) / direction[i];
+    double t1 = (upper - start[i]) / direction[i];
+    tEnter = std::max(tEnter, std::min(t0, t1));
+    tExit = std::min(tExit, std::max(t0, t1));
+    }
+  if (tEnter > tExit || (tEnter == tExit && length > 0))
+    {
+    return;
+    }
+
+  int voxel[3];
+  int step[3];
+  double tMax[3];
+  double tDelta[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    double position = start[i] + tEnter * direction[i];
+    voxel[i] = std::max(0, std::min(volume.Dimensions[i] - 1,
+                                    static_cast<int>(floor(position + 0.5))));
+    if (direction[i] > 0)
+      {
+      step[i] = 1;
+      tMax[i] = (voxel[i] + 0.5 - start[i]) / direction[i];
+      tDelta[i] = 1.0 / direction[i];
+      }
+    else if (direction[i] < 0)
+      {
+      step[i] = -1;
+      tMax[i] = (voxel[i] - 0.5 - start[i]) / direction[i];
+      tDelta[i] = -1.0 / direction[i];
+      }
+    else
+      {
+      step[i] = 0;
+      tMax[i] = infinity;
+      tDelta[i] = infinity;
+      }
+    }
+
+  double t = tEnter;
+  for (;;)
+    {
+    int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2)
+                                 : (tMax[1] < tMax[2] ? 1 : 2);
+    double tNext = std::min(tMax[axis], tExit);
+    int label = static_cast<int>(scalars[voxel[0] * volume.Increments[0] +
+                                         voxel[1] * volume.Increments[1] +
+                                         voxel[2] * volume.Increments[2]]);
+    // Voxels only touched on an edge or a corner are skipped
+    if (label != 0 && (tNext > t || length == 0))
+      {
+      AddLabelInterval(intervals, label, t * length, tNext * length);
+      }
+    if (tMax[axis] >= tExit)
+      {
+      break;
+      }
+
+    t = tNext;
+    voxel[axis] += step[axis];
+    if (voxel[axis] < 0 || voxel[axis] >= volume.Dimensions[axis])
+      {
+      break;
+      }
+    tMax[axis] += tDelta[axis];
+    }
+}
+
+//----------------------------------------------------------------------------
+// Labels crossed from entry to target
+void TraverseTrajectoryLabels(const SamplingVolume& labelMap,
+                              const double entry[3], const double target[3],
+                              vtkSlicerPathExplorerLogic::LabelIntervalList& intervals)
+{
+  double length = sqrt(vtkMath::Distance2BetweenPoints(entry, target));
+
+  double start[3];
+  double end[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    const double* m = labelMap.RASToIJK[i];
+    start[i] = m[0] * entry[0] + m[1] * entry[1] + m[2] * entry[2] + m[3];
+    end[i] = m[0] * target[0] + m[1] * target[1] + m[2] * target[2] + m[3];
+    }
+
+  intervals.clear();
+  const vtkPathExplorerTrilinearInterpolation::Volume& volume = labelMap.Data;
+  switch (volume.ScalarType)
+    {
+    vtkTemplateMacro(
+      TraverseLabels<VTK_TT>(volume, start, end, length, intervals));
+    default:
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+void LabelJob::ProcessTrajectory(int row)
+{
+  TraverseTrajectoryLabels(this->LabelMap, this->EntryPositions + 3 * row,
+                           this->TargetPositions + 3 * row, (*this->Intervals)[row]);
+}
+
+//----------------------------------------------------------------------------
+// Name of the metric storing the clearance of the trajectories
+const char* const ClearanceMetricName = "Clearance";
+
+// Names of the metrics storing the robustness of the trajectories, the hit
+// probability of a label is stored in HitProbabilityMetricPrefix<label>
+const char* const CollisionProbabilityMetricName = "CollisionProbability";
+const char* const RobustClearanceMetricName = "RobustClearance";
+const char* const HitProbabilityMetricPrefix = "HitProbability_";
+
+// Names of the metrics storing the distance of the trajectories to the
+// closest one and their number of neighbors closer than the minimum spacing
+const char* const SpacingMetricName = "Spacing";
+const char* const SpacingViolationsMetricName = "SpacingViolations";
+
+// Scheduler key of the tracked metric updates
+const char* const MetricUpdateKey = "Metrics";
+
+// Scheduler key of the robustness analyses of a list:
+// RobustnessAnalysisKeyPrefix<list node ID>
+const char* const RobustnessAnalysisKeyPrefix = "Robustness ";
+
+//----------------------------------------------------------------------------
+// Squared distance of the voxels that are not seeds, before the transform.
+// Large but finite so that the parabola intersections stay defined.
+const double FarDistance2 = 1e30;
+
+//----------------------------------------------------------------------------
+// One dimensional squared Euclidean distance transform (Felzenszwalb and
+// Huttenlocher), in linear time: lower envelope of the parabolas rooted at
+// each sample. Samples are spacing mm apart and stride values apart in data.
+// f, v and z are scratch buffers of n, n and n + 1 elements.
+void DistanceTransformLine(float* data, vtkIdType stride, int n, double spacing,
+                           std::vector<double>& f, std::vector<int>& v,
+                           std::vector<double>& z)
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  for (int q = 0; q < n; ++q)
+    {
+    f[q] = data[q * stride];
+    }
+
+  // Parabolas of the envelope (v) and their ranges [z[k], z[k + 1]]
+  int k = 0;
+  v[0] = 0;
+  z[0] = -infinity;
+  z[1] = infinity;
+  for (int q = 1; q < n; ++q)
+    {
+    double position = q * spacing;
+    double intersection;
+    for (;;)
+      {
+      double root = v[k] * spacing;
+      intersection = ((f[q] + position * position) - (f[v[k]] + root * root)) /
+                     (2.0 * (position - root));
+      if (intersection > z[k])
+        {
+        break;
+        }
+      --k;
+      }
+    ++k;
+    v[k] = q;
+    z[k] = intersection;
+    z[k + 1] = infinity;
+    }
+
+  k = 0;
+  for (int q = 0; q < n; ++q)
+    {
+    double position = q * spacing;
+    while (z[k + 1] < position)
+      {
+      ++k;
+      }
+    double distance = position - v[k] * spacing;
+    data[q * stride] = static_cast<float>(distance * distance + f[v[k]]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Seeds of a slice: 0 on labeled voxels (or background voxels if inside),
+// FarDistance2 elsewhere.
+template <class T>
+void InitializeDistanceSlice(const vtkPathExplorerTrilinearInterpolation::Volume& labels,
+                             int k, bool inside, float* slice)
+{
+  const T* scalars = static_cast<const T*>(labels.Scalars) + k * labels.Increments[2];
+  vtkIdType numberOfVoxels =
+    static_cast<vtkIdType>(labels.Dimensions[0]) * labels.Dimensions[1];
+  for (vtkIdType voxel = 0; voxel < numberOfVoxels; ++voxel)
+    {
+    bool labeled = scalars[voxel * labels.Increments[0]] != 0;
+    slice[voxel] = labeled != inside ? 0.0f : static_cast<float>(FarDistance2);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Separable squared distance transform of a label map: the X and Y passes
+// are done slice by slice, then the Z pass row by row. SignPass combines
+// the distances outside (Distances) and inside (InsideDistances) the
+// labeled voxels into the signed distance, slice by slice.
+struct DistanceMapJob : public ParallelJob
+{
+  enum Pass
+    {
+    SlicePass,
+    ColumnPass,
+    SignPass
+    };
+  virtual void ProcessItem(int item);
+
+  vtkPathExplorerTrilinearInterpolation::Volume Labels;
+  double Spacing[3];
+  Pass CurrentPass;
+  bool Inside;
+  float* Distances;
+  const float* InsideDistances;
+};
+
+//----------------------------------------------------------------------------
+void DistanceMapJob::ProcessItem(int item)
+{
+  const int* dimensions = this->Labels.Dimensions;
+  vtkIdType sliceSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+  int n = std::max(dimensions[0], std::max(dimensions[1], dimensions[2]));
+  std::vector<double> f(n);
+  std::vector<int> v(n);
+  std::vector<double> z(n + 1);
+
+  switch (this->CurrentPass)
+    {
+    case SlicePass:
+      {
+      float* slice = this->Distances + item * sliceSize;
+      switch (this->Labels.ScalarType)
+        {
+        vtkTemplateMacro(
+          InitializeDistanceSlice<VTK_TT>(this->Labels, item, this->Inside, slice));
+        default:
+          break;
+        }
+      for (int j = 0; j < dimensions[1]; ++j)
+        {
+        DistanceTransformLine(slice + j * dimensions[0], 1, dimensions[0],
+                              this->Spacing[0], f, v, z);
+        }
+      for (int i = 0; i < dimensions[0]; ++i)
+        {
+        DistanceTransformLine(slice + i, dimensions[0], dimensions[1],
+                              this->Spacing[1], f, v, z);
+        }
+      break;
+      }
+    case ColumnPass:
+      {
+      float* row = this->Distances + item * dimensions[0];
+      for (int i = 0; i < dimensions[0]; ++i)
+        {
+        DistanceTransformLine(row + i, sliceSize, dimensions[2],
+                              this->Spacing[2], f, v, z);
+        }
+      break;
+      }
+    case SignPass:
+      {
+      float* distances = this->Distances + item * sliceSize;
+      const float* insideDistances = this->InsideDistances + item * sliceSize;
+      for (vtkIdType voxel = 0; voxel < sliceSize; ++voxel)
+        {
+        distances[voxel] = sqrt(distances[voxel]) - sqrt(insideDistances[voxel]);
+        }
+      break;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Signed Euclidean distance map of a label map, in mm, between voxel
+// centers. Return false if there is no labeled or no background voxel.
+bool ComputeSignedDistanceMap(const vtkPathExplorerTrilinearInterpolation::Volume& labels,
+                              const double spacing[3], int numberOfThreads,
+                              std::vector<float>& distances)
+{
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(labels.Dimensions[0]) *
+    labels.Dimensions[1] * labels.Dimensions[2];
+  if (numberOfVoxels == 0)
+    {
+    return false;
+    }
+  distances.resize(numberOfVoxels);
+  std::vector<float> insideDistances(numberOfVoxels);
+
+  DistanceMapJob job;
+  job.Labels = labels;
+  for (int i = 0; i < 3; ++i)
+    {
+    job.Spacing[i] = spacing[i];
+    }
+  for (int inside = 0; inside < 2; ++inside)
+    {
+    job.Inside = inside != 0;
+    job.Distances = inside ? &insideDistances[0] : &distances[0];
+    job.CurrentPass = DistanceMapJob::SlicePass;
+    job.NumberOfItems = labels.Dimensions[2];
+    RunParallelJob(job, numberOfThreads);
+    job.CurrentPass = DistanceMapJob::ColumnPass;
+    job.NumberOfItems = labels.Dimensions[1];
+    RunParallelJob(job, numberOfThreads);
+
+    // Without any seed, no distance is finite
+    if (job.Distances[0] >= FarDistance2)
+      {
+      return false;
+      }
+    }
+
+  job.CurrentPass = DistanceMapJob::SignPass;
+  job.Distances = &distances[0];
+  job.InsideDistances = &insideDistances[0];
+  job.NumberOfItems = labels.Dimensions[2];
+  RunParallelJob(job, numberOfThreads);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+struct ClearanceJob : public TrajectoryJob
+{
+  virtual void ProcessTrajectory(int row);
+
+  double Step;
+  SamplingVolume DistanceMap;
+  std::vector<double> Clearances;
+};
+
+//----------------------------------------------------------------------------
+// Minimum of the distance map sampled every step mm from entry to target.
+// Samples outside the label map are NaN and ignored, inside is set to
+// whether there is none.
+double SampleClearance(const SamplingVolume& distanceMap, const double entry[3],
+                       const double target[3], double step, bool* inside = 0)
+{
+  double start[3];
+  double stepIJK[3];
+  int numberOfSamples =
+    GetSamplingLine(entry, target, step, distanceMap, start, stepIJK);
+  std::vector<double> samples(numberOfSamples);
+  distanceMap.Kernel(distanceMap.Data, start, stepIJK, numberOfSamples, &samples[0], 1);
+
+  double clearance = std::numeric_limits<double>::quiet_NaN();
+  bool allInside = true;
+  for (int sample = 0; sample < numberOfSamples; ++sample)
+    {
+    if (samples[sample] < clearance || vtkMath::IsNan(clearance))
+      {
+      clearance = samples[sample];
+      }
+    allInside = allInside && !vtkMath::IsNan(samples[sample]);
+    }
+  if (inside)
+    {
+    *inside = allInside;
+    }
+  return clearance;
+}
+
+//----------------------------------------------------------------------------
+void ClearanceJob::ProcessTrajectory(int row)
+{
+  this->Clearances[row] =
+    SampleClearance(this->DistanceMap, this->EntryPositions + 3 * row,
+                    this->TargetPositions + 3 * row, this->Step);
+}
+
+//----------------------------------------------------------------------------
+// Triangles of the polygons (fan triangulation) or triangle strips of cells
+void AddCellTriangles(vtkCellArray* cells, bool strips,
+                      std::vector<vtkIdType>& triangles)
+{
+  if (!cells)
+    {
+    return;
+    }
+  vtkIdType numberOfPoints;
+  vtkIdType* points;
+  cells->InitTraversal();
+  while (cells->GetNextCell(numberOfPoints, points))
+    {
+    for (vtkIdType i = 0; i + 2 < numberOfPoints; ++i)
+      {
+      triangles.push_back(strips ? points[i] : points[0]);
+      triangles.push_back(points[i + 1]);
+      triangles.push_back(points[i + 2]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+struct ModelQueryJob : public TrajectoryJob
+{
+  virtual void ProcessTrajectory(int row);
+
+  // First intersection or closest distance
+  bool Intersection;
+  std::vector<const vtkPathExplorerTriangleBVH*> Hierarchies;
+  std::vector<double>* Results;
+};
+
+//----------------------------------------------------------------------------
+void ModelQueryJob::ProcessTrajectory(int row)
+{
+  const double* entry = this->EntryPositions + 3 * row;
+  const double* target = this->TargetPositions + 3 * row;
+  size_t numberOfHierarchies = this->Hierarchies.size();
+  vtkIdType triangle;
+
+  if (!this->Intersection)
+    {
+    // Models farther than the closest one so far are not searched
+    double distance = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < numberOfHierarchies; ++i)
+      {
+      distance = this->Hierarchies[i]->GetSegmentDistance(entry, target, distance, triangle);
+      }
+    (*this->Results)[row] = distance;
+    return;
+    }
+
+  double tFirst = 1.0;
+  bool found = false;
+  for (size_t i = 0; i < numberOfHierarchies; ++i)
+    {
+    double t;
+    if (this->Hierarchies[i]->IntersectSegment(entry, target, t, triangle) && t <= tFirst)
+      {
+      tFirst = t;
+      found = true;
+      }
+    }
+  (*this->Results)[row] = found ?
+    tFirst * sqrt(vtkMath::Distance2BetweenPoints(entry, target)) :
+    std::numeric_limits<double>::quiet_NaN();
+}
+
+//----------------------------------------------------------------------------
+// Candidates of the entry point search: the geometry is checked by the
+// search, the labels crossed and the clearance from the label map are added
+// to the cost.
+struct EntrySearchJob : public ParallelJob
+{
+  EntrySearchJob() : Search(0), UseLabelMap(false)
+    {
+    this->ChunkSize = TrajectoryChunkSize;
+    }
+  virtual void ProcessItem(int candidate);
+
+  const vtkPathExplorerEntrySearch* Search;
+  double Step;
+  bool UseLabelMap;
+  SamplingVolume LabelMap;
+  SamplingVolume DistanceMap;
+  // One per candidate, rejected candidates have a NaN cost
+  vtkSlicerPathExplorerLogic::EntryPointList EntryPoints;
+};
+
+//----------------------------------------------------------------------------
+void EntrySearchJob::ProcessItem(int candidate)
+{
+  vtkSlicerPathExplorerLogic::EntryPoint& entryPoint = this->EntryPoints[candidate];
+  if (!this->Search->EvaluateCandidate(candidate, entryPoint))
+    {
+    return;
+    }
+  if (this->UseLabelMap)
+    {
+    const double* target = this->Search->GetTarget();
+    vtkSlicerPathExplorerLogic::LabelIntervalList intervals;
+    TraverseTrajectoryLabels(this->LabelMap, entryPoint.Position, target, intervals);
+    entryPoint.NumberOfCrossedLabels = static_cast<int>(intervals.size());
+    entryPoint.Clearance =
+      SampleClearance(this->DistanceMap, entryPoint.Position, target, this->Step);
+    }
+  this->Search->ComputeCost(entryPoint);
+}
+
+//----------------------------------------------------------------------------
+struct RobustnessJob : public TrajectoryJob
+{
+  RobustnessJob() : UIDs(0), Analysis(0)
+    {
+    // Each trajectory is perturbed many times: rows are handed out one by one
+    this->ChunkSize = 1;
+    }
+  virtual void ProcessTrajectory(int row);
+
+  const int* UIDs;
+  const vtkPathExplorerRobustnessAnalysis* Analysis;
+  double Step;
+  // Clearance above which a trajectory can't cross a label
+  double CrossingClearance;
+  SamplingVolume LabelMap;
+  SamplingVolume DistanceMap;
+  vtkSlicerPathExplorerLogic::TrajectoryRobustnessList Results;
+};
+
+//----------------------------------------------------------------------------
+void RobustnessJob::ProcessTrajectory(int row)
+{
+  const double* entry = this->EntryPositions + 3 * row;
+  const double* target = this->TargetPositions + 3 * row;
+  unsigned int stream = static_cast<unsigned int>(this->UIDs[row]);
+  vtkPathExplorerRobustnessAnalysis::Statistics statistics;
+  vtkSlicerPathExplorerLogic::LabelIntervalList intervals;
+  std::vector<int> labels;
+
+  int numberOfSamples = this->Analysis->GetNumberOfSamples();
+  for (int sample = 0; sample < numberOfSamples; ++sample)
+    {
+    double perturbedEntry[3];
+    double perturbedTarget[3];
+    this->Analysis->GetPerturbedTrajectory(stream, sample, entry, target,
+                                           perturbedEntry, perturbedTarget);
+    bool inside = false;
+    double clearance = SampleClearance(this->DistanceMap, perturbedEntry,
+                                       perturbedTarget, this->Step, &inside);
+    labels.clear();
+    // Labels at the border of the label map may be crossed out of the
+    // samples
+    if (!inside || clearance <= this->CrossingClearance)
+      {
+      TraverseTrajectoryLabels(this->LabelMap, perturbedEntry, perturbedTarget, intervals);
+      for (size_t i = 0; i < intervals.size(); ++i)
+        {
+        labels.push_back(intervals[i].Label);
+        }
+      }
+    statistics.AddSample(clearance, labels);
+    }
+  statistics.GetRobustness(this->Results[row]);
+}
+
+//----------------------------------------------------------------------------
+// Closest trajectory and trajectories closer than the minimum spacing
+struct SpacingJob : public TrajectoryJob
+{
+  virtual void ProcessTrajectory(int row) { this->Spacing->ComputeTrajectory(row); }
+
+  vtkPathExplorerTrajectorySpacing* Spacing;
+};
+
+//----------------------------------------------------------------------------
+// Store interpolated values in a row of scalars: rounded and clamped for
+// integer types, 0 outside the volume (NaN).
+template <class T>
+void StoreRow(const double* values, int numberOfValues, T* row)
+{
+  const double minimum = std::numeric_limits<T>::is_integer ?
+    static_cast<double>(std::numeric_limits<T>::min()) :
+    -static_cast<double>(std::numeric_limits<T>::max());
+  const double maximum = static_cast<double>(std::numeric_limits<T>::max());
+  const double rounding = std::numeric_limits<T>::is_integer ? 0.5 : 0.0;
+  for (int i = 0; i < numberOfValues; ++i)
+    {
+    double value = values[i];
+    if (vtkMath::IsNan(value))
+      {
+      row[i] = static_cast<T>(0);
+      continue;
+      }
+    value = std::min(std::max(value, minimum), maximum);
+    row[i] = static_cast<T>(rounding != 0.0 ? floor(value + rounding) : value);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Planes resampled from a volume, one plane per item. Pixel (i, j) of
+// plane k is at origin + i * columnStep + j * rowStep (RAS), with the 9
+// values of PlaneAxes from 9 * k.
+struct StraighteningJob : public ParallelJob
+{
+  StraighteningJob() : Nearest(false), Planes(0)
+    {
+    // A plane is already a lot of rows
+    this->ChunkSize = 1;
+    }
+  virtual void ProcessItem(int plane);
+
+  SamplingVolume Volume;
+  bool Nearest;
+  std::vector<double> PlaneAxes;
+  int Dimensions[2];
+  // Output scalars, of the type of the volume scalars
+  int ScalarType;
+  void* Planes;
+};
+
+//----------------------------------------------------------------------------
+void StraighteningJob::ProcessItem(int plane)
+{
+  int columns = this->Dimensions[0];
+  int rows = this->Dimensions[1];
+  std::vector<double> values(columns);
+  std::vector<double> points(this->Nearest ? 3 * columns : 0);
+  const double* origin = &this->PlaneAxes[9 * plane];
+  const double* columnStep = origin + 3;
+  const double* rowStep = origin + 6;
+
+  double step[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    const double* m = this->Volume.RASToIJK[i];
+    step[i] = m[0] * columnStep[0] + m[1] * columnStep[1] + m[2] * columnStep[2];
+    }
+  for (int row = 0; row < rows; ++row)
+    {
+    double startRAS[3];
+    double start[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      startRAS[i] = origin[i] + row * rowStep[i];
+      }
+    for (int i = 0; i < 3; ++i)
+      {
+      const double* m = this->Volume.RASToIJK[i];
+      start[i] = m[0] * startRAS[0] + m[1] * startRAS[1] + m[2] * startRAS[2] + m[3];
+      }
+
+    // Labels are not interpolated: the kernel is given voxel centers
+    if (this->Nearest)
+      {
+      for (int column = 0; column < columns; ++column)
+        {
+        for (int i = 0; i < 3; ++i)
+          {
+          points[3 * column + i] = floor(start[i] + column * step[i] + 0.5);
+          }
+        }
+      vtkPathExplorerTrilinearInterpolation::InterpolatePoints(
+        this->Volume.Data, &points[0], columns, &values[0]);
+      }
+    else
+      {
+      this->Volume.Kernel(this->Volume.Data, start, step, columns, &values[0], 1);
+      }
+
+    vtkIdType offset = (static_cast<vtkIdType>(plane) * rows + row) * columns;
+    switch (this->ScalarType)
+      {
+      vtkTemplateMacro(
+        StoreRow<VTK_TT>(&values[0], columns, static_cast<VTK_TT*>(this->Planes) + offset));
+      default:
+        break;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// RAS to IJK matrix of a volume (16 values). Return false for other nodes.
+bool GetVolumeGeometry(vtkMRMLNode* node, double geometry[16])
+{
+  vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(node);
+  if (!volumeNode)
+    {
+    return false;
+    }
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+  const double* matrix = &rasToIJK->Element[0][0];
+  std::copy(matrix, matrix + 16, geometry);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Replace the image and geometry of a volume, in world coordinates.
+void SetVolumeImage(vtkMRMLVolumeNode* volumeNode, vtkImageData* image,
+                    const double ijkToRAS[4][4])
+{
+  vtkNew<vtkMatrix4x4> matrix;
+  for (int i = 0; i < 4; ++i)
+    {
+    for (int j = 0; j < 4; ++j)
+      {
+      matrix->SetElement(i, j, ijkToRAS[i][j]);
+      }
+    }
+  int wasModifying = volumeNode->StartModify();
+  volumeNode->SetAndObserveTransformNodeID(NULL);
+  volumeNode->SetIJKToRASMatrix(matrix.GetPointer());
+  if (volumeNode->GetImageData() != image)
+    {
+    volumeNode->SetAndObserveImageData(image);
+    }
+  volumeNode->EndModify(wasModifying);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+// Values of tracked metrics computed by a scheduler task. Inputs are read
+// from MRML by the main thread when the update starts.
+struct vtkSlicerPathExplorerLogic::MetricUpdate : public vtkPathExplorerTask
+{
+  MetricUpdate(vtkSlicerPathExplorerLogic* logic)
+    : Logic(logic), Step(1.0), NumberOfThreads(0) {}
+  virtual ~MetricUpdate();
+  virtual void Run() { this->Logic->RunMetricUpdate(*this); }
+  virtual void Finish() { this->Logic->FinishMetricUpdate(); }
+
+  // Values of a metric of a list
+
+  struct Item
+    {
+    Item() : Valid(false), Type(ClearanceMetric), InputVersion(0), Labels(0),
+             ScalarType(0), NumberOfComponents(0), DistanceMap(0),
+             NewDistanceMap(0), Hierarchy(0) {}
+
+    std::string ListID;
+    std::string MetricName;
+    bool Valid;
+    int Type;
+    std::string InputNodeID;
+    unsigned long InputVersion;
+
+    // Trajectories to compute, with the version of their position
+    std::vector<int> UIDs;
+    std::vector<unsigned long> Versions;
+    std::vector<double> EntryPositions;
+    std::vector<double> TargetPositions;
+    std::vector<double> Values;
+
+    // ClearanceMetric: label map. The image and its scalars are referenced
+    // until the update is deleted, in case they are replaced meanwhile.
+    // DistanceMap is the cached map if it is up to date, NewDistanceMap
+    // otherwise: it is computed by the update and cached by
+    // FinishMetricUpdate.
+    SamplingVolume LabelMap;
+    vtkSmartPointer<vtkImageData> Image;
+    vtkSmartPointer<vtkDataArray> Scalars;
+    const void* Labels;
+    int ScalarType;
+    int NumberOfComponents;
+    double Spacing[3];
+    const vtkSlicerPathExplorerLogic::DistanceMap* DistanceMap;
+    vtkSlicerPathExplorerLogic::DistanceMap* NewDistanceMap;
+
+    // ModelDistanceMetric
+    const vtkPathExplorerTriangleBVH* Hierarchy;
+    };
+  std::vector<Item> Items;
+
+  vtkSlicerPathExplorerLogic* Logic;
+  double Step;
+  int NumberOfThreads;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic::MetricUpdate::~MetricUpdate()
+{
+  for (size_t i = 0; i < this->Items.size(); ++i)
+    {
+    delete this->Items[i].NewDistanceMap;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Straightened volume or rotated planes resampled by a scheduler task. The
+// output image is allocated by the main thread and published by
+// FinishStraightening.
+struct vtkSlicerPathExplorerLogic::StraighteningTask : public vtkPathExplorerTask
+{
+  StraighteningTask(vtkSlicerPathExplorerLogic* logic, vtkMRMLVolumeNode* volumeNode,
+                    int numberOfPlanes, const int planeDimensions[2]);
+  virtual void Run()
+    {
+    this->Job.Task = this;
+    RunParallelJob(this->Job, this->NumberOfThreads);
+    }
+  virtual void Finish() { this->Logic->FinishStraightening(*this); }
+
+  vtkSlicerPathExplorerLogic* Logic;
+  // Output node ID of a straightening, cache key of rotated planes
+  std::string Key;
+  bool Rotation;
+  // The source image and its scalars are referenced until the task is
+  // deleted, in case they are replaced meanwhile.
+  vtkSmartPointer<vtkImageData> Image;
+  vtkSmartPointer<vtkDataArray> Scalars;
+  vtkSmartPointer<vtkImageData> Output;
+  double IJKToRAS[4][4];
+  StraighteningJob Job;
+  int NumberOfThreads;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic::StraighteningTask
+::StraighteningTask(vtkSlicerPathExplorerLogic* logic, vtkMRMLVolumeNode* volumeNode,
+                    int numberOfPlanes, const int planeDimensions[2])
+  : Logic(logic), Rotation(false), NumberOfThreads(logic->NumberOfSamplingThreads)
+{
+  this->Image = volumeNode->GetImageData();
+  this->Scalars = this->Image->GetPointData()->GetScalars();
+  PrepareSamplingVolume(volumeNode, this->Job.Volume);
+  this->Job.Nearest = vtkSlicerPathExplorerLogic::IsLabelMapVolume(volumeNode);
+  this->Job.NumberOfItems = numberOfPlanes;
+  this->Job.Dimensions[0] = planeDimensions[0];
+  this->Job.Dimensions[1] = planeDimensions[1];
+  this->Job.PlaneAxes.resize(9 * numberOfPlanes);
+
+  // Only the first component is resampled
+  this->Output = vtkSmartPointer<vtkImageData>::New();
+  this->Output->SetDimensions(planeDimensions[0], planeDimensions[1], numberOfPlanes);
+  this->Output->SetScalarType(this->Image->GetScalarType());
+  this->Output->SetNumberOfScalarComponents(1);
+  this->Output->AllocateScalars();
+  this->Job.ScalarType = this->Output->GetScalarType();
+  this->Job.Planes = this->Output->GetScalarPointer();
+}
+
+//----------------------------------------------------------------------------
+// Robustness analysis run by a scheduler task. Inputs are read from MRML by
+// the main thread when the analysis starts. DistanceMap is the cached map
+// if it is up to date, NewDistanceMap otherwise: it is computed by the task
+// and cached by FinishRobustnessAnalysis.
+struct vtkSlicerPathExplorerLogic::RobustnessTask : public vtkPathExplorerTask
+{
+  RobustnessTask(vtkSlicerPathExplorerLogic* logic)
+    : Logic(logic), DistanceMap(0), NewDistanceMap(0),
+      NumberOfThreads(logic->NumberOfSamplingThreads) {}
+  virtual ~RobustnessTask() { delete this->NewDistanceMap; }
+  virtual void Run();
+  virtual void Finish() { this->Logic->FinishRobustnessAnalysis(*this); }
+
+  vtkSlicerPathExplorerLogic* Logic;
+  vtkWeakPointer<vtkMRMLPathPlannerTrajectoryNode> TrajectoryList;
+  vtkWeakPointer<vtkMRMLVolumeNode> LabelMapNode;
+  std::string LabelMapID;
+  // Trajectories analyzed
+  std::vector<int> UIDs;
+  std::vector<double> EntryPositions;
+  std::vector<double> TargetPositions;
+  // The label map image and its scalars are referenced until the task is
+  // deleted, in case they are replaced meanwhile.
+  vtkSmartPointer<vtkImageData> Image;
+  vtkSmartPointer<vtkDataArray> Scalars;
+  const vtkSlicerPathExplorerLogic::DistanceMap* DistanceMap;
+  vtkSlicerPathExplorerLogic::DistanceMap* NewDistanceMap;
+  vtkPathExplorerRobustnessAnalysis Analysis;
+  RobustnessJob Job;
+  int NumberOfThreads;
+};
+
+//----------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::RobustnessTask::Run()
+{
+  // The distance map is computed first: half of the progress
+  this->Job.Task = this;
+  if (this->NewDistanceMap)
+    {
+    if (!ComputeSignedDistanceMap(this->Job.LabelMap.Data, this->NewDistanceMap->Spacing,
+                                  this->NumberOfThreads, this->NewDistanceMap->Distances))
+      {
+      this->NewDistanceMap->Distances.clear();
+      }
+    this->SetProgress(0.5);
+    this->Job.ProgressStart = 0.5;
+    }
+  if (this->IsCanceled() || this->DistanceMap->Distances.empty())
+    {
+    return;
+    }
+  this->Job.DistanceMap = this->Job.LabelMap;
+  SetVolumeData(this->Job.DistanceMap, &this->DistanceMap->Distances[0], VTK_FLOAT,
+                this->Job.LabelMap.Data.Dimensions, 1);
+  RunParallelJob(this->Job, this->NumberOfThreads);
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerPathExplorerLogic);
+
+//----------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic::vtkSlicerPathExplorerLogic()
+{
+  this->SamplingStep = 1.0;
+  this->NumberOfSamplingThreads = 0;
+  this->BatchDepth = 0;
+
+  this->EntrySearchSpacing = 1.0;
+  this->EntrySearchMaximumLength = 150.0;
+  this->EntrySearchMaximumAngle = 60.0;
+  this->EntrySearchClearanceMargin = 10.0;
+  this->EntrySearchWeights[0] = 1.0;
+  this->EntrySearchWeights[1] = 1.0;
+  this->EntrySearchWeights[2] = 1.0;
+  this->EntrySearchMinimumSeparation = 5.0;
+  this->NumberOfEntryCandidates = 0;
+
+  this->RobustnessNumberOfSamples = 1000;
+  this->RobustnessSeed = 0;
+  this->SetPositionErrorStandardDeviation(1.0);
+  this->MinimumTrajectorySpacing = 3.0;
+  this->RotationCacheSize = 256.0;
+  this->RotationCacheClock = 0;
+
+  this->ObservedObjectDeleteCallback = vtkCallbackCommand::New();
+  this->ObservedObjectDeleteCallback->SetClientData(this);
+  this->ObservedObjectDeleteCallback->SetCallback(
+    vtkSlicerPathExplorerLogic::OnObservedObjectDeleted);
+
+  this->MetricEventCallback = vtkCallbackCommand::New();
+  this->MetricEventCallback->SetClientData(this);
+  this->MetricEventCallback->SetCallback(vtkSlicerPathExplorerLogic::OnMetricEvent);
+  this->TaskScheduler = new vtkPathExplorerTaskScheduler;
+  this->MetricUpdateTaskID = -1;
+  this->RunningMetricUpdate = 0;
+  this->NumberOfUpdatedMetricValues = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic::~vtkSlicerPathExplorerLogic()
+{
+  // Pending tasks are deleted without publishing their results
+  delete this->TaskScheduler;
+  this->RunningMetricUpdate = 0;
+  this->RobustnessTasks.clear();
+  this->ClearDistanceMaps();
+  this->ClearModelHierarchies();
+  this->DeleteRetiredCacheEntries();
+  while (!this->TrackedLists.empty())
+    {
+    this->UntrackMetrics(this->TrackedLists.begin()->second.Node);
+    }
+  this->MetricEventCallback->Delete();
+
+  for (std::map<vtkObject*, ObservedObject>::iterator it =
+         this->ObservedObjects.begin(); it != this->ObservedObjects.end(); ++it)
+    {
+    it->first->RemoveObserver(it->second.DeleteObserverTag);
+    }
+  this->ObservedObjectDeleteCallback->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SamplingStep: " << this->SamplingStep << "\n";
+  os << indent << "NumberOfSamplingThreads: " << this->NumberOfSamplingThreads << "\n";
+  os << indent << "BatchDepth: " << this->BatchDepth << "\n";
+  os << indent << "EntrySearchSpacing: " << this->EntrySearchSpacing << "\n";
+  os << indent << "EntrySearchMaximumLength: " << this->EntrySearchMaximumLength << "\n";
+  os << indent << "EntrySearchMaximumAngle: " << this->EntrySearchMaximumAngle << "\n";
+  os << indent << "EntrySearchClearanceMargin: " << this->EntrySearchClearanceMargin << "\n";
+  os << indent << "EntrySearchWeights: " << this->EntrySearchWeights[0] << " "
+     << this->EntrySearchWeights[1] << " " << this->EntrySearchWeights[2] << "\n";
+  os << indent << "EntrySearchMinimumSeparation: " << this->EntrySearchMinimumSeparation << "\n";
+  os << indent << "NumberOfEntryCandidates: " << this->NumberOfEntryCandidates << "\n";
+  os << indent << "RobustnessNumberOfSamples: " << this->RobustnessNumberOfSamples << "\n";
+  os << indent << "RobustnessSeed: " << this->RobustnessSeed << "\n";
+  os << indent << "EntryErrorCovariance:";
+  for (int i = 0; i < 9; ++i)
+    {
+    os << " " << this->EntryErrorCovariance[i];
+    }
+  os << "\n";
+  os << indent << "TargetErrorCovariance:";
+  for (int i = 0; i < 9; ++i)
+    {
+    os << " " << this->TargetErrorCovariance[i];
+    }
+  os << "\n";
+  os << indent << "MinimumTrajectorySpacing: " << this->MinimumTrajectorySpacing << "\n";
+  os << indent << "RotationCacheSize: " << this->RotationCacheSize << "\n";
+  os << indent << "Rotations: " << this->Rotations.size() << "\n";
+  os << indent << "DistanceMaps: " << this->GetNumberOfDistanceMaps() << "\n";
+  os << indent << "ModelHierarchies: " << this->GetNumberOfModelHierarchies() << "\n";
+  os << indent << "TrackedLists: " << this->TrackedLists.size() << "\n";
+  os << indent << "MetricInputs: " << this->MetricInputs.size() << "\n";
+  os << indent << "NumberOfUpdatedMetricValues: " << this->NumberOfUpdatedMetricValues << "\n";
+
+  os << indent << "ObservedObjects: " << this->GetNumberOfObservedObjects() << "\n";
+  for (std::map<vtkObject*, ObservedObject>::iterator it =
+         this->ObservedObjects.begin(); it != this->ObservedObjects.end(); ++it)
+    {
+    os << indent.GetNextIndent() << it->first->GetClassName()
+       << " (" << it->first << "): " << it->second.Observations.size() << "\n";
+    }
+  os << indent << "Callbacks:\n";
+  for (std::map<std::string, CallbackCounter>::iterator it =
+         this->CallbackCounters.begin(); it != this->CallbackCounters.end(); ++it)
+    {
+    os << indent.GetNextIndent() << it->first
+       << ": Count " << it->second.Count
+       << ", Rate " << this->GetCallbacksPerSecond(it->first.c_str()) << "/s"
+       << ", Time " << it->second.Time << "s\n";
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::StartBatch()
+{
+  if (this->BatchDepth++ == 0 && this->GetMRMLScene())
+    {
+    this->GetMRMLScene()->StartState(vtkMRMLScene::BatchProcessState);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::EndBatch()
+{
+  if (this->BatchDepth <= 0)
+    {
+    vtkErrorMacro("EndBatch: No batch started");
+    return;
+    }
+  if (--this->BatchDepth > 0)
+    {
+    return;
+    }
+
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  std::set<std::string> hierarchyIDs;
+  hierarchyIDs.swap(this->ModifiedHierarchyIDs);
+  if (!scene)
+    {
+    return;
+    }
+
+  for (std::set<std::string>::iterator it = hierarchyIDs.begin();
+       it != hierarchyIDs.end(); ++it)
+    {
+    vtkMRMLNode* hierarchyNode = scene->GetNodeByID(it->c_str());
+    if (hierarchyNode)
+      {
+      hierarchyNode->Modified();
+      }
+    }
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::IsBatching()
+{
+  return this->BatchDepth > 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::HierarchyModified(vtkMRMLNode* hierarchyNode)
+{
+  if (!hierarchyNode || !hierarchyNode->GetID())
+    {
+    return;
+    }
+
+  // Removing a child doesn't modify its hierarchy, views wait for this event
+  if (this->IsBatching())
+    {
+    this->ModifiedHierarchyIDs.insert(hierarchyNode->GetID());
+    return;
+    }
+  hierarchyNode->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::SampleTrajectories(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                     vtkMRMLVolumeNode* volumeNode)
+{
+  vtkNew<vtkCollection> volumeNodes;
+  if (volumeNode)
+    {
+    volumeNodes->AddItem(volumeNode);
+    }
+  return this->SampleTrajectories(trajectoryList, volumeNodes.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::SampleTrajectories(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                     vtkCollection* volumeNodes)
+{
+  if (!trajectoryList || !volumeNodes || volumeNodes->GetNumberOfItems() == 0)
+    {
+    vtkErrorMacro("SampleTrajectories: No trajectory list or volume");
+    return false;
+    }
+  if (this->SamplingStep <= 0)
+    {
+    vtkErrorMacro("SampleTrajectories: Invalid sampling step " << this->SamplingStep);
+    return false;
+    }
+
+  SamplingJob job;
+  job.Volumes.resize(volumeNodes->GetNumberOfItems());
+  for (int i = 0; i < volumeNodes->GetNumberOfItems(); ++i)
+    {
+    vtkMRMLVolumeNode* volumeNode =
+      vtkMRMLVolumeNode::SafeDownCast(volumeNodes->GetItemAsObject(i));
+    if (!PrepareSamplingVolume(volumeNode, job.Volumes[i]))
+      {
+      vtkErrorMacro("SampleTrajectories: Unable to sample volume "
+                    << (volumeNode && volumeNode->GetID() ? volumeNode->GetID() : "(none)"));
+      return false;
+      }
+    }
+
+  job.NumberOfItems = trajectoryList->GetNumberOfTrajectories();
+  if (job.NumberOfItems == 0)
+    {
+    return true;
+    }
+  job.EntryPositions = trajectoryList->GetEntryPositions();
+  job.TargetPositions = trajectoryList->GetTargetPositions();
+  job.Step = this->SamplingStep;
+  job.Profiles.resize(job.NumberOfItems);
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+
+  // Observers get a single ModifiedEvent
+  int numberOfVolumes = static_cast<int>(job.Volumes.size());
+  int wasModifying = trajectoryList->StartModify();
+  for (int row = 0; row < job.NumberOfItems; ++row)
+    {
+    std::vector<double>& profile = job.Profiles[row];
+    trajectoryList->SetTrajectorySamples(
+      row, static_cast<int>(profile.size()) / numberOfVolumes, numberOfVolumes,
+      profile.empty() ? 0 : &profile[0]);
+    }
+  trajectoryList->EndModify(wasModifying);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::IsLabelMapVolume(vtkMRMLVolumeNode* volumeNode)
+{
+#if (Slicer_VERSION_MAJOR == 4 && Slicer_VERSION_MINOR <= 4)
+  vtkMRMLScalarVolumeNode* scalarVolumeNode =
+    vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  return scalarVolumeNode && scalarVolumeNode->GetLabelMap();
+#else
+  return vtkMRMLLabelMapVolumeNode::SafeDownCast(volumeNode) != 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeLabelIntervals(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        vtkMRMLVolumeNode* labelMapNode,
+                        std::vector<LabelIntervalList>& intervals)
+{
+  intervals.clear();
+  if (!trajectoryList)
+    {
+    vtkErrorMacro("ComputeLabelIntervals: No trajectory list");
+    return false;
+    }
+
+  LabelJob job;
+  if (!PrepareSamplingVolume(labelMapNode, job.LabelMap))
+    {
+    vtkErrorMacro("ComputeLabelIntervals: Unable to traverse label map "
+                  << (labelMapNode && labelMapNode->GetID() ? labelMapNode->GetID() : "(none)"));
+    return false;
+    }
+
+  job.NumberOfItems = trajectoryList->GetNumberOfTrajectories();
+  if (job.NumberOfItems == 0)
+    {
+    return true;
+    }
+  job.EntryPositions = trajectoryList->GetEntryPositions();
+  job.TargetPositions = trajectoryList->GetTargetPositions();
+  intervals.resize(job.NumberOfItems);
+  job.Intervals = &intervals;
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+const char* vtkSlicerPathExplorerLogic::GetClearanceMetricName()
+{
+  return ClearanceMetricName;
+}
+
+//---------------------------------------------------------------------------
+const float* vtkSlicerPathExplorerLogic::GetDistanceMap(vtkMRMLVolumeNode* labelMapNode)
+{
+  vtkImageData* image = labelMapNode ? labelMapNode->GetImageData() : 0;
+  if (!image || !image->GetScalarPointer() || !labelMapNode->GetID())
+    {
+    return 0;
+    }
+
+  const DistanceMap* cachedMap = this->GetCachedDistanceMap(labelMapNode);
+  if (cachedMap)
+    {
+    return &cachedMap->Distances[0];
+    }
+
+  // Distances are in mm: the map depends on the spacing as well
+  DistanceMap* distanceMap = new DistanceMap;
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  SamplingVolume volume;
+  SetVolumeData(volume, image->GetScalarPointer(), image->GetScalarType(),
+                dimensions, image->GetNumberOfScalarComponents());
+  distanceMap->ImageMTime = image->GetMTime();
+  std::copy(labelMapNode->GetSpacing(), labelMapNode->GetSpacing() + 3,
+            distanceMap->Spacing);
+  if (!ComputeSignedDistanceMap(volume.Data, distanceMap->Spacing,
+                                this->NumberOfSamplingThreads, distanceMap->Distances))
+    {
+    delete distanceMap;
+    this->RemoveDistanceMap(labelMapNode->GetID());
+    return 0;
+    }
+  this->SetDistanceMap(labelMapNode->GetID(), distanceMap);
+  return &distanceMap->Distances[0];
+}
+
+//---------------------------------------------------------------------------
+const vtkSlicerPathExplorerLogic::DistanceMap* vtkSlicerPathExplorerLogic
+::GetCachedDistanceMap(vtkMRMLVolumeNode* labelMapNode)
+{
+  vtkImageData* image = labelMapNode ? labelMapNode->GetImageData() : 0;
+  if (!image || !labelMapNode->GetID())
+    {
+    return 0;
+    }
+  std::map<std::string, DistanceMap*>::iterator it =
+    this->DistanceMaps.find(labelMapNode->GetID());
+  if (it == this->DistanceMaps.end() ||
+      it->second->ImageMTime != image->GetMTime() ||
+      !std::equal(it->second->Spacing, it->second->Spacing + 3,
+                  labelMapNode->GetSpacing()))
+    {
+    return 0;
+    }
+  return it->second;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::SetDistanceMap(const std::string& labelMapID, DistanceMap* distanceMap)
+{
+  this->RemoveDistanceMap(labelMapID);
+  this->DistanceMaps[labelMapID] = distanceMap;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::RemoveDistanceMap(const std::string& labelMapID)
+{
+  std::map<std::string, DistanceMap*>::iterator it = this->DistanceMaps.find(labelMapID);
+  if (it == this->DistanceMaps.end())
+    {
+    return;
+    }
+  // A running task may still read it
+  if (this->IsReadingCaches())
+    {
+    this->RetiredDistanceMaps.push_back(it->second);
+    }
+  else
+    {
+    delete it->second;
+    }
+  this->DistanceMaps.erase(it);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic::GetNumberOfDistanceMaps()
+{
+  return static_cast<int>(this->DistanceMaps.size());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::ClearDistanceMaps()
+{
+  while (!this->DistanceMaps.empty())
+    {
+    this->RemoveDistanceMap(this->DistanceMaps.begin()->first);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeClearance(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                   vtkMRMLVolumeNode* labelMapNode)
+{
+  return this->ComputeClearanceRows(trajectoryList, labelMapNode, -1);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeClearance(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                   vtkMRMLVolumeNode* labelMapNode, int row)
+{
+  if (row < 0)
+    {
+    return false;
+    }
+  return this->ComputeClearanceRows(trajectoryList, labelMapNode, row);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeClearanceRows(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                       vtkMRMLVolumeNode* labelMapNode, int row)
+{
+  if (!trajectoryList || !labelMapNode)
+    {
+    vtkErrorMacro("ComputeClearance: No trajectory list or label map");
+    return false;
+    }
+  if (this->SamplingStep <= 0)
+    {
+    vtkErrorMacro("ComputeClearance: Invalid sampling step " << this->SamplingStep);
+    return false;
+    }
+  int numberOfTrajectories = trajectoryList->GetNumberOfTrajectories();
+  if (row >= numberOfTrajectories)
+    {
+    return false;
+    }
+
+  // The distance map is sampled in place of the labels
+  ClearanceJob job;
+  const float* distances = this->GetDistanceMap(labelMapNode);
+  if (!distances || !PrepareSamplingVolume(labelMapNode, job.DistanceMap))
+    {
+    vtkErrorMacro("ComputeClearance: Unable to compute the distance map of "
+                  << labelMapNode->GetID());
+    return false;
+    }
+  SetVolumeData(job.DistanceMap, distances, VTK_FLOAT,
+                job.DistanceMap.Data.Dimensions, 1);
+
+  job.NumberOfItems = numberOfTrajectories;
+  if (numberOfTrajectories == 0)
+    {
+    return true;
+    }
+  job.EntryPositions = trajectoryList->GetEntryPositions();
+  job.TargetPositions = trajectoryList->GetTargetPositions();
+  job.Step = this->SamplingStep;
+  job.Clearances.resize(numberOfTrajectories);
+
+  // A single row is updated on its own (TrajectoryModifiedEvent), all the
+  // rows at once (single ModifiedEvent)
+  if (row >= 0)
+    {
+    job.ProcessTrajectory(row);
+    int metric = trajectoryList->AddMetric(ClearanceMetricName);
+    trajectoryList->SetMetricValue(row, metric, job.Clearances[row]);
+    return true;
+    }
+
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+  int wasModifying = trajectoryList->StartModify();
+  int metric = trajectoryList->AddMetric(ClearanceMetricName);
+  for (int trajectory = 0; trajectory < numberOfTrajectories; ++trajectory)
+    {
+    trajectoryList->SetMetricValue(trajectory, metric, job.Clearances[trajectory]);
+    }
+  trajectoryList->EndModify(wasModifying);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+const vtkPathExplorerTriangleBVH* vtkSlicerPathExplorerLogic
+::GetModelHierarchy(vtkMRMLModelNode* modelNode)
+{
+  vtkPolyData* polyData = modelNode ? modelNode->GetPolyData() : 0;
+  if (!polyData || !modelNode->GetID())
+    {
+    return 0;
+    }
+
+  // Triangles are in world coordinates
+  vtkNew<vtkMatrix4x4> toWorld;
+  vtkMRMLTransformNode* transformNode = modelNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    if (!transformNode->IsTransformToWorldLinear())
+      {
+      return 0;
+      }
+    transformNode->GetMatrixTransformToWorld(toWorld.GetPointer());
+    }
+  const double* matrix = &toWorld->Element[0][0];
+
+  std::map<std::string, ModelHierarchy*>::iterator it =
+    this->ModelHierarchies.find(modelNode->GetID());
+  if (it != this->ModelHierarchies.end() &&
+      it->second->PolyDataMTime == polyData->GetMTime() &&
+      std::equal(matrix, matrix + 16, it->second->ToWorld))
+    {
+    return &it->second->Hierarchy;
+    }
+
+  vtkIdType numberOfPoints = polyData->GetNumberOfPoints();
+  std::vector<double> points(3 * numberOfPoints);
+  for (vtkIdType id = 0; id < numberOfPoints; ++id)
+    {
+    double point[4] = { 0.0, 0.0, 0.0, 1.0 };
+    double worldPoint[4];
+    polyData->GetPoint(id, point);
+    toWorld->MultiplyPoint(point, worldPoint);
+    std::copy(worldPoint, worldPoint + 3, &points[3 * id]);
+    }
+  std::vector<vtkIdType> triangles;
+  AddCellTriangles(polyData->GetPolys(), false, triangles);
+  AddCellTriangles(polyData->GetStrips(), true, triangles);
+
+  // A new hierarchy is built: the running update may still read the old one
+  ModelHierarchy* modelHierarchy = new ModelHierarchy;
+  modelHierarchy->Hierarchy.Build(points.empty() ? 0 : &points[0],
+                                  triangles.empty() ? 0 : &triangles[0],
+                                  static_cast<vtkIdType>(triangles.size() / 3));
+  modelHierarchy->PolyDataMTime = polyData->GetMTime();
+  std::copy(matrix, matrix + 16, modelHierarchy->ToWorld);
+  this->RemoveModelHierarchy(modelNode->GetID());
+  this->ModelHierarchies[modelNode->GetID()] = modelHierarchy;
+  return &modelHierarchy->Hierarchy;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::RemoveModelHierarchy(const std::string& modelID)
+{
+  std::map<std::string, ModelHierarchy*>::iterator it = this->ModelHierarchies.find(modelID);
+  if (it == this->ModelHierarchies.end())
+    {
+    return;
+    }
+  if (this->IsReadingCaches())
+    {
+    this->RetiredModelHierarchies.push_back(it->second);
+    }
+  else
+    {
+    delete it->second;
+    }
+  this->ModelHierarchies.erase(it);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::IsReadingCaches()
+{
+  return this->RunningMetricUpdate || !this->RobustnessTasks.empty();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::DeleteRetiredCacheEntries()
+{
+  for (size_t i = 0; i < this->RetiredDistanceMaps.size(); ++i)
+    {
+    delete this->RetiredDistanceMaps[i];
+    }
+  this->RetiredDistanceMaps.clear();
+  for (size_t i = 0; i < this->RetiredModelHierarchies.size(); ++i)
+    {
+    delete this->RetiredModelHierarchies[i];
+    }
+  this->RetiredModelHierarchies.clear();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic::GetNumberOfModelHierarchies()
+{
+  return static_cast<int>(this->ModelHierarchies.size());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::ClearModelHierarchies()
+{
+  while (!this->ModelHierarchies.empty())
+    {
+    this->RemoveModelHierarchy(this->ModelHierarchies.begin()->first);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::IntersectModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                  vtkMRMLModelNode* modelNode, std::vector<double>& intersections)
+{
+  vtkNew<vtkCollection> modelNodes;
+  if (modelNode)
+    {
+    modelNodes->AddItem(modelNode);
+    }
+  return this->QueryModels(trajectoryList, modelNodes.GetPointer(), true, intersections);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::IntersectModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                  vtkCollection* modelNodes, std::vector<double>& intersections)
+{
+  return this->QueryModels(trajectoryList, modelNodes, true, intersections);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeModelDistances(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        vtkMRMLModelNode* modelNode, std::vector<double>& distances)
+{
+  vtkNew<vtkCollection> modelNodes;
+  if (modelNode)
+    {
+    modelNodes->AddItem(modelNode);
+    }
+  return this->QueryModels(trajectoryList, modelNodes.GetPointer(), false, distances);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeModelDistances(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        vtkCollection* modelNodes, std::vector<double>& distances)
+{
+  return this->QueryModels(trajectoryList, modelNodes, false, distances);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::QueryModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+              vtkCollection* modelNodes, bool intersection,
+              std::vector<double>& results)
+{
+  results.clear();
+  if (!trajectoryList || !modelNodes || modelNodes->GetNumberOfItems() == 0)
+    {
+    vtkErrorMacro("QueryModels: No trajectory list or model");
+    return false;
+    }
+
+  ModelQueryJob job;
+  for (int i = 0; i < modelNodes->GetNumberOfItems(); ++i)
+    {
+    vtkMRMLModelNode* modelNode =
+      vtkMRMLModelNode::SafeDownCast(modelNodes->GetItemAsObject(i));
+    const vtkPathExplorerTriangleBVH* hierarchy = this->GetModelHierarchy(modelNode);
+    if (!hierarchy)
+      {
+      vtkErrorMacro("QueryModels: Unable to query model "
+                    << (modelNode && modelNode->GetID() ? modelNode->GetID() : "(none)"));
+      return false;
+      }
+    job.Hierarchies.push_back(hierarchy);
+    }
+
+  job.NumberOfItems = trajectoryList->GetNumberOfTrajectories();
+  if (job.NumberOfItems == 0)
+    {
+    return true;
+    }
+  job.EntryPositions = trajectoryList->GetEntryPositions();
+  job.TargetPositions = trajectoryList->GetTargetPositions();
+  job.Intersection = intersection;
+  results.resize(job.NumberOfItems);
+  job.Results = &results;
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::FindEntryPoints(vtkMRMLAnnotationFiducialNode* targetNode,
+                  vtkMRMLModelNode* surfaceNode, vtkMRMLVolumeNode* labelMapNode,
+                  int numberOfEntryPoints, EntryPointList& entryPoints)
+{
+  if (!targetNode)
+    {
+    entryPoints.clear();
+    vtkErrorMacro("FindEntryPoints: No target");
+    return false;
+    }
+  double target[4] = { 0.0, 0.0, 0.0, 1.0 };
+  targetNode->GetFiducialWorldCoordinates(target);
+  return this->FindEntryPoints(target, surfaceNode, labelMapNode,
+                               numberOfEntryPoints, entryPoints);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::FindEntryPoints(const double target[3], vtkMRMLModelNode* surfaceNode,
+                  vtkMRMLVolumeNode* labelMapNode, int numberOfEntryPoints,
+                  EntryPointList& entryPoints)
+{
+  entryPoints.clear();
+  this->NumberOfEntryCandidates = 0;
+  if (this->EntrySearchSpacing <= 0 || this->EntrySearchMaximumLength <= 0 ||
+      this->SamplingStep <= 0)
+    {
+    vtkErrorMacro("FindEntryPoints: Invalid spacing " << this->EntrySearchSpacing
+                  << ", maximum length " << this->EntrySearchMaximumLength
+                  << " or sampling step " << this->SamplingStep);
+    return false;
+    }
+
+  const vtkPathExplorerTriangleBVH* surface = this->GetModelHierarchy(surfaceNode);
+  if (!surface)
+    {
+    vtkErrorMacro("FindEntryPoints: Unable to use surface "
+                  << (surfaceNode && surfaceNode->GetID() ? surfaceNode->GetID() : "(none)"));
+    return false;
+    }
+
+  // Critical structures: labels are traversed, the distance map is sampled
+  EntrySearchJob job;
+  if (labelMapNode)
+    {
+    const float* distances = this->GetDistanceMap(labelMapNode);
+    if (!distances || !PrepareSamplingVolume(labelMapNode, job.LabelMap))
+      {
+      vtkErrorMacro("FindEntryPoints: Unable to compute the distance map of "
+                    << labelMapNode->GetID());
+      return false;
+      }
+    job.DistanceMap = job.LabelMap;
+    SetVolumeData(job.DistanceMap, distances, VTK_FLOAT,
+                  job.LabelMap.Data.Dimensions, 1);
+    job.UseLabelMap = true;
+    }
+
+  vtkPathExplorerEntrySearch search;
+  search.SetSpacing(this->EntrySearchSpacing);
+  search.SetMaximumLength(this->EntrySearchMaximumLength);
+  search.SetMaximumAngle(this->EntrySearchMaximumAngle);
+  search.SetClearanceMargin(this->EntrySearchClearanceMargin);
+  search.SetWeights(this->EntrySearchWeights);
+  search.SetMinimumSeparation(this->EntrySearchMinimumSeparation);
+  search.GenerateCandidates(target, surface);
+  job.NumberOfItems = search.GetNumberOfCandidates();
+  this->NumberOfEntryCandidates = job.NumberOfItems;
+  if (job.NumberOfItems == 0 || numberOfEntryPoints <= 0)
+    {
+    return true;
+    }
+  job.Search = &search;
+  job.Step = this->SamplingStep;
+  job.EntryPoints.resize(job.NumberOfItems);
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+  search.SelectEntryPoints(job.EntryPoints, numberOfEntryPoints, entryPoints);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::SetEntryErrorCovariance(const double covariance[9])
+{
+  if (std::equal(covariance, covariance + 9, this->EntryErrorCovariance))
+    {
+    return;
+    }
+  std::copy(covariance, covariance + 9, this->EntryErrorCovariance);
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::GetEntryErrorCovariance(double covariance[9])
+{
+  std::copy(this->EntryErrorCovariance, this->EntryErrorCovariance + 9, covariance);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::SetTargetErrorCovariance(const double covariance[9])
+{
+  if (std::equal(covariance, covariance + 9, this->TargetErrorCovariance))
+    {
+    return;
+    }
+  std::copy(covariance, covariance + 9, this->TargetErrorCovariance);
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::GetTargetErrorCovariance(double covariance[9])
+{
+  std::copy(this->TargetErrorCovariance, this->TargetErrorCovariance + 9, covariance);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::SetPositionErrorStandardDeviation(double sigma)
+{
+  double covariance[9] = { 0.0 };
+  covariance[0] = covariance[4] = covariance[8] = sigma * sigma;
+  this->SetEntryErrorCovariance(covariance);
+  this->SetTargetErrorCovariance(covariance);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::AnalyzeRobustness(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                    vtkMRMLVolumeNode* labelMapNode, TrajectoryRobustnessList& results)
+{
+  results.clear();
+  RobustnessTask* task = this->CreateRobustnessTask(trajectoryList, labelMapNode);
+  if (!task)
+    {
+    return false;
+    }
+  task->Run();
+  bool analyzed = this->FinishRobustnessAnalysis(*task);
+  if (analyzed)
+    {
+    results.swap(task->Job.Results);
+    }
+  delete task;
+  return analyzed;
+}
 
-// VTK includes
-#include <vtkNew.h>
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::StartRobustnessAnalysis(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                          vtkMRMLVolumeNode* labelMapNode)
+{
+  RobustnessTask* task = this->CreateRobustnessTask(trajectoryList, labelMapNode);
+  if (!task)
+    {
+    return false;
+    }
+  this->RobustnessTasks.push_back(task);
+  std::string key = std::string(RobustnessAnalysisKeyPrefix) +
+    (trajectoryList->GetID() ? trajectoryList->GetID() : "");
+  this->TaskScheduler->Submit(task, key.c_str());
+  return true;
+}
 
-// STD includes
-#include <cassert>
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::CancelRobustnessAnalysis(vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  if (!trajectoryList)
+    {
+    return;
+    }
+  std::string key = std::string(RobustnessAnalysisKeyPrefix) +
+    (trajectoryList->GetID() ? trajectoryList->GetID() : "");
+  this->TaskScheduler->Cancel(key.c_str());
+}
 
-//----------------------------------------------------------------------------
-vtkStandardNewMacro(vtkSlicerPathExplorerLogic);
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::IsAnalyzingRobustness(vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  for (size_t i = 0; trajectoryList && i < this->RobustnessTasks.size(); ++i)
+    {
+    if (this->RobustnessTasks[i]->TrajectoryList == trajectoryList &&
+        !this->RobustnessTasks[i]->IsCanceled())
+      {
+      return true;
+      }
+    }
+  return false;
+}
 
-//----------------------------------------------------------------------------
-vtkSlicerPathExplorerLogic::vtkSlicerPathExplorerLogic()
+//---------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic::RobustnessTask* vtkSlicerPathExplorerLogic
+::CreateRobustnessTask(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                       vtkMRMLVolumeNode* labelMapNode)
 {
+  if (!trajectoryList || !labelMapNode)
+    {
+    vtkErrorMacro("AnalyzeRobustness: No trajectory list or label map");
+    return 0;
+    }
+  if (this->SamplingStep <= 0 || this->RobustnessNumberOfSamples <= 0)
+    {
+    vtkErrorMacro("AnalyzeRobustness: Invalid sampling step " << this->SamplingStep
+                  << " or number of samples " << this->RobustnessNumberOfSamples);
+    return 0;
+    }
+
+  RobustnessTask* task = new RobustnessTask(this);
+  vtkPathExplorerRobustnessAnalysis& analysis = task->Analysis;
+  analysis.SetNumberOfSamples(this->RobustnessNumberOfSamples);
+  analysis.SetSeed(this->RobustnessSeed);
+  if (!analysis.SetEntryErrorCovariance(this->EntryErrorCovariance) ||
+      !analysis.SetTargetErrorCovariance(this->TargetErrorCovariance))
+    {
+    vtkErrorMacro("AnalyzeRobustness: Error covariances must be symmetric "
+                  "positive semi-definite");
+    delete task;
+    return 0;
+    }
+
+  // Critical structures: labels are traversed, the distance map is sampled
+  RobustnessJob& job = task->Job;
+  vtkImageData* image = labelMapNode->GetImageData();
+  if (!image || !image->GetScalarPointer() || !labelMapNode->GetID() ||
+      !PrepareSamplingVolume(labelMapNode, job.LabelMap))
+    {
+    vtkErrorMacro("AnalyzeRobustness: Unable to use label map "
+                  << (labelMapNode->GetID() ? labelMapNode->GetID() : "(no ID)"));
+    delete task;
+    return 0;
+    }
+  task->LabelMapNode = labelMapNode;
+  task->LabelMapID = labelMapNode->GetID();
+  task->Image = image;
+  task->Scalars = image->GetPointData()->GetScalars();
+  task->DistanceMap = this->GetCachedDistanceMap(labelMapNode);
+  if (!task->DistanceMap)
+    {
+    task->NewDistanceMap = new DistanceMap;
+    task->NewDistanceMap->ImageMTime = image->GetMTime();
+    std::copy(labelMapNode->GetSpacing(), labelMapNode->GetSpacing() + 3,
+              task->NewDistanceMap->Spacing);
+    task->DistanceMap = task->NewDistanceMap;
+    }
+
+  // Perturbations are drawn from the stream of each trajectory UID
+  task->TrajectoryList = trajectoryList;
+  int numberOfTrajectories = trajectoryList->GetNumberOfTrajectories();
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    task->UIDs.push_back(trajectoryList->GetTrajectoryUID(row));
+    }
+  task->EntryPositions.assign(trajectoryList->GetEntryPositions(),
+                              trajectoryList->GetEntryPositions() + 3 * numberOfTrajectories);
+  task->TargetPositions.assign(trajectoryList->GetTargetPositions(),
+                               trajectoryList->GetTargetPositions() + 3 * numberOfTrajectories);
+  if (numberOfTrajectories > 0)
+    {
+    job.UIDs = &task->UIDs[0];
+    job.EntryPositions = &task->EntryPositions[0];
+    job.TargetPositions = &task->TargetPositions[0];
+    }
+  job.NumberOfItems = numberOfTrajectories;
+  job.Results.resize(numberOfTrajectories);
+  job.Analysis = &analysis;
+  job.Step = this->SamplingStep;
+  // A trajectory whose samples are all in the label map and farther from the
+  // structures than a step and a voxel diagonal doesn't cross any of them
+  const double* spacing = labelMapNode->GetSpacing();
+  job.CrossingClearance = job.Step +
+    sqrt(spacing[0] * spacing[0] + spacing[1] * spacing[1] + spacing[2] * spacing[2]);
+  return task;
 }
 
-//----------------------------------------------------------------------------
-vtkSlicerPathExplorerLogic::~vtkSlicerPathExplorerLogic()
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::FinishRobustnessAnalysis(RobustnessTask& task)
 {
+  std::vector<RobustnessTask*>::iterator pending =
+    std::find(this->RobustnessTasks.begin(), this->RobustnessTasks.end(), &task);
+  if (pending != this->RobustnessTasks.end())
+    {
+    this->RobustnessTasks.erase(pending);
+    }
+
+  // A distance map computed for an unchanged label map is cached, even if
+  // the analysis was canceled
+  vtkMRMLVolumeNode* labelMapNode = task.LabelMapNode;
+  if (task.NewDistanceMap && !task.NewDistanceMap->Distances.empty() &&
+      labelMapNode && labelMapNode->GetImageData() == task.Image &&
+      task.Image->GetMTime() == task.NewDistanceMap->ImageMTime &&
+      std::equal(task.NewDistanceMap->Spacing, task.NewDistanceMap->Spacing + 3,
+                 labelMapNode->GetSpacing()))
+    {
+    this->SetDistanceMap(task.LabelMapID, task.NewDistanceMap);
+    task.NewDistanceMap = 0;
+    }
+  if (!this->IsReadingCaches())
+    {
+    this->DeleteRetiredCacheEntries();
+    }
+
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = task.TrajectoryList;
+  if (task.IsCanceled() || !trajectoryList)
+    {
+    return false;
+    }
+  if (task.DistanceMap->Distances.empty())
+    {
+    vtkErrorMacro("AnalyzeRobustness: Unable to compute the distance map of "
+                  << task.LabelMapID);
+    return false;
+    }
+
+  // Trajectories moved or removed since the analysis started are skipped
+  const TrajectoryRobustnessList& results = task.Job.Results;
+  std::vector<int> rows(results.size(), -1);
+  for (size_t i = 0; i < results.size(); ++i)
+    {
+    int row = trajectoryList->GetTrajectoryRow(task.UIDs[i]);
+    if (row >= 0 &&
+        std::equal(&task.EntryPositions[3 * i], &task.EntryPositions[3 * i] + 3,
+                   trajectoryList->GetEntryPositions() + 3 * row) &&
+        std::equal(&task.TargetPositions[3 * i], &task.TargetPositions[3 * i] + 3,
+                   trajectoryList->GetTargetPositions() + 3 * row))
+      {
+      rows[i] = row;
+      }
+    }
+
+  // Metrics, hit probabilities of labels no longer hit are reset
+  int wasModifying = trajectoryList->StartModify();
+  int collisionMetric = trajectoryList->AddMetric(CollisionProbabilityMetricName);
+  int clearanceMetric = trajectoryList->AddMetric(RobustClearanceMetricName);
+  const std::string hitPrefix = HitProbabilityMetricPrefix;
+  std::map<int, int> hitMetrics;
+  for (int metric = 0; metric < trajectoryList->GetNumberOfMetrics(); ++metric)
+    {
+    std::string name = trajectoryList->GetMetricName(metric);
+    if (name.compare(0, hitPrefix.size(), hitPrefix) == 0)
+      {
+      hitMetrics[atoi(name.c_str() + hitPrefix.size())] = metric;
+      }
+    }
+  for (size_t i = 0; i < results.size(); ++i)
+    {
+    for (size_t hit = 0; rows[i] >= 0 && hit < results[i].HitProbabilities.size(); ++hit)
+      {
+      int label = results[i].HitProbabilities[hit].first;
+      if (hitMetrics.find(label) == hitMetrics.end())
+        {
+        std::ostringstream name;
+        name << hitPrefix << label;
+        hitMetrics[label] = trajectoryList->AddMetric(name.str().c_str());
+        }
+      }
+    }
+  for (size_t i = 0; i < results.size(); ++i)
+    {
+    int row = rows[i];
+    if (row < 0)
+      {
+      continue;
+      }
+    const TrajectoryRobustness& result = results[i];
+    trajectoryList->SetMetricValue(row, collisionMetric, result.CollisionProbability);
+    trajectoryList->SetMetricValue(row, clearanceMetric, result.RobustClearance);
+    size_t hit = 0;
+    for (std::map<int, int>::const_iterator it = hitMetrics.begin();
+         it != hitMetrics.end(); ++it)
+      {
+      double probability = 0.0;
+      if (hit < result.HitProbabilities.size() &&
+          result.HitProbabilities[hit].first == it->first)
+        {
+        probability = result.HitProbabilities[hit++].second;
+        }
+      trajectoryList->SetMetricValue(row, it->second, probability);
+      }
+    }
+  trajectoryList->EndModify(wasModifying);
+  return true;
 }
 
-//----------------------------------------------------------------------------
-void vtkSlicerPathExplorerLogic::PrintSelf(ostream& os, vtkIndent indent)
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ComputeTrajectorySpacing(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                           TrajectoryPairList& violations)
 {
-  this->Superclass::PrintSelf(os, indent);
+  violations.clear();
+  if (!trajectoryList)
+    {
+    vtkErrorMacro("ComputeTrajectorySpacing: No trajectory list");
+    return false;
+    }
+  int numberOfTrajectories = trajectoryList->GetNumberOfTrajectories();
+  if (numberOfTrajectories == 0)
+    {
+    return true;
+    }
+
+  vtkPathExplorerTrajectorySpacing spacing;
+  spacing.SetMinimumSpacing(this->MinimumTrajectorySpacing);
+  spacing.Build(trajectoryList->GetEntryPositions(),
+                trajectoryList->GetTargetPositions(), numberOfTrajectories);
+  SpacingJob job;
+  job.Spacing = &spacing;
+  job.NumberOfItems = numberOfTrajectories;
+  RunParallelJob(job, this->NumberOfSamplingThreads);
+  std::vector<int> violationCounts;
+  spacing.GetViolations(violations, violationCounts);
+
+  int wasModifying = trajectoryList->StartModify();
+  int spacingMetric = trajectoryList->AddMetric(SpacingMetricName);
+  int violationsMetric = trajectoryList->AddMetric(SpacingViolationsMetricName);
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    trajectoryList->SetMetricValue(row, spacingMetric, spacing.GetSpacing(row));
+    trajectoryList->SetMetricValue(row, violationsMetric, violationCounts[row]);
+    }
+  trajectoryList->EndModify(wasModifying);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::WriteTrajectoryPairs(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                       const TrajectoryPairList& pairs, const char* fileName)
+{
+  if (!trajectoryList || !fileName)
+    {
+    vtkErrorMacro("WriteTrajectoryPairs: No trajectory list or file name");
+    return false;
+    }
+  std::ofstream of(fileName);
+  if (!of)
+    {
+    vtkErrorMacro("WriteTrajectoryPairs: Unable to open " << fileName << " for writing");
+    return false;
+    }
+
+  std::vector<std::string> names;
+  for (int row = 0; row < trajectoryList->GetNumberOfTrajectories(); ++row)
+    {
+    const char* name = trajectoryList->GetTrajectoryName(row);
+    names.push_back(name ? name : "");
+    }
+  vtkPathExplorerTrajectorySpacing::WritePairs(of, pairs, names);
+  of.close();
+  if (!of)
+    {
+    vtkErrorMacro("WriteTrajectoryPairs: Unable to write " << fileName);
+    return false;
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::Straightening
+::IsSameAs(const Straightening& other) const
+{
+  return this->VolumeNodeID == other.VolumeNodeID &&
+         this->TrajectoryListNodeID == other.TrajectoryListNodeID &&
+         this->ImageMTime == other.ImageMTime &&
+         std::equal(this->RASToIJK, this->RASToIJK + 12, other.RASToIJK) &&
+         std::equal(this->Entry, this->Entry + 3, other.Entry) &&
+         std::equal(this->Target, this->Target + 3, other.Target) &&
+         this->NumberOfPlanes == other.NumberOfPlanes &&
+         this->PlaneDimensions[0] == other.PlaneDimensions[0] &&
+         this->PlaneDimensions[1] == other.PlaneDimensions[1] &&
+         this->PlaneSpacing == other.PlaneSpacing;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::GetStraightening(vtkMRMLVolumeNode* volumeNode,
+                   vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                   int numberOfPlanes, const int planeDimensions[2],
+                   double planeSpacing, Straightening& straightening)
+{
+  vtkImageData* image = volumeNode ? volumeNode->GetImageData() : 0;
+  SamplingVolume volume;
+  if (!image || !volumeNode->GetID() || !trajectoryList ||
+      row < 0 || row >= trajectoryList->GetNumberOfTrajectories() ||
+      numberOfPlanes < 2 || planeDimensions[0] < 1 || planeDimensions[1] < 1 ||
+      planeSpacing <= 0.0 || !PrepareSamplingVolume(volumeNode, volume))
+    {
+    return false;
+    }
+
+  straightening.VolumeNodeID = volumeNode->GetID();
+  straightening.TrajectoryListNodeID =
+    trajectoryList->GetID() ? trajectoryList->GetID() : "";
+  straightening.ImageMTime = image->GetMTime();
+  std::copy(&volume.RASToIJK[0][0], &volume.RASToIJK[0][0] + 12,
+            straightening.RASToIJK);
+  trajectoryList->GetEntryPosition(row, straightening.Entry);
+  trajectoryList->GetTargetPosition(row, straightening.Target);
+  straightening.NumberOfPlanes = numberOfPlanes;
+  straightening.PlaneDimensions[0] = planeDimensions[0];
+  straightening.PlaneDimensions[1] = planeDimensions[1];
+  straightening.PlaneSpacing = planeSpacing;
+  straightening.Task = 0;
+  straightening.Ready = false;
+  straightening.Size = 0.0;
+  straightening.LastUse = 0;
+  return vtkMath::Distance2BetweenPoints(straightening.Entry, straightening.Target) > 0.0;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::StartStraightening(vtkMRMLVolumeNode* volumeNode,
+                     vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                     int numberOfPlanes, const int planeDimensions[2],
+                     double planeSpacing, vtkMRMLVolumeNode* outputNode)
+{
+  Straightening straightening;
+  if (!outputNode || !outputNode->GetID() ||
+      !this->GetStraightening(volumeNode, trajectoryList, row, numberOfPlanes,
+                              planeDimensions, planeSpacing, straightening))
+    {
+    vtkErrorMacro("StartStraightening: Invalid volume, trajectory or output");
+    return false;
+    }
+
+  std::map<std::string, Straightening>::iterator it =
+    this->Straightenings.find(outputNode->GetID());
+  if (it != this->Straightenings.end() &&
+      (it->second.Ready || it->second.Task) &&
+      it->second.IsSameAs(straightening))
+    {
+    return true;
+    }
+
+  // Planes: pixel (i, j) of plane k is at origin + k * planeStep +
+  // i * columnStep + j * rowStep
+  double direction[3];
+  vtkMath::Subtract(straightening.Target, straightening.Entry, direction);
+  double length = vtkMath::Normalize(direction);
+  double columnAxis[3];
+  double rowAxis[3];
+  vtkMath::Perpendiculars(direction, columnAxis, NULL, 0);
+  vtkMath::Cross(direction, columnAxis, rowAxis);
+  double planeStep = length / (numberOfPlanes - 1);
+
+  StraighteningTask* task =
+    new StraighteningTask(this, volumeNode, numberOfPlanes, planeDimensions);
+  task->Key = outputNode->GetID();
+  for (int i = 0; i < 3; ++i)
+    {
+    task->IJKToRAS[i][0] = columnAxis[i] * planeSpacing;
+    task->IJKToRAS[i][1] = rowAxis[i] * planeSpacing;
+    task->IJKToRAS[i][2] = direction[i] * planeStep;
+    task->IJKToRAS[i][3] = straightening.Entry[i] -
+      0.5 * (planeDimensions[0] - 1) * task->IJKToRAS[i][0] -
+      0.5 * (planeDimensions[1] - 1) * task->IJKToRAS[i][1];
+    task->IJKToRAS[3][i] = 0.0;
+    }
+  task->IJKToRAS[3][3] = 1.0;
+  for (int k = 0; k < numberOfPlanes; ++k)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      task->Job.PlaneAxes[9 * k + i] = task->IJKToRAS[i][3] + k * task->IJKToRAS[i][2];
+      task->Job.PlaneAxes[9 * k + 3 + i] = task->IJKToRAS[i][0];
+      task->Job.PlaneAxes[9 * k + 6 + i] = task->IJKToRAS[i][1];
+      }
+    }
+
+  std::string key = std::string("Straightening:") + outputNode->GetID();
+  straightening.Task = task;
+  this->Straightenings[outputNode->GetID()] = straightening;
+  this->TaskScheduler->Submit(task, key.c_str());
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::IsStraightened(vtkMRMLVolumeNode* volumeNode,
+                 vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                 int numberOfPlanes, const int planeDimensions[2],
+                 double planeSpacing, vtkMRMLVolumeNode* outputNode)
+{
+  Straightening straightening;
+  if (!outputNode || !outputNode->GetID() ||
+      !this->GetStraightening(volumeNode, trajectoryList, row, numberOfPlanes,
+                              planeDimensions, planeSpacing, straightening))
+    {
+    return false;
+    }
+  std::map<std::string, Straightening>::iterator it =
+    this->Straightenings.find(outputNode->GetID());
+  return it != this->Straightenings.end() && it->second.Ready &&
+         it->second.IsSameAs(straightening);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::CancelStraightening(vtkMRMLVolumeNode* outputNode)
+{
+  if (!outputNode || !outputNode->GetID() ||
+      !this->Straightenings.erase(outputNode->GetID()))
+    {
+    return;
+    }
+  std::string key = std::string("Straightening:") + outputNode->GetID();
+  this->TaskScheduler->Cancel(key.c_str());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::FinishStraightening(StraighteningTask& task)
+{
+  // Superseded or canceled tasks are dropped
+  std::map<std::string, Straightening>& entries =
+    task.Rotation ? this->Rotations : this->Straightenings;
+  std::map<std::string, Straightening>::iterator it = entries.find(task.Key);
+  if (it == entries.end() || it->second.Task != &task)
+    {
+    return;
+    }
+  if (task.Rotation)
+    {
+    it->second.Task = 0;
+    if (task.IsCanceled())
+      {
+      entries.erase(it);
+      return;
+      }
+    it->second.Planes = task.Output;
+    it->second.Ready = true;
+    return;
+    }
+
+  it->second.Task = 0;
+  vtkMRMLVolumeNode* outputNode = vtkMRMLVolumeNode::SafeDownCast(
+    this->GetMRMLScene() ? this->GetMRMLScene()->GetNodeByID(task.Key) : 0);
+  if (task.IsCanceled() || !outputNode)
+    {
+    this->Straightenings.erase(it);
+    return;
+    }
+  it->second.Ready = true;
+  SetVolumeImage(outputNode, task.Output, task.IJKToRAS);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::GetRotation(vtkMRMLVolumeNode* volumeNode,
+              vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+              const int planeDimensions[2], double planeSpacing,
+              std::string& key, Straightening& rotation)
+{
+  // One plane per degree from 0 to 180
+  if (!trajectoryList || !trajectoryList->GetID() ||
+      !this->GetStraightening(volumeNode, trajectoryList, row, 181,
+                              planeDimensions, planeSpacing, rotation))
+    {
+    return false;
+    }
+  std::stringstream keyStream;
+  keyStream << rotation.VolumeNodeID << " " << rotation.TrajectoryListNodeID
+            << " " << trajectoryList->GetTrajectoryUID(row);
+  key = keyStream.str();
+
+  // Coarser planes until they fit in the cache
+  double voxelSize = volumeNode->GetImageData()->GetScalarSize() / (1024.0 * 1024.0);
+  for (;;)
+    {
+    rotation.Size = voxelSize * rotation.NumberOfPlanes *
+      rotation.PlaneDimensions[0] * rotation.PlaneDimensions[1];
+    if (rotation.Size <= this->RotationCacheSize)
+      {
+      break;
+      }
+    if (rotation.NumberOfPlanes > 46)
+      {
+      rotation.NumberOfPlanes = (rotation.NumberOfPlanes - 1) / 2 + 1;
+      }
+    else if (std::min(rotation.PlaneDimensions[0], rotation.PlaneDimensions[1]) >= 64)
+      {
+      rotation.PlaneDimensions[0] = (rotation.PlaneDimensions[0] + 1) / 2;
+      rotation.PlaneDimensions[1] = (rotation.PlaneDimensions[1] + 1) / 2;
+      rotation.PlaneSpacing *= 2.0;
+      }
+    else
+      {
+      break;
+      }
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::StartRotation(vtkMRMLVolumeNode* volumeNode,
+                vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                const int planeDimensions[2], double planeSpacing)
+{
+  std::string key;
+  Straightening rotation;
+  if (!this->GetRotation(volumeNode, trajectoryList, row, planeDimensions,
+                         planeSpacing, key, rotation))
+    {
+    vtkErrorMacro("StartRotation: Invalid volume or trajectory");
+    return false;
+    }
+
+  rotation.LastUse = ++this->RotationCacheClock;
+  std::map<std::string, Straightening>::iterator it = this->Rotations.find(key);
+  if (it != this->Rotations.end() &&
+      (it->second.Ready || it->second.Task) &&
+      it->second.IsSameAs(rotation))
+    {
+    it->second.LastUse = rotation.LastUse;
+    return true;
+    }
+
+  // Evict the least recently used planes of the other trajectories
+  for (;;)
+    {
+    double size = rotation.Size;
+    std::map<std::string, Straightening>::iterator oldest = this->Rotations.end();
+    for (it = this->Rotations.begin(); it != this->Rotations.end(); ++it)
+      {
+      if (it->first == key)
+        {
+        continue;
+        }
+      size += it->second.Size;
+      if (oldest == this->Rotations.end() ||
+          it->second.LastUse < oldest->second.LastUse)
+        {
+        oldest = it;
+        }
+      }
+    if (size <= this->RotationCacheSize || oldest == this->Rotations.end())
+      {
+      break;
+      }
+    this->TaskScheduler->Cancel(("Rotation:" + oldest->first).c_str());
+    this->Rotations.erase(oldest);
+    }
+
+  // Plane k is rotated by k / (numberOfPlanes - 1) * 180 degrees
+  double direction[3];
+  vtkMath::Subtract(rotation.Target, rotation.Entry, direction);
+  vtkMath::Normalize(direction);
+  StraighteningTask* task = new StraighteningTask(
+    this, volumeNode, rotation.NumberOfPlanes, rotation.PlaneDimensions);
+  task->Key = key;
+  task->Rotation = true;
+  for (int k = 0; k < rotation.NumberOfPlanes; ++k)
+    {
+    double normal[3];
+    double rowAxis[3];
+    vtkMath::Perpendiculars(direction, normal, NULL,
+                            vtkMath::Pi() * k / (rotation.NumberOfPlanes - 1));
+    vtkMath::Cross(normal, direction, rowAxis);
+    double* axes = &task->Job.PlaneAxes[9 * k];
+    for (int i = 0; i < 3; ++i)
+      {
+      axes[3 + i] = direction[i] * rotation.PlaneSpacing;
+      axes[6 + i] = rowAxis[i] * rotation.PlaneSpacing;
+      axes[i] = rotation.Target[i] -
+        0.5 * (rotation.PlaneDimensions[0] - 1) * axes[3 + i] -
+        0.5 * (rotation.PlaneDimensions[1] - 1) * axes[6 + i];
+      }
+    }
+
+  rotation.Task = task;
+  this->Rotations[key] = rotation;
+  this->TaskScheduler->Submit(task, ("Rotation:" + key).c_str());
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::ShowRotatedPlane(vtkMRMLVolumeNode* volumeNode,
+                   vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                   const int planeDimensions[2], double planeSpacing,
+                   double angle, vtkMRMLVolumeNode* outputNode)
+{
+  std::string key;
+  Straightening rotation;
+  if (!outputNode || !outputNode->GetID() ||
+      !this->GetRotation(volumeNode, trajectoryList, row, planeDimensions,
+                         planeSpacing, key, rotation))
+    {
+    return false;
+    }
+  std::map<std::string, Straightening>::iterator it = this->Rotations.find(key);
+  if (it == this->Rotations.end() || !it->second.Ready ||
+      !it->second.IsSameAs(rotation))
+    {
+    return false;
+    }
+  it->second.LastUse = ++this->RotationCacheClock;
+
+  // The plane the closest to the angle is placed in the plane at this
+  // angle, where the slice is
+  int plane = static_cast<int>(floor(angle / 180.0 * (rotation.NumberOfPlanes - 1) + 0.5));
+  plane = std::min(std::max(plane, 0), rotation.NumberOfPlanes - 1);
+  double direction[3];
+  vtkMath::Subtract(rotation.Target, rotation.Entry, direction);
+  vtkMath::Normalize(direction);
+  double normal[3];
+  double rowAxis[3];
+  vtkMath::Perpendiculars(direction, normal, NULL, vtkMath::RadiansFromDegrees(angle));
+  vtkMath::Cross(normal, direction, rowAxis);
+  double ijkToRAS[4][4];
+  for (int i = 0; i < 3; ++i)
+    {
+    ijkToRAS[i][0] = direction[i] * rotation.PlaneSpacing;
+    ijkToRAS[i][1] = rowAxis[i] * rotation.PlaneSpacing;
+    ijkToRAS[i][2] = normal[i] * rotation.PlaneSpacing;
+    ijkToRAS[i][3] = rotation.Target[i] -
+      0.5 * (rotation.PlaneDimensions[0] - 1) * ijkToRAS[i][0] -
+      0.5 * (rotation.PlaneDimensions[1] - 1) * ijkToRAS[i][1] -
+      plane * ijkToRAS[i][2];
+    ijkToRAS[3][i] = 0.0;
+    }
+  ijkToRAS[3][3] = 1.0;
+
+  // The output doesn't hold a straightened volume anymore
+  this->CancelStraightening(outputNode);
+  SetVolumeImage(outputNode, it->second.Planes, ijkToRAS);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::RemoveRotations(vtkMRMLNode* node)
+{
+  std::map<std::string, Straightening>::iterator it = this->Rotations.begin();
+  while (it != this->Rotations.end())
+    {
+    if (it->second.VolumeNodeID == node->GetID() ||
+        it->second.TrajectoryListNodeID == node->GetID())
+      {
+      this->TaskScheduler->Cancel(("Rotation:" + it->first).c_str());
+      this->Rotations.erase(it++);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::TrackMetric(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+              const char* metricName, int metricType, vtkMRMLNode* inputNode)
+{
+  if (!trajectoryList || !trajectoryList->GetID() || !metricName ||
+      !inputNode || !inputNode->GetID())
+    {
+    vtkErrorMacro("TrackMetric: No trajectory list, metric or input");
+    return;
+    }
+  if ((metricType == ClearanceMetric && !vtkMRMLVolumeNode::SafeDownCast(inputNode)) ||
+      (metricType == ModelDistanceMetric && !vtkMRMLModelNode::SafeDownCast(inputNode)) ||
+      (metricType != ClearanceMetric && metricType != ModelDistanceMetric))
+    {
+    vtkErrorMacro("TrackMetric: Invalid input " << inputNode->GetID()
+                  << " for metric " << metricName);
+    return;
+    }
+
+  std::map<std::string, TrackedList>::iterator listIt =
+    this->TrackedLists.find(trajectoryList->GetID());
+  if (listIt == this->TrackedLists.end())
+    {
+    listIt = this->TrackedLists.insert(
+      std::make_pair(std::string(trajectoryList->GetID()), TrackedList())).first;
+    TrackedList& trackedList = listIt->second;
+    trackedList.Node = trajectoryList;
+    const unsigned long events[] = {
+      vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent,
+      vtkMRMLPathPlannerTrajectoryNode::TrajectoryRemovedEvent,
+      vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent,
+      vtkCommand::ModifiedEvent,
+      vtkCommand::DeleteEvent };
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); ++i)
+      {
+      trackedList.ObserverTags.push_back(
+        trajectoryList->AddObserver(events[i], this->MetricEventCallback));
+      }
+    this->SynchronizeTrackedTrajectories(trackedList);
+    }
+  TrackedList& trackedList = listIt->second;
+
+  // Same input: the values are still valid
+  if (!trackedList.Tracker.TrackMetric(metricName, metricType, inputNode->GetID()))
+    {
+    return;
+    }
+  this->ObserveMetricInput(inputNode);
+  this->ReleaseMetricInputs();
+  this->CancelMetricUpdate();
+  this->StartMetricUpdate();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::UntrackMetric(vtkMRMLPathPlannerTrajectoryNode* trajectoryList, const char* metricName)
+{
+  if (!trajectoryList || !trajectoryList->GetID() || !metricName)
+    {
+    return;
+    }
+  std::map<std::string, TrackedList>::iterator listIt =
+    this->TrackedLists.find(trajectoryList->GetID());
+  if (listIt == this->TrackedLists.end())
+    {
+    return;
+    }
+  vtkPathExplorerMetricTracker& tracker = listIt->second.Tracker;
+  tracker.UntrackMetric(metricName);
+  if (tracker.GetNumberOfMetrics() == 0)
+    {
+    this->UntrackMetrics(trajectoryList);
+    return;
+    }
+  // The other metrics of the update are computed again by the next one
+  if (this->IsMetricUpdateComputing(trajectoryList->GetID(), metricName))
+    {
+    this->CancelMetricUpdate();
+    }
+  this->ReleaseMetricInputs();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::UntrackMetrics(vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  if (!trajectoryList || !trajectoryList->GetID())
+    {
+    return;
+    }
+  std::map<std::string, TrackedList>::iterator listIt =
+    this->TrackedLists.find(trajectoryList->GetID());
+  if (listIt == this->TrackedLists.end())
+    {
+    return;
+    }
+  std::vector<unsigned long>& tags = listIt->second.ObserverTags;
+  for (size_t i = 0; i < tags.size(); ++i)
+    {
+    trajectoryList->RemoveObserver(tags[i]);
+    }
+  this->TrackedLists.erase(listIt);
+  if (this->IsMetricUpdateComputing(trajectoryList->GetID(), 0))
+    {
+    this->CancelMetricUpdate();
+    }
+  this->ReleaseMetricInputs();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic
+::GetNumberOfTrackedMetrics(vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  if (!trajectoryList || !trajectoryList->GetID())
+    {
+    return 0;
+    }
+  std::map<std::string, TrackedList>::iterator listIt =
+    this->TrackedLists.find(trajectoryList->GetID());
+  return listIt == this->TrackedLists.end() ? 0 :
+    listIt->second.Tracker.GetNumberOfMetrics();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::SynchronizeTrackedTrajectory(TrackedList& trackedList, int row)
+{
+  int uid = trackedList.Node->GetTrajectoryUID(row);
+  if (uid < 0)
+    {
+    return false;
+    }
+  double entry[3];
+  double target[3];
+  trackedList.Node->GetEntryPosition(row, entry);
+  trackedList.Node->GetTargetPosition(row, target);
+  return trackedList.Tracker.SetTrajectory(uid, entry, target);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::SynchronizeTrackedTrajectories(TrackedList& trackedList)
+{
+  bool invalidated = false;
+  std::set<int> uids;
+  int numberOfTrajectories = trackedList.Node->GetNumberOfTrajectories();
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    invalidated = this->SynchronizeTrackedTrajectory(trackedList, row) || invalidated;
+    uids.insert(trackedList.Node->GetTrajectoryUID(row));
+    }
+  // Removed trajectories
+  trackedList.Tracker.RemoveOtherTrajectories(uids);
+  return invalidated;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::OnMetricEvent(vtkObject* caller, unsigned long event,
+                void* clientData, void* callData)
+{
+  vtkSlicerPathExplorerLogic* self =
+    reinterpret_cast<vtkSlicerPathExplorerLogic*>(clientData);
+  vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(caller);
+  if (!self || !node || !node->GetID())
+    {
+    return;
+    }
+  // Nodes deleted outside of a scene are dropped as if removed
+  if (event == vtkCommand::DeleteEvent)
+    {
+    self->OnMRMLSceneNodeRemoved(node);
+    return;
+    }
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList =
+    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(node);
+  if (trajectoryList && self->TrackedLists.count(node->GetID()))
+    {
+    self->OnTrackedListEvent(trajectoryList, event, callData);
+    }
+  else if (self->MetricInputs.count(node->GetID()))
+    {
+    self->OnMetricInputEvent(node, event);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::OnTrackedListEvent(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                     unsigned long event, void* callData)
+{
+  TrackedList& trackedList = this->TrackedLists[trajectoryList->GetID()];
+  int* row = reinterpret_cast<int*>(callData);
+
+  // A moved fiducial only invalidates the rows using it
+  bool invalidated;
+  if (row && (event == vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent ||
+              event == vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent))
+    {
+    invalidated = this->SynchronizeTrackedTrajectory(trackedList, *row);
+    }
+  else
+    {
+    invalidated = this->SynchronizeTrackedTrajectories(trackedList);
+    }
+  if (invalidated)
+    {
+    this->StartMetricUpdate();
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::OnMetricInputEvent(vtkMRMLNode* inputNode,
+                                                    unsigned long event)
+{
+  MetricInput& input = this->MetricInputs[inputNode->GetID()];
+  if (event == vtkCommand::ModifiedEvent)
+    {
+    // Only a new geometry changes the values
+    double geometry[16];
+    if (!GetVolumeGeometry(inputNode, geometry) ||
+        std::equal(geometry, geometry + 16, input.Geometry))
+      {
+      return;
+      }
+    std::copy(geometry, geometry + 16, input.Geometry);
+    }
+
+  bool invalidated = false;
+  for (std::map<std::string, TrackedList>::iterator listIt = this->TrackedLists.begin();
+       listIt != this->TrackedLists.end(); ++listIt)
+    {
+    invalidated = listIt->second.Tracker.InvalidateInput(inputNode->GetID()) || invalidated;
+    }
+  if (invalidated)
+    {
+    this->CancelMetricUpdate();
+    this->StartMetricUpdate();
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::ObserveMetricInput(vtkMRMLNode* inputNode)
+{
+  if (this->MetricInputs.count(inputNode->GetID()))
+    {
+    return;
+    }
+  MetricInput& input = this->MetricInputs[inputNode->GetID()];
+  input.Node = inputNode;
+  std::fill(input.Geometry, input.Geometry + 16, 0.0);
+  std::vector<unsigned long> events;
+  if (GetVolumeGeometry(inputNode, input.Geometry))
+    {
+    events.push_back(vtkCommand::ModifiedEvent);
+    events.push_back(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+    }
+  else
+    {
+    events.push_back(vtkMRMLModelNode::PolyDataModifiedEvent);
+    }
+  events.push_back(vtkMRMLTransformableNode::TransformModifiedEvent);
+  events.push_back(vtkCommand::DeleteEvent);
+  for (size_t i = 0; i < events.size(); ++i)
+    {
+    input.ObserverTags.push_back(
+      inputNode->AddObserver(events[i], this->MetricEventCallback));
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::ReleaseMetricInputs()
+{
+  std::set<std::string> usedInputIDs;
+  for (std::map<std::string, TrackedList>::iterator listIt = this->TrackedLists.begin();
+       listIt != this->TrackedLists.end(); ++listIt)
+    {
+    listIt->second.Tracker.GetInputNodeIDs(usedInputIDs);
+    }
+
+  std::map<std::string, MetricInput>::iterator it = this->MetricInputs.begin();
+  while (it != this->MetricInputs.end())
+    {
+    if (usedInputIDs.count(it->first))
+      {
+      ++it;
+      continue;
+      }
+    for (size_t i = 0; i < it->second.ObserverTags.size(); ++i)
+      {
+      it->second.Node->RemoveObserver(it->second.ObserverTags[i]);
+      }
+    this->MetricInputs.erase(it++);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::StartMetricUpdate()
+{
+  // Values invalidated meanwhile are computed by the next update
+  if (this->RunningMetricUpdate)
+    {
+    return;
+    }
+
+  MetricUpdate* update = new MetricUpdate(this);
+  update->Step = this->SamplingStep;
+  update->NumberOfThreads = this->NumberOfSamplingThreads;
+  for (std::map<std::string, TrackedList>::iterator listIt = this->TrackedLists.begin();
+       listIt != this->TrackedLists.end(); ++listIt)
+    {
+    vtkPathExplorerMetricTracker& tracker = listIt->second.Tracker;
+    for (int i = 0; i < tracker.GetNumberOfMetrics(); ++i)
+      {
+      vtkPathExplorerMetricTracker::Metric& metric = *tracker.GetMetric(i);
+      if (metric.InvalidUIDs.empty())
+        {
+        continue;
+        }
+      update->Items.push_back(MetricUpdate::Item());
+      MetricUpdate::Item& item = update->Items.back();
+      item.ListID = listIt->first;
+      item.MetricName = metric.Name;
+      item.Type = metric.Type;
+      item.InputNodeID = metric.InputNodeID;
+      item.InputVersion = metric.InputVersion;
+      for (std::set<int>::iterator it = metric.InvalidUIDs.begin();
+           it != metric.InvalidUIDs.end(); ++it)
+        {
+        const vtkPathExplorerMetricTracker::Trajectory* trajectory =
+          tracker.GetTrajectory(*it);
+        item.UIDs.push_back(*it);
+        item.Versions.push_back(trajectory->Version);
+        item.EntryPositions.insert(item.EntryPositions.end(),
+                                   trajectory->Entry, trajectory->Entry + 3);
+        item.TargetPositions.insert(item.TargetPositions.end(),
+                                    trajectory->Target, trajectory->Target + 3);
+        }
+      metric.InvalidUIDs.clear();
+
+      // Inputs are read now, the update thread doesn't access MRML
+      vtkMRMLNode* inputNode = this->MetricInputs[item.InputNodeID].Node;
+      if (item.Type == ClearanceMetric)
+        {
+        vtkMRMLVolumeNode* labelMapNode = vtkMRMLVolumeNode::SafeDownCast(inputNode);
+        vtkImageData* image = labelMapNode ? labelMapNode->GetImageData() : 0;
+        if (image && image->GetScalarPointer() &&
+            PrepareSamplingVolume(labelMapNode, item.LabelMap))
+          {
+          item.Image = image;
+          item.Scalars = image->GetPointData()->GetScalars();
+          item.Labels = image->GetScalarPointer();
+          item.ScalarType = image->GetScalarType();
+          item.NumberOfComponents = image->GetNumberOfScalarComponents();
+          std::copy(labelMapNode->GetSpacing(), labelMapNode->GetSpacing() + 3,
+                    item.Spacing);
+          item.DistanceMap = this->GetCachedDistanceMap(labelMapNode);
+          for (size_t j = 0; !item.DistanceMap && j + 1 < update->Items.size(); ++j)
+            {
+            if (update->Items[j].InputNodeID == item.InputNodeID)
+              {
+              item.DistanceMap = update->Items[j].DistanceMap;
+              }
+            }
+          if (!item.DistanceMap)
+            {
+            item.NewDistanceMap = new DistanceMap;
+            item.NewDistanceMap->ImageMTime = image->GetMTime();
+            std::copy(item.Spacing, item.Spacing + 3, item.NewDistanceMap->Spacing);
+            item.DistanceMap = item.NewDistanceMap;
+            }
+          item.Valid = true;
+          }
+        }
+      else
+        {
+        item.Hierarchy = this->GetModelHierarchy(vtkMRMLModelNode::SafeDownCast(inputNode));
+        item.Valid = item.Hierarchy != 0;
+        }
+      if (!item.Valid)
+        {
+        vtkWarningMacro("StartMetricUpdate: Unable to compute metric "
+                        << item.MetricName << " from " << item.InputNodeID);
+        }
+      }
+    }
+
+  if (update->Items.empty())
+    {
+    delete update;
+    return;
+    }
+  this->RunningMetricUpdate = update;
+  this->MetricUpdateTaskID = this->TaskScheduler->Submit(update, MetricUpdateKey);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::RunMetricUpdate(MetricUpdate& update)
+{
+  // Progress is the fraction of the values computed
+  size_t numberOfValues = 0;
+  for (size_t i = 0; i < update.Items.size(); ++i)
+    {
+    numberOfValues += update.Items[i].UIDs.size();
+    }
+  size_t computedValues = 0;
+
+  for (size_t i = 0; i < update.Items.size(); ++i)
+    {
+    MetricUpdate::Item& item = update.Items[i];
+    int numberOfTrajectories = static_cast<int>(item.UIDs.size());
+    item.Values.assign(numberOfTrajectories, std::numeric_limits<double>::quiet_NaN());
+    double progressStart = static_cast<double>(computedValues) / numberOfValues;
+    computedValues += numberOfTrajectories;
+    double progressEnd = static_cast<double>(computedValues) / numberOfValues;
+    if (update.IsCanceled())
+      {
+      return;
+      }
+    if (!item.Valid)
+      {
+      update.SetProgress(progressEnd);
+      continue;
+      }
+
+    if (item.Type == ClearanceMetric)
+      {
+      if (item.NewDistanceMap)
+        {
+        SamplingVolume labels;
+        SetVolumeData(labels, item.Labels, item.ScalarType,
+                      item.LabelMap.Data.Dimensions, item.NumberOfComponents);
+        if (!ComputeSignedDistanceMap(labels.Data, item.Spacing, update.NumberOfThreads,
+                                      item.NewDistanceMap->Distances))
+          {
+          item.NewDistanceMap->Distances.clear();
+          }
+        }
+      // Map computed by a previous item, or not computed
+      if (item.DistanceMap->Distances.empty())
+        {
+        continue;
+        }
+      ClearanceJob job;
+      job.DistanceMap = item.LabelMap;
+      SetVolumeData(job.DistanceMap, &item.DistanceMap->Distances[0], VTK_FLOAT,
+                    item.LabelMap.Data.Dimensions, 1);
+      job.NumberOfItems = numberOfTrajectories;
+      job.EntryPositions = &item.EntryPositions[0];
+      job.TargetPositions = &item.TargetPositions[0];
+      job.Step = update.Step;
+      job.Clearances.resize(numberOfTrajectories);
+      job.Task = &update;
+      job.ProgressStart = progressStart;
+      job.ProgressEnd = progressEnd;
+      RunParallelJob(job, update.NumberOfThreads);
+      item.Values = job.Clearances;
+      }
+    else
+      {
+      ModelQueryJob job;
+      job.Hierarchies.push_back(item.Hierarchy);
+      job.NumberOfItems = numberOfTrajectories;
+      job.EntryPositions = &item.EntryPositions[0];
+      job.TargetPositions = &item.TargetPositions[0];
+      job.Intersection = false;
+      job.Results = &item.Values;
+      job.Task = &update;
+      job.ProgressStart = progressStart;
+      job.ProgressEnd = progressEnd;
+      RunParallelJob(job, update.NumberOfThreads);
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::CancelMetricUpdate()
+{
+  if (this->RunningMetricUpdate)
+    {
+    this->TaskScheduler->Cancel(MetricUpdateKey);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::IsMetricUpdateComputing(const char* nodeID, const char* metricName)
+{
+  if (!this->RunningMetricUpdate || !nodeID)
+    {
+    return false;
+    }
+  const std::vector<MetricUpdate::Item>& items = this->RunningMetricUpdate->Items;
+  for (size_t i = 0; i < items.size(); ++i)
+    {
+    if ((items[i].ListID == nodeID &&
+         (!metricName || items[i].MetricName == metricName)) ||
+        (!metricName && items[i].InputNodeID == nodeID))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::FinishMetricUpdate()
+{
+  // Called by the scheduler, which deletes the update
+  MetricUpdate* update = this->RunningMetricUpdate;
+  this->RunningMetricUpdate = 0;
+  this->MetricUpdateTaskID = -1;
+  bool canceled = update->IsCanceled();
+
+  // Distance maps computed for inputs still in use are cached, even if the
+  // update was canceled
+  for (size_t i = 0; i < update->Items.size(); ++i)
+    {
+    MetricUpdate::Item& item = update->Items[i];
+    if (item.NewDistanceMap && !item.NewDistanceMap->Distances.empty() &&
+        this->MetricInputs.count(item.InputNodeID))
+      {
+      this->SetDistanceMap(item.InputNodeID, item.NewDistanceMap);
+      item.NewDistanceMap = 0;
+      }
+    }
+
+  // One modification per list
+  std::map<vtkMRMLPathPlannerTrajectoryNode*, int> modifiedLists;
+  for (size_t i = 0; i < update->Items.size(); ++i)
+    {
+    const MetricUpdate::Item& item = update->Items[i];
+    std::map<std::string, TrackedList>::iterator listIt =
+      this->TrackedLists.find(item.ListID);
+    if (listIt == this->TrackedLists.end())
+      {
+      continue;
+      }
+    TrackedList& trackedList = listIt->second;
+    vtkPathExplorerMetricTracker::Metric* metric =
+      trackedList.Tracker.FindMetric(item.MetricName.c_str());
+    // Values of a previous input
+    if (!metric || metric->InputVersion != item.InputVersion ||
+        metric->InputNodeID != item.InputNodeID)
+      {
+      continue;
+      }
+
+    // Values left to compute by the next update
+    if (canceled)
+      {
+      for (size_t j = 0; j < item.UIDs.size(); ++j)
+        {
+        trackedList.Tracker.InvalidateValue(*metric, item.UIDs[j]);
+        }
+      continue;
+      }
+
+    vtkMRMLPathPlannerTrajectoryNode* trajectoryList = trackedList.Node;
+    if (!modifiedLists.count(trajectoryList))
+      {
+      modifiedLists[trajectoryList] = trajectoryList->StartModify();
+      }
+    int metricIndex = trajectoryList->AddMetric(item.MetricName.c_str());
+    for (size_t j = 0; j < item.UIDs.size(); ++j)
+      {
+      // Trajectories moved or removed since the update started
+      const vtkPathExplorerMetricTracker::Trajectory* trajectory =
+        trackedList.Tracker.GetTrajectory(item.UIDs[j]);
+      int row = trajectoryList->GetTrajectoryRow(item.UIDs[j]);
+      if (!trajectory || row < 0 || trajectory->Version != item.Versions[j])
+        {
+        continue;
+        }
+      trajectoryList->SetMetricValue(row, metricIndex, item.Values[j]);
+      ++this->NumberOfUpdatedMetricValues;
+      }
+    }
+
+  for (std::map<vtkMRMLPathPlannerTrajectoryNode*, int>::iterator it =
+         modifiedLists.begin(); it != modifiedLists.end(); ++it)
+    {
+    it->first->EndModify(it->second);
+    }
+  if (!this->IsReadingCaches())
+    {
+    this->DeleteRetiredCacheEntries();
+    }
+  this->StartMetricUpdate();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::UpdateMetrics(bool wait)
+{
+  // Finishing an update starts the next one
+  this->NumberOfUpdatedMetricValues = 0;
+  this->TaskScheduler->ProcessFinishedTasks();
+  this->StartMetricUpdate();
+  while (wait && this->RunningMetricUpdate)
+    {
+    this->TaskScheduler->Wait(this->MetricUpdateTaskID);
+    this->TaskScheduler->ProcessFinishedTasks();
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkPathExplorerTaskScheduler* vtkSlicerPathExplorerLogic::GetTaskScheduler()
+{
+  return this->TaskScheduler;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic::HasPendingMetrics()
+{
+  if (this->RunningMetricUpdate)
+    {
+    return true;
+    }
+  for (std::map<std::string, TrackedList>::iterator listIt = this->TrackedLists.begin();
+       listIt != this->TrackedLists.end(); ++listIt)
+    {
+    if (listIt->second.Tracker.HasInvalidValues())
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPathExplorerLogic
+::RegisterObserver(vtkObject* object, unsigned long event,
+                   void* observer, const char* callback)
+{
+  if (!object || !callback)
+    {
+    return false;
+    }
+
+  std::map<vtkObject*, ObservedObject>::iterator it =
+    this->ObservedObjects.find(object);
+  if (it == this->ObservedObjects.end())
+    {
+    it = this->ObservedObjects.insert(
+      std::make_pair(object, ObservedObject())).first;
+    it->second.DeleteObserverTag =
+      object->AddObserver(vtkCommand::DeleteEvent, this->ObservedObjectDeleteCallback);
+    }
+  Observation observation(event, std::make_pair(observer, std::string(callback)));
+  return it->second.Observations.insert(observation).second;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::UnregisterObserver(vtkObject* object, unsigned long event,
+                     void* observer, const char* callback)
+{
+  if (!object || !callback)
+    {
+    return;
+    }
+
+  std::map<vtkObject*, ObservedObject>::iterator it =
+    this->ObservedObjects.find(object);
+  if (it == this->ObservedObjects.end())
+    {
+    return;
+    }
+  Observation observation(event, std::make_pair(observer, std::string(callback)));
+  it->second.Observations.erase(observation);
+  if (it->second.Observations.empty())
+    {
+    object->RemoveObserver(it->second.DeleteObserverTag);
+    this->ObservedObjects.erase(it);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::UnregisterObservers(void* observer)
+{
+  std::map<vtkObject*, ObservedObject>::iterator it =
+    this->ObservedObjects.begin();
+  while (it != this->ObservedObjects.end())
+    {
+    std::set<Observation>& observations = it->second.Observations;
+    for (std::set<Observation>::iterator obsIt = observations.begin();
+         obsIt != observations.end();)
+      {
+      if (obsIt->second.first == observer)
+        {
+        observations.erase(obsIt++);
+        }
+      else
+        {
+        ++obsIt;
+        }
+      }
+    if (observations.empty())
+      {
+      it->first->RemoveObserver(it->second.DeleteObserverTag);
+      this->ObservedObjects.erase(it++);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic::GetNumberOfObservers(vtkObject* object)
+{
+  std::map<vtkObject*, ObservedObject>::iterator it =
+    this->ObservedObjects.find(object);
+  if (it == this->ObservedObjects.end())
+    {
+    return 0;
+    }
+  return static_cast<int>(it->second.Observations.size());
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic::GetNumberOfObservers()
+{
+  int numberOfObservers = 0;
+  for (std::map<vtkObject*, ObservedObject>::iterator it =
+         this->ObservedObjects.begin(); it != this->ObservedObjects.end(); ++it)
+    {
+    numberOfObservers += static_cast<int>(it->second.Observations.size());
+    }
+  return numberOfObservers;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPathExplorerLogic::GetNumberOfObservedObjects()
+{
+  return static_cast<int>(this->ObservedObjects.size());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic
+::OnObservedObjectDeleted(vtkObject* caller, unsigned long vtkNotUsed(event),
+                          void* clientData, void* vtkNotUsed(callData))
+{
+  vtkSlicerPathExplorerLogic* self =
+    reinterpret_cast<vtkSlicerPathExplorerLogic*>(clientData);
+  if (self)
+    {
+    self->ObservedObjects.erase(caller);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::CallbackInvoked(const char* callback, double seconds)
+{
+  if (!callback)
+    {
+    return;
+    }
+
+  double now = vtkTimerLog::GetUniversalTime();
+  std::map<std::string, CallbackCounter>::iterator it =
+    this->CallbackCounters.find(callback);
+  if (it == this->CallbackCounters.end())
+    {
+    CallbackCounter counter;
+    counter.Count = 0;
+    counter.Time = 0.0;
+    counter.WindowStart = now;
+    counter.WindowCount = 0;
+    counter.Rate = 0.0;
+    it = this->CallbackCounters.insert(std::make_pair(std::string(callback), counter)).first;
+    }
+
+  CallbackCounter& counter = it->second;
+  if (now - counter.WindowStart >= 1.0)
+    {
+    counter.Rate = counter.WindowCount / (now - counter.WindowStart);
+    counter.WindowStart = now;
+    counter.WindowCount = 0;
+    }
+  ++counter.Count;
+  ++counter.WindowCount;
+  counter.Time += seconds;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerPathExplorerLogic::GetNumberOfCallbacks(const char* callback)
+{
+  std::map<std::string, CallbackCounter>::iterator it =
+    callback ? this->CallbackCounters.find(callback) : this->CallbackCounters.end();
+  return it != this->CallbackCounters.end() ? it->second.Count : 0;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerPathExplorerLogic::GetCallbacksPerSecond(const char* callback)
+{
+  std::map<std::string, CallbackCounter>::iterator it =
+    callback ? this->CallbackCounters.find(callback) : this->CallbackCounters.end();
+  if (it == this->CallbackCounters.end())
+    {
+    return 0.0;
+    }
+
+  // No callback closed the window: rate falls off when callbacks stop
+  const CallbackCounter& counter = it->second;
+  double elapsed = vtkTimerLog::GetUniversalTime() - counter.WindowStart;
+  if (elapsed >= 1.0)
+    {
+    return counter.WindowCount / elapsed;
+    }
+  return counter.Rate;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerPathExplorerLogic::GetCallbackTime(const char* callback)
+{
+  std::map<std::string, CallbackCounter>::iterator it =
+    callback ? this->CallbackCounters.find(callback) : this->CallbackCounters.end();
+  return it != this->CallbackCounters.end() ? it->second.Time : 0.0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPathExplorerLogic::ResetCallbackCounters()
+{
+  this->CallbackCounters.clear();
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerPathExplorerLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
 {
+  this->CancelMetricUpdate();
+  while (!this->TrackedLists.empty())
+    {
+    this->UntrackMetrics(this->TrackedLists.begin()->second.Node);
+    }
+
   vtkNew<vtkIntArray> events;
   events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
   events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
   events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
   this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+  this->ClearDistanceMaps();
+  this->ClearModelHierarchies();
 }
 
 //-----------------------------------------------------------------------------
@@ -70,6 +3620,11 @@ void vtkSlicerPathExplorerLogic::RegisterNodes()
     = vtkMRMLPathPlannerTrajectoryNode::New();
   this->GetMRMLScene()->RegisterNodeClass(trajectoryNode);
   trajectoryNode->Delete();
+
+  vtkMRMLPathPlannerTrajectoryStorageNode* trajectoryStorageNode
+    = vtkMRMLPathPlannerTrajectoryStorageNode::New();
+  this->GetMRMLScene()->RegisterNodeClass(trajectoryStorageNode);
+  trajectoryStorageNode->Delete();
 }
 
 //---------------------------------------------------------------------------
@@ -86,7 +3641,46 @@ void vtkSlicerPathExplorerLogic
 
 //---------------------------------------------------------------------------
 void vtkSlicerPathExplorerLogic
-::OnMRMLSceneNodeRemoved(vtkMRMLNode* vtkNotUsed(node))
+::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
 {
-}
+  if (!node || !node->GetID())
+    {
+    return;
+    }
+  this->UntrackMetrics(vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(node));
+  this->CancelRobustnessAnalysis(vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(node));
+  for (size_t i = 0; i < this->RobustnessTasks.size(); ++i)
+    {
+    if (this->RobustnessTasks[i]->LabelMapID == node->GetID())
+      {
+      this->CancelRobustnessAnalysis(this->RobustnessTasks[i]->TrajectoryList);
+      }
+    }
+  if (this->MetricInputs.count(node->GetID()))
+    {
+    std::vector<std::pair<vtkMRMLPathPlannerTrajectoryNode*, std::string> > metrics;
+    for (std::map<std::string, TrackedList>::iterator listIt = this->TrackedLists.begin();
+         listIt != this->TrackedLists.end(); ++listIt)
+      {
+      vtkPathExplorerMetricTracker& tracker = listIt->second.Tracker;
+      for (int i = 0; i < tracker.GetNumberOfMetrics(); ++i)
+        {
+        if (tracker.GetMetric(i)->InputNodeID == node->GetID())
+          {
+          metrics.push_back(std::make_pair(listIt->second.Node,
+                                           tracker.GetMetric(i)->Name));
+          }
+        }
+      }
+    for (size_t i = 0; i < metrics.size(); ++i)
+      {
+      this->UntrackMetric(metrics[i].first, metrics[i].second.c_str());
+      }
+    }
 
+  // Entries read by a running update are deleted with it
+  this->RemoveDistanceMap(node->GetID());
+  this->RemoveModelHierarchy(node->GetID());
+  this->CancelStraightening(vtkMRMLVolumeNode::SafeDownCast(node));
+  this->RemoveRotations(node);
+}
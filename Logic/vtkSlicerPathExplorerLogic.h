@@ -32,13 +32,37 @@
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
 
+// PathExplorer Logic includes
+#include "vtkPathExplorerEntrySearch.h"
+#include "vtkPathExplorerMetricTracker.h"
+#include "vtkPathExplorerRobustnessAnalysis.h"
+#include "vtkPathExplorerTrajectorySpacing.h"
+#include "vtkPathExplorerTriangleBVH.h"
+
 // MRML includes
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
 // STD includes
 #include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "vtkSlicerPathExplorerModuleLogicExport.h"
 
+class vtkCallbackCommand;
+class vtkCollection;
+class vtkImageData;
+class vtkMRMLAnnotationFiducialNode;
+class vtkMRMLModelNode;
+class vtkMRMLNode;
+class vtkMRMLPathPlannerTrajectoryNode;
+class vtkMRMLVolumeNode;
+class vtkPathExplorerTaskScheduler;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class VTK_SLICER_PATHEXPLORER_MODULE_LOGIC_EXPORT vtkSlicerPathExplorerLogic :
@@ -50,6 +74,384 @@ public:
   vtkTypeMacro(vtkSlicerPathExplorerLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream& os, vtkIndent indent);
 
+  // Description:
+  // Group the scene modifications of a user action (delete, clear, update).
+  // The outermost StartBatch puts the scene in BatchProcessState; the
+  // matching EndBatch invokes one ModifiedEvent per hierarchy passed to
+  // HierarchyModified and ends the batch, so views refresh once.
+  // Calls can be nested.
+  void StartBatch();
+  void EndBatch();
+  bool IsBatching();
+
+  // Description:
+  // Notify that children were added to or removed from a hierarchy.
+  // The ModifiedEvent is deferred to EndBatch when batching.
+  void HierarchyModified(vtkMRMLNode* hierarchyNode);
+
+  // Description:
+  // Distance between two samples along a trajectory, in mm. Default is 1.
+  vtkSetMacro(SamplingStep, double);
+  vtkGetMacro(SamplingStep, double);
+
+  // Description:
+  // Number of threads processing the trajectories (sampling, label
+  // intervals, clearance, model queries, entry point search) and computing
+  // the distance maps.
+  // 0 (default) uses the vtkMultiThreader default, one per core.
+  vtkSetMacro(NumberOfSamplingThreads, int);
+  vtkGetMacro(NumberOfSamplingThreads, int);
+
+  // Description:
+  // Sample scalar volumes along every trajectory of the list, from entry
+  // to target every SamplingStep mm, with trilinear interpolation of the
+  // first scalar component. The profile of each trajectory is stored in the
+  // list (SetTrajectorySamples) with one component per volume. Samples
+  // outside a volume are NaN.
+  // Return false if a volume has no image or a non-linear transform.
+  bool SampleTrajectories(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                          vtkMRMLVolumeNode* volumeNode);
+  bool SampleTrajectories(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                          vtkCollection* volumeNodes);
+
+  // Description:
+  // Part of a trajectory crossing a label. Distances are from the entry
+  // point, in mm.
+  struct LabelInterval
+    {
+    int Label;
+    double Enter;
+    double Exit;
+    };
+  typedef std::vector<LabelInterval> LabelIntervalList;
+
+  // Description:
+  // Return true if the volume is a label map: a vtkMRMLLabelMapVolumeNode,
+  // or a scalar volume with LabelMap set up to Slicer 4.4. Label maps are
+  // resampled without interpolation.
+  static bool IsLabelMapVolume(vtkMRMLVolumeNode* volumeNode);
+
+  // Description:
+  // Walk every trajectory of the list through the voxels of a label map
+  // (3D-DDA, exact) and list the labels it crosses, in order from entry to
+  // target, one list per row. Consecutive voxels with the same label make
+  // one interval; the background (0) is not listed.
+  // Return false if the label map has no image or a non-linear transform.
+  bool ComputeLabelIntervals(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                             vtkMRMLVolumeNode* labelMapNode,
+                             std::vector<LabelIntervalList>& intervals);
+
+  // Description:
+  // Signed Euclidean distance map of a label map (critical structures), in
+  // mm: distance from each voxel center to the closest labeled (non-zero)
+  // voxel center, negative inside the labeled voxels. Values are ordered
+  // like the label map voxels. Maps are computed by a separable linear-time
+  // transform and cached per label map node; a map is only recomputed when
+  // the label map image is modified (MTime) or its spacing changes.
+  // Return 0 if the label map has no image, no labeled or no background voxel.
+  const float* GetDistanceMap(vtkMRMLVolumeNode* labelMapNode);
+  int GetNumberOfDistanceMaps();
+  void ClearDistanceMaps();
+
+  // Description:
+  // Clearance of the trajectories from the critical structures of a label
+  // map: minimum of its distance map sampled every SamplingStep mm from
+  // entry to target, negative if a trajectory goes through a structure,
+  // NaN outside the label map. Stored in the "Clearance" metric of the list.
+  // The row version only updates one trajectory.
+  // Return false if the distance map can't be computed.
+  bool ComputeClearance(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        vtkMRMLVolumeNode* labelMapNode);
+  bool ComputeClearance(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        vtkMRMLVolumeNode* labelMapNode, int row);
+
+  // Description:
+  // Collision queries of the trajectories against surface models (critical
+  // structures given as models), one result per row. Each model gets a
+  // bounding volume hierarchy over its triangles in world coordinates
+  // (vtkPathExplorerTriangleBVH), cached per model node and only rebuilt
+  // when the model polydata or its parent transform changes.
+  // IntersectModels gives the distance in mm from the entry point to the
+  // first intersection with a model, NaN if the trajectory crosses none.
+  // ComputeModelDistances gives the distance in mm from each trajectory to
+  // the closest triangle, 0 if it crosses a model.
+  // Return false if a model has no polydata or a non-linear transform.
+  bool IntersectModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                       vtkMRMLModelNode* modelNode,
+                       std::vector<double>& intersections);
+  bool IntersectModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                       vtkCollection* modelNodes,
+                       std::vector<double>& intersections);
+  bool ComputeModelDistances(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                             vtkMRMLModelNode* modelNode,
+                             std::vector<double>& distances);
+  bool ComputeModelDistances(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                             vtkCollection* modelNodes,
+                             std::vector<double>& distances);
+  int GetNumberOfModelHierarchies();
+  void ClearModelHierarchies();
+
+  // Description:
+  // Parameters of the entry point search (FindEntryPoints), see
+  // vtkPathExplorerEntrySearch.
+  // Candidates are spaced by about EntrySearchSpacing mm on the surface.
+  // Trajectories longer than EntrySearchMaximumLength mm or making more than
+  // EntrySearchMaximumAngle degrees with the surface normal are rejected.
+  // The cost of a trajectory adds its length, its angle and its lack of
+  // clearance (below EntrySearchClearanceMargin mm), each normalized to
+  // [0, 1] for the acceptable values and weighted by EntrySearchWeights
+  // (length, angle, clearance). Entry points returned are at least
+  // EntrySearchMinimumSeparation mm apart.
+  vtkSetMacro(EntrySearchSpacing, double);
+  vtkGetMacro(EntrySearchSpacing, double);
+  vtkSetMacro(EntrySearchMaximumLength, double);
+  vtkGetMacro(EntrySearchMaximumLength, double);
+  vtkSetMacro(EntrySearchMaximumAngle, double);
+  vtkGetMacro(EntrySearchMaximumAngle, double);
+  vtkSetMacro(EntrySearchClearanceMargin, double);
+  vtkGetMacro(EntrySearchClearanceMargin, double);
+  vtkSetVector3Macro(EntrySearchWeights, double);
+  vtkGetVector3Macro(EntrySearchWeights, double);
+  vtkSetMacro(EntrySearchMinimumSeparation, double);
+  vtkGetMacro(EntrySearchMinimumSeparation, double);
+
+  // Description:
+  // Entry point found for a target, with the properties of its trajectory.
+  // Angle is between the trajectory and the surface normal, in degrees.
+  // Clearance is NaN without critical structures.
+  typedef vtkPathExplorerEntrySearch::EntryPoint EntryPoint;
+  typedef vtkPathExplorerEntrySearch::EntryPointList EntryPointList;
+
+  // Description:
+  // Search the entry points of a target on a surface model (skin, skull).
+  // Candidates are sampled on the triangles within reach of the target and
+  // the trajectories from the candidates that see the target (the
+  // trajectory doesn't cross the surface) are scored in parallel. The
+  // optional label map gives the critical structures: trajectories crossing
+  // fewer labels come first, then lower costs. The best entry points, at
+  // most numberOfEntryPoints, are returned in order.
+  // Segmentations are given by their exported model and label map.
+  // Return false if the surface has no polydata or a non-linear transform,
+  // or if the label map can't be used.
+  bool FindEntryPoints(const double target[3], vtkMRMLModelNode* surfaceNode,
+                       vtkMRMLVolumeNode* labelMapNode, int numberOfEntryPoints,
+                       EntryPointList& entryPoints);
+  bool FindEntryPoints(vtkMRMLAnnotationFiducialNode* targetNode,
+                       vtkMRMLModelNode* surfaceNode,
+                       vtkMRMLVolumeNode* labelMapNode, int numberOfEntryPoints,
+                       EntryPointList& entryPoints);
+
+  // Description:
+  // Number of candidates scored by the last FindEntryPoints.
+  vtkGetMacro(NumberOfEntryCandidates, int);
+
+  // Description:
+  // Parameters of the robustness analysis (AnalyzeRobustness). Entry and
+  // target positions are perturbed RobustnessNumberOfSamples times (1000 by
+  // default) by Gaussian errors of covariance EntryErrorCovariance and
+  // TargetErrorCovariance (3x3, row major, in mm^2). The perturbations only
+  // depend on RobustnessSeed and on the trajectory UIDs: results are
+  // reproducible whatever the number of threads (see
+  // vtkPathExplorerRobustnessAnalysis).
+  // SetPositionErrorStandardDeviation sets both covariances to sigma^2 I
+  // (1 mm by default).
+  vtkSetMacro(RobustnessNumberOfSamples, int);
+  vtkGetMacro(RobustnessNumberOfSamples, int);
+  vtkSetMacro(RobustnessSeed, unsigned int);
+  vtkGetMacro(RobustnessSeed, unsigned int);
+  void SetEntryErrorCovariance(const double covariance[9]);
+  void GetEntryErrorCovariance(double covariance[9]);
+  void SetTargetErrorCovariance(const double covariance[9]);
+  void GetTargetErrorCovariance(double covariance[9]);
+  void SetPositionErrorStandardDeviation(double sigma);
+
+  // Description:
+  // Robustness of a trajectory to the positioning errors, NaN clearances
+  // outside the label map.
+  typedef vtkPathExplorerRobustnessAnalysis::TrajectoryRobustness TrajectoryRobustness;
+  typedef std::vector<TrajectoryRobustness> TrajectoryRobustnessList;
+
+  // Description:
+  // Monte Carlo robustness analysis of every trajectory of the list against
+  // the critical structures of a label map, one result per row. The
+  // clearance of each perturbed trajectory is sampled in the distance map
+  // (see ComputeClearance) and its labels are traversed (see
+  // ComputeLabelIntervals) unless the clearance shows it crosses none.
+  // The probabilities and robust clearance are also stored in the
+  // "CollisionProbability", "HitProbability_<label>" and "RobustClearance"
+  // metrics of the list.
+  // Return false if the label map can't be used or a covariance isn't
+  // positive semi-definite.
+  bool AnalyzeRobustness(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                         vtkMRMLVolumeNode* labelMapNode,
+                         TrajectoryRobustnessList& results);
+
+  // Description:
+  // Run AnalyzeRobustness in the background: a task of the task scheduler,
+  // with its progress, which supersedes the analysis of the same list.
+  // The metrics are stored when the task is finished (see UpdateMetrics),
+  // except for the trajectories moved or removed meanwhile. The analysis
+  // is canceled if the list or the label map is removed.
+  // Return false if the analysis can't be started.
+  bool StartRobustnessAnalysis(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                               vtkMRMLVolumeNode* labelMapNode);
+  void CancelRobustnessAnalysis(vtkMRMLPathPlannerTrajectoryNode* trajectoryList);
+  bool IsAnalyzingRobustness(vtkMRMLPathPlannerTrajectoryNode* trajectoryList);
+
+  // Description:
+  // Minimum distance required between any two trajectories of a list, in
+  // mm (3 mm by default), e.g. between SEEG electrodes or ablation needles.
+  vtkSetMacro(MinimumTrajectorySpacing, double);
+  vtkGetMacro(MinimumTrajectorySpacing, double);
+
+  // Description:
+  // Two trajectories (rows, Row1 < Row2) and the distance between them.
+  typedef vtkPathExplorerTrajectorySpacing::TrajectoryPair TrajectoryPair;
+  typedef vtkPathExplorerTrajectorySpacing::TrajectoryPairList TrajectoryPairList;
+
+  // Description:
+  // Minimum distance between the segments of the trajectories of a list.
+  // The pairs closer than MinimumTrajectorySpacing are returned in
+  // violations, sorted by rows. The distance of each trajectory to the
+  // closest other one and its number of violations are stored in the
+  // "Spacing" and "SpacingViolations" metrics of the list.
+  // Trajectories are searched in a bounding volume hierarchy (see
+  // vtkPathExplorerTrajectorySpacing): only the close pairs are computed,
+  // not the N^2 distances.
+  bool ComputeTrajectorySpacing(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                                TrajectoryPairList& violations);
+
+  // Description:
+  // Write the pairs (e.g. the violations of ComputeTrajectorySpacing) in a
+  // comma separated file, with the quoted names of the trajectories.
+  bool WriteTrajectoryPairs(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                            const TrajectoryPairList& pairs, const char* fileName);
+
+  // Description:
+  // Name of the metric storing the clearance (ComputeClearance).
+  static const char* GetClearanceMetricName();
+
+  // Description:
+  // Metrics of a trajectory list kept up to date by the logic. A tracked
+  // metric is derived from one input node: ClearanceMetric from a label map
+  // (see ComputeClearance), ModelDistanceMetric from a model (see
+  // ComputeModelDistances). The logic observes the list and the inputs:
+  // moving an entry or target point only invalidates the trajectories using
+  // it, modifying an input only invalidates the metrics derived from it.
+  // Tracking a metric with a new input invalidates all its values.
+  void TrackMetric(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                   const char* metricName, int metricType, vtkMRMLNode* inputNode);
+  void UntrackMetric(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                     const char* metricName);
+  void UntrackMetrics(vtkMRMLPathPlannerTrajectoryNode* trajectoryList);
+  int GetNumberOfTrackedMetrics(vtkMRMLPathPlannerTrajectoryNode* trajectoryList);
+  enum
+    {
+    ClearanceMetric,
+    ModelDistanceMetric
+    };
+
+  // Description:
+  // Invalid values of the tracked metrics are recomputed by a task of the
+  // task scheduler. UpdateMetrics must be called from the main thread when
+  // a task finished (see vtkPathExplorerTaskScheduler::SetTaskFinishedCallback)
+  // or while HasPendingMetrics is true: it finishes the tasks, which
+  // publishes the values in a single modification of each list, then
+  // starts the computation of the values invalidated meanwhile. Values of
+  // trajectories moved during a computation are not published. A
+  // computation is canceled when one of its inputs is modified or removed,
+  // or when a metric it computes is untracked: the main thread never waits
+  // for it.
+  // With wait, UpdateMetrics returns once all the values are up to date.
+  void UpdateMetrics(bool wait = false);
+  bool HasPendingMetrics();
+
+  // Description:
+  // Workers running the background computations of the logic. Owned by
+  // the logic.
+  vtkPathExplorerTaskScheduler* GetTaskScheduler();
+
+  // Description:
+  // Number of values published by the last UpdateMetrics.
+  vtkGetMacro(NumberOfUpdatedMetricValues, int);
+
+  // Description:
+  // Straightened volume of a trajectory: a stack of planes perpendicular to
+  // it, resampled from a volume once so that perpendicular reslicing only
+  // has to pick a plane. Plane k of numberOfPlanes (at least 2) is centered
+  // on entry + k / (numberOfPlanes - 1) * (target - entry), with the axes
+  // of perpendicular reslicing: columns along vtkMath::Perpendiculars of
+  // the trajectory direction, rows along direction x columns. Planes have
+  // planeDimensions pixels spaced by planeSpacing mm. Label maps are
+  // resampled with the nearest voxel, other volumes are interpolated.
+  // StartStraightening resamples in the background, with the sampling
+  // threads, and replaces the image and geometry of outputNode when the
+  // task is finished (see UpdateMetrics). It does nothing if outputNode
+  // already holds, or is about to hold, this straightened volume, and
+  // supersedes the previous straightening of outputNode otherwise.
+  // Return false if the volume can't be resampled.
+  bool StartStraightening(vtkMRMLVolumeNode* volumeNode,
+                          vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                          int numberOfPlanes, const int planeDimensions[2],
+                          double planeSpacing, vtkMRMLVolumeNode* outputNode);
+  // Description:
+  // Return true if outputNode holds the straightened volume of the volume
+  // and trajectory as they are now, with these parameters.
+  bool IsStraightened(vtkMRMLVolumeNode* volumeNode,
+                      vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                      int numberOfPlanes, const int planeDimensions[2],
+                      double planeSpacing, vtkMRMLVolumeNode* outputNode);
+  void CancelStraightening(vtkMRMLVolumeNode* outputNode);
+
+  // Description:
+  // Rotated planes of a trajectory, for in-plane reslicing: planes
+  // containing the trajectory, rotated around it from 0 to 180 degrees
+  // as the normal vtkMath::Perpendiculars gives for each angle. Planes are
+  // centered on the target, with columns along the trajectory direction.
+  // They are resampled every degree with planeDimensions pixels spaced by
+  // planeSpacing mm, once per volume and trajectory, in the background.
+  // Planes are cached up to RotationCacheSize MB, evicting the least
+  // recently used first: angular, then spatial resolution is halved (down
+  // to 4 degrees and 32 pixels) for planes that don't fit in the cache.
+  // StartRotation does nothing if the planes are cached or being
+  // resampled. ShowRotatedPlane makes outputNode show the cached plane the
+  // closest to the angle (in degrees), placed in the plane at this angle,
+  // and returns false if the planes are not resampled yet.
+  vtkSetMacro(RotationCacheSize, double);
+  vtkGetMacro(RotationCacheSize, double);
+  bool StartRotation(vtkMRMLVolumeNode* volumeNode,
+                     vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                     const int planeDimensions[2], double planeSpacing);
+  bool ShowRotatedPlane(vtkMRMLVolumeNode* volumeNode,
+                        vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                        const int planeDimensions[2], double planeSpacing,
+                        double angle, vtkMRMLVolumeNode* outputNode);
+
+  // Description:
+  // Registry of the MRML observations made by the module widgets.
+  // An observation is an (event, observer, callback) triple on an object.
+  // RegisterObserver returns false if the observation is already registered,
+  // in which case the observer must not connect it again.
+  // Observations of a deleted object are dropped automatically; observers
+  // call UnregisterObservers when they are destroyed.
+  bool RegisterObserver(vtkObject* object, unsigned long event,
+                        void* observer, const char* callback);
+  void UnregisterObserver(vtkObject* object, unsigned long event,
+                          void* observer, const char* callback);
+  void UnregisterObservers(void* observer);
+  int GetNumberOfObservers(vtkObject* object);
+  int GetNumberOfObservers();
+  int GetNumberOfObservedObjects();
+
+  // Description:
+  // Callback counters. Observers report each callback with the time spent
+  // in it (in seconds). The rate is measured over the last second.
+  void CallbackInvoked(const char* callback, double seconds);
+  vtkIdType GetNumberOfCallbacks(const char* callback);
+  double GetCallbacksPerSecond(const char* callback);
+  double GetCallbackTime(const char* callback);
+  void ResetCallbackCounters();
+
 protected:
   vtkSlicerPathExplorerLogic();
   virtual ~vtkSlicerPathExplorerLogic();
@@ -60,6 +462,208 @@ protected:
   virtual void UpdateFromMRMLScene();
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+
+  // Description:
+  // Compute the clearance of all the rows (row < 0) or of one row.
+  bool ComputeClearanceRows(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                            vtkMRMLVolumeNode* labelMapNode, int row);
+
+  // Description:
+  // Triangle hierarchy of a model, built if needed. Return 0 if the model
+  // has no polydata or a non-linear transform.
+  const vtkPathExplorerTriangleBVH* GetModelHierarchy(vtkMRMLModelNode* modelNode);
+
+  // Description:
+  // Run the intersection (or distance) queries of every trajectory against
+  // the models.
+  bool QueryModels(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                   vtkCollection* modelNodes, bool intersection,
+                   std::vector<double>& results);
+
+  double SamplingStep;
+  int NumberOfSamplingThreads;
+
+  double EntrySearchSpacing;
+  double EntrySearchMaximumLength;
+  double EntrySearchMaximumAngle;
+  double EntrySearchClearanceMargin;
+  double EntrySearchWeights[3];
+  double EntrySearchMinimumSeparation;
+  int NumberOfEntryCandidates;
+
+  int RobustnessNumberOfSamples;
+  unsigned int RobustnessSeed;
+  double EntryErrorCovariance[9];
+  double TargetErrorCovariance[9];
+
+  double MinimumTrajectorySpacing;
+
+  int BatchDepth;
+  std::set<std::string> ModifiedHierarchyIDs;
+
+  // Signed distance maps, by label map node ID
+  struct DistanceMap
+    {
+    unsigned long ImageMTime;
+    double Spacing[3];
+    std::vector<float> Distances;
+    };
+  std::map<std::string, DistanceMap*> DistanceMaps;
+
+  // Triangle hierarchies of the models, by model node ID
+  struct ModelHierarchy
+    {
+    unsigned long PolyDataMTime;
+    double ToWorld[16];
+    vtkPathExplorerTriangleBVH Hierarchy;
+    };
+  std::map<std::string, ModelHierarchy*> ModelHierarchies;
+
+  // Description:
+  // The caches are only accessed from the main thread. Entries are never
+  // modified once cached: the tasks read the ones they started with.
+  // Entries replaced or removed while a task may read them are retired,
+  // and deleted once no such task is pending.
+  const DistanceMap* GetCachedDistanceMap(vtkMRMLVolumeNode* labelMapNode);
+  void SetDistanceMap(const std::string& labelMapID, DistanceMap* distanceMap);
+  void RemoveDistanceMap(const std::string& labelMapID);
+  void RemoveModelHierarchy(const std::string& modelID);
+  bool IsReadingCaches();
+  void DeleteRetiredCacheEntries();
+  std::vector<DistanceMap*> RetiredDistanceMaps;
+  std::vector<ModelHierarchy*> RetiredModelHierarchies;
+
+  // Description:
+  // Tracked metrics: observation of the lists and inputs, invalidation.
+  static void OnMetricEvent(vtkObject* caller, unsigned long event,
+                            void* clientData, void* callData);
+  void OnTrackedListEvent(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                          unsigned long event, void* callData);
+  void OnMetricInputEvent(vtkMRMLNode* inputNode, unsigned long event);
+  void ObserveMetricInput(vtkMRMLNode* inputNode);
+  void ReleaseMetricInputs();
+
+  // Description:
+  // Background computation of the invalid values (a scheduler task). The
+  // main thread never waits for it: a task computing values that are no
+  // longer needed is canceled. FinishMetricUpdate publishes the values and
+  // the distance maps computed by the task, or invalidates the values
+  // again if the task was canceled, and starts the next task.
+  // IsMetricUpdateComputing tells if the running task computes a metric of
+  // a list, or any value of a list or from an input (no metricName).
+  struct MetricUpdate;
+  void StartMetricUpdate();
+  void CancelMetricUpdate();
+  bool IsMetricUpdateComputing(const char* nodeID, const char* metricName);
+  void FinishMetricUpdate();
+  void RunMetricUpdate(MetricUpdate& update);
+
+  // Tracked metrics, by list node ID
+  struct TrackedList
+    {
+    vtkMRMLPathPlannerTrajectoryNode* Node;
+    std::vector<unsigned long> ObserverTags;
+    vtkPathExplorerMetricTracker Tracker;
+    };
+  std::map<std::string, TrackedList> TrackedLists;
+  bool SynchronizeTrackedTrajectory(TrackedList& trackedList, int row);
+  bool SynchronizeTrackedTrajectories(TrackedList& trackedList);
+
+  // Inputs of the tracked metrics, by node ID. Geometry is the RAS to IJK
+  // matrix of a volume, compared on ModifiedEvent.
+  struct MetricInput
+    {
+    vtkMRMLNode* Node;
+    std::vector<unsigned long> ObserverTags;
+    double Geometry[16];
+    };
+  std::map<std::string, MetricInput> MetricInputs;
+  vtkCallbackCommand* MetricEventCallback;
+
+  vtkPathExplorerTaskScheduler* TaskScheduler;
+  int MetricUpdateTaskID;
+  MetricUpdate* RunningMetricUpdate;
+  int NumberOfUpdatedMetricValues;
+
+  // Description:
+  // Robustness analyses run by the scheduler, superseded or not, until
+  // they are finished. CreateRobustnessTask reads the inputs, Run
+  // computes the distance map if it isn't cached, FinishRobustnessAnalysis
+  // caches it and stores the metrics of the analysis if it wasn't
+  // canceled.
+  struct RobustnessTask;
+  std::vector<RobustnessTask*> RobustnessTasks;
+  RobustnessTask* CreateRobustnessTask(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                                       vtkMRMLVolumeNode* labelMapNode);
+  bool FinishRobustnessAnalysis(RobustnessTask& task);
+
+  // Description:
+  // Straightened volumes, by output node ID, and rotated planes, by volume
+  // node ID, trajectory list node ID and trajectory UID. Task is the
+  // resampling task not finished yet, if any: only its results are
+  // published.
+  struct StraighteningTask;
+  struct Straightening
+    {
+    std::string VolumeNodeID;
+    std::string TrajectoryListNodeID;
+    unsigned long ImageMTime;
+    // World to IJK matrix of the volume (3 rows)
+    double RASToIJK[12];
+    double Entry[3];
+    double Target[3];
+    int NumberOfPlanes;
+    int PlaneDimensions[2];
+    double PlaneSpacing;
+    StraighteningTask* Task;
+    bool Ready;
+    // Rotations: planes, their size in MB and last use
+    vtkSmartPointer<vtkImageData> Planes;
+    double Size;
+    unsigned long LastUse;
+
+    // Same volume, trajectory and parameters
+    bool IsSameAs(const Straightening& other) const;
+    };
+  std::map<std::string, Straightening> Straightenings;
+  bool GetStraightening(vtkMRMLVolumeNode* volumeNode,
+                        vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                        int numberOfPlanes, const int planeDimensions[2],
+                        double planeSpacing, Straightening& straightening);
+  void FinishStraightening(StraighteningTask& task);
+
+  std::map<std::string, Straightening> Rotations;
+  double RotationCacheSize;
+  unsigned long RotationCacheClock;
+  bool GetRotation(vtkMRMLVolumeNode* volumeNode,
+                   vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int row,
+                   const int planeDimensions[2], double planeSpacing,
+                   std::string& key, Straightening& rotation);
+  void RemoveRotations(vtkMRMLNode* node);
+
+  // Observer registry
+  typedef std::pair<unsigned long, std::pair<void*, std::string> > Observation;
+  struct ObservedObject
+    {
+    std::set<Observation> Observations;
+    unsigned long DeleteObserverTag;
+    };
+  std::map<vtkObject*, ObservedObject> ObservedObjects;
+  vtkCallbackCommand* ObservedObjectDeleteCallback;
+  static void OnObservedObjectDeleted(vtkObject* caller, unsigned long event,
+                                      void* clientData, void* callData);
+
+  struct CallbackCounter
+    {
+    vtkIdType Count;
+    double Time;
+    // Callbacks since WindowStart, and rate of the last completed window
+    double WindowStart;
+    vtkIdType WindowCount;
+    double Rate;
+    };
+  std::map<std::string, CallbackCounter> CallbackCounters;
+
 private:
 
   vtkSlicerPathExplorerLogic(const vtkSlicerPathExplorerLogic&); // Not implemented
@@ -1,9 +1,9 @@
 /*==============================================================================
 
   Program: 3D Slicer
- 
+
   Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
- 
+
   See COPYRIGHT.txt
   or http://www.slicer.org/copyright/copyright.txt for details.
 
@@ -12,21 +12,211 @@
   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
   See the License for the specific language governing permissions and
   limitations under the License.
- 
+
   This file was originally developed by Laurent Chauvin, Brigham and Women's
   Hospital. The project was supported by grants 5P01CA067165,
   5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
   5R42CA137886, 8P41EB015898
- 
+
 ==============================================================================*/
 
 #include "vtkMRMLPathPlannerTrajectoryNode.h"
 
+// MRML includes
 #include "vtkMRMLAnnotationFiducialNode.h"
+#include "vtkMRMLAnnotationHierarchyNode.h"
 #include "vtkMRMLAnnotationRulerNode.h"
+#include "vtkMRMLPathPlannerTrajectoryStorageNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkPathPlannerMappedFile.h"
 
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
 #include <vtkObjectFactory.h>
 
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Coordinates written back by the annotation nodes are compared with
+// a tolerance to stop the fiducial -> ruler -> fiducial update loop.
+bool SamePosition(const double* a, const double* b)
+{
+  const double tolerance = 1e-6;
+  return fabs(a[0] - b[0]) < tolerance &&
+         fabs(a[1] - b[1]) < tolerance &&
+         fabs(a[2] - b[2]) < tolerance;
+}
+
+//----------------------------------------------------------------------------
+// Strings are written as space separated tokens.
+// Characters other than [A-Za-z0-9_.:] are percent-encoded and an empty
+// string is written as "-".
+std::string EncodeToken(const std::string& value)
+{
+  if (value.empty())
+    {
+    return "-";
+    }
+
+  static const char hex[] = "0123456789ABCDEF";
+  std::string encoded;
+  for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+    {
+    unsigned char c = static_cast<unsigned char>(*it);
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+        (c >= '0' && c <= '9') || c == '_' || c == '.' || c == ':')
+      {
+      encoded += static_cast<char>(c);
+      }
+    else
+      {
+      encoded += '%';
+      encoded += hex[c >> 4];
+      encoded += hex[c & 0x0F];
+      }
+    }
+  return encoded;
+}
+
+//----------------------------------------------------------------------------
+std::string DecodeToken(const std::string& token)
+{
+  if (token == "-")
+    {
+    return std::string();
+    }
+
+  std::string decoded;
+  for (size_t i = 0; i < token.size(); ++i)
+    {
+    if (token[i] == '%' && i + 2 < token.size())
+      {
+      decoded += static_cast<char>(strtol(token.substr(i + 1, 2).c_str(), 0, 16));
+      i += 2;
+      }
+    else
+      {
+      decoded += token[i];
+      }
+    }
+  return decoded;
+}
+
+//----------------------------------------------------------------------------
+void SplitTokens(const char* value, std::vector<std::string>& tokens)
+{
+  tokens.clear();
+  std::stringstream ss(value ? value : "");
+  std::string token;
+  while (ss >> token)
+    {
+    tokens.push_back(token);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Missing values are written as an explicit "nan" token: the spelling of
+// a streamed NaN depends on the C runtime and strtod does not parse all of
+// them. Only "nan" itself is recognized, in any case and with an optional
+// sign.
+bool IsNanToken(const std::string& token)
+{
+  size_t start = !token.empty() && (token[0] == '+' || token[0] == '-') ? 1 : 0;
+  if (token.size() != start + 3)
+    {
+    return false;
+    }
+  for (size_t i = 0; i < 3; ++i)
+    {
+    if (tolower(static_cast<unsigned char>(token[start + i])) != "nan"[i])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Return false if a token is not a number (it is read as NaN).
+bool SplitNumbers(const char* value, std::vector<double>& numbers)
+{
+  std::vector<std::string> tokens;
+  SplitTokens(value, tokens);
+  numbers.resize(tokens.size());
+  bool valid = true;
+  for (size_t i = 0; i < tokens.size(); ++i)
+    {
+    numbers[i] = std::numeric_limits<double>::quiet_NaN();
+    if (IsNanToken(tokens[i]))
+      {
+      continue;
+      }
+    const char* begin = tokens[i].c_str();
+    char* end = 0;
+    double number = strtod(begin, &end);
+    if (end == begin || *end != '\0')
+      {
+      valid = false;
+      continue;
+      }
+    numbers[i] = number;
+    }
+  return valid;
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void WriteNumber(ostream& of, T value)
+{
+  of << value;
+}
+
+//----------------------------------------------------------------------------
+template <>
+void WriteNumber(ostream& of, double value)
+{
+  if (value != value)
+    {
+    of << "nan";
+    }
+  else
+    {
+    of << value;
+    }
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+void WriteNumbers(ostream& of, const std::vector<T>& values)
+{
+  for (size_t i = 0; i < values.size(); ++i)
+    {
+    of << (i ? " " : "");
+    WriteNumber(of, values[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void WriteTokens(ostream& of, const std::vector<std::string>& values)
+{
+  for (size_t i = 0; i < values.size(); ++i)
+    {
+    of << (i ? " " : "") << EncodeToken(values[i]);
+    }
+}
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLPathPlannerTrajectoryNode);
 
@@ -35,42 +225,1443 @@ vtkMRMLNodeNewMacro(vtkMRMLPathPlannerTrajectoryNode);
 vtkMRMLPathPlannerTrajectoryNode::vtkMRMLPathPlannerTrajectoryNode()
 {
   this->HideFromEditors = false;
+  this->NextUID = 0;
+  this->RulerHierarchyNodeID = NULL;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLPathPlannerTrajectoryNode::~vtkMRMLPathPlannerTrajectoryNode()
 {
+  this->SetRulerHierarchyNodeID(NULL);
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLPathPlannerTrajectoryNode::WriteXML(ostream& of, int nIndent)
 {
   Superclass::WriteXML(of, nIndent);
+
+  vtkIndent indent(nIndent);
+
+  if (this->RulerHierarchyNodeID)
+    {
+    of << indent << " rulerHierarchyNodeRef=\"" << this->RulerHierarchyNodeID << "\"";
+    }
+
+  if (this->GetStorageNode())
+    {
+    // Trajectories are written by the storage node
+    return;
+    }
+
+  // One attribute per column, rows in the same order in every column.
+  // Entry/target/ruler IDs keep the link between the table and the fiducials.
+  std::streamsize oldPrecision = of.precision(17);
+
+  of << indent << " trajectoryUIDs=\"";
+  WriteNumbers(of, this->UIDs);
+  of << "\"";
+
+  of << indent << " trajectoryNames=\"";
+  WriteTokens(of, this->Names);
+  of << "\"";
+
+  of << indent << " entryNodeIDs=\"";
+  WriteTokens(of, this->EntryNodeIDs);
+  of << "\"";
+
+  of << indent << " targetNodeIDs=\"";
+  WriteTokens(of, this->TargetNodeIDs);
+  of << "\"";
+
+  of << indent << " rulerNodeIDs=\"";
+  WriteTokens(of, this->RulerNodeIDs);
+  of << "\"";
+
+  of << indent << " trajectoryFlags=\"";
+  WriteNumbers(of, this->Flags);
+  of << "\"";
+
+  of << indent << " entryPositions=\"";
+  WriteNumbers(of, this->EntryPositions);
+  of << "\"";
+
+  of << indent << " targetPositions=\"";
+  WriteNumbers(of, this->TargetPositions);
+  of << "\"";
+
+  of << indent << " metricNames=\"";
+  WriteTokens(of, this->MetricNames);
+  of << "\"";
+
+  of << indent << " metricValues=\"";
+  for (size_t metric = 0; metric < this->MetricValues.size(); ++metric)
+    {
+    of << (metric ? " " : "");
+    WriteNumbers(of, this->MetricValues[metric]);
+    }
+  of << "\"";
+
+  of.precision(oldPrecision);
 }
 
 
 //----------------------------------------------------------------------------
 void vtkMRMLPathPlannerTrajectoryNode::ReadXMLAttributes(const char** atts)
 {
+  int disabledModify = this->StartModify();
+
   Superclass::ReadXMLAttributes(atts);
+
+  std::vector<double> uids;
+  std::vector<double> flags;
+  std::vector<double> metricValues;
+  std::vector<std::string> tokens;
+  bool validNumbers = true;
+
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+
+    if (!strcmp(attName, "rulerHierarchyNodeRef"))
+      {
+      this->SetRulerHierarchyNodeID(attValue);
+      }
+    else if (!strcmp(attName, "trajectoryUIDs"))
+      {
+      validNumbers = SplitNumbers(attValue, uids) && validNumbers;
+      }
+    else if (!strcmp(attName, "trajectoryNames"))
+      {
+      SplitTokens(attValue, tokens);
+      this->Names.resize(tokens.size());
+      std::transform(tokens.begin(), tokens.end(), this->Names.begin(), DecodeToken);
+      }
+    else if (!strcmp(attName, "entryNodeIDs"))
+      {
+      SplitTokens(attValue, tokens);
+      this->EntryNodeIDs.resize(tokens.size());
+      std::transform(tokens.begin(), tokens.end(), this->EntryNodeIDs.begin(), DecodeToken);
+      }
+    else if (!strcmp(attName, "targetNodeIDs"))
+      {
+      SplitTokens(attValue, tokens);
+      this->TargetNodeIDs.resize(tokens.size());
+      std::transform(tokens.begin(), tokens.end(), this->TargetNodeIDs.begin(), DecodeToken);
+      }
+    else if (!strcmp(attName, "rulerNodeIDs"))
+      {
+      SplitTokens(attValue, tokens);
+      this->RulerNodeIDs.resize(tokens.size());
+      std::transform(tokens.begin(), tokens.end(), this->RulerNodeIDs.begin(), DecodeToken);
+      }
+    else if (!strcmp(attName, "trajectoryFlags"))
+      {
+      validNumbers = SplitNumbers(attValue, flags) && validNumbers;
+      }
+    else if (!strcmp(attName, "entryPositions"))
+      {
+      validNumbers = SplitNumbers(attValue, this->EntryPositions) && validNumbers;
+      }
+    else if (!strcmp(attName, "targetPositions"))
+      {
+      validNumbers = SplitNumbers(attValue, this->TargetPositions) && validNumbers;
+      }
+    else if (!strcmp(attName, "metricNames"))
+      {
+      SplitTokens(attValue, tokens);
+      this->MetricNames.resize(tokens.size());
+      std::transform(tokens.begin(), tokens.end(), this->MetricNames.begin(), DecodeToken);
+      }
+    else if (!strcmp(attName, "metricValues"))
+      {
+      validNumbers = SplitNumbers(attValue, metricValues) && validNumbers;
+      }
+    }
+  if (!validNumbers)
+    {
+    vtkWarningMacro("ReadXMLAttributes: invalid numbers in node " <<
+                    (this->GetID() ? this->GetID() : "(none)") << " are read as nan");
+    }
+
+  // Make all columns consistent with the name column
+  size_t numberOfTrajectories = this->Names.size();
+  this->UIDs.resize(numberOfTrajectories);
+  this->NextUID = 0;
+  for (size_t row = 0; row < numberOfTrajectories; ++row)
+    {
+    this->UIDs[row] = row < uids.size() && uids[row] == uids[row] ?
+      static_cast<int>(uids[row]) : static_cast<int>(row);
+    this->NextUID = std::max(this->NextUID, this->UIDs[row] + 1);
+    }
+  this->EntryNodeIDs.resize(numberOfTrajectories);
+  this->TargetNodeIDs.resize(numberOfTrajectories);
+  this->RulerNodeIDs.resize(numberOfTrajectories);
+  this->EntryPositions.resize(3*numberOfTrajectories, 0.0);
+  this->TargetPositions.resize(3*numberOfTrajectories, 0.0);
+  this->Flags.assign(numberOfTrajectories, DefaultFlags);
+  for (size_t row = 0; row < numberOfTrajectories && row < flags.size(); ++row)
+    {
+    if (flags[row] == flags[row])
+      {
+      this->Flags[row] = static_cast<int>(flags[row]);
+      }
+    }
+
+  this->MetricValues.assign(this->MetricNames.size(),
+                            std::vector<double>(numberOfTrajectories,
+                                                std::numeric_limits<double>::quiet_NaN()));
+  for (size_t metric = 0; metric < this->MetricNames.size(); ++metric)
+    {
+    for (size_t row = 0; row < numberOfTrajectories; ++row)
+      {
+      size_t index = metric * numberOfTrajectories + row;
+      if (index < metricValues.size())
+        {
+        this->MetricValues[metric][row] = metricValues[index];
+        }
+      }
+    }
+
+  this->Samples.assign(numberOfTrajectories, SampleBlock());
+  this->MappedFile = NULL;
+
+  // Fiducials are observed in UpdateScene, once all nodes are loaded
+  this->RebuildIndex();
+
+  this->EndModify(disabledModify);
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLPathPlannerTrajectoryNode::Copy(vtkMRMLNode *anode)
 {
   Superclass::Copy(anode);
+
+  vtkMRMLPathPlannerTrajectoryNode* node =
+    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(anode);
+  if (!node)
+    {
+    return;
+    }
+
+  // Both nodes display their trajectories with the same rulers
+  this->UIDs            = node->UIDs;
+  this->EntryPositions  = node->EntryPositions;
+  this->TargetPositions = node->TargetPositions;
+  this->Names           = node->Names;
+  this->EntryNodeIDs    = node->EntryNodeIDs;
+  this->TargetNodeIDs   = node->TargetNodeIDs;
+  this->RulerNodeIDs    = node->RulerNodeIDs;
+  this->Flags           = node->Flags;
+  this->MetricNames     = node->MetricNames;
+  this->MetricValues    = node->MetricValues;
+  this->Samples         = node->Samples;
+  this->MappedFile      = node->MappedFile;
+  this->NextUID         = node->NextUID;
+  this->SetRulerHierarchyNodeID(node->RulerHierarchyNodeID);
+  this->RebuildIndex();
+  this->ResolveReferences();
 }
 
 //-----------------------------------------------------------
 void vtkMRMLPathPlannerTrajectoryNode::UpdateScene(vtkMRMLScene *scene)
 {
   Superclass::UpdateScene(scene);
+
+  if (!scene)
+    {
+    return;
+    }
+
+  if (this->GetStorageNode())
+    {
+    // The storage node read the trajectories and resolved the references
+    return;
+    }
+
+  this->ResolveReferences();
+}
+
+//-----------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::ResolveReferences()
+{
+  vtkMRMLScene* scene = this->GetScene();
+  if (!scene)
+    {
+    return;
+    }
+
+  // Resolve entry/target/ruler references in one pass over the rows.
+  // Scene lookups by ID are indexed, so this is linear in the number of
+  // trajectories.
+  int disabledModify = this->StartModify();
+
+  for (FiducialIndex::iterator it = this->ObservedFiducials.begin();
+       it != this->ObservedFiducials.end(); ++it)
+    {
+    vtkMRMLNode* fiducial = scene->GetNodeByID(it->first.c_str());
+    if (fiducial)
+      {
+      this->MRMLObserverManager->RemoveObjectEvents(fiducial);
+      }
+    }
+  this->ObservedFiducials.clear();
+
+  vtkNew<vtkIntArray> rulerEvents;
+  rulerEvents->InsertNextValue(vtkCommand::ModifiedEvent);
+  rulerEvents->InsertNextValue(vtkCommand::DeleteEvent);
+  rulerEvents->InsertNextValue(vtkMRMLDisplayableNode::DisplayModifiedEvent);
+
+  double position[4] = {0,0,0,0};
+  for (int row = 0; row < this->GetNumberOfTrajectories(); ++row)
+    {
+    this->ObserveFiducial(this->EntryNodeIDs[row], this->UIDs[row]);
+    this->ObserveFiducial(this->TargetNodeIDs[row], this->UIDs[row]);
+
+    // Fiducials are the reference for the coordinates
+    vtkMRMLAnnotationFiducialNode* entryPoint = this->GetEntryNode(row);
+    if (entryPoint)
+      {
+      entryPoint->GetFiducialWorldCoordinates(position);
+      std::copy(position, position + 3, this->EntryPositions.begin() + 3*row);
+      }
+    vtkMRMLAnnotationFiducialNode* targetPoint = this->GetTargetNode(row);
+    if (targetPoint)
+      {
+      targetPoint->GetFiducialWorldCoordinates(position);
+      std::copy(position, position + 3, this->TargetPositions.begin() + 3*row);
+      }
+
+    // Rulers that no longer exist will be created again on demand
+    vtkMRMLAnnotationRulerNode* ruler = this->GetRulerNode(row);
+    if (ruler)
+      {
+      this->MRMLObserverManager->RemoveObjectEvents(ruler);
+      this->MRMLObserverManager->AddObjectEvents(ruler, rulerEvents.GetPointer());
+      }
+    else
+      {
+      this->SetRulerNodeID(row, std::string());
+      }
+    }
+
+  this->Modified();
+  this->EndModify(disabledModify);
+}
+
+//-----------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::UpdateReferenceID(const char *oldID, const char *newID)
+{
+  Superclass::UpdateReferenceID(oldID, newID);
+
+  if (!oldID || !newID)
+    {
+    return;
+    }
+
+  // Node IDs may change when a scene is imported
+  for (int row = 0; row < this->GetNumberOfTrajectories(); ++row)
+    {
+    if (this->EntryNodeIDs[row].compare(oldID) == 0)
+      {
+      this->EntryNodeIDs[row] = newID;
+      }
+    if (this->TargetNodeIDs[row].compare(oldID) == 0)
+      {
+      this->TargetNodeIDs[row] = newID;
+      }
+    if (this->RulerNodeIDs[row].compare(oldID) == 0)
+      {
+      this->SetRulerNodeID(row, newID);
+      }
+    }
+
+  if (this->RulerHierarchyNodeID && !strcmp(oldID, this->RulerHierarchyNodeID))
+    {
+    this->SetRulerHierarchyNodeID(newID);
+    }
+
+  FiducialIndex::iterator it = this->ObservedFiducials.find(oldID);
+  if (it != this->ObservedFiducials.end())
+    {
+    std::multiset<int> uids;
+    uids.swap(it->second);
+    this->ObservedFiducials.erase(it);
+    this->ObservedFiducials[newID].insert(uids.begin(), uids.end());
+    }
 }
 
 //---------------------------------------------------------------------------
 void vtkMRMLPathPlannerTrajectoryNode::ProcessMRMLEvents ( vtkObject *caller,
-                                           unsigned long event, 
+                                           unsigned long event,
                                            void *callData )
 {
+  if (event == vtkCommand::DeleteEvent)
+    {
+    // Observed fiducial or ruler is being destroyed
+    this->MRMLObserverManager->RemoveObjectEvents(caller);
+    return;
+    }
+
+  if (event == vtkCommand::ModifiedEvent)
+    {
+    vtkMRMLAnnotationRulerNode* ruler =
+      vtkMRMLAnnotationRulerNode::SafeDownCast(caller);
+    if (ruler)
+      {
+      this->OnRulerModified(ruler);
+      return;
+      }
+
+    vtkMRMLAnnotationFiducialNode* fiducial =
+      vtkMRMLAnnotationFiducialNode::SafeDownCast(caller);
+    if (fiducial)
+      {
+      this->OnFiducialModified(fiducial);
+      return;
+      }
+    }
+
+  if (event == vtkMRMLDisplayableNode::DisplayModifiedEvent)
+    {
+    vtkMRMLAnnotationRulerNode* ruler =
+      vtkMRMLAnnotationRulerNode::SafeDownCast(caller);
+    if (ruler && ruler->GetID())
+      {
+      // Keep PathVisible flag in sync with ruler visibility changed
+      // from other modules (ruler is kept, only hidden)
+      int row = this->GetRulerTrajectoryRow(ruler->GetID());
+      if (row >= 0)
+        {
+        int visible = ruler->GetDisplayVisibility();
+        if (visible != ((this->Flags[row] & PathVisible) != 0))
+          {
+          this->Flags[row] = visible ?
+            (this->Flags[row] | PathVisible) :
+            (this->Flags[row] & ~PathVisible);
+          this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+          }
+        }
+      return;
+      }
+    }
+
   Superclass::ProcessMRMLEvents(caller, event, callData);
 }
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetNumberOfTrajectories()
+{
+  return static_cast<int>(this->UIDs.size());
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLPathPlannerTrajectoryNode::IsValidRow(int row)
+{
+  return row >= 0 && row < this->GetNumberOfTrajectories();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::InvokeTrajectoryEvent(unsigned long event, int row)
+{
+  if (this->GetDisableModifiedEvent())
+    {
+    // Batch modification. Observers refresh everything on ModifiedEvent.
+    this->Modified();
+    return;
+    }
+  this->InvokeEvent(event, &row);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::
+AddTrajectory(vtkMRMLAnnotationFiducialNode* entryPoint,
+              vtkMRMLAnnotationFiducialNode* targetPoint,
+              const char* name)
+{
+  if (!entryPoint || !targetPoint)
+    {
+    return -1;
+    }
+
+  double entry[4] = {0,0,0,0};
+  double target[4] = {0,0,0,0};
+  entryPoint->GetFiducialWorldCoordinates(entry);
+  targetPoint->GetFiducialWorldCoordinates(target);
+
+  return this->AddTrajectory(entry, target, name,
+                             entryPoint->GetID(), targetPoint->GetID());
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::
+AddTrajectory(const double entry[3], const double target[3],
+              const char* name,
+              const char* entryNodeID, const char* targetNodeID,
+              int flags)
+{
+  int row = this->GetNumberOfTrajectories();
+  int uid = this->NextUID++;
+
+  this->UIDs.push_back(uid);
+  this->UIDRows[uid] = row;
+  this->EntryPositions.insert(this->EntryPositions.end(), entry, entry + 3);
+  this->TargetPositions.insert(this->TargetPositions.end(), target, target + 3);
+  this->Names.push_back(name ? name : "");
+  this->EntryNodeIDs.push_back(entryNodeID ? entryNodeID : "");
+  this->TargetNodeIDs.push_back(targetNodeID ? targetNodeID : "");
+  this->RulerNodeIDs.push_back(std::string());
+  this->Flags.push_back(flags);
+  for (size_t metric = 0; metric < this->MetricValues.size(); ++metric)
+    {
+    this->MetricValues[metric].push_back(std::numeric_limits<double>::quiet_NaN());
+    }
+  this->Samples.push_back(SampleBlock());
+
+  this->ObserveFiducial(this->EntryNodeIDs[row], uid);
+  this->ObserveFiducial(this->TargetNodeIDs[row], uid);
+  this->UpdateRulerNode(row);
+
+  this->InvokeTrajectoryEvent(TrajectoryAddedEvent, row);
+  return row;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::RemoveTrajectory(int row)
+{
+  if (!this->IsValidRow(row))
+    {
+    return;
+    }
+
+  int uid = this->UIDs[row];
+  this->RemoveRulerNode(row);
+  this->UnobserveFiducial(this->EntryNodeIDs[row], uid);
+  this->UnobserveFiducial(this->TargetNodeIDs[row], uid);
+
+  // Following rows move up
+  this->UIDRows.erase(uid);
+  for (size_t next = row + 1; next < this->UIDs.size(); ++next)
+    {
+    --this->UIDRows[this->UIDs[next]];
+    }
+
+  this->UIDs.erase(this->UIDs.begin() + row);
+  this->EntryPositions.erase(this->EntryPositions.begin() + 3*row,
+                             this->EntryPositions.begin() + 3*row + 3);
+  this->TargetPositions.erase(this->TargetPositions.begin() + 3*row,
+                              this->TargetPositions.begin() + 3*row + 3);
+  this->Names.erase(this->Names.begin() + row);
+  this->EntryNodeIDs.erase(this->EntryNodeIDs.begin() + row);
+  this->TargetNodeIDs.erase(this->TargetNodeIDs.begin() + row);
+  this->RulerNodeIDs.erase(this->RulerNodeIDs.begin() + row);
+  this->Flags.erase(this->Flags.begin() + row);
+  for (size_t metric = 0; metric < this->MetricValues.size(); ++metric)
+    {
+    this->MetricValues[metric].erase(this->MetricValues[metric].begin() + row);
+    }
+  this->Samples.erase(this->Samples.begin() + row);
+
+  this->InvokeTrajectoryEvent(TrajectoryRemovedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::RemoveAllTrajectories()
+{
+  std::vector<int> rows(this->GetNumberOfTrajectories());
+  for (size_t row = 0; row < rows.size(); ++row)
+    {
+    rows[row] = static_cast<int>(row);
+    }
+  this->RemoveTrajectories(rows);
+  this->MappedFile = NULL;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::RemoveTrajectories(const std::vector<int>& rows)
+{
+  int numberOfTrajectories = this->GetNumberOfTrajectories();
+  std::vector<bool> removed(numberOfTrajectories, false);
+  bool anyRemoved = false;
+  for (std::vector<int>::const_iterator it = rows.begin(); it != rows.end(); ++it)
+    {
+    if (this->IsValidRow(*it))
+      {
+      removed[*it] = true;
+      anyRemoved = true;
+      }
+    }
+  if (!anyRemoved)
+    {
+    return;
+    }
+
+  int disabledModify = this->StartModify();
+
+  // Move the remaining rows up, in place
+  int kept = 0;
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    int uid = this->UIDs[row];
+    if (removed[row])
+      {
+      this->RemoveRulerNode(row);
+      this->UnobserveFiducial(this->EntryNodeIDs[row], uid);
+      this->UnobserveFiducial(this->TargetNodeIDs[row], uid);
+      this->UIDRows.erase(uid);
+      continue;
+      }
+
+    if (kept != row)
+      {
+      this->UIDs[kept] = uid;
+      std::copy(this->EntryPositions.begin() + 3*row,
+                this->EntryPositions.begin() + 3*row + 3,
+                this->EntryPositions.begin() + 3*kept);
+      std::copy(this->TargetPositions.begin() + 3*row,
+                this->TargetPositions.begin() + 3*row + 3,
+                this->TargetPositions.begin() + 3*kept);
+      this->Names[kept].swap(this->Names[row]);
+      this->EntryNodeIDs[kept].swap(this->EntryNodeIDs[row]);
+      this->TargetNodeIDs[kept].swap(this->TargetNodeIDs[row]);
+      this->RulerNodeIDs[kept].swap(this->RulerNodeIDs[row]);
+      this->Flags[kept] = this->Flags[row];
+      for (size_t metric = 0; metric < this->MetricValues.size(); ++metric)
+        {
+        this->MetricValues[metric][kept] = this->MetricValues[metric][row];
+        }
+      SampleBlock& block = this->Samples[kept];
+      block.MappedValues = this->Samples[row].MappedValues;
+      block.NumberOfSamples = this->Samples[row].NumberOfSamples;
+      block.NumberOfComponents = this->Samples[row].NumberOfComponents;
+      block.Values.swap(this->Samples[row].Values);
+      this->UIDRows[uid] = kept;
+      }
+    ++kept;
+    }
+
+  this->UIDs.resize(kept);
+  this->EntryPositions.resize(3*kept);
+  this->TargetPositions.resize(3*kept);
+  this->Names.resize(kept);
+  this->EntryNodeIDs.resize(kept);
+  this->TargetNodeIDs.resize(kept);
+  this->RulerNodeIDs.resize(kept);
+  this->Flags.resize(kept);
+  for (size_t metric = 0; metric < this->MetricValues.size(); ++metric)
+    {
+    this->MetricValues[metric].resize(kept);
+    }
+  this->Samples.resize(kept);
+
+  this->Modified();
+  this->EndModify(disabledModify);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryUID(int row)
+{
+  return this->IsValidRow(row) ? this->UIDs[row] : -1;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryRow(int uid)
+{
+  UIDIndex::iterator it = this->UIDRows.find(uid);
+  return it != this->UIDRows.end() ? it->second : -1;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::
+FindTrajectory(const char* entryNodeID, const char* targetNodeID)
+{
+  if (!entryNodeID || !targetNodeID)
+    {
+    return -1;
+    }
+
+  FiducialIndex::iterator it = this->ObservedFiducials.find(entryNodeID);
+  if (it == this->ObservedFiducials.end())
+    {
+    return -1;
+    }
+
+  for (std::multiset<int>::iterator uid = it->second.begin();
+       uid != it->second.end(); ++uid)
+    {
+    int row = this->GetTrajectoryRow(*uid);
+    if (row >= 0 &&
+        this->EntryNodeIDs[row].compare(entryNodeID) == 0 &&
+        this->TargetNodeIDs[row].compare(targetNodeID) == 0)
+      {
+      return row;
+      }
+    }
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::
+GetTrajectoriesUsingFiducial(const char* fiducialID, std::vector<int>& rows)
+{
+  rows.clear();
+  if (!fiducialID)
+    {
+    return;
+    }
+
+  FiducialIndex::iterator it = this->ObservedFiducials.find(fiducialID);
+  if (it == this->ObservedFiducials.end())
+    {
+    return;
+    }
+
+  for (std::multiset<int>::iterator uid = it->second.begin();
+       uid != it->second.end(); uid = it->second.upper_bound(*uid))
+    {
+    int row = this->GetTrajectoryRow(*uid);
+    if (row >= 0)
+      {
+      rows.push_back(row);
+      }
+    }
+  std::sort(rows.begin(), rows.end());
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::GetEntryPosition(int row, double position[3])
+{
+  if (!this->IsValidRow(row))
+    {
+    return;
+    }
+  position[0] = this->EntryPositions[3*row];
+  position[1] = this->EntryPositions[3*row+1];
+  position[2] = this->EntryPositions[3*row+2];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetEntryPosition(int row, const double position[3])
+{
+  if (!this->IsValidRow(row) ||
+      SamePosition(&this->EntryPositions[3*row], position))
+    {
+    return;
+    }
+  this->EntryPositions[3*row]   = position[0];
+  this->EntryPositions[3*row+1] = position[1];
+  this->EntryPositions[3*row+2] = position[2];
+  this->UpdateRulerNode(row);
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::GetTargetPosition(int row, double position[3])
+{
+  if (!this->IsValidRow(row))
+    {
+    return;
+    }
+  position[0] = this->TargetPositions[3*row];
+  position[1] = this->TargetPositions[3*row+1];
+  position[2] = this->TargetPositions[3*row+2];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetTargetPosition(int row, const double position[3])
+{
+  if (!this->IsValidRow(row) ||
+      SamePosition(&this->TargetPositions[3*row], position))
+    {
+    return;
+    }
+  this->TargetPositions[3*row]   = position[0];
+  this->TargetPositions[3*row+1] = position[1];
+  this->TargetPositions[3*row+2] = position[2];
+  this->UpdateRulerNode(row);
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryLength(int row)
+{
+  if (!this->IsValidRow(row))
+    {
+    return 0.0;
+    }
+  return sqrt(vtkMath::Distance2BetweenPoints(&this->EntryPositions[3*row],
+                                              &this->TargetPositions[3*row]));
+}
+
+//---------------------------------------------------------------------------
+const double* vtkMRMLPathPlannerTrajectoryNode::GetEntryPositions()
+{
+  return this->EntryPositions.empty() ? 0 : &this->EntryPositions[0];
+}
+
+//---------------------------------------------------------------------------
+const double* vtkMRMLPathPlannerTrajectoryNode::GetTargetPositions()
+{
+  return this->TargetPositions.empty() ? 0 : &this->TargetPositions[0];
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryName(int row)
+{
+  return this->IsValidRow(row) ? this->Names[row].c_str() : 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetTrajectoryName(int row, const char* name)
+{
+  if (!this->IsValidRow(row) || !name ||
+      this->Names[row].compare(name) == 0)
+    {
+    return;
+    }
+  this->Names[row] = name;
+
+  vtkMRMLAnnotationRulerNode* ruler = this->GetRulerNode(row);
+  if (ruler)
+    {
+    ruler->SetName(name);
+    }
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLPathPlannerTrajectoryNode::GetEntryNodeID(int row)
+{
+  return this->IsValidRow(row) ? this->EntryNodeIDs[row].c_str() : 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetEntryNodeID(int row, const char* nodeID)
+{
+  if (!this->IsValidRow(row) || !nodeID ||
+      this->EntryNodeIDs[row].compare(nodeID) == 0)
+    {
+    return;
+    }
+  this->UnobserveFiducial(this->EntryNodeIDs[row], this->UIDs[row]);
+  this->EntryNodeIDs[row] = nodeID;
+  this->ObserveFiducial(this->EntryNodeIDs[row], this->UIDs[row]);
+
+  vtkMRMLAnnotationFiducialNode* entryPoint = this->GetEntryNode(row);
+  if (entryPoint)
+    {
+    double entry[4] = {0,0,0,0};
+    entryPoint->GetFiducialWorldCoordinates(entry);
+    std::copy(entry, entry + 3, this->EntryPositions.begin() + 3*row);
+    this->UpdateRulerNode(row);
+    }
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAnnotationFiducialNode* vtkMRMLPathPlannerTrajectoryNode::GetEntryNode(int row)
+{
+  if (!this->IsValidRow(row) || !this->GetScene() ||
+      this->EntryNodeIDs[row].empty())
+    {
+    return 0;
+    }
+  return vtkMRMLAnnotationFiducialNode::SafeDownCast(
+    this->GetScene()->GetNodeByID(this->EntryNodeIDs[row].c_str()));
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLPathPlannerTrajectoryNode::GetTargetNodeID(int row)
+{
+  return this->IsValidRow(row) ? this->TargetNodeIDs[row].c_str() : 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetTargetNodeID(int row, const char* nodeID)
+{
+  if (!this->IsValidRow(row) || !nodeID ||
+      this->TargetNodeIDs[row].compare(nodeID) == 0)
+    {
+    return;
+    }
+  this->UnobserveFiducial(this->TargetNodeIDs[row], this->UIDs[row]);
+  this->TargetNodeIDs[row] = nodeID;
+  this->ObserveFiducial(this->TargetNodeIDs[row], this->UIDs[row]);
+
+  vtkMRMLAnnotationFiducialNode* targetPoint = this->GetTargetNode(row);
+  if (targetPoint)
+    {
+    double target[4] = {0,0,0,0};
+    targetPoint->GetFiducialWorldCoordinates(target);
+    std::copy(target, target + 3, this->TargetPositions.begin() + 3*row);
+    this->UpdateRulerNode(row);
+    }
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAnnotationFiducialNode* vtkMRMLPathPlannerTrajectoryNode::GetTargetNode(int row)
+{
+  if (!this->IsValidRow(row) || !this->GetScene() ||
+      this->TargetNodeIDs[row].empty())
+    {
+    return 0;
+    }
+  return vtkMRMLAnnotationFiducialNode::SafeDownCast(
+    this->GetScene()->GetNodeByID(this->TargetNodeIDs[row].c_str()));
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLPathPlannerTrajectoryNode::GetRulerNodeID(int row)
+{
+  return this->IsValidRow(row) ? this->RulerNodeIDs[row].c_str() : 0;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAnnotationRulerNode* vtkMRMLPathPlannerTrajectoryNode::GetRulerNode(int row)
+{
+  if (!this->IsValidRow(row) || !this->GetScene() ||
+      this->RulerNodeIDs[row].empty())
+    {
+    return 0;
+    }
+  return vtkMRMLAnnotationRulerNode::SafeDownCast(
+    this->GetScene()->GetNodeByID(this->RulerNodeIDs[row].c_str()));
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryFlags(int row)
+{
+  return this->IsValidRow(row) ? this->Flags[row] : 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetTrajectoryFlags(int row, int flags)
+{
+  if (!this->IsValidRow(row) || this->Flags[row] == flags)
+    {
+    return;
+    }
+  bool visibilityChanged =
+    (this->Flags[row] & PathVisible) != (flags & PathVisible);
+  this->Flags[row] = flags;
+  if (visibilityChanged)
+    {
+    this->UpdateRulerNode(row);
+    }
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLPathPlannerTrajectoryNode::GetTrajectoryFlag(int row, int flag)
+{
+  return (this->GetTrajectoryFlags(row) & flag) != 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetTrajectoryFlag(int row, int flag, bool on)
+{
+  if (!this->IsValidRow(row))
+    {
+    return;
+    }
+  this->SetTrajectoryFlags(row, on ?
+                           (this->Flags[row] | flag) :
+                           (this->Flags[row] & ~flag));
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetNumberOfMetrics()
+{
+  return static_cast<int>(this->MetricNames.size());
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLPathPlannerTrajectoryNode::GetMetricName(int metric)
+{
+  if (metric < 0 || metric >= this->GetNumberOfMetrics())
+    {
+    return 0;
+    }
+  return this->MetricNames[metric].c_str();
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetMetricIndex(const char* name)
+{
+  if (!name)
+    {
+    return -1;
+    }
+  for (int metric = 0; metric < this->GetNumberOfMetrics(); ++metric)
+    {
+    if (this->MetricNames[metric].compare(name) == 0)
+      {
+      return metric;
+      }
+    }
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::AddMetric(const char* name)
+{
+  if (!name)
+    {
+    return -1;
+    }
+  int metric = this->GetMetricIndex(name);
+  if (metric >= 0)
+    {
+    return metric;
+    }
+  this->MetricNames.push_back(name);
+  this->MetricValues.push_back(
+    std::vector<double>(this->UIDs.size(), std::numeric_limits<double>::quiet_NaN()));
+  this->Modified();
+  return this->GetNumberOfMetrics() - 1;
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLPathPlannerTrajectoryNode::GetMetricValue(int row, int metric)
+{
+  if (!this->IsValidRow(row) ||
+      metric < 0 || metric >= this->GetNumberOfMetrics())
+    {
+    return std::numeric_limits<double>::quiet_NaN();
+    }
+  return this->MetricValues[metric][row];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetMetricValue(int row, int metric, double value)
+{
+  if (!this->IsValidRow(row) ||
+      metric < 0 || metric >= this->GetNumberOfMetrics())
+    {
+    return;
+    }
+  double& oldValue = this->MetricValues[metric][row];
+  if (value == oldValue || (vtkMath::IsNan(value) && vtkMath::IsNan(oldValue)))
+    {
+    return;
+    }
+  oldValue = value;
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+double* vtkMRMLPathPlannerTrajectoryNode::GetMetricValues(int metric)
+{
+  if (metric < 0 || metric >= this->GetNumberOfMetrics() ||
+      this->MetricValues[metric].empty())
+    {
+    return 0;
+    }
+  return &this->MetricValues[metric][0];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::
+SetTrajectorySamples(int row, int numberOfSamples, int numberOfComponents,
+                     const double* samples)
+{
+  if (!this->IsValidRow(row) || numberOfSamples < 0 || numberOfComponents < 0)
+    {
+    return;
+    }
+
+  SampleBlock& block = this->Samples[row];
+  block.MappedValues = 0;
+  block.NumberOfSamples = numberOfSamples;
+  block.NumberOfComponents = numberOfComponents;
+  if (samples)
+    {
+    block.Values.assign(samples, samples + numberOfSamples * numberOfComponents);
+    }
+  else
+    {
+    block.Values.assign(numberOfSamples * numberOfComponents, 0.0);
+    }
+  this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetNumberOfTrajectorySamples(int row)
+{
+  return this->IsValidRow(row) ? this->Samples[row].NumberOfSamples : 0;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetNumberOfTrajectorySampleComponents(int row)
+{
+  return this->IsValidRow(row) ? this->Samples[row].NumberOfComponents : 0;
+}
+
+//---------------------------------------------------------------------------
+const double* vtkMRMLPathPlannerTrajectoryNode::GetTrajectorySamples(int row)
+{
+  if (!this->IsValidRow(row))
+    {
+    return 0;
+    }
+  const SampleBlock& block = this->Samples[row];
+  if (block.MappedValues)
+    {
+    return block.MappedValues;
+    }
+  return block.Values.empty() ? 0 : &block.Values[0];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::UnmapSamples()
+{
+  for (size_t row = 0; row < this->Samples.size(); ++row)
+    {
+    SampleBlock& block = this->Samples[row];
+    if (block.MappedValues)
+      {
+      block.Values.assign(block.MappedValues,
+                          block.MappedValues + block.NumberOfSamples * block.NumberOfComponents);
+      block.MappedValues = 0;
+      }
+    }
+  this->MappedFile = NULL;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLStorageNode* vtkMRMLPathPlannerTrajectoryNode::CreateDefaultStorageNode()
+{
+  return vtkMRMLPathPlannerTrajectoryStorageNode::New();
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAnnotationHierarchyNode* vtkMRMLPathPlannerTrajectoryNode::GetRulerHierarchyNode()
+{
+  if (!this->RulerHierarchyNodeID || !this->GetScene())
+    {
+    return NULL;
+    }
+  return vtkMRMLAnnotationHierarchyNode::SafeDownCast(
+    this->GetScene()->GetNodeByID(this->RulerHierarchyNodeID));
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAnnotationHierarchyNode* vtkMRMLPathPlannerTrajectoryNode::CreateRulerHierarchyNode()
+{
+  vtkMRMLAnnotationHierarchyNode* rulerHierarchy = vtkMRMLAnnotationHierarchyNode::New();
+  std::string name = std::string(this->GetName() ? this->GetName() : "Trajectories") + " Rulers";
+  rulerHierarchy->SetName(name.c_str());
+  this->GetScene()->AddNode(rulerHierarchy);
+  this->SetRulerHierarchyNodeID(rulerHierarchy->GetID());
+  rulerHierarchy->Delete();
+  return this->GetRulerHierarchyNode();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::UpdateRulerNode(int row)
+{
+  if (!this->IsValidRow(row))
+    {
+    return;
+    }
+
+  vtkMRMLAnnotationRulerNode* ruler = this->GetRulerNode(row);
+  if (!(this->Flags[row] & PathVisible))
+    {
+    if (ruler)
+      {
+      this->RemoveRulerNode(row);
+      }
+    return;
+    }
+
+  if (!ruler)
+    {
+    if (!this->GetScene())
+      {
+      return;
+      }
+
+    vtkMRMLAnnotationHierarchyNode* rulerHierarchy = this->GetRulerHierarchyNode();
+    if (!rulerHierarchy)
+      {
+      rulerHierarchy = this->CreateRulerHierarchyNode();
+      }
+
+    // The annotation logic parents the new ruler to the active hierarchy,
+    // move it to the rulers of the list
+    vtkMRMLAnnotationRulerNode* newRuler = vtkMRMLAnnotationRulerNode::New();
+    newRuler->Initialize(this->GetScene());
+    vtkMRMLHierarchyNode* rulerItem = vtkMRMLHierarchyNode::GetAssociatedHierarchyNode(
+      this->GetScene(), newRuler->GetID());
+    if (rulerItem && rulerHierarchy)
+      {
+      rulerItem->SetParentNodeID(rulerHierarchy->GetID());
+      }
+    if (!this->Names[row].empty())
+      {
+      newRuler->SetName(this->Names[row].c_str());
+      }
+    else
+      {
+      this->Names[row] = newRuler->GetName();
+      }
+    this->SetRulerNodeID(row, newRuler->GetID());
+
+    vtkNew<vtkIntArray> events;
+    events->InsertNextValue(vtkCommand::ModifiedEvent);
+    events->InsertNextValue(vtkCommand::DeleteEvent);
+    events->InsertNextValue(vtkMRMLDisplayableNode::DisplayModifiedEvent);
+    this->MRMLObserverManager->AddObjectEvents(newRuler, events.GetPointer());
+
+    ruler = newRuler;
+    newRuler->Delete();
+    }
+
+  // Convention: Point1 -> Entry Point
+  //             Point2 -> Target Point
+  double rulerEntry[4] = {0,0,0,0};
+  double rulerTarget[4] = {0,0,0,0};
+  ruler->GetPositionWorldCoordinates1(rulerEntry);
+  ruler->GetPositionWorldCoordinates2(rulerTarget);
+  if (!SamePosition(rulerEntry, &this->EntryPositions[3*row]))
+    {
+    ruler->SetPositionWorldCoordinates1(&this->EntryPositions[3*row]);
+    }
+  if (!SamePosition(rulerTarget, &this->TargetPositions[3*row]))
+    {
+    ruler->SetPositionWorldCoordinates2(&this->TargetPositions[3*row]);
+    }
+  if (!ruler->GetDisplayVisibility())
+    {
+    ruler->SetDisplayVisibility(1);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::RemoveRulerNode(int row)
+{
+  if (!this->IsValidRow(row) || this->RulerNodeIDs[row].empty())
+    {
+    return;
+    }
+
+  vtkMRMLAnnotationRulerNode* ruler = this->GetRulerNode(row);
+  this->SetRulerNodeID(row, std::string());
+  if (ruler)
+    {
+    this->MRMLObserverManager->RemoveObjectEvents(ruler);
+    this->GetScene()->RemoveNode(ruler);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::ObserveFiducial(const std::string& nodeID, int uid)
+{
+  if (nodeID.empty())
+    {
+    return;
+    }
+
+  std::multiset<int>& uids = this->ObservedFiducials[nodeID];
+  uids.insert(uid);
+  if (uids.size() > 1 || !this->GetScene())
+    {
+    return;
+    }
+
+  vtkMRMLNode* fiducial = this->GetScene()->GetNodeByID(nodeID.c_str());
+  if (fiducial)
+    {
+    vtkNew<vtkIntArray> events;
+    events->InsertNextValue(vtkCommand::ModifiedEvent);
+    events->InsertNextValue(vtkCommand::DeleteEvent);
+    this->MRMLObserverManager->AddObjectEvents(fiducial, events.GetPointer());
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::UnobserveFiducial(const std::string& nodeID, int uid)
+{
+  FiducialIndex::iterator it = this->ObservedFiducials.find(nodeID);
+  if (it == this->ObservedFiducials.end())
+    {
+    return;
+    }
+
+  // Remove one use only: entry and target may be the same fiducial
+  std::multiset<int>::iterator use = it->second.find(uid);
+  if (use != it->second.end())
+    {
+    it->second.erase(use);
+    }
+  if (!it->second.empty())
+    {
+    return;
+    }
+  this->ObservedFiducials.erase(it);
+
+  vtkMRMLNode* fiducial = this->GetScene() ?
+    this->GetScene()->GetNodeByID(nodeID.c_str()) : 0;
+  if (fiducial)
+    {
+    this->MRMLObserverManager->RemoveObjectEvents(fiducial);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::
+OnFiducialModified(vtkMRMLAnnotationFiducialNode* fiducial)
+{
+  if (!fiducial->GetID())
+    {
+    return;
+    }
+
+  double position[4] = {0,0,0,0};
+  fiducial->GetFiducialWorldCoordinates(position);
+
+  std::vector<int> rows;
+  this->GetTrajectoriesUsingFiducial(fiducial->GetID(), rows);
+  for (std::vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
+    {
+    int row = *it;
+    bool isEntry = this->EntryNodeIDs[row].compare(fiducial->GetID()) == 0;
+    bool isTarget = this->TargetNodeIDs[row].compare(fiducial->GetID()) == 0;
+    if (!isEntry && !isTarget)
+      {
+      continue;
+      }
+
+    if (isEntry)
+      {
+      std::copy(position, position + 3, this->EntryPositions.begin() + 3*row);
+      }
+    if (isTarget)
+      {
+      std::copy(position, position + 3, this->TargetPositions.begin() + 3*row);
+      }
+    this->UpdateRulerNode(row);
+
+    // Fiducial name may have changed as well
+    this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::
+OnRulerModified(vtkMRMLAnnotationRulerNode* ruler)
+{
+  if (!ruler->GetID())
+    {
+    return;
+    }
+
+  int row = this->GetRulerTrajectoryRow(ruler->GetID());
+  if (row >= 0)
+    {
+    double entry[4] = {0,0,0,0};
+    double target[4] = {0,0,0,0};
+    ruler->GetPositionWorldCoordinates1(entry);
+    ruler->GetPositionWorldCoordinates2(target);
+    if (SamePosition(entry, &this->EntryPositions[3*row]) &&
+        SamePosition(target, &this->TargetPositions[3*row]))
+      {
+      return;
+      }
+
+    // Ruler moved in the viewers: move the fiducials to keep them linked
+    std::copy(entry, entry + 3, this->EntryPositions.begin() + 3*row);
+    std::copy(target, target + 3, this->TargetPositions.begin() + 3*row);
+
+    vtkMRMLAnnotationFiducialNode* entryPoint = this->GetEntryNode(row);
+    if (entryPoint)
+      {
+      entryPoint->SetFiducialWorldCoordinates(entry);
+      }
+    vtkMRMLAnnotationFiducialNode* targetPoint = this->GetTargetNode(row);
+    if (targetPoint)
+      {
+      targetPoint->SetFiducialWorldCoordinates(target);
+      }
+
+    this->InvokeTrajectoryEvent(TrajectoryModifiedEvent, row);
+    return;
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::SetRulerNodeID(int row, const std::string& nodeID)
+{
+  if (!this->RulerNodeIDs[row].empty())
+    {
+    this->RulerUIDs.erase(this->RulerNodeIDs[row]);
+    }
+  this->RulerNodeIDs[row] = nodeID;
+  if (!nodeID.empty())
+    {
+    this->RulerUIDs[nodeID] = this->UIDs[row];
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNode::GetRulerTrajectoryRow(const char* rulerID)
+{
+  if (!rulerID)
+    {
+    return -1;
+    }
+  RulerIndex::iterator it = this->RulerUIDs.find(rulerID);
+  return it != this->RulerUIDs.end() ? this->GetTrajectoryRow(it->second) : -1;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryNode::RebuildIndex()
+{
+  // Nodes of the current index may no longer be referenced by the columns
+  vtkMRMLScene* scene = this->GetScene();
+  if (scene)
+    {
+    for (FiducialIndex::iterator it = this->ObservedFiducials.begin();
+         it != this->ObservedFiducials.end(); ++it)
+      {
+      vtkMRMLNode* fiducial = scene->GetNodeByID(it->first.c_str());
+      if (fiducial)
+        {
+        this->MRMLObserverManager->RemoveObjectEvents(fiducial);
+        }
+      }
+    for (RulerIndex::iterator it = this->RulerUIDs.begin();
+         it != this->RulerUIDs.end(); ++it)
+      {
+      vtkMRMLNode* ruler = scene->GetNodeByID(it->first.c_str());
+      if (ruler)
+        {
+        this->MRMLObserverManager->RemoveObjectEvents(ruler);
+        }
+      }
+    }
+
+  this->UIDRows.clear();
+  this->ObservedFiducials.clear();
+  this->RulerUIDs.clear();
+  for (int row = 0; row < this->GetNumberOfTrajectories(); ++row)
+    {
+    this->UIDRows[this->UIDs[row]] = row;
+    if (!this->EntryNodeIDs[row].empty())
+      {
+      this->ObservedFiducials[this->EntryNodeIDs[row]].insert(this->UIDs[row]);
+      }
+    if (!this->TargetNodeIDs[row].empty())
+      {
+      this->ObservedFiducials[this->TargetNodeIDs[row]].insert(this->UIDs[row]);
+      }
+    if (!this->RulerNodeIDs[row].empty())
+      {
+      this->RulerUIDs[this->RulerNodeIDs[row]] = this->UIDs[row];
+      }
+    }
+}
@@ -1,9 +1,9 @@
 /*==============================================================================
 
   Program: 3D Slicer
- 
+
   Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
- 
+
   See COPYRIGHT.txt
   or http://www.slicer.org/copyright/copyright.txt for details.
 
@@ -12,30 +12,72 @@
   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
   See the License for the specific language governing permissions and
   limitations under the License.
- 
+
   This file was originally developed by Laurent Chauvin, Brigham and Women's
   Hospital. The project was supported by grants 5P01CA067165,
   5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
   5R42CA137886, 8P41EB015898
- 
+
 ==============================================================================*/
 
 #ifndef __vtkMRMLPathPlannerTrajectoryNode_h
 #define __vtkMRMLPathPlannerTrajectoryNode_h
 
 #include "vtkSlicerPathExplorerModuleMRMLExport.h"
-#include "vtkMRMLAnnotationHierarchyNode.h" 
+#include "vtkMRMLStorableNode.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 class vtkMRMLNode;
 class vtkMRMLScene;
 class vtkMRMLAnnotationFiducialNode;
+class vtkMRMLAnnotationHierarchyNode;
 class vtkMRMLAnnotationRulerNode;
+class vtkPathPlannerMappedFile;
 
-class  VTK_SLICER_PATHEXPLORER_MODULE_MRML_EXPORT vtkMRMLPathPlannerTrajectoryNode : public vtkMRMLAnnotationHierarchyNode
+/// \brief Store of the trajectories planned between entry and target points.
+///
+/// Trajectories are kept as parallel arrays indexed by row: entry and target
+/// coordinates, names, entry/target fiducial IDs, flags and metrics.
+/// Each trajectory also gets a unique identifier (UID) that remains valid
+/// when other rows are removed.
+/// A vtkMRMLAnnotationRulerNode is only created for the trajectories that have
+/// the PathVisible flag set, and is kept in sync with the stored coordinates.
+/// The rulers are grouped in an annotation hierarchy owned by the list.
+class  VTK_SLICER_PATHEXPLORER_MODULE_MRML_EXPORT vtkMRMLPathPlannerTrajectoryNode : public vtkMRMLStorableNode
 {
 public:
   static vtkMRMLPathPlannerTrajectoryNode *New();
-  vtkTypeMacro(vtkMRMLPathPlannerTrajectoryNode, vtkMRMLAnnotationHierarchyNode);
+  vtkTypeMacro(vtkMRMLPathPlannerTrajectoryNode, vtkMRMLStorableNode);
+
+  // Description:
+  // Events invoked with a pointer to the row index as call data.
+  enum
+    {
+    TrajectoryAddedEvent = 21000,
+    TrajectoryRemovedEvent,
+    TrajectoryModifiedEvent
+    };
+
+  // Description:
+  // Per-trajectory flags
+  enum
+    {
+    PathVisible     = 0x01,
+    EntryVisible    = 0x02,
+    TargetVisible   = 0x04,
+    PathProjected   = 0x08,
+    EntryProjected  = 0x10,
+    TargetProjected = 0x20,
+    DefaultFlags    = PathVisible | EntryVisible | TargetVisible
+    };
 
   //--------------------------------------------------------------------------
   // MRMLNode methods
@@ -51,33 +93,254 @@ public:
   // Description:
   // Read node attributes from XML file
   virtual void ReadXMLAttributes( const char** atts);
-  
+
   // Description:
   // Write this node's information to a MRML file in XML format.
   virtual void WriteXML(ostream& of, int indent);
 
+  // Description:
+  // Resolve entry/target/ruler node references read from the XML file.
   virtual void UpdateScene(vtkMRMLScene *scene);
 
+  // Description:
+  // Update entry/target/ruler IDs when nodes are renamed on scene import.
+  virtual void UpdateReferenceID(const char *oldID, const char *newID);
+
   // Description:
   // Copy the node's attributes to this object
   virtual void Copy(vtkMRMLNode *node);
 
+  // Description:
+  // Create a vtkMRMLPathPlannerTrajectoryStorageNode, used by the save
+  // dialog to write the trajectories in a .ptraj file.
+  virtual vtkMRMLStorageNode* CreateDefaultStorageNode();
+
   // Description:
   // alternative method to propagate events generated in Display nodes
-  virtual void ProcessMRMLEvents ( vtkObject * /*caller*/, 
-                                   unsigned long /*event*/, 
+  virtual void ProcessMRMLEvents ( vtkObject * /*caller*/,
+                                   unsigned long /*event*/,
                                    void * /*callData*/ );
 
+  //--------------------------------------------------------------------------
+  // Trajectories
+  //--------------------------------------------------------------------------
+
+  // Description:
+  // Number of trajectories stored in the node
+  int GetNumberOfTrajectories();
+
+  // Description:
+  // Add a trajectory and return its row.
+  // If the PathVisible flag is set (default) and the node belongs to a scene,
+  // a ruler is created for it.
+  int AddTrajectory(vtkMRMLAnnotationFiducialNode* entryPoint,
+                    vtkMRMLAnnotationFiducialNode* targetPoint,
+                    const char* name = 0);
+  int AddTrajectory(const double entry[3], const double target[3],
+                    const char* name = 0,
+                    const char* entryNodeID = 0, const char* targetNodeID = 0,
+                    int flags = DefaultFlags);
+
+  // Description:
+  // Remove a trajectory and its ruler, if any.
+  void RemoveTrajectory(int row);
+  void RemoveAllTrajectories();
+
+  // Description:
+  // Remove several trajectories in a single pass over the columns.
+  // Invalid or duplicated rows are ignored. Observers get one ModifiedEvent.
+  void RemoveTrajectories(const std::vector<int>& rows);
+
+  // Description:
+  // Unique identifier of the trajectory at a given row, and reverse lookup.
+  // GetTrajectoryRow returns -1 if the UID is unknown.
+  int GetTrajectoryUID(int row);
+  int GetTrajectoryRow(int uid);
+
+  // Description:
+  // Row of the trajectory going from entryNodeID to targetNodeID,
+  // -1 if there is none.
+  int FindTrajectory(const char* entryNodeID, const char* targetNodeID);
+
+  // Description:
+  // Rows (sorted) of the trajectories using the fiducial as entry or target.
+  void GetTrajectoriesUsingFiducial(const char* fiducialID, std::vector<int>& rows);
+
+  // Description:
+  // Entry / target coordinates (RAS).
+  void GetEntryPosition(int row, double position[3]);
+  void SetEntryPosition(int row, const double position[3]);
+  void GetTargetPosition(int row, double position[3]);
+  void SetTargetPosition(int row, const double position[3]);
+  double GetTrajectoryLength(int row);
+
+  // Description:
+  // Contiguous coordinate arrays (3 values per trajectory).
+  const double* GetEntryPositions();
+  const double* GetTargetPositions();
+
+  // Description:
+  // Trajectory name. The ruler, if any, is renamed as well.
+  const char* GetTrajectoryName(int row);
+  void SetTrajectoryName(int row, const char* name);
+
+  // Description:
+  // Fiducials used to define the trajectory.
+  // The fiducials are observed to keep the coordinates up to date.
+  const char* GetEntryNodeID(int row);
+  void SetEntryNodeID(int row, const char* nodeID);
+  vtkMRMLAnnotationFiducialNode* GetEntryNode(int row);
+  const char* GetTargetNodeID(int row);
+  void SetTargetNodeID(int row, const char* nodeID);
+  vtkMRMLAnnotationFiducialNode* GetTargetNode(int row);
+
+  // Description:
+  // Ruler displaying the trajectory. NULL if the trajectory is not displayed.
+  const char* GetRulerNodeID(int row);
+  vtkMRMLAnnotationRulerNode* GetRulerNode(int row);
+
+  // Description:
+  // Trajectory flags. Setting or clearing PathVisible creates or removes
+  // the ruler.
+  int GetTrajectoryFlags(int row);
+  void SetTrajectoryFlags(int row, int flags);
+  bool GetTrajectoryFlag(int row, int flag);
+  void SetTrajectoryFlag(int row, int flag, bool on);
+
+  //--------------------------------------------------------------------------
+  // Metrics
+  //--------------------------------------------------------------------------
+
+  // Description:
+  // Named per-trajectory values (e.g. clearance, score), stored as one
+  // contiguous column per metric.
+  int GetNumberOfMetrics();
+  const char* GetMetricName(int metric);
+  int GetMetricIndex(const char* name);
+  // Description:
+  // Return the index of the metric, creating it (filled with NaN) if needed.
+  int AddMetric(const char* name);
+  // Description:
+  // Setting a different value invokes TrajectoryModifiedEvent.
+  double GetMetricValue(int row, int metric);
+  void SetMetricValue(int row, int metric, double value);
+  double* GetMetricValues(int metric);
+
+  //--------------------------------------------------------------------------
+  // Samples
+  //--------------------------------------------------------------------------
+
+  // Description:
+  // Values sampled along a trajectory (e.g. intensity profile), stored as
+  // numberOfSamples tuples of numberOfComponents values.
+  // Samples are only saved by vtkMRMLPathPlannerTrajectoryStorageNode.
+  void SetTrajectorySamples(int row, int numberOfSamples, int numberOfComponents,
+                            const double* samples);
+  int GetNumberOfTrajectorySamples(int row);
+  int GetNumberOfTrajectorySampleComponents(int row);
+  const double* GetTrajectorySamples(int row);
+
+  //--------------------------------------------------------------------------
+  // Rulers
+  //--------------------------------------------------------------------------
+
+  // Description:
+  // Annotation hierarchy of the rulers, created with the first ruler.
+  vtkSetStringMacro(RulerHierarchyNodeID);
+  vtkGetStringMacro(RulerHierarchyNodeID);
+  vtkMRMLAnnotationHierarchyNode* GetRulerHierarchyNode();
+
 protected:
   vtkMRMLPathPlannerTrajectoryNode();
   ~vtkMRMLPathPlannerTrajectoryNode();
   vtkMRMLPathPlannerTrajectoryNode(const vtkMRMLPathPlannerTrajectoryNode&);
-  void operator=(const vtkMRMLPathPlannerTrajectoryNode&); 
+  void operator=(const vtkMRMLPathPlannerTrajectoryNode&);
+
+  bool IsValidRow(int row);
+  void InvokeTrajectoryEvent(unsigned long event, int row);
+
+  // Description:
+  // Create, remove or update the ruler of a trajectory.
+  void UpdateRulerNode(int row);
+  void RemoveRulerNode(int row);
+
+  // Description:
+  // Add an annotation hierarchy for the rulers to the scene.
+  vtkMRMLAnnotationHierarchyNode* CreateRulerHierarchyNode();
+
+  // Description:
+  // Observation of the entry/target fiducials. The fiducial is observed
+  // as long as at least one trajectory uses it.
+  void ObserveFiducial(const std::string& nodeID, int uid);
+  void UnobserveFiducial(const std::string& nodeID, int uid);
+
+  // Description:
+  // Keep RulerNodeIDs and RulerUIDs in sync.
+  void SetRulerNodeID(int row, const std::string& nodeID);
+
+  // Description:
+  // Rebuild the UID, fiducial and ruler indices from the trajectory columns.
+  // The nodes of the previous index are no longer observed, the new ones
+  // are not observed until ResolveReferences is called.
+  void RebuildIndex();
+
+  // Description:
+  // Row of the trajectory displayed by a ruler, -1 if none.
+  int GetRulerTrajectoryRow(const char* rulerID);
+
+  void OnFiducialModified(vtkMRMLAnnotationFiducialNode* fiducial);
+  void OnRulerModified(vtkMRMLAnnotationRulerNode* ruler);
+
+  // Description:
+  // Observe entry/target fiducials and rulers of all the rows.
+  void ResolveReferences();
+
+  // Description:
+  // Copy the samples still in the mapped file into memory and release it.
+  void UnmapSamples();
+
+  friend class vtkMRMLPathPlannerTrajectoryStorageNode;
+
+  // Trajectory storage (one entry per row)
+  std::vector<int>         UIDs;
+  std::vector<double>      EntryPositions;  // 3 per row
+  std::vector<double>      TargetPositions; // 3 per row
+  std::vector<std::string> Names;
+  std::vector<std::string> EntryNodeIDs;
+  std::vector<std::string> TargetNodeIDs;
+  std::vector<std::string> RulerNodeIDs;
+  std::vector<int>         Flags;
+
+  // Metric storage (one column per metric)
+  std::vector<std::string>          MetricNames;
+  std::vector<std::vector<double> > MetricValues;
+
+  // Sample storage (one block per row). Blocks read from a binary file
+  // point into MappedFile until they are modified.
+  struct SampleBlock
+    {
+    SampleBlock() : MappedValues(0), NumberOfSamples(0), NumberOfComponents(0) {}
+    const double*       MappedValues;
+    int                 NumberOfSamples;
+    int                 NumberOfComponents;
+    std::vector<double> Values;
+    };
+  std::vector<SampleBlock>                  Samples;
+  vtkSmartPointer<vtkPathPlannerMappedFile> MappedFile;
+
+  int NextUID;
 
-  typedef std::pair<vtkMRMLAnnotationFiducialNode*, vtkMRMLAnnotationFiducialNode*> FiducialPair;
-  typedef std::map<FiducialPair, vtkMRMLAnnotationRulerNode*> FiducialRuler;
+  char* RulerHierarchyNodeID;
 
-  FiducialRuler RulerList;
+  // Indices kept in sync with the columns
+  typedef std::map<int, int> UIDIndex;
+  UIDIndex UIDRows;
+  // Fiducial ID -> UIDs of the trajectories using it (once per use)
+  typedef std::map<std::string, std::multiset<int> > FiducialIndex;
+  FiducialIndex ObservedFiducials;
+  // Ruler ID -> UID of the trajectory it displays
+  typedef std::map<std::string, int> RulerIndex;
+  RulerIndex RulerUIDs;
 };
 
 #endif
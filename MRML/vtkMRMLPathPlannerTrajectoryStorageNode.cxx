@@ -0,0 +1,496 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#include "vtkMRMLPathPlannerTrajectoryStorageNode.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include "vtkPathPlannerMappedFile.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkType.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// File layout (version 1), all offsets from the beginning of the file:
+//
+//   FileHeader
+//   FileRecord      x NumberOfTrajectories   (RecordSize bytes each)
+//   FileString      x NumberOfMetrics        (metric names)
+//   double          x NumberOfMetrics * NumberOfTrajectories (metric-major)
+//   char            x StringsSize            (NULL terminated strings)
+//   double          x ...                    (sample blocks)
+//
+// Every block starts on an 8-byte boundary. Readers must use RecordSize
+// as stride, so later versions can append fields to the records.
+const char FileMagic[8] = {'P','A','T','H','P','L','A','N'};
+const vtkTypeUInt32 FileByteOrder = 0x01020304;
+const size_t FileAlignment = 8;
+
+struct FileString
+{
+  vtkTypeUInt32 Offset; // in the string table
+  vtkTypeUInt32 Length; // without the NULL character
+};
+
+struct FileHeader
+{
+  char          Magic[8];
+  vtkTypeUInt32 Version;
+  vtkTypeUInt32 ByteOrder;
+  vtkTypeUInt32 HeaderSize;
+  vtkTypeUInt32 RecordSize;
+  vtkTypeUInt32 NumberOfTrajectories;
+  vtkTypeUInt32 NumberOfMetrics;
+  vtkTypeInt32  NextUID;
+  vtkTypeUInt32 Reserved;
+  vtkTypeUInt64 RecordsOffset;
+  vtkTypeUInt64 MetricNamesOffset;
+  vtkTypeUInt64 MetricValuesOffset;
+  vtkTypeUInt64 StringsOffset;
+  vtkTypeUInt64 StringsSize;
+  vtkTypeUInt64 SamplesOffset;
+  vtkTypeUInt64 FileSize;
+};
+
+struct FileRecord
+{
+  double        Entry[3];
+  double        Target[3];
+  vtkTypeInt32  UID;
+  vtkTypeInt32  Flags;
+  FileString    Name;
+  FileString    EntryNodeID;
+  FileString    TargetNodeID;
+  FileString    RulerNodeID;
+  vtkTypeUInt64 SamplesOffset;
+  vtkTypeUInt32 NumberOfSamples;
+  vtkTypeUInt32 NumberOfSampleComponents;
+};
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 Align(vtkTypeUInt64 offset)
+{
+  return (offset + FileAlignment - 1) / FileAlignment * FileAlignment;
+}
+
+//----------------------------------------------------------------------------
+FileString AddString(std::string& strings, const std::string& value)
+{
+  FileString fileString;
+  fileString.Offset = static_cast<vtkTypeUInt32>(strings.size());
+  fileString.Length = static_cast<vtkTypeUInt32>(value.size());
+  strings.append(value);
+  strings.push_back('\0');
+  return fileString;
+}
+
+//----------------------------------------------------------------------------
+bool GetString(const char* strings, vtkTypeUInt64 stringsSize,
+               const FileString& fileString, std::string& value)
+{
+  if (static_cast<vtkTypeUInt64>(fileString.Offset) + fileString.Length >= stringsSize)
+    {
+    return false;
+    }
+  value.assign(strings + fileString.Offset, fileString.Length);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool InFile(vtkTypeUInt64 offset, vtkTypeUInt64 size, vtkTypeUInt64 fileSize)
+{
+  return offset <= fileSize && size <= fileSize - offset;
+}
+
+//----------------------------------------------------------------------------
+// Same as above for an array of numberOfItems * itemSize bytes. The
+// product read from the file header may wrap around, it is compared
+// with a division instead.
+bool InFile(vtkTypeUInt64 offset, vtkTypeUInt64 numberOfItems,
+            vtkTypeUInt64 itemSize, vtkTypeUInt64 fileSize)
+{
+  return offset <= fileSize &&
+         (itemSize == 0 || numberOfItems <= (fileSize - offset) / itemSize);
+}
+
+//----------------------------------------------------------------------------
+void WritePadding(std::ofstream& of, vtkTypeUInt64 offset)
+{
+  static const char zeros[FileAlignment] = {0};
+  of.write(zeros, static_cast<std::streamsize>(Align(offset) - offset));
+}
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLPathPlannerTrajectoryStorageNode);
+
+//----------------------------------------------------------------------------
+vtkMRMLPathPlannerTrajectoryStorageNode::vtkMRMLPathPlannerTrajectoryStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLPathPlannerTrajectoryStorageNode::~vtkMRMLPathPlannerTrajectoryStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLPathPlannerTrajectoryStorageNode::CanReadInReferenceNode(vtkMRMLNode* refNode)
+{
+  return refNode && refNode->IsA("vtkMRMLPathPlannerTrajectoryNode");
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLPathPlannerTrajectoryStorageNode::InitializeSupportedWriteFileTypes()
+{
+  this->SupportedWriteFileTypes->InsertNextValue("Path Planner Trajectories (.ptraj)");
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryStorageNode::ReadDataInternal(vtkMRMLNode* refNode)
+{
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryNode =
+    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(refNode);
+  if (!trajectoryNode)
+    {
+    vtkErrorMacro("ReadData: Reference node is not a vtkMRMLPathPlannerTrajectoryNode");
+    return 0;
+    }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+    {
+    vtkErrorMacro("ReadData: File name not specified");
+    return 0;
+    }
+
+  vtkSmartPointer<vtkPathPlannerMappedFile> file =
+    vtkSmartPointer<vtkPathPlannerMappedFile>::New();
+  if (!file->Open(fullName.c_str()))
+    {
+    vtkErrorMacro("ReadData: Unable to map file " << fullName);
+    return 0;
+    }
+
+  const char* data = file->GetData();
+  vtkTypeUInt64 fileSize = file->GetSize();
+
+  // Header
+  FileHeader header;
+  if (fileSize < sizeof(FileHeader))
+    {
+    vtkErrorMacro("ReadData: " << fullName << " is too small");
+    return 0;
+    }
+  memcpy(&header, data, sizeof(FileHeader));
+
+  if (memcmp(header.Magic, FileMagic, sizeof(FileMagic)) != 0)
+    {
+    vtkErrorMacro("ReadData: " << fullName << " is not a trajectory file");
+    return 0;
+    }
+  if (header.ByteOrder != FileByteOrder)
+    {
+    vtkErrorMacro("ReadData: " << fullName << " was written with a different byte order");
+    return 0;
+    }
+  if (header.Version == 0 || header.Version > FileFormatVersion)
+    {
+    vtkErrorMacro("ReadData: Unsupported file version " << header.Version);
+    return 0;
+    }
+
+  vtkTypeUInt64 numberOfTrajectories = header.NumberOfTrajectories;
+  vtkTypeUInt64 numberOfMetrics = header.NumberOfMetrics;
+  if (header.HeaderSize < sizeof(FileHeader) ||
+      header.RecordSize < sizeof(FileRecord) ||
+      header.FileSize != fileSize ||
+      !InFile(header.RecordsOffset, numberOfTrajectories, header.RecordSize, fileSize) ||
+      !InFile(header.MetricNamesOffset, numberOfMetrics, sizeof(FileString), fileSize) ||
+      !InFile(header.MetricValuesOffset,
+              numberOfTrajectories, numberOfMetrics * sizeof(double), fileSize) ||
+      !InFile(header.StringsOffset, header.StringsSize, fileSize) ||
+      header.RecordsOffset % FileAlignment != 0 ||
+      header.MetricValuesOffset % FileAlignment != 0 ||
+      header.SamplesOffset % FileAlignment != 0)
+    {
+    vtkErrorMacro("ReadData: " << fullName << " is corrupted");
+    return 0;
+    }
+
+  const char* strings = data + header.StringsOffset;
+
+  int disabledModify = trajectoryNode->StartModify();
+
+  trajectoryNode->RemoveAllTrajectories();
+
+  // Metrics
+  std::vector<std::string> metricNames(header.NumberOfMetrics);
+  std::vector<std::vector<double> > metricValues(header.NumberOfMetrics);
+  for (vtkTypeUInt32 metric = 0; metric < header.NumberOfMetrics; ++metric)
+    {
+    FileString name;
+    memcpy(&name, data + header.MetricNamesOffset + metric * sizeof(FileString),
+           sizeof(FileString));
+    const double* values = reinterpret_cast<const double*>(
+      data + header.MetricValuesOffset + metric * numberOfTrajectories * sizeof(double));
+    if (!GetString(strings, header.StringsSize, name, metricNames[metric]))
+      {
+      vtkErrorMacro("ReadData: " << fullName << " is corrupted");
+      trajectoryNode->EndModify(disabledModify);
+      return 0;
+      }
+    metricValues[metric].assign(values, values + numberOfTrajectories);
+    }
+  trajectoryNode->MetricNames.swap(metricNames);
+  trajectoryNode->MetricValues.swap(metricValues);
+
+  // Records. Sample blocks are not touched, they stay in the mapped file.
+  size_t size = static_cast<size_t>(numberOfTrajectories);
+  trajectoryNode->UIDs.resize(size);
+  trajectoryNode->EntryPositions.resize(3*size);
+  trajectoryNode->TargetPositions.resize(3*size);
+  trajectoryNode->Names.resize(size);
+  trajectoryNode->EntryNodeIDs.resize(size);
+  trajectoryNode->TargetNodeIDs.resize(size);
+  trajectoryNode->RulerNodeIDs.resize(size);
+  trajectoryNode->Flags.resize(size);
+  trajectoryNode->Samples.assign(size, vtkMRMLPathPlannerTrajectoryNode::SampleBlock());
+
+  bool valid = true;
+  bool hasSamples = false;
+  FileRecord record;
+  for (size_t row = 0; row < size && valid; ++row)
+    {
+    memcpy(&record, data + header.RecordsOffset + row * header.RecordSize,
+           sizeof(FileRecord));
+
+    trajectoryNode->UIDs[row] = record.UID;
+    std::copy(record.Entry, record.Entry + 3, trajectoryNode->EntryPositions.begin() + 3*row);
+    std::copy(record.Target, record.Target + 3, trajectoryNode->TargetPositions.begin() + 3*row);
+    trajectoryNode->Flags[row] = record.Flags;
+    valid = GetString(strings, header.StringsSize, record.Name, trajectoryNode->Names[row]) &&
+            GetString(strings, header.StringsSize, record.EntryNodeID, trajectoryNode->EntryNodeIDs[row]) &&
+            GetString(strings, header.StringsSize, record.TargetNodeID, trajectoryNode->TargetNodeIDs[row]) &&
+            GetString(strings, header.StringsSize, record.RulerNodeID, trajectoryNode->RulerNodeIDs[row]);
+
+    if (record.NumberOfSamples > 0 && record.NumberOfSampleComponents > 0)
+      {
+      vtkTypeUInt64 numberOfValues =
+        static_cast<vtkTypeUInt64>(record.NumberOfSamples) * record.NumberOfSampleComponents;
+      valid = valid &&
+              record.NumberOfSamples <= static_cast<vtkTypeUInt32>(VTK_INT_MAX) &&
+              record.NumberOfSampleComponents <= static_cast<vtkTypeUInt32>(VTK_INT_MAX) &&
+              record.SamplesOffset % FileAlignment == 0 &&
+              InFile(record.SamplesOffset, numberOfValues, sizeof(double), fileSize);
+
+      vtkMRMLPathPlannerTrajectoryNode::SampleBlock& block = trajectoryNode->Samples[row];
+      block.MappedValues = valid ?
+        reinterpret_cast<const double*>(data + record.SamplesOffset) : 0;
+      block.NumberOfSamples = static_cast<int>(record.NumberOfSamples);
+      block.NumberOfComponents = static_cast<int>(record.NumberOfSampleComponents);
+      hasSamples = true;
+      }
+    }
+
+  if (!valid)
+    {
+    vtkErrorMacro("ReadData: " << fullName << " is corrupted");
+    trajectoryNode->RemoveAllTrajectories();
+    trajectoryNode->EndModify(disabledModify);
+    return 0;
+    }
+
+  trajectoryNode->NextUID = header.NextUID;
+  trajectoryNode->RebuildIndex();
+  // Keep the file mapped as long as the node uses the sample blocks
+  trajectoryNode->MappedFile = hasSamples ? file.GetPointer() : 0;
+
+  trajectoryNode->ResolveReferences();
+  trajectoryNode->Modified();
+  trajectoryNode->EndModify(disabledModify);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryStorageNode::WriteDataInternal(vtkMRMLNode* refNode)
+{
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryNode =
+    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(refNode);
+  if (!trajectoryNode)
+    {
+    vtkErrorMacro("WriteData: Reference node is not a vtkMRMLPathPlannerTrajectoryNode");
+    return 0;
+    }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+    {
+    vtkErrorMacro("WriteData: File name not specified");
+    return 0;
+    }
+
+  vtkTypeUInt32 numberOfTrajectories =
+    static_cast<vtkTypeUInt32>(trajectoryNode->GetNumberOfTrajectories());
+  vtkTypeUInt32 numberOfMetrics =
+    static_cast<vtkTypeUInt32>(trajectoryNode->GetNumberOfMetrics());
+
+  // Records and string table
+  std::string strings;
+  std::vector<FileRecord> records(numberOfTrajectories);
+  for (vtkTypeUInt32 row = 0; row < numberOfTrajectories; ++row)
+    {
+    FileRecord& record = records[row];
+    memset(&record, 0, sizeof(FileRecord));
+    trajectoryNode->GetEntryPosition(row, record.Entry);
+    trajectoryNode->GetTargetPosition(row, record.Target);
+    record.UID = trajectoryNode->UIDs[row];
+    record.Flags = trajectoryNode->Flags[row];
+    record.Name = AddString(strings, trajectoryNode->Names[row]);
+    record.EntryNodeID = AddString(strings, trajectoryNode->EntryNodeIDs[row]);
+    record.TargetNodeID = AddString(strings, trajectoryNode->TargetNodeIDs[row]);
+    record.RulerNodeID = AddString(strings, trajectoryNode->RulerNodeIDs[row]);
+    }
+  std::vector<FileString> metricNames(numberOfMetrics);
+  for (vtkTypeUInt32 metric = 0; metric < numberOfMetrics; ++metric)
+    {
+    metricNames[metric] = AddString(strings, trajectoryNode->MetricNames[metric]);
+    }
+
+  // Layout
+  FileHeader header;
+  memset(&header, 0, sizeof(FileHeader));
+  memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+  header.Version = FileFormatVersion;
+  header.ByteOrder = FileByteOrder;
+  header.HeaderSize = sizeof(FileHeader);
+  header.RecordSize = sizeof(FileRecord);
+  header.NumberOfTrajectories = numberOfTrajectories;
+  header.NumberOfMetrics = numberOfMetrics;
+  header.NextUID = trajectoryNode->NextUID;
+  header.RecordsOffset = Align(sizeof(FileHeader));
+  header.MetricNamesOffset =
+    Align(header.RecordsOffset + numberOfTrajectories * sizeof(FileRecord));
+  header.MetricValuesOffset =
+    Align(header.MetricNamesOffset + numberOfMetrics * sizeof(FileString));
+  header.StringsOffset = header.MetricValuesOffset +
+    static_cast<vtkTypeUInt64>(numberOfMetrics) * numberOfTrajectories * sizeof(double);
+  header.StringsSize = strings.size();
+  header.SamplesOffset = Align(header.StringsOffset + header.StringsSize);
+
+  vtkTypeUInt64 offset = header.SamplesOffset;
+  for (vtkTypeUInt32 row = 0; row < numberOfTrajectories; ++row)
+    {
+    FileRecord& record = records[row];
+    record.NumberOfSamples = trajectoryNode->GetNumberOfTrajectorySamples(row);
+    record.NumberOfSampleComponents = trajectoryNode->GetNumberOfTrajectorySampleComponents(row);
+    if (trajectoryNode->GetTrajectorySamples(row))
+      {
+      record.SamplesOffset = offset;
+      offset += static_cast<vtkTypeUInt64>(record.NumberOfSamples) *
+                record.NumberOfSampleComponents * sizeof(double);
+      }
+    }
+  header.FileSize = offset;
+
+  // The current file may still be mapped by the node: write a new file
+  // and replace the old one when done.
+  std::string tempName = fullName + ".tmp";
+  std::ofstream of(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!of.is_open())
+    {
+    vtkErrorMacro("WriteData: Unable to open " << tempName << " for writing");
+    return 0;
+    }
+
+  of.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  WritePadding(of, sizeof(FileHeader));
+  if (!records.empty())
+    {
+    of.write(reinterpret_cast<const char*>(&records[0]),
+             static_cast<std::streamsize>(records.size() * sizeof(FileRecord)));
+    }
+  WritePadding(of, header.RecordsOffset + records.size() * sizeof(FileRecord));
+  if (!metricNames.empty())
+    {
+    of.write(reinterpret_cast<const char*>(&metricNames[0]),
+             static_cast<std::streamsize>(metricNames.size() * sizeof(FileString)));
+    }
+  WritePadding(of, header.MetricNamesOffset + metricNames.size() * sizeof(FileString));
+  for (vtkTypeUInt32 metric = 0; metric < numberOfMetrics && numberOfTrajectories > 0; ++metric)
+    {
+    of.write(reinterpret_cast<const char*>(trajectoryNode->GetMetricValues(metric)),
+             static_cast<std::streamsize>(numberOfTrajectories * sizeof(double)));
+    }
+  of.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+  WritePadding(of, header.StringsOffset + header.StringsSize);
+  for (vtkTypeUInt32 row = 0; row < numberOfTrajectories; ++row)
+    {
+    const double* samples = trajectoryNode->GetTrajectorySamples(row);
+    if (samples)
+      {
+      of.write(reinterpret_cast<const char*>(samples),
+               static_cast<std::streamsize>(records[row].NumberOfSamples *
+                                            records[row].NumberOfSampleComponents *
+                                            sizeof(double)));
+      }
+    }
+
+  bool written = of.good();
+  of.close();
+  if (!written)
+    {
+    vtkErrorMacro("WriteData: Unable to write " << tempName);
+    remove(tempName.c_str());
+    return 0;
+    }
+
+  // rename replaces the file atomically on POSIX. Windows can't rename
+  // over an existing (or mapped) file: release it, remove it and try again.
+  if (rename(tempName.c_str(), fullName.c_str()) != 0)
+    {
+    trajectoryNode->UnmapSamples();
+    remove(fullName.c_str());
+    if (rename(tempName.c_str(), fullName.c_str()) != 0)
+      {
+      vtkErrorMacro("WriteData: Unable to replace " << fullName);
+      remove(tempName.c_str());
+      return 0;
+      }
+    }
+
+  return 1;
+}
@@ -0,0 +1,76 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkMRMLPathPlannerTrajectoryStorageNode_h
+#define __vtkMRMLPathPlannerTrajectoryStorageNode_h
+
+#include "vtkSlicerPathExplorerModuleMRMLExport.h"
+#include "vtkMRMLStorageNode.h"
+
+/// \brief Binary storage of a vtkMRMLPathPlannerTrajectoryNode.
+///
+/// The .ptraj file is made of a fixed size header, one fixed stride record
+/// per trajectory, the metric columns, a string table and the optional
+/// per-trajectory sample blocks. All offsets are 8-byte aligned.
+/// The file is memory-mapped on read: records, strings and metrics are copied
+/// into the node, sample blocks are accessed in place and only loaded by the
+/// system when a trajectory's samples are requested.
+class VTK_SLICER_PATHEXPLORER_MODULE_MRML_EXPORT vtkMRMLPathPlannerTrajectoryStorageNode : public vtkMRMLStorageNode
+{
+public:
+  static vtkMRMLPathPlannerTrajectoryStorageNode *New();
+  vtkTypeMacro(vtkMRMLPathPlannerTrajectoryStorageNode, vtkMRMLStorageNode);
+
+  virtual vtkMRMLNode* CreateNodeInstance();
+
+  // Description:
+  // Get node XML tag name (like Storage, Model)
+  virtual const char* GetNodeTagName() {return "PathPlannerTrajectoryStorage";};
+
+  // Description:
+  // Return true if the node is a vtkMRMLPathPlannerTrajectoryNode
+  virtual bool CanReadInReferenceNode(vtkMRMLNode* refNode);
+
+  // Description:
+  // Return the default file extension (ptraj)
+  virtual const char* GetDefaultWriteFileExtension() {return "ptraj";};
+
+  // Description:
+  // Current version of the file format
+  enum
+    {
+    FileFormatVersion = 1
+    };
+
+protected:
+  vtkMRMLPathPlannerTrajectoryStorageNode();
+  ~vtkMRMLPathPlannerTrajectoryStorageNode();
+  vtkMRMLPathPlannerTrajectoryStorageNode(const vtkMRMLPathPlannerTrajectoryStorageNode&);
+  void operator=(const vtkMRMLPathPlannerTrajectoryStorageNode&);
+
+  virtual void InitializeSupportedWriteFileTypes();
+
+  virtual int ReadDataInternal(vtkMRMLNode *refNode);
+  virtual int WriteDataInternal(vtkMRMLNode *refNode);
+};
+
+#endif
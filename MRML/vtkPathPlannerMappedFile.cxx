@@ -0,0 +1,158 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#include "vtkPathPlannerMappedFile.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPathPlannerMappedFile);
+
+//----------------------------------------------------------------------------
+vtkPathPlannerMappedFile::vtkPathPlannerMappedFile()
+{
+  this->Data = NULL;
+  this->Size = 0;
+#ifdef _WIN32
+  this->FileHandle = NULL;
+  this->MappingHandle = NULL;
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkPathPlannerMappedFile::~vtkPathPlannerMappedFile()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void vtkPathPlannerMappedFile::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Size: " << this->Size << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkPathPlannerMappedFile::Open(const char* fileName)
+{
+  this->Close();
+
+  if (!fileName)
+    {
+    return false;
+    }
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    return false;
+    }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+    CloseHandle(file);
+    return false;
+    }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping)
+    {
+    CloseHandle(file);
+    return false;
+    }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data)
+    {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+    }
+
+  this->FileHandle = file;
+  this->MappingHandle = mapping;
+  this->Data = static_cast<const char*>(data);
+  this->Size = static_cast<size_t>(size.QuadPart);
+#else
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+
+  struct stat fileStatus;
+  if (fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+    close(fd);
+    return false;
+    }
+
+  void* data = mmap(NULL, static_cast<size_t>(fileStatus.st_size),
+                    PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED)
+    {
+    return false;
+    }
+
+  this->Data = static_cast<const char*>(data);
+  this->Size = static_cast<size_t>(fileStatus.st_size);
+#endif
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPathPlannerMappedFile::Close()
+{
+  if (!this->Data)
+    {
+    return;
+    }
+
+#ifdef _WIN32
+  UnmapViewOfFile(this->Data);
+  CloseHandle(static_cast<HANDLE>(this->MappingHandle));
+  CloseHandle(static_cast<HANDLE>(this->FileHandle));
+  this->MappingHandle = NULL;
+  this->FileHandle = NULL;
+#else
+  munmap(const_cast<char*>(this->Data), this->Size);
+#endif
+
+  this->Data = NULL;
+  this->Size = 0;
+}
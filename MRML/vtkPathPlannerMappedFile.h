@@ -0,0 +1,72 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathPlannerMappedFile_h
+#define __vtkPathPlannerMappedFile_h
+
+#include "vtkSlicerPathExplorerModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+/// \brief Read-only memory mapping of a file.
+///
+/// Pages are only loaded by the system when they are accessed, so large
+/// trajectory plans can be opened without reading the sample blocks of
+/// the paths that are never displayed.
+/// The mapping is reference counted: nodes pointing into the mapped data
+/// keep it alive after the storage node that opened it is gone.
+class VTK_SLICER_PATHEXPLORER_MODULE_MRML_EXPORT vtkPathPlannerMappedFile : public vtkObject
+{
+public:
+  static vtkPathPlannerMappedFile *New();
+  vtkTypeMacro(vtkPathPlannerMappedFile, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Map the whole file. Return false if the file can't be opened or is empty.
+  bool Open(const char* fileName);
+  void Close();
+
+  // Description:
+  // Mapped data, NULL if no file is mapped.
+  const char* GetData() { return this->Data; }
+  size_t GetSize() { return this->Size; }
+
+protected:
+  vtkPathPlannerMappedFile();
+  ~vtkPathPlannerMappedFile();
+
+  const char* Data;
+  size_t      Size;
+
+#ifdef _WIN32
+  void* FileHandle;
+  void* MappingHandle;
+#endif
+
+private:
+  vtkPathPlannerMappedFile(const vtkPathPlannerMappedFile&); // Not implemented
+  void operator=(const vtkPathPlannerMappedFile&);           // Not implemented
+};
+
+#endif
@@ -0,0 +1,484 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerFiducialTableModel.h"
+#include "qSlicerPathExplorerTrajectoryTableModel.h"
+
+// PathExplorer MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// MRML includes
+#include <vtkMRMLAnnotationFiducialNode.h>
+
+// Qt includes
+#include <QBrush>
+#include <QColor>
+#include <QCoreApplication>
+#include <QModelIndex>
+#include <QSignalSpy>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Structural signals of a model
+struct ModelSpy
+{
+  ModelSpy(QAbstractItemModel* model)
+    : Inserted(model, SIGNAL(rowsInserted(QModelIndex,int,int)))
+    , Removed(model, SIGNAL(rowsRemoved(QModelIndex,int,int)))
+    , Reset(model, SIGNAL(modelReset()))
+    , Changed(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)))
+  {}
+  void Clear()
+  {
+    this->Inserted.clear();
+    this->Removed.clear();
+    this->Reset.clear();
+    this->Changed.clear();
+  }
+  QSignalSpy Inserted;
+  QSignalSpy Removed;
+  QSignalSpy Reset;
+  QSignalSpy Changed;
+};
+
+//----------------------------------------------------------------------------
+// A single rowsInserted or rowsRemoved signal for the given rows
+bool SameRows(const QSignalSpy& spy, int first, int last)
+{
+  return spy.count() == 1 &&
+    !spy.at(0).at(0).value<QModelIndex>().isValid() &&
+    spy.at(0).at(1).toInt() == first && spy.at(0).at(2).toInt() == last;
+}
+
+//----------------------------------------------------------------------------
+// A single dataChanged signal covering all the columns of the given rows
+bool SameChange(const QSignalSpy& spy, int firstRow, int lastRow, int columnCount)
+{
+  if (spy.count() != 1)
+    {
+    return false;
+    }
+  QModelIndex topLeft = spy.at(0).at(0).value<QModelIndex>();
+  QModelIndex bottomRight = spy.at(0).at(1).value<QModelIndex>();
+  return topLeft.row() == firstRow && topLeft.column() == 0 &&
+    bottomRight.row() == lastRow && bottomRight.column() == columnCount - 1;
+}
+
+//----------------------------------------------------------------------------
+// Consistency of a flat table model, in the manner of QAbstractItemModelTester.
+// Return the line of the first inconsistency, 0 if none.
+int CheckModel(QAbstractItemModel* model)
+{
+  int rowCount = model->rowCount();
+  int columnCount = model->columnCount();
+  if (rowCount < 0 || columnCount < 0 ||
+      model->hasChildren() != (rowCount > 0 && columnCount > 0))
+    {
+    return __LINE__;
+    }
+
+  // Nothing outside the table
+  if (model->index(-1, 0).isValid() || model->index(0, -1).isValid() ||
+      model->index(rowCount, 0).isValid() || model->index(0, columnCount).isValid() ||
+      model->data(QModelIndex()).isValid() ||
+      model->flags(QModelIndex()) != Qt::NoItemFlags)
+    {
+    return __LINE__;
+    }
+
+  for (int column = 0; column < columnCount; ++column)
+    {
+    if (model->headerData(column, Qt::Horizontal).toString().isEmpty())
+      {
+      return __LINE__;
+      }
+    }
+  for (int row = 0; row < rowCount; ++row)
+    {
+    if (model->headerData(row, Qt::Vertical).toInt() != row + 1)
+      {
+      return __LINE__;
+      }
+    for (int column = 0; column < columnCount; ++column)
+      {
+      // Cells have no children, and are displayed as they are edited
+      QModelIndex index = model->index(row, column);
+      if (!index.isValid() || index.row() != row || index.column() != column ||
+          index.model() != model || index.parent().isValid() ||
+          model->rowCount(index) != 0 || model->columnCount(index) != 0 ||
+          model->hasChildren(index) ||
+          !(model->flags(index) & Qt::ItemIsEnabled) ||
+          model->data(index, Qt::DisplayRole) != model->data(index, Qt::EditRole))
+        {
+        return __LINE__;
+        }
+      }
+    }
+  return 0;
+}
+}
+
+//----------------------------------------------------------------------------
+int qSlicerPathExplorerTableModelTest1(int argc, char * argv [] )
+{
+  QCoreApplication app(argc, argv);
+  qRegisterMetaType<QModelIndex>("QModelIndex");
+
+  //--------------------------------------------------------------------------
+  // Trajectory table
+  //--------------------------------------------------------------------------
+  typedef qSlicerPathExplorerTrajectoryTableModel TrajectoryModel;
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  double entry[3] = { 0.0, 0.0, 0.0 };
+  double target[3] = { 0.0, 0.0, 10.0 };
+  trajectoryList->AddTrajectory(entry, target, "Trajectory 0");
+  trajectoryList->AddTrajectory(entry, target, "Trajectory 1");
+  trajectoryList->AddTrajectory(entry, target, "Trajectory 2",
+                                0, 0, vtkMRMLPathPlannerTrajectoryNode::EntryVisible);
+
+  TrajectoryModel trajectoryModel;
+  ModelSpy trajectorySpy(&trajectoryModel);
+  trajectoryModel.setTrajectoryListNode(trajectoryList.GetPointer());
+  int line = CheckModel(&trajectoryModel);
+  if (line || trajectorySpy.Reset.count() != 1 ||
+      trajectoryModel.trajectoryListNode() != trajectoryList.GetPointer() ||
+      trajectoryModel.rowCount() != 3 ||
+      trajectoryModel.columnCount() != TrajectoryModel::NumberOfColumns)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Trajectory table doesn't match the list, "
+              << trajectoryModel.rowCount() << " rows" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Cells are read from the list. Entry and target are not fiducials of a
+  // scene: their names are empty.
+  if (trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::NameColumn)).toString() !=
+        "Trajectory 1" ||
+      !trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::EntryColumn)).toString().isEmpty() ||
+      !trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::TargetColumn)).toString().isEmpty() ||
+      trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::DisplayColumn),
+                           Qt::CheckStateRole).toInt() != Qt::Checked ||
+      trajectoryModel.data(trajectoryModel.index(2, TrajectoryModel::DisplayColumn),
+                           Qt::CheckStateRole).toInt() != Qt::Unchecked ||
+      trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::NameColumn),
+                           Qt::CheckStateRole).isValid())
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong trajectory cells" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (trajectoryModel.headerData(TrajectoryModel::NameColumn, Qt::Horizontal).toString() != "Name" ||
+      trajectoryModel.headerData(TrajectoryModel::DisplayColumn, Qt::Horizontal).toString() != "Display" ||
+      trajectoryModel.headerData(TrajectoryModel::NameColumn, Qt::Horizontal,
+                                 Qt::ToolTipRole).isValid() ||
+      trajectoryModel.headerData(TrajectoryModel::NumberOfColumns, Qt::Horizontal).isValid())
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong trajectory headers" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Only the name is editable and only the display is checkable
+  if (!(trajectoryModel.flags(trajectoryModel.index(0, TrajectoryModel::NameColumn)) &
+        Qt::ItemIsEditable) ||
+      (trajectoryModel.flags(trajectoryModel.index(0, TrajectoryModel::EntryColumn)) &
+       Qt::ItemIsEditable) ||
+      !(trajectoryModel.flags(trajectoryModel.index(0, TrajectoryModel::DisplayColumn)) &
+        Qt::ItemIsUserCheckable) ||
+      (trajectoryModel.flags(trajectoryModel.index(0, TrajectoryModel::DisplayColumn)) &
+       Qt::ItemIsEditable))
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong trajectory flags" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Rows follow the trajectories added and removed one by one
+  trajectorySpy.Clear();
+  trajectoryList->AddTrajectory(entry, target, "Trajectory 3");
+  line = CheckModel(&trajectoryModel);
+  if (line || !SameRows(trajectorySpy.Inserted, 3, 3) || trajectorySpy.Reset.count() != 0 ||
+      trajectoryModel.rowCount() != 4 ||
+      trajectoryModel.data(trajectoryModel.index(3, TrajectoryModel::NameColumn)).toString() !=
+        "Trajectory 3")
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Trajectory added, "
+              << trajectorySpy.Inserted.count() << " rowsInserted" << std::endl;
+    return EXIT_FAILURE;
+    }
+  trajectorySpy.Clear();
+  trajectoryList->RemoveTrajectory(1);
+  line = CheckModel(&trajectoryModel);
+  if (line || !SameRows(trajectorySpy.Removed, 1, 1) || trajectorySpy.Reset.count() != 0 ||
+      trajectoryModel.rowCount() != 3 ||
+      trajectoryModel.data(trajectoryModel.index(1, TrajectoryModel::NameColumn)).toString() !=
+        "Trajectory 2")
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Trajectory removed, "
+              << trajectorySpy.Removed.count() << " rowsRemoved" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A metric added to the list is a new column, empty until it is computed
+  trajectorySpy.Clear();
+  int clearance = trajectoryList->AddMetric("Clearance");
+  int clearanceColumn = TrajectoryModel::NumberOfColumns + clearance;
+  line = CheckModel(&trajectoryModel);
+  if (line || trajectorySpy.Reset.count() != 1 ||
+      trajectoryModel.columnCount() != TrajectoryModel::NumberOfColumns + 1 ||
+      trajectoryModel.headerData(clearanceColumn, Qt::Horizontal).toString() != "Clearance" ||
+      !trajectoryModel.data(trajectoryModel.index(0, clearanceColumn)).toString().isEmpty() ||
+      trajectoryModel.data(trajectoryModel.index(0, clearanceColumn), Qt::TextAlignmentRole).toInt() !=
+        static_cast<int>(Qt::AlignRight | Qt::AlignVCenter) ||
+      (trajectoryModel.flags(trajectoryModel.index(0, clearanceColumn)) &
+       (Qt::ItemIsEditable | Qt::ItemIsUserCheckable)))
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Wrong metric column" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without scheduler, a modified trajectory updates its row right away
+  trajectorySpy.Clear();
+  trajectoryList->SetMetricValue(2, clearance, 1.5);
+  if (!SameChange(trajectorySpy.Changed, 2, 2, trajectoryModel.columnCount()) ||
+      trajectoryModel.data(trajectoryModel.index(2, clearanceColumn)).toString() != "1.50")
+    {
+    std::cerr << "Line " << __LINE__ << ": Metric value modified, "
+              << trajectorySpy.Changed.count() << " dataChanged" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Renaming through the model renames the trajectory and reports the old name
+  QSignalSpy renamedSpy(&trajectoryModel, SIGNAL(trajectoryRenamed(int,QString)));
+  trajectorySpy.Clear();
+  QModelIndex nameIndex = trajectoryModel.index(0, TrajectoryModel::NameColumn);
+  if (!trajectoryModel.setData(nameIndex, QString("Renamed")) ||
+      QString(trajectoryList->GetTrajectoryName(0)) != "Renamed" ||
+      renamedSpy.count() != 1 || renamedSpy.at(0).at(0).toInt() != 0 ||
+      renamedSpy.at(0).at(1).toString() != "Trajectory 0" ||
+      !SameChange(trajectorySpy.Changed, 0, 0, trajectoryModel.columnCount()))
+    {
+    std::cerr << "Line " << __LINE__ << ": Trajectory not renamed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (trajectoryModel.setData(nameIndex, QString("Renamed")) ||
+      trajectoryModel.setData(trajectoryModel.index(0, TrajectoryModel::EntryColumn), QString("Entry")) ||
+      trajectoryModel.setData(trajectoryModel.index(0, clearanceColumn), 2.0) ||
+      renamedSpy.count() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Cell modified without change" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Display check box is the PathVisible flag
+  QModelIndex displayIndex = trajectoryModel.index(0, TrajectoryModel::DisplayColumn);
+  if (!trajectoryModel.setData(displayIndex, Qt::Unchecked, Qt::CheckStateRole) ||
+      trajectoryList->GetTrajectoryFlag(0, vtkMRMLPathPlannerTrajectoryNode::PathVisible) ||
+      trajectoryModel.data(displayIndex, Qt::CheckStateRole).toInt() != Qt::Unchecked ||
+      !trajectoryList->GetTrajectoryFlag(0, vtkMRMLPathPlannerTrajectoryNode::EntryVisible))
+    {
+    std::cerr << "Line " << __LINE__ << ": Trajectory still displayed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Batch removal can't be followed row by row: the table is reset
+  trajectorySpy.Clear();
+  std::vector<int> rows;
+  rows.push_back(0);
+  rows.push_back(2);
+  trajectoryList->RemoveTrajectories(rows);
+  line = CheckModel(&trajectoryModel);
+  if (line || trajectorySpy.Reset.count() != 1 || trajectorySpy.Removed.count() != 0 ||
+      trajectoryModel.rowCount() != 1 ||
+      trajectoryModel.data(trajectoryModel.index(0, TrajectoryModel::NameColumn)).toString() !=
+        "Trajectory 2")
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Trajectories removed, "
+              << trajectoryModel.rowCount() << " rows" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without list, the table is empty and doesn't follow the old list
+  trajectoryModel.setTrajectoryListNode(0);
+  trajectorySpy.Clear();
+  trajectoryList->AddTrajectory(entry, target, "Trajectory 4");
+  line = CheckModel(&trajectoryModel);
+  if (line || trajectoryModel.rowCount() != 0 || trajectoryModel.columnCount() !=
+        TrajectoryModel::NumberOfColumns ||
+      trajectorySpy.Inserted.count() != 0 || trajectorySpy.Reset.count() != 0)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Table still follows the list" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //--------------------------------------------------------------------------
+  // Fiducial table
+  //--------------------------------------------------------------------------
+  typedef qSlicerPathExplorerFiducialTableModel FiducialModel;
+
+  std::vector<vtkMRMLAnnotationFiducialNode*> fiducials;
+  for (int i = 0; i < 3; ++i)
+    {
+    vtkMRMLAnnotationFiducialNode* fiducial = vtkMRMLAnnotationFiducialNode::New();
+    double position[4] = { i + 0.5, -i * 2.0, 10.0, 1.0 };
+    fiducial->SetFiducialWorldCoordinates(position);
+    fiducial->SetName(QString("F-%1").arg(i).toStdString().c_str());
+    fiducials.push_back(fiducial);
+    }
+
+  FiducialModel fiducialModel;
+  ModelSpy fiducialSpy(&fiducialModel);
+  for (int i = 0; i < 3; ++i)
+    {
+    fiducialSpy.Clear();
+    if (fiducialModel.addFiducial(fiducials[i]) != i || !SameRows(fiducialSpy.Inserted, i, i))
+      {
+      std::cerr << "Line " << __LINE__ << ": Fiducial " << i << " not added" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A fiducial is listed once
+  fiducialSpy.Clear();
+  line = CheckModel(&fiducialModel);
+  if (line || fiducialModel.addFiducial(fiducials[1]) != 1 || fiducialModel.addFiducial(0) != -1 ||
+      fiducialSpy.Inserted.count() != 0 || fiducialModel.rowCount() != 3 ||
+      fiducialModel.columnCount() != FiducialModel::NumberOfColumns ||
+      fiducialModel.rowOf(fiducials[2]) != 2 || fiducialModel.fiducialNode(2) != fiducials[2] ||
+      fiducialModel.fiducialNode(3) != 0 || fiducialModel.fiducials().size() != 3)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Fiducial table doesn't match the fiducials, "
+              << fiducialModel.rowCount() << " rows" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Name and coordinates are read from the fiducial, and editable
+  if (fiducialModel.data(fiducialModel.index(1, FiducialModel::NameColumn)).toString() != "F-1" ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::RColumn)).toString() != "1.50" ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::AColumn)).toString() != "-2.00" ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::SColumn)).toString() != "10.00" ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::TimeColumn)).toString().isEmpty() ||
+      fiducialModel.headerData(FiducialModel::RColumn, Qt::Horizontal).toString() != "R" ||
+      fiducialModel.headerData(FiducialModel::NumberOfColumns, Qt::Horizontal).isValid() ||
+      !(fiducialModel.flags(fiducialModel.index(1, FiducialModel::SColumn)) & Qt::ItemIsEditable) ||
+      (fiducialModel.flags(fiducialModel.index(1, FiducialModel::TimeColumn)) & Qt::ItemIsEditable))
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong fiducial cells" << std::endl;
+    return EXIT_FAILURE;
+    }
+  double position[4] = { 0.0, 0.0, 0.0, 1.0 };
+  if (!fiducialModel.setData(fiducialModel.index(1, FiducialModel::AColumn), QString("7.25")))
+    {
+    std::cerr << "Line " << __LINE__ << ": Coordinate not edited" << std::endl;
+    return EXIT_FAILURE;
+    }
+  fiducials[1]->GetFiducialWorldCoordinates(position);
+  if (position[0] != 1.5 || position[1] != 7.25 || position[2] != 10.0 ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::AColumn)).toString() != "7.25")
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong coordinates " << position[0] << ", "
+              << position[1] << ", " << position[2] << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (fiducialModel.setData(fiducialModel.index(1, FiducialModel::RColumn), QString("abc")) ||
+      fiducialModel.setData(fiducialModel.index(1, FiducialModel::NameColumn), QString()) ||
+      fiducialModel.setData(fiducialModel.index(1, FiducialModel::TimeColumn), QString("12:00")))
+    {
+    std::cerr << "Line " << __LINE__ << ": Invalid value accepted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without scheduler, a modified fiducial updates its row right away
+  fiducialSpy.Clear();
+  if (!fiducialModel.setData(fiducialModel.index(2, FiducialModel::NameColumn), QString("Target")) ||
+      QString(fiducials[2]->GetName()) != "Target" ||
+      !SameChange(fiducialSpy.Changed, 2, 2, FiducialModel::NumberOfColumns))
+    {
+    std::cerr << "Line " << __LINE__ << ": Fiducial not renamed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Background of all the cells
+  fiducialSpy.Clear();
+  fiducialModel.setBackgroundColor(QColor(Qt::yellow));
+  if (!SameChange(fiducialSpy.Changed, 0, 2, FiducialModel::NumberOfColumns) ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::TimeColumn),
+                         Qt::BackgroundRole).value<QBrush>().color() != QColor(Qt::yellow))
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong background" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The row of a deleted fiducial is removed, following rows move up
+  fiducialSpy.Clear();
+  vtkMRMLAnnotationFiducialNode* deletedFiducial = fiducials[0];
+  fiducials.erase(fiducials.begin());
+  deletedFiducial->Delete();
+  line = CheckModel(&fiducialModel);
+  if (line || !SameRows(fiducialSpy.Removed, 0, 0) || fiducialModel.rowCount() != 2 ||
+      fiducialModel.rowOf(fiducials[0]) != 0 || fiducialModel.rowOf(fiducials[1]) != 1 ||
+      fiducialModel.data(fiducialModel.index(1, FiducialModel::NameColumn)).toString() != "Target")
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Deleted fiducial still listed, "
+              << fiducialModel.rowCount() << " rows" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A fiducial no longer listed is not observed
+  fiducialSpy.Clear();
+  fiducialModel.removeFiducial(fiducials[0]);
+  fiducialModel.removeFiducial(5);
+  fiducials[0]->SetName("F-1 renamed");
+  line = CheckModel(&fiducialModel);
+  if (line || !SameRows(fiducialSpy.Removed, 0, 0) || fiducialSpy.Changed.count() != 0 ||
+      fiducialModel.rowCount() != 1 || fiducialModel.rowOf(fiducials[0]) != -1 ||
+      fiducialModel.rowOf(fiducials[1]) != 0)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Fiducial not removed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  fiducialSpy.Clear();
+  fiducialModel.clear();
+  fiducials[1]->SetName("Target renamed");
+  line = CheckModel(&fiducialModel);
+  if (line || fiducialSpy.Reset.count() != 1 || fiducialSpy.Changed.count() != 0 ||
+      fiducialModel.rowCount() != 0 || !fiducialModel.fiducials().isEmpty())
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Fiducial table not cleared" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for (size_t i = 0; i < fiducials.size(); ++i)
+    {
+    fiducials[i]->Delete();
+    }
+  return EXIT_SUCCESS;
+}
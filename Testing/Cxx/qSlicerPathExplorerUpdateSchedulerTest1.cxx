@@ -0,0 +1,251 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerFiducialTableModel.h"
+#include "qSlicerPathExplorerTrajectoryTableModel.h"
+#include "qSlicerPathExplorerUpdateScheduler.h"
+
+// PathExplorer MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// MRML includes
+#include <vtkMRMLAnnotationFiducialNode.h>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QModelIndex>
+#include <QSignalSpy>
+#include <QTime>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const int NumberOfTrajectories = 6;
+
+//----------------------------------------------------------------------------
+// A single dataChanged signal covering all the columns of the given rows
+bool SameChange(const QSignalSpy& spy, int firstRow, int lastRow, int columnCount)
+{
+  if (spy.count() != 1)
+    {
+    return false;
+    }
+  QModelIndex topLeft = spy.at(0).at(0).value<QModelIndex>();
+  QModelIndex bottomRight = spy.at(0).at(1).value<QModelIndex>();
+  return topLeft.row() == firstRow && topLeft.column() == 0 &&
+    bottomRight.row() == lastRow && bottomRight.column() == columnCount - 1;
+}
+
+//----------------------------------------------------------------------------
+// Process events until the scheduler flushed, at most one second
+void WaitForFlush(qSlicerPathExplorerUpdateScheduler* scheduler)
+{
+  QTime time;
+  time.start();
+  while (scheduler->hasPendingUpdates() && time.elapsed() < 1000)
+    {
+    QCoreApplication::processEvents();
+    }
+}
+}
+
+//----------------------------------------------------------------------------
+int qSlicerPathExplorerUpdateSchedulerTest1(int argc, char * argv [] )
+{
+  QCoreApplication app(argc, argv);
+  qRegisterMetaType<QModelIndex>("QModelIndex");
+
+  qSlicerPathExplorerUpdateScheduler scheduler;
+  if (scheduler.interval() != 16 || scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong default interval " << scheduler.interval() << std::endl;
+    return EXIT_FAILURE;
+    }
+  scheduler.setInterval(-5);
+  if (scheduler.interval() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Negative interval " << scheduler.interval() << std::endl;
+    return EXIT_FAILURE;
+    }
+  scheduler.scheduleUpdate(0);
+  if (scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": Update scheduled without object" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  int clearance = trajectoryList->AddMetric("Clearance");
+  double entry[3] = { 0.0, 0.0, 0.0 };
+  double target[3] = { 0.0, 0.0, 10.0 };
+  for (int i = 0; i < NumberOfTrajectories; ++i)
+    {
+    trajectoryList->AddTrajectory(entry, target);
+    }
+
+  qSlicerPathExplorerTrajectoryTableModel trajectoryModel;
+  trajectoryModel.setTrajectoryListNode(trajectoryList.GetPointer());
+  trajectoryModel.setUpdateScheduler(&scheduler);
+  int columnCount = trajectoryModel.columnCount();
+  QSignalSpy changedSpy(&trajectoryModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+
+  // An event storm on a few rows costs a single update, at the flush, of
+  // the range of rows modified
+  for (int i = 0; i < 100; ++i)
+    {
+    trajectoryList->SetMetricValue(1, clearance, i);
+    trajectoryList->SetMetricValue(3, clearance, -i);
+    }
+  if (changedSpy.count() != 0 || !scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": " << changedSpy.count()
+              << " dataChanged before the flush" << std::endl;
+    return EXIT_FAILURE;
+    }
+  scheduler.flush();
+  if (!SameChange(changedSpy, 1, 3, columnCount) || scheduler.hasPendingUpdates() ||
+      trajectoryModel.data(trajectoryModel.index(3, columnCount - 1)).toString() != "-99.00")
+    {
+    std::cerr << "Line " << __LINE__ << ": " << changedSpy.count()
+              << " dataChanged at the flush instead of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  changedSpy.clear();
+  scheduler.flush();
+  if (changedSpy.count() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Rows updated twice" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Pending updates of rows that moved up are flushed at their new rows
+  trajectoryList->SetMetricValue(4, clearance, 1.0);
+  trajectoryList->RemoveTrajectory(2);
+  scheduler.flush();
+  if (!SameChange(changedSpy, 2, NumberOfTrajectories - 2, columnCount))
+    {
+    std::cerr << "Line " << __LINE__ << ": Moved rows not updated" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A reset drops the pending updates of the old rows
+  changedSpy.clear();
+  trajectoryList->SetMetricValue(0, clearance, 2.0);
+  std::vector<int> rows;
+  rows.push_back(0);
+  rows.push_back(1);
+  trajectoryList->RemoveTrajectories(rows);
+  scheduler.flush();
+  if (changedSpy.count() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Rows of the reset table updated" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Several models share the scheduler and are flushed together
+  vtkSmartPointer<vtkMRMLAnnotationFiducialNode> fiducial =
+    vtkSmartPointer<vtkMRMLAnnotationFiducialNode>::New();
+  qSlicerPathExplorerFiducialTableModel fiducialModel;
+  fiducialModel.addFiducial(fiducial);
+  fiducialModel.setUpdateScheduler(&scheduler);
+  QSignalSpy fiducialChangedSpy(&fiducialModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+  for (int i = 0; i < 20; ++i)
+    {
+    fiducial->SetName(QString("F-%1").arg(i).toStdString().c_str());
+    trajectoryList->SetMetricValue(0, clearance, i);
+    }
+  if (fiducialChangedSpy.count() != 0 || changedSpy.count() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Models updated before the flush" << std::endl;
+    return EXIT_FAILURE;
+    }
+  scheduler.flush();
+  if (!SameChange(fiducialChangedSpy, 0, 0, qSlicerPathExplorerFiducialTableModel::NumberOfColumns) ||
+      !SameChange(changedSpy, 0, 0, columnCount))
+    {
+    std::cerr << "Line " << __LINE__ << ": " << fiducialChangedSpy.count() << " and "
+              << changedSpy.count() << " dataChanged at the flush instead of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A model destroyed before the flush is skipped
+  changedSpy.clear();
+  qSlicerPathExplorerTrajectoryTableModel* deletedModel = new qSlicerPathExplorerTrajectoryTableModel;
+  deletedModel->setTrajectoryListNode(trajectoryList.GetPointer());
+  deletedModel->setUpdateScheduler(&scheduler);
+  trajectoryList->SetMetricValue(1, clearance, 3.0);
+  delete deletedModel;
+  scheduler.flush();
+  if (!SameChange(changedSpy, 1, 1, columnCount) || scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": Flush failed after a model was destroyed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The event loop flushes on its own, at most once per interval
+  changedSpy.clear();
+  trajectoryList->SetMetricValue(0, clearance, 4.0);
+  WaitForFlush(&scheduler);
+  if (!SameChange(changedSpy, 0, 0, columnCount) || scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": Event loop didn't flush" << std::endl;
+    return EXIT_FAILURE;
+    }
+  changedSpy.clear();
+  scheduler.setInterval(60000);
+  scheduler.flush();
+  trajectoryList->SetMetricValue(0, clearance, 5.0);
+  QCoreApplication::processEvents();
+  if (changedSpy.count() != 0 || !scheduler.hasPendingUpdates())
+    {
+    std::cerr << "Line " << __LINE__ << ": Flushed before the end of the interval" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without scheduler, pending updates are flushed and the next ones are
+  // immediate
+  trajectoryModel.setUpdateScheduler(0);
+  if (!SameChange(changedSpy, 0, 0, columnCount))
+    {
+    std::cerr << "Line " << __LINE__ << ": Pending updates lost" << std::endl;
+    return EXIT_FAILURE;
+    }
+  changedSpy.clear();
+  trajectoryList->SetMetricValue(1, clearance, 6.0);
+  trajectoryList->SetMetricValue(2, clearance, 6.0);
+  if (changedSpy.count() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << changedSpy.count()
+              << " dataChanged instead of 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,383 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Gives access to the ruler index
+class vtkPathExplorerIndexTestNode : public vtkMRMLPathPlannerTrajectoryNode
+{
+public:
+  static vtkPathExplorerIndexTestNode* New();
+  vtkTypeMacro(vtkPathExplorerIndexTestNode, vtkMRMLPathPlannerTrajectoryNode);
+  int GetRulerRow(const char* rulerID)
+    {
+    return this->GetRulerTrajectoryRow(rulerID);
+    }
+};
+vtkStandardNewMacro(vtkPathExplorerIndexTestNode);
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+
+const int NumberOfFiducials = 8;
+const int NumberOfInitialTrajectories = 30;
+const int NumberOfOperations = 400;
+
+//----------------------------------------------------------------------------
+// Expected content of a row
+struct Trajectory
+{
+  int UID;
+  std::string EntryNodeID;
+  std::string TargetNodeID;
+  std::string RulerNodeID;
+};
+
+//----------------------------------------------------------------------------
+void CountEvent(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event),
+                void* clientData, void* vtkNotUsed(callData))
+{
+  ++*reinterpret_cast<int*>(clientData);
+}
+
+//----------------------------------------------------------------------------
+std::string FiducialID(int fiducial)
+{
+  std::stringstream id;
+  id << "vtkMRMLAnnotationFiducialNode" << fiducial;
+  return id.str();
+}
+
+//----------------------------------------------------------------------------
+// Fiducial of a new trajectory, sometimes none
+std::string RandomFiducialID(unsigned int& seed)
+{
+  int fiducial = static_cast<int>(Random(seed) * (NumberOfFiducials + 1));
+  return fiducial < NumberOfFiducials ? FiducialID(fiducial) : std::string();
+}
+
+//----------------------------------------------------------------------------
+// Initial trajectories, read with their rulers: rulers are only created in
+// a scene
+void ReadTrajectories(vtkMRMLPathPlannerTrajectoryNode* node,
+                      std::vector<Trajectory>& trajectories, unsigned int& seed)
+{
+  std::stringstream uids;
+  std::stringstream names;
+  std::stringstream entryNodeIDs;
+  std::stringstream targetNodeIDs;
+  std::stringstream rulerNodeIDs;
+  for (int i = 0; i < NumberOfInitialTrajectories; ++i)
+    {
+    Trajectory trajectory;
+    trajectory.UID = 2 * i;
+    trajectory.EntryNodeID = RandomFiducialID(seed);
+    trajectory.TargetNodeID = RandomFiducialID(seed);
+    std::stringstream rulerNodeID;
+    rulerNodeID << "vtkMRMLAnnotationRulerNode" << i;
+    trajectory.RulerNodeID = i % 4 ? rulerNodeID.str() : std::string();
+    trajectories.push_back(trajectory);
+
+    const char* separator = i ? " " : "";
+    uids << separator << trajectory.UID;
+    names << separator << "T" << i;
+    entryNodeIDs << separator << (trajectory.EntryNodeID.empty() ? "-" : trajectory.EntryNodeID);
+    targetNodeIDs << separator << (trajectory.TargetNodeID.empty() ? "-" : trajectory.TargetNodeID);
+    rulerNodeIDs << separator << (trajectory.RulerNodeID.empty() ? "-" : trajectory.RulerNodeID);
+    }
+  std::vector<std::string> values;
+  values.push_back(uids.str());
+  values.push_back(names.str());
+  values.push_back(entryNodeIDs.str());
+  values.push_back(targetNodeIDs.str());
+  values.push_back(rulerNodeIDs.str());
+  const char* atts[] = {
+    "trajectoryUIDs", values[0].c_str(),
+    "trajectoryNames", values[1].c_str(),
+    "entryNodeIDs", values[2].c_str(),
+    "targetNodeIDs", values[3].c_str(),
+    "rulerNodeIDs", values[4].c_str(),
+    NULL };
+  node->ReadXMLAttributes(atts);
+}
+
+//----------------------------------------------------------------------------
+// Return the line of the first index entry that doesn't match the rows,
+// 0 if none. Every lookup is compared to a scan of the rows.
+int CheckIndex(vtkPathExplorerIndexTestNode* node,
+               const std::vector<Trajectory>& trajectories, int maximumUID)
+{
+  int numberOfTrajectories = static_cast<int>(trajectories.size());
+  if (node->GetNumberOfTrajectories() != numberOfTrajectories)
+    {
+    return __LINE__;
+    }
+
+  // UIDs and rulers
+  std::vector<int> uidRows(maximumUID + 1, -1);
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    const Trajectory& trajectory = trajectories[row];
+    uidRows[trajectory.UID] = row;
+    if (node->GetTrajectoryUID(row) != trajectory.UID ||
+        trajectory.EntryNodeID != node->GetEntryNodeID(row) ||
+        trajectory.TargetNodeID != node->GetTargetNodeID(row) ||
+        trajectory.RulerNodeID != node->GetRulerNodeID(row))
+      {
+      return __LINE__;
+      }
+    }
+  for (int uid = 0; uid <= maximumUID; ++uid)
+    {
+    if (node->GetTrajectoryRow(uid) != uidRows[uid])
+      {
+      return __LINE__;
+      }
+    }
+  for (int i = 0; i < NumberOfInitialTrajectories; ++i)
+    {
+    std::stringstream rulerNodeID;
+    rulerNodeID << "vtkMRMLAnnotationRulerNode" << i;
+    int expectedRow = -1;
+    for (int row = 0; row < numberOfTrajectories; ++row)
+      {
+      if (trajectories[row].RulerNodeID == rulerNodeID.str())
+        {
+        expectedRow = row;
+        }
+      }
+    if (node->GetRulerRow(rulerNodeID.str().c_str()) != expectedRow)
+      {
+      return __LINE__;
+      }
+    }
+
+  // Fiducials, and pairs of fiducials
+  for (int fiducial = 0; fiducial <= NumberOfFiducials; ++fiducial)
+    {
+    std::string id = FiducialID(fiducial);
+    std::vector<int> expectedRows;
+    for (int row = 0; row < numberOfTrajectories; ++row)
+      {
+      if (trajectories[row].EntryNodeID == id || trajectories[row].TargetNodeID == id)
+        {
+        expectedRows.push_back(row);
+        }
+      }
+    std::vector<int> rows;
+    node->GetTrajectoriesUsingFiducial(id.c_str(), rows);
+    if (rows != expectedRows)
+      {
+      return __LINE__;
+      }
+
+    for (int target = 0; target <= NumberOfFiducials; ++target)
+      {
+      std::string targetID = FiducialID(target);
+      int expectedRow = -1;
+      for (int row = numberOfTrajectories - 1; row >= 0; --row)
+        {
+        if (trajectories[row].EntryNodeID == id && trajectories[row].TargetNodeID == targetID)
+          {
+          expectedRow = row;
+          }
+        }
+      if (node->FindTrajectory(id.c_str(), targetID.c_str()) != expectedRow)
+        {
+        return __LINE__;
+        }
+      }
+    }
+  return 0;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryIndexTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // The index is rebuilt on read
+  vtkNew<vtkPathExplorerIndexTestNode> node;
+  std::vector<Trajectory> trajectories;
+  unsigned int seed = 1;
+  ReadTrajectories(node.GetPointer(), trajectories, seed);
+  int maximumUID = 2 * (NumberOfInitialTrajectories - 1);
+  int line = CheckIndex(node.GetPointer(), trajectories, maximumUID);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Index doesn't match the trajectories read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // and kept up to date by every modification
+  const double entry[3] = { 0.0, 0.0, 0.0 };
+  const double target[3] = { 10.0, 0.0, 0.0 };
+  for (int operation = 0; operation < NumberOfOperations; ++operation)
+    {
+    double choice = Random(seed);
+    int numberOfTrajectories = static_cast<int>(trajectories.size());
+    int row = static_cast<int>(Random(seed) * numberOfTrajectories);
+    if (choice < 0.4 || numberOfTrajectories == 0)
+      {
+      Trajectory trajectory;
+      trajectory.EntryNodeID = RandomFiducialID(seed);
+      trajectory.TargetNodeID = RandomFiducialID(seed);
+      row = node->AddTrajectory(entry, target, "",
+                                trajectory.EntryNodeID.c_str(), trajectory.TargetNodeID.c_str());
+      trajectory.UID = node->GetTrajectoryUID(row);
+      if (trajectory.UID <= maximumUID)
+        {
+        std::cerr << "Line " << __LINE__ << ": UID " << trajectory.UID << " reused" << std::endl;
+        return EXIT_FAILURE;
+        }
+      maximumUID = trajectory.UID;
+      trajectories.push_back(trajectory);
+      }
+    else if (choice < 0.6)
+      {
+      node->RemoveTrajectory(row);
+      trajectories.erase(trajectories.begin() + row);
+      }
+    else if (choice < 0.75)
+      {
+      trajectories[row].EntryNodeID = RandomFiducialID(seed);
+      node->SetEntryNodeID(row, trajectories[row].EntryNodeID.c_str());
+      }
+    else if (choice < 0.9)
+      {
+      trajectories[row].TargetNodeID = RandomFiducialID(seed);
+      node->SetTargetNodeID(row, trajectories[row].TargetNodeID.c_str());
+      }
+    else
+      {
+      // A few rows, in any order
+      std::vector<int> rows;
+      std::vector<bool> removed(numberOfTrajectories, false);
+      for (int i = 0; i < 3; ++i)
+        {
+        int removedRow = static_cast<int>(Random(seed) * numberOfTrajectories);
+        rows.push_back(removedRow);
+        removed[removedRow] = true;
+        }
+      node->RemoveTrajectories(rows);
+      for (int i = numberOfTrajectories - 1; i >= 0; --i)
+        {
+        if (removed[i])
+          {
+          trajectories.erase(trajectories.begin() + i);
+          }
+        }
+      }
+
+    line = CheckIndex(node.GetPointer(), trajectories, maximumUID);
+    if (line)
+      {
+      std::cerr << "Line " << line << ": Index doesn't match the trajectories after operation "
+                << operation << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Deleting a fiducial removes its trajectories, and their rulers, in one
+  // pass: a trajectory from and to the same fiducial is removed once
+  int row = node->AddTrajectory(entry, target, "", FiducialID(0).c_str(), FiducialID(0).c_str());
+  Trajectory loop;
+  loop.UID = node->GetTrajectoryUID(row);
+  loop.EntryNodeID = FiducialID(0);
+  loop.TargetNodeID = FiducialID(0);
+  trajectories.push_back(loop);
+  maximumUID = loop.UID;
+  int modifiedEvents = 0;
+  int removedEvents = 0;
+  vtkNew<vtkCallbackCommand> modifiedCallback;
+  modifiedCallback->SetCallback(CountEvent);
+  modifiedCallback->SetClientData(&modifiedEvents);
+  node->AddObserver(vtkCommand::ModifiedEvent, modifiedCallback.GetPointer());
+  vtkNew<vtkCallbackCommand> removedCallback;
+  removedCallback->SetCallback(CountEvent);
+  removedCallback->SetClientData(&removedEvents);
+  node->AddObserver(vtkMRMLPathPlannerTrajectoryNode::TrajectoryRemovedEvent,
+                    removedCallback.GetPointer());
+  for (int fiducial = 0; fiducial < NumberOfFiducials; ++fiducial)
+    {
+    std::string id = FiducialID(fiducial);
+    std::vector<int> rows;
+    node->GetTrajectoriesUsingFiducial(id.c_str(), rows);
+    modifiedEvents = 0;
+    node->RemoveTrajectories(rows);
+    int numberOfRemovedTrajectories = 0;
+    for (int i = static_cast<int>(trajectories.size()) - 1; i >= 0; --i)
+      {
+      if (trajectories[i].EntryNodeID == id || trajectories[i].TargetNodeID == id)
+        {
+        trajectories.erase(trajectories.begin() + i);
+        ++numberOfRemovedTrajectories;
+        }
+      }
+    if (static_cast<int>(rows.size()) != numberOfRemovedTrajectories ||
+        modifiedEvents != (rows.empty() ? 0 : 1) || removedEvents != 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": Deleting fiducial " << fiducial << " removed "
+                << rows.size() << " trajectories instead of " << numberOfRemovedTrajectories
+                << " with " << modifiedEvents << " ModifiedEvent and " << removedEvents
+                << " TrajectoryRemovedEvent" << std::endl;
+      return EXIT_FAILURE;
+      }
+    line = CheckIndex(node.GetPointer(), trajectories, maximumUID);
+    if (line)
+      {
+      std::cerr << "Line " << line << ": Index doesn't match the trajectories after deleting fiducial "
+                << fiducial << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Only trajectories without fiducials are left
+  for (size_t i = 0; i < trajectories.size(); ++i)
+    {
+    if (!trajectories[i].EntryNodeID.empty() || !trajectories[i].TargetNodeID.empty())
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << trajectories[i].UID
+                << " still uses a deleted fiducial" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
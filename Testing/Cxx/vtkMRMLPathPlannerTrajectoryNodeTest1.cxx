@@ -0,0 +1,414 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::SameValue;
+using vtkPathExplorerTestingUtilities::SplitAttributes;
+
+const int NumberOfTrajectories = 20;
+
+//----------------------------------------------------------------------------
+// Events invoked by the node, with the rows passed as call data
+struct EventLog
+{
+  EventLog() : Modified(0) {}
+  int Modified;
+  std::vector<int> AddedRows;
+  std::vector<int> RemovedRows;
+  std::vector<int> ModifiedRows;
+};
+
+//----------------------------------------------------------------------------
+void LogEvent(vtkObject* vtkNotUsed(caller), unsigned long event,
+              void* clientData, void* callData)
+{
+  EventLog* log = reinterpret_cast<EventLog*>(clientData);
+  int row = callData ? *reinterpret_cast<int*>(callData) : -1;
+  switch (event)
+    {
+    case vtkCommand::ModifiedEvent:
+      ++log->Modified;
+      break;
+    case vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent:
+      log->AddedRows.push_back(row);
+      break;
+    case vtkMRMLPathPlannerTrajectoryNode::TrajectoryRemovedEvent:
+      log->RemovedRows.push_back(row);
+      break;
+    case vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent:
+      log->ModifiedRows.push_back(row);
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Expected content of a row
+struct Trajectory
+{
+  int UID;
+  double Entry[3];
+  double Target[3];
+  std::string Name;
+  std::string EntryNodeID;
+  std::string TargetNodeID;
+  int Flags;
+  double Clearance;
+};
+
+//----------------------------------------------------------------------------
+Trajectory MakeTrajectory(int i)
+{
+  Trajectory trajectory;
+  trajectory.UID = i;
+  for (int j = 0; j < 3; ++j)
+    {
+    trajectory.Entry[j] = i + 0.25 * j;
+    trajectory.Target[j] = -i - 0.5 * j;
+    }
+  std::stringstream name;
+  name << "Trajectory " << i;
+  trajectory.Name = name.str();
+  std::stringstream entryNodeID;
+  entryNodeID << "vtkMRMLAnnotationFiducialNode" << i % 4;
+  trajectory.EntryNodeID = entryNodeID.str();
+  std::stringstream targetNodeID;
+  targetNodeID << "vtkMRMLAnnotationFiducialNode" << 10 + i % 5;
+  trajectory.TargetNodeID = targetNodeID.str();
+  trajectory.Flags = i % 2 ? vtkMRMLPathPlannerTrajectoryNode::DefaultFlags :
+    vtkMRMLPathPlannerTrajectoryNode::EntryVisible;
+  trajectory.Clearance = i % 3 ? i * 0.5 : std::numeric_limits<double>::quiet_NaN();
+  return trajectory;
+}
+
+//----------------------------------------------------------------------------
+// Return the line of the first difference, 0 if none. Every column and
+// the contiguous position arrays must follow the rows.
+int CheckNode(vtkMRMLPathPlannerTrajectoryNode* node,
+              const std::vector<Trajectory>& trajectories)
+{
+  int numberOfTrajectories = static_cast<int>(trajectories.size());
+  if (node->GetNumberOfTrajectories() != numberOfTrajectories ||
+      node->GetNumberOfMetrics() != 2)
+    {
+    return __LINE__;
+    }
+  const double* entries = node->GetEntryPositions();
+  const double* targets = node->GetTargetPositions();
+  if ((entries == 0) != (numberOfTrajectories == 0) ||
+      (targets == 0) != (numberOfTrajectories == 0))
+    {
+    return __LINE__;
+    }
+  for (int row = 0; row < numberOfTrajectories; ++row)
+    {
+    const Trajectory& trajectory = trajectories[row];
+    if (node->GetTrajectoryUID(row) != trajectory.UID ||
+        node->GetTrajectoryRow(trajectory.UID) != row ||
+        trajectory.Name != node->GetTrajectoryName(row) ||
+        trajectory.EntryNodeID != node->GetEntryNodeID(row) ||
+        trajectory.TargetNodeID != node->GetTargetNodeID(row) ||
+        node->GetTrajectoryFlags(row) != trajectory.Flags ||
+        !SameValue(node->GetMetricValue(row, 0), trajectory.Clearance) ||
+        !SameValue(node->GetMetricValues(0)[row], trajectory.Clearance) ||
+        !SameValue(node->GetMetricValue(row, 1),
+                   std::numeric_limits<double>::quiet_NaN()))
+      {
+      return __LINE__;
+      }
+    double entry[3];
+    double target[3];
+    node->GetEntryPosition(row, entry);
+    node->GetTargetPosition(row, target);
+    for (int i = 0; i < 3; ++i)
+      {
+      if (entry[i] != trajectory.Entry[i] || entries[3 * row + i] != trajectory.Entry[i] ||
+          target[i] != trajectory.Target[i] || targets[3 * row + i] != trajectory.Target[i])
+        {
+        return __LINE__;
+        }
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void ReadXML(vtkMRMLPathPlannerTrajectoryNode* node, const std::string& xml)
+{
+  std::vector<std::string> attributes;
+  SplitAttributes(xml, attributes);
+  std::vector<const char*> atts;
+  for (size_t i = 0; i < attributes.size(); ++i)
+    {
+    atts.push_back(attributes[i].c_str());
+    }
+  atts.push_back(NULL);
+  node->ReadXMLAttributes(&atts[0]);
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryNodeTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> node;
+  EventLog log;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(LogEvent);
+  callback->SetClientData(&log);
+  node->AddObserver(vtkCommand::ModifiedEvent, callback.GetPointer());
+  node->AddObserver(vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent, callback.GetPointer());
+  node->AddObserver(vtkMRMLPathPlannerTrajectoryNode::TrajectoryRemovedEvent, callback.GetPointer());
+  node->AddObserver(vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent, callback.GetPointer());
+
+  // A metric added before the trajectories gets a value per row, one added
+  // after them is filled with NaN
+  if (node->AddMetric("Clearance") != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": AddMetric failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::vector<Trajectory> trajectories;
+  for (int i = 0; i < NumberOfTrajectories; ++i)
+    {
+    trajectories.push_back(MakeTrajectory(i));
+    const Trajectory& trajectory = trajectories.back();
+    int row = node->AddTrajectory(trajectory.Entry, trajectory.Target, trajectory.Name.c_str(),
+                                  trajectory.EntryNodeID.c_str(), trajectory.TargetNodeID.c_str(),
+                                  trajectory.Flags);
+    if (row != i)
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << i << " added at row " << row << std::endl;
+      return EXIT_FAILURE;
+      }
+    node->SetMetricValue(row, 0, trajectory.Clearance);
+    }
+  if (node->AddMetric("Risk") != 1 || node->AddMetric("Clearance") != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": AddMetric failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int line = CheckNode(node.GetPointer(), trajectories);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Node doesn't match the added trajectories" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (static_cast<int>(log.AddedRows.size()) != NumberOfTrajectories ||
+      log.AddedRows.back() != NumberOfTrajectories - 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << log.AddedRows.size()
+              << " TrajectoryAddedEvent instead of " << NumberOfTrajectories << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Only a different value modifies a trajectory, NaN included
+  log.ModifiedRows.clear();
+  node->SetMetricValue(0, 0, trajectories[0].Clearance);
+  node->SetMetricValue(1, 0, trajectories[1].Clearance);
+  double entry[3] = { 100.0, 0.0, 0.0 };
+  node->SetEntryPosition(4, entry);
+  std::copy(entry, entry + 3, trajectories[4].Entry);
+  if (log.ModifiedRows.size() != 1 || log.ModifiedRows[0] != 4)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << log.ModifiedRows.size()
+              << " TrajectoryModifiedEvent instead of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Following rows move up
+  node->RemoveTrajectory(3);
+  trajectories.erase(trajectories.begin() + 3);
+  line = CheckNode(node.GetPointer(), trajectories);
+  if (line || log.RemovedRows.size() != 1 || log.RemovedRows[0] != 3 ||
+      node->GetTrajectoryRow(3) != -1)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": RemoveTrajectory failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Several rows in one pass: invalid and duplicated rows are ignored and
+  // observers get a single ModifiedEvent
+  log.Modified = 0;
+  log.RemovedRows.clear();
+  std::vector<int> rows;
+  rows.push_back(10);
+  rows.push_back(0);
+  rows.push_back(10);
+  rows.push_back(NumberOfTrajectories - 2);
+  rows.push_back(-1);
+  rows.push_back(NumberOfTrajectories + 5);
+  node->RemoveTrajectories(rows);
+  trajectories.erase(trajectories.begin() + NumberOfTrajectories - 2);
+  trajectories.erase(trajectories.begin() + 10);
+  trajectories.erase(trajectories.begin());
+  line = CheckNode(node.GetPointer(), trajectories);
+  if (line || log.Modified != 1 || !log.RemovedRows.empty())
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": RemoveTrajectories failed, "
+              << log.Modified << " ModifiedEvent" << std::endl;
+    return EXIT_FAILURE;
+    }
+  log.Modified = 0;
+  node->RemoveTrajectories(std::vector<int>(1, -1));
+  if (log.Modified != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Nothing removed but the node was modified" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // UIDs of removed trajectories are not reused
+  trajectories.push_back(MakeTrajectory(NumberOfTrajectories));
+  Trajectory& added = trajectories.back();
+  int row = node->AddTrajectory(added.Entry, added.Target, added.Name.c_str(),
+                                added.EntryNodeID.c_str(), added.TargetNodeID.c_str(),
+                                added.Flags);
+  node->SetMetricValue(row, 0, added.Clearance);
+  line = CheckNode(node.GetPointer(), trajectories);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Trajectory added after removals doesn't match" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // XML round trip: missing metric values are written as "nan", names and
+  // node IDs are encoded as tokens, empty or not
+  node->SetTrajectoryName(0, "Left \"frontal\", 100% <safe>");
+  trajectories[0].Name = "Left \"frontal\", 100% <safe>";
+  node->SetTrajectoryName(1, "");
+  trajectories[1].Name = "";
+  node->SetEntryNodeID(2, "");
+  trajectories[2].EntryNodeID = "";
+  std::stringstream xml;
+  node->WriteXML(xml, 0);
+  if (xml.str().find(" nan") == std::string::npos)
+    {
+    std::cerr << "Line " << __LINE__ << ": Missing values not written as nan" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> xmlNode;
+  ReadXML(xmlNode.GetPointer(), xml.str());
+  line = CheckNode(xmlNode.GetPointer(), trajectories);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": XML round trip doesn't match" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (xmlNode->FindTrajectory(trajectories[3].EntryNodeID.c_str(),
+                              trajectories[3].TargetNodeID.c_str()) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": Fiducial index not rebuilt on read" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // UIDs go on after the largest one read
+  double target[3] = { 0.0, 0.0, 0.0 };
+  row = xmlNode->AddTrajectory(entry, target);
+  if (xmlNode->GetTrajectoryUID(row) != NumberOfTrajectories + 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": UID " << xmlNode->GetTrajectoryUID(row)
+              << " instead of " << NumberOfTrajectories + 1 << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Any spelling of "nan" is a missing value. Other invalid numbers are
+  // read as NaN too, not as the number they start with. Short columns are
+  // completed with defaults.
+  const char* atts[] = {
+    "trajectoryUIDs", "7 3 x",
+    "trajectoryNames", "A%20B - C",
+    "trajectoryFlags", "8 nan",
+    "entryPositions", "1 2 3 NaN -nan +NAN 4 5",
+    "targetPositions", "0 0 0 1 1 1 2 2 2",
+    "metricNames", "Clearance Risk",
+    "metricValues", "nan 1.5abc 2 1e-3 -Nan 0x",
+    NULL };
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> tokenNode;
+  tokenNode->ReadXMLAttributes(atts);
+  const double expectedEntries[] = { 1.0, 2.0, 3.0, std::numeric_limits<double>::quiet_NaN(),
+                                     std::numeric_limits<double>::quiet_NaN(),
+                                     std::numeric_limits<double>::quiet_NaN(),
+                                     4.0, 5.0, 0.0 };
+  const double expectedMetrics[] = { std::numeric_limits<double>::quiet_NaN(),
+                                     std::numeric_limits<double>::quiet_NaN(), 2.0, 1e-3,
+                                     std::numeric_limits<double>::quiet_NaN(),
+                                     std::numeric_limits<double>::quiet_NaN() };
+  if (tokenNode->GetNumberOfTrajectories() != 3 ||
+      tokenNode->GetTrajectoryUID(0) != 7 || tokenNode->GetTrajectoryUID(1) != 3 ||
+      tokenNode->GetTrajectoryUID(2) != 2 ||
+      std::string(tokenNode->GetTrajectoryName(0)) != "A B" ||
+      std::string(tokenNode->GetTrajectoryName(1)) != "" ||
+      tokenNode->GetTrajectoryFlags(0) != 8 ||
+      tokenNode->GetTrajectoryFlags(1) != vtkMRMLPathPlannerTrajectoryNode::DefaultFlags ||
+      tokenNode->GetTrajectoryFlags(2) != vtkMRMLPathPlannerTrajectoryNode::DefaultFlags)
+    {
+    std::cerr << "Line " << __LINE__ << ": Tokens misread" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < 9; ++i)
+    {
+    if (!SameValue(tokenNode->GetEntryPositions()[i], expectedEntries[i]))
+      {
+      std::cerr << "Line " << __LINE__ << ": Entry coordinate " << i << " read as "
+                << tokenNode->GetEntryPositions()[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  for (int i = 0; i < 6; ++i)
+    {
+    if (!SameValue(tokenNode->GetMetricValue(i % 3, i / 3), expectedMetrics[i]))
+      {
+      std::cerr << "Line " << __LINE__ << ": Metric value " << i << " read as "
+                << tokenNode->GetMetricValue(i % 3, i / 3) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Metrics are kept without trajectories
+  node->RemoveAllTrajectories();
+  trajectories.clear();
+  line = CheckNode(node.GetPointer(), trajectories);
+  if (line || node->GetTrajectoryRow(added.UID) != -1)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": RemoveAllTrajectories failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include "vtkMRMLPathPlannerTrajectoryStorageNode.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
+#include <vtkType.h>
+
+// STD includes
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::SameValue;
+using vtkPathExplorerTestingUtilities::SplitAttributes;
+
+const int NumberOfTrajectories = 5000;
+const int NumberOfSamples = 128;
+const int NumberOfSampleComponents = 2;
+
+//----------------------------------------------------------------------------
+void PopulateNode(vtkMRMLPathPlannerTrajectoryNode* node)
+{
+  int clearance = node->AddMetric("Clearance");
+  int risk = node->AddMetric("Risk score");
+
+  std::vector<double> samples(NumberOfSamples * NumberOfSampleComponents);
+  for (int i = 0; i < NumberOfTrajectories; ++i)
+    {
+    double entry[3] = {i * 0.1, 20.0, -i * 0.5};
+    double target[3] = {i * 0.1, -10.0, 35.25};
+    std::stringstream name;
+    name << "Trajectory " << i;
+    std::stringstream entryID;
+    entryID << "vtkMRMLAnnotationFiducialNode" << i % 50;
+    std::stringstream targetID;
+    targetID << "vtkMRMLAnnotationFiducialNode" << 50 + i / 50;
+
+    // No ruler: the node is not in a scene
+    int row = node->AddTrajectory(entry, target, name.str().c_str(),
+                                  entryID.str().c_str(), targetID.str().c_str(),
+                                  vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    node->SetMetricValue(row, clearance, 1.0 / (i + 1));
+    if (i % 3 != 0)
+      {
+      node->SetMetricValue(row, risk, i * 0.25);
+      }
+
+    // Intensity profile on every other trajectory
+    if (i % 2 == 0)
+      {
+      for (size_t s = 0; s < samples.size(); ++s)
+        {
+        samples[s] = i + s * 0.5;
+        }
+      node->SetTrajectorySamples(row, NumberOfSamples, NumberOfSampleComponents, &samples[0]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool CompareNodes(vtkMRMLPathPlannerTrajectoryNode* node1,
+                  vtkMRMLPathPlannerTrajectoryNode* node2,
+                  bool compareSamples)
+{
+  if (node1->GetNumberOfTrajectories() != node2->GetNumberOfTrajectories() ||
+      node1->GetNumberOfMetrics() != node2->GetNumberOfMetrics())
+    {
+    std::cerr << "Line " << __LINE__ << ": Number of trajectories/metrics mismatch" << std::endl;
+    return false;
+    }
+
+  for (int metric = 0; metric < node1->GetNumberOfMetrics(); ++metric)
+    {
+    if (std::string(node1->GetMetricName(metric)) != node2->GetMetricName(metric))
+      {
+      std::cerr << "Line " << __LINE__ << ": Metric name mismatch" << std::endl;
+      return false;
+      }
+    }
+
+  for (int row = 0; row < node1->GetNumberOfTrajectories(); ++row)
+    {
+    double position1[3], position2[3];
+    node1->GetEntryPosition(row, position1);
+    node2->GetEntryPosition(row, position2);
+    bool same = position1[0] == position2[0] && position1[1] == position2[1] && position1[2] == position2[2];
+    node1->GetTargetPosition(row, position1);
+    node2->GetTargetPosition(row, position2);
+    same = same && position1[0] == position2[0] && position1[1] == position2[1] && position1[2] == position2[2];
+    same = same &&
+      node1->GetTrajectoryUID(row) == node2->GetTrajectoryUID(row) &&
+      node1->GetTrajectoryFlags(row) == node2->GetTrajectoryFlags(row) &&
+      std::string(node1->GetTrajectoryName(row)) == node2->GetTrajectoryName(row) &&
+      std::string(node1->GetEntryNodeID(row)) == node2->GetEntryNodeID(row) &&
+      std::string(node1->GetTargetNodeID(row)) == node2->GetTargetNodeID(row);
+    for (int metric = 0; metric < node1->GetNumberOfMetrics(); ++metric)
+      {
+      same = same && SameValue(node1->GetMetricValue(row, metric), node2->GetMetricValue(row, metric));
+      }
+    if (!same)
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << row << " mismatch" << std::endl;
+      return false;
+      }
+
+    if (!compareSamples)
+      {
+      continue;
+      }
+    int numberOfValues = node1->GetNumberOfTrajectorySamples(row) *
+                         node1->GetNumberOfTrajectorySampleComponents(row);
+    if (node1->GetNumberOfTrajectorySamples(row) != node2->GetNumberOfTrajectorySamples(row) ||
+        node1->GetNumberOfTrajectorySampleComponents(row) != node2->GetNumberOfTrajectorySampleComponents(row))
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << row << " sample size mismatch" << std::endl;
+      return false;
+      }
+    const double* samples1 = node1->GetTrajectorySamples(row);
+    const double* samples2 = node2->GetTrajectorySamples(row);
+    for (int i = 0; i < numberOfValues; ++i)
+      {
+      if (samples1[i] != samples2[i])
+        {
+        std::cerr << "Line " << __LINE__ << ": Trajectory " << row << " samples mismatch" << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Field offsets of the binary format, used to corrupt a written file
+const std::streamoff HeaderNumberOfTrajectoriesOffset = 24;
+const std::streamoff HeaderRecordsOffsetOffset = 40;
+const std::streamoff RecordNumberOfSamplesOffset = 96;
+
+//----------------------------------------------------------------------------
+template <typename T>
+bool ReadFile(const std::string& fileName, std::streamoff offset, T* values, int count)
+{
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+  file.seekg(offset);
+  file.read(reinterpret_cast<char*>(values), count * sizeof(T));
+  return file.good();
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+bool PatchFile(const std::string& fileName, std::streamoff offset, const T* values, int count)
+{
+  std::fstream file(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(offset);
+  file.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+  return file.good();
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLPathPlannerTrajectoryStorageNodeTest1(int argc, char * argv [] )
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: vtkMRMLPathPlannerTrajectoryStorageNodeTest1 <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string fileName = std::string(argv[1]) + "/vtkMRMLPathPlannerTrajectoryStorageNodeTest1.ptraj";
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> node;
+  PopulateNode(node.GetPointer());
+
+  vtkNew<vtkTimerLog> timer;
+
+  // Binary round trip
+  vtkNew<vtkMRMLPathPlannerTrajectoryStorageNode> storageNode;
+  storageNode->SetFileName(fileName.c_str());
+
+  timer->StartTimer();
+  if (!storageNode->WriteData(node.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": WriteData failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  timer->StopTimer();
+  double binaryWriteTime = timer->GetElapsedTime();
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> binaryNode;
+  timer->StartTimer();
+  if (!storageNode->ReadData(binaryNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": ReadData failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  timer->StopTimer();
+  double binaryReadTime = timer->GetElapsedTime();
+
+  if (!CompareNodes(node.GetPointer(), binaryNode.GetPointer(), true))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Overwrite the file still mapped by binaryNode, after modifying
+  // samples (copied in memory) and keeping others (still mapped).
+  std::vector<double> samples(4, 42.0);
+  binaryNode->SetTrajectorySamples(0, 2, 2, &samples[0]);
+  if (!storageNode->WriteData(binaryNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": WriteData over mapped file failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> binaryNode2;
+  if (!storageNode->ReadData(binaryNode2.GetPointer()) ||
+      !CompareNodes(binaryNode.GetPointer(), binaryNode2.GetPointer(), true) ||
+      binaryNode2->GetTrajectorySamples(0)[3] != 42.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Round trip over mapped file failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // XML round trip, for comparison
+  timer->StartTimer();
+  std::stringstream xml;
+  node->WriteXML(xml, 0);
+  timer->StopTimer();
+  double xmlWriteTime = timer->GetElapsedTime();
+
+  std::vector<std::string> attributes;
+  SplitAttributes(xml.str(), attributes);
+  std::vector<const char*> atts;
+  for (size_t i = 0; i < attributes.size(); ++i)
+    {
+    atts.push_back(attributes[i].c_str());
+    }
+  atts.push_back(NULL);
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> xmlNode;
+  timer->StartTimer();
+  xmlNode->ReadXMLAttributes(&atts[0]);
+  timer->StopTimer();
+  double xmlReadTime = timer->GetElapsedTime();
+
+  // Samples are not saved in XML
+  if (!CompareNodes(node.GetPointer(), xmlNode.GetPointer(), false))
+    {
+    return EXIT_FAILURE;
+    }
+
+  std::cout << NumberOfTrajectories << " trajectories, "
+            << NumberOfSamples << "x" << NumberOfSampleComponents << " samples on every other one" << std::endl;
+  std::cout << "  binary: write " << binaryWriteTime << "s, read " << binaryReadTime << "s" << std::endl;
+  std::cout << "  XML (without samples): write " << xmlWriteTime << "s, read " << xmlReadTime << "s" << std::endl;
+
+  // Corrupted file must be rejected
+  remove(fileName.c_str());
+  {
+  std::ofstream corrupted(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  corrupted << "PATHPLAN but not really";
+  }
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> corruptedNode;
+  if (storageNode->ReadData(corruptedNode.GetPointer()) ||
+      corruptedNode->GetNumberOfTrajectories() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Corrupted file was read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Sizes that wrap around once multiplied must be rejected too
+  const vtkTypeUInt32 wrappingCounts[][2] = {{0x80000000u, 0x40000000u},
+                                             {0x40000000u, 0x80000000u}};
+  for (int i = 0; i < 2; ++i)
+    {
+    // Header counts
+    remove(fileName.c_str());
+    if (!storageNode->WriteData(node.GetPointer()) ||
+        !PatchFile(fileName, HeaderNumberOfTrajectoriesOffset, wrappingCounts[i], 2))
+      {
+      std::cerr << "Line " << __LINE__ << ": Unable to patch " << fileName << std::endl;
+      return EXIT_FAILURE;
+      }
+    vtkNew<vtkMRMLPathPlannerTrajectoryNode> wrappingHeaderNode;
+    if (storageNode->ReadData(wrappingHeaderNode.GetPointer()) ||
+        wrappingHeaderNode->GetNumberOfTrajectories() != 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": File with wrapping metric size was read" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Sample counts of the first trajectory
+    remove(fileName.c_str());
+    vtkTypeUInt64 recordsOffset = 0;
+    if (!storageNode->WriteData(node.GetPointer()) ||
+        !ReadFile(fileName, HeaderRecordsOffsetOffset, &recordsOffset, 1) ||
+        !PatchFile(fileName, recordsOffset + RecordNumberOfSamplesOffset, wrappingCounts[i], 2))
+      {
+      std::cerr << "Line " << __LINE__ << ": Unable to patch " << fileName << std::endl;
+      return EXIT_FAILURE;
+      }
+    vtkNew<vtkMRMLPathPlannerTrajectoryNode> wrappingSamplesNode;
+    if (storageNode->ReadData(wrappingSamplesNode.GetPointer()) ||
+        wrappingSamplesNode->GetNumberOfTrajectories() != 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": File with wrapping sample size was read" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
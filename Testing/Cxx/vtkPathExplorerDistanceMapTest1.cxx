@@ -0,0 +1,307 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTrilinearInterpolation.h"
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+
+const int Dimensions[3] = { 21, 16, 13 };
+const double Spacing[3] = { 0.7, 1.1, 2.5 };
+const int NumberOfTrajectories = 500;
+
+//----------------------------------------------------------------------------
+// Reference: distance in mm from each voxel center to the closest voxel
+// center on the other side (labeled or background), negative inside.
+void BruteForceDistanceMap(const short* labels, std::vector<float>& distances)
+{
+  int numberOfVoxels = Dimensions[0] * Dimensions[1] * Dimensions[2];
+  distances.resize(numberOfVoxels);
+  for (int voxel = 0; voxel < numberOfVoxels; ++voxel)
+    {
+    int i = voxel % Dimensions[0];
+    int j = (voxel / Dimensions[0]) % Dimensions[1];
+    int k = voxel / (Dimensions[0] * Dimensions[1]);
+    bool inside = labels[voxel] != 0;
+    double distance2 = std::numeric_limits<double>::infinity();
+    for (int other = 0; other < numberOfVoxels; ++other)
+      {
+      if ((labels[other] != 0) == inside)
+        {
+        continue;
+        }
+      double di = (other % Dimensions[0] - i) * Spacing[0];
+      double dj = ((other / Dimensions[0]) % Dimensions[1] - j) * Spacing[1];
+      double dk = (other / (Dimensions[0] * Dimensions[1]) - k) * Spacing[2];
+      distance2 = std::min(distance2, di * di + dj * dj + dk * dk);
+      }
+    distances[voxel] = static_cast<float>(inside ? -sqrt(distance2) : sqrt(distance2));
+    }
+}
+
+//----------------------------------------------------------------------------
+// First voxel where the distances differ, -1 if none
+int FindDifference(const float* distances, const std::vector<float>& expected)
+{
+  for (int voxel = 0; voxel < static_cast<int>(expected.size()); ++voxel)
+    {
+    if (fabs(distances[voxel] - expected[voxel]) > 1e-4 * (1.0 + fabs(expected[voxel])))
+      {
+      return voxel;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+// Reference: minimum of the distance map interpolated every step mm from
+// entry to target, NaN if no sample is inside.
+double BruteForceClearance(const vtkPathExplorerTrilinearInterpolation::Volume& distanceMap,
+                           vtkMatrix4x4* rasToIJK, const double entry[3],
+                           const double target[3], double step)
+{
+  double direction[3] =
+    { target[0] - entry[0], target[1] - entry[1], target[2] - entry[2] };
+  double length = sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                       direction[2] * direction[2]);
+  int numberOfSamples = static_cast<int>(floor(length / step)) + 1;
+  double clearance = std::numeric_limits<double>::quiet_NaN();
+  for (int sample = 0; sample < numberOfSamples; ++sample)
+    {
+    double point[4] = { 0.0, 0.0, 0.0, 1.0 };
+    for (int i = 0; i < 3; ++i)
+      {
+      point[i] = entry[i] + direction[i] * sample * step / length;
+      }
+    rasToIJK->MultiplyPoint(point, point);
+    double value;
+    vtkPathExplorerTrilinearInterpolation::InterpolatePoints(distanceMap, point, 1, &value);
+    if (value == value && (clearance != clearance || value < clearance))
+      {
+      clearance = value;
+      }
+    }
+  return clearance;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* CreateLabelMapNode(vtkMRMLScene* scene, vtkImageData* image)
+{
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  const double c = cos(0.4);
+  const double s = sin(0.4);
+  const double rotation[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, c, -s }, { 0.0, s, c } };
+  const double origin[3] = { 8.0, -20.0, 5.5 };
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      ijkToRAS->SetElement(i, j, rotation[i][j] * Spacing[j]);
+      }
+    ijkToRAS->SetElement(i, 3, origin[i]);
+    }
+  vtkMRMLScalarVolumeNode* labelMapNode = vtkMRMLScalarVolumeNode::New();
+  labelMapNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+  labelMapNode->SetAndObserveImageData(image);
+  scene->AddNode(labelMapNode);
+  return labelMapNode;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* CreateImage()
+{
+  vtkImageData* image = vtkImageData::New();
+  image->SetDimensions(Dimensions[0], Dimensions[1], Dimensions[2]);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  return image;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerDistanceMapTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+
+  // Two balls and some isolated voxels
+  vtkImageData* image = CreateImage();
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  unsigned int seed = 1;
+  int numberOfVoxels = Dimensions[0] * Dimensions[1] * Dimensions[2];
+  for (int voxel = 0; voxel < numberOfVoxels; ++voxel)
+    {
+    double x = (voxel % Dimensions[0]) * Spacing[0];
+    double y = ((voxel / Dimensions[0]) % Dimensions[1]) * Spacing[1];
+    double z = (voxel / (Dimensions[0] * Dimensions[1])) * Spacing[2];
+    double d1 = (x - 5.0) * (x - 5.0) + (y - 6.0) * (y - 6.0) + (z - 12.0) * (z - 12.0);
+    double d2 = (x - 10.0) * (x - 10.0) + (y - 12.0) * (y - 12.0) + (z - 20.0) * (z - 20.0);
+    labels[voxel] = d1 < 16.0 ? 1 : (d2 < 9.0 ? 2 : 0);
+    if (Random(seed) < 0.005)
+      {
+      labels[voxel] = 3;
+      }
+    }
+  vtkMRMLScalarVolumeNode* labelMapNode = CreateLabelMapNode(scene.GetPointer(), image);
+
+  std::vector<float> expected;
+  BruteForceDistanceMap(labels, expected);
+
+  const float* distances = logic->GetDistanceMap(labelMapNode);
+  if (!distances)
+    {
+    std::cerr << "Line " << __LINE__ << ": No distance map" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int voxel = FindDifference(distances, expected);
+  if (voxel >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Voxel " << voxel << " at distance "
+              << distances[voxel] << " instead of " << expected[voxel] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The map is cached until the image is modified
+  if (logic->GetDistanceMap(labelMapNode) != distances ||
+      logic->GetNumberOfDistanceMaps() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Distance map not cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+  labels[0] = 4;
+  image->Modified();
+  BruteForceDistanceMap(labels, expected);
+  distances = logic->GetDistanceMap(labelMapNode);
+  if (!distances || FindDifference(distances, expected) >= 0 ||
+      logic->GetNumberOfDistanceMaps() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Distance map not updated" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Clearance of random trajectories, some leaving the label map
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  labelMapNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  ijkToRAS->DeepCopy(rasToIJK.GetPointer());
+  ijkToRAS->Invert();
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    double entry[4] = { 0.0, 0.0, 0.0, 1.0 };
+    double target[4] = { 0.0, 0.0, 0.0, 1.0 };
+    for (int i = 0; i < 3; ++i)
+      {
+      entry[i] = Random(seed) * (Dimensions[i] + 4) - 2.0;
+      target[i] = Random(seed) * (Dimensions[i] - 1);
+      }
+    ijkToRAS->MultiplyPoint(entry, entry);
+    ijkToRAS->MultiplyPoint(target, target);
+    trajectoryList->AddTrajectory(entry, target, "", "", "",
+                                  vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    }
+  logic->SetSamplingStep(0.6);
+  if (!logic->ComputeClearance(trajectoryList.GetPointer(), labelMapNode))
+    {
+    std::cerr << "Line " << __LINE__ << ": ComputeClearance failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int metric = trajectoryList->GetMetricIndex("Clearance");
+
+  vtkPathExplorerTrilinearInterpolation::Volume distanceMap;
+  distanceMap.Scalars = &expected[0];
+  distanceMap.ScalarType = VTK_FLOAT;
+  for (int i = 0; i < 3; ++i)
+    {
+    distanceMap.Dimensions[i] = Dimensions[i];
+    }
+  distanceMap.Increments[0] = 1;
+  distanceMap.Increments[1] = Dimensions[0];
+  distanceMap.Increments[2] = Dimensions[0] * Dimensions[1];
+  int numberOfCollisions = 0;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    double entry[3];
+    double target[3];
+    trajectoryList->GetEntryPosition(t, entry);
+    trajectoryList->GetTargetPosition(t, target);
+    double expectedClearance =
+      BruteForceClearance(distanceMap, rasToIJK.GetPointer(), entry, target, 0.6);
+    double clearance = metric < 0 ? 0.0 : trajectoryList->GetMetricValue(t, metric);
+    if (fabs(clearance - expectedClearance) > 1e-4 * (1.0 + fabs(expectedClearance)))
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << t << " clearance "
+                << clearance << " instead of " << expectedClearance << std::endl;
+      return EXIT_FAILURE;
+      }
+    numberOfCollisions += clearance < 0 ? 1 : 0;
+    }
+  if (numberOfCollisions == 0 || numberOfCollisions == NumberOfTrajectories)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << numberOfCollisions
+              << " trajectories through a structure" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without any labeled voxel, there is no map
+  vtkImageData* emptyImage = CreateImage();
+  short* emptyLabels = static_cast<short*>(emptyImage->GetScalarPointer());
+  std::fill(emptyLabels, emptyLabels + numberOfVoxels, static_cast<short>(0));
+  vtkMRMLScalarVolumeNode* emptyNode = CreateLabelMapNode(scene.GetPointer(), emptyImage);
+  if (logic->GetDistanceMap(emptyNode) ||
+      logic->ComputeClearance(trajectoryList.GetPointer(), emptyNode))
+    {
+    std::cerr << "Line " << __LINE__ << ": Distance map without label" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  emptyNode->Delete();
+  emptyImage->Delete();
+  labelMapNode->Delete();
+  image->Delete();
+  return EXIT_SUCCESS;
+}
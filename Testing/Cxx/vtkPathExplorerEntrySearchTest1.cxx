@@ -0,0 +1,347 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const double SkinRadius = 50.0;
+const double SkullRadius = 45.0;
+const double Target[3] = { 10.0, 0.0, 0.0 };
+// Critical structure between the target and the closest part of the skin
+const double BallCenter[3] = { 30.0, 0.0, 0.0 };
+const double BallRadius = 8.0;
+const int NumberOfEntryPoints = 10;
+
+//----------------------------------------------------------------------------
+// Triangulated sphere centered on the origin, 64 sectors and 32 stacks
+void AddSphere(double radius, vtkPoints* points, vtkCellArray* polys)
+{
+  const int sectors = 64;
+  const int stacks = 32;
+  vtkIdType firstPoint = points->GetNumberOfPoints();
+  points->InsertNextPoint(0.0, 0.0, radius);
+  for (int stack = 1; stack < stacks; ++stack)
+    {
+    double phi = vtkMath::Pi() * stack / stacks;
+    for (int sector = 0; sector < sectors; ++sector)
+      {
+      double theta = 2.0 * vtkMath::Pi() * sector / sectors;
+      points->InsertNextPoint(radius * sin(phi) * cos(theta),
+                              radius * sin(phi) * sin(theta), radius * cos(phi));
+      }
+    }
+  points->InsertNextPoint(0.0, 0.0, -radius);
+
+  vtkIdType lastPoint = firstPoint + 1 + (stacks - 1) * sectors;
+  for (int sector = 0; sector < sectors; ++sector)
+    {
+    vtkIdType next = (sector + 1) % sectors;
+    vtkIdType top[3] = { firstPoint, firstPoint + 1 + sector, firstPoint + 1 + next };
+    polys->InsertNextCell(3, top);
+    for (int stack = 1; stack < stacks - 1; ++stack)
+      {
+      vtkIdType row = firstPoint + 1 + (stack - 1) * sectors;
+      vtkIdType quad[4] = { row + sector, row + sectors + sector,
+                            row + sectors + next, row + next };
+      polys->InsertNextCell(4, quad);
+      }
+    vtkIdType row = firstPoint + 1 + (stacks - 2) * sectors;
+    vtkIdType bottom[3] = { row + sector, lastPoint, row + next };
+    polys->InsertNextCell(3, bottom);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLModelNode* CreateSurfaceNode(vtkMRMLScene* scene, bool skull)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> polys;
+  AddSphere(SkinRadius, points.GetPointer(), polys.GetPointer());
+  if (skull)
+    {
+    AddSphere(SkullRadius, points.GetPointer(), polys.GetPointer());
+    }
+  vtkPolyData* polyData = vtkPolyData::New();
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetPolys(polys.GetPointer());
+  vtkMRMLModelNode* surfaceNode = vtkMRMLModelNode::New();
+  surfaceNode->SetAndObservePolyData(polyData);
+  polyData->Delete();
+  scene->AddNode(surfaceNode);
+  return surfaceNode;
+}
+
+//----------------------------------------------------------------------------
+// Label map of the ball, 2 mm voxels around the skin
+vtkMRMLScalarVolumeNode* CreateLabelMapNode(vtkMRMLScene* scene)
+{
+  const int dimension = 53;
+  const double spacing = 2.0;
+  const double origin = -52.0;
+  vtkImageData* image = vtkImageData::New();
+  image->SetDimensions(dimension, dimension, dimension);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  for (int k = 0; k < dimension; ++k)
+    {
+    for (int j = 0; j < dimension; ++j)
+      {
+      for (int i = 0; i < dimension; ++i)
+        {
+        double position[3] =
+          { origin + i * spacing, origin + j * spacing, origin + k * spacing };
+        labels[(k * dimension + j) * dimension + i] =
+          vtkMath::Distance2BetweenPoints(position, BallCenter) < BallRadius * BallRadius ? 1 : 0;
+        }
+      }
+    }
+
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  for (int i = 0; i < 3; ++i)
+    {
+    ijkToRAS->SetElement(i, i, spacing);
+    ijkToRAS->SetElement(i, 3, origin);
+    }
+  vtkMRMLScalarVolumeNode* labelMapNode = vtkMRMLScalarVolumeNode::New();
+  labelMapNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+  labelMapNode->SetAndObserveImageData(image);
+  image->Delete();
+  scene->AddNode(labelMapNode);
+  return labelMapNode;
+}
+
+//----------------------------------------------------------------------------
+// Properties every search result must have; the number of the first
+// failing line, 0 if none
+int CheckEntryPoints(vtkSlicerPathExplorerLogic* logic,
+                     const vtkSlicerPathExplorerLogic::EntryPointList& entryPoints)
+{
+  if (static_cast<int>(entryPoints.size()) != NumberOfEntryPoints)
+    {
+    return __LINE__;
+    }
+  double separation2 = logic->GetEntrySearchMinimumSeparation() *
+    logic->GetEntrySearchMinimumSeparation();
+  for (size_t e = 0; e < entryPoints.size(); ++e)
+    {
+    const vtkSlicerPathExplorerLogic::EntryPoint& entryPoint = entryPoints[e];
+    // On the skin, within reach of the target
+    double radius = vtkMath::Norm(entryPoint.Position);
+    if (radius > SkinRadius + 1e-9 || radius < SkinRadius * cos(vtkMath::Pi() / 32.0))
+      {
+      return __LINE__;
+      }
+    double direction[3];
+    vtkMath::Subtract(Target, entryPoint.Position, direction);
+    double length = vtkMath::Norm(direction);
+    if (fabs(entryPoint.Length - length) > 1e-9 ||
+        length > logic->GetEntrySearchMaximumLength())
+      {
+      return __LINE__;
+      }
+    // The facet normal is close to the radial direction
+    double radialAngle = vtkMath::DegreesFromRadians(
+      acos(fabs(vtkMath::Dot(direction, entryPoint.Position)) / (length * radius)));
+    if (entryPoint.Angle > logic->GetEntrySearchMaximumAngle() ||
+        fabs(entryPoint.Angle - radialAngle) > 6.0)
+      {
+      return __LINE__;
+      }
+    // In order, apart
+    if (e > 0 &&
+        (entryPoint.NumberOfCrossedLabels < entryPoints[e - 1].NumberOfCrossedLabels ||
+         (entryPoint.NumberOfCrossedLabels == entryPoints[e - 1].NumberOfCrossedLabels &&
+          entryPoint.Cost < entryPoints[e - 1].Cost)))
+      {
+      return __LINE__;
+      }
+    for (size_t other = 0; other < e; ++other)
+      {
+      if (vtkMath::Distance2BetweenPoints(entryPoint.Position,
+                                          entryPoints[other].Position) < separation2)
+        {
+        return __LINE__;
+        }
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void SetTrajectories(const vtkSlicerPathExplorerLogic::EntryPointList& entryPoints,
+                     vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  trajectoryList->RemoveAllTrajectories();
+  for (size_t e = 0; e < entryPoints.size(); ++e)
+    {
+    trajectoryList->AddTrajectory(entryPoints[e].Position, Target, "", "", "",
+                                  vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    }
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerEntrySearchTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+  logic->SetEntrySearchSpacing(2.0);
+  vtkMRMLModelNode* skinNode = CreateSurfaceNode(scene.GetPointer(), false);
+  vtkMRMLModelNode* skullNode = CreateSurfaceNode(scene.GetPointer(), true);
+  vtkMRMLScalarVolumeNode* labelMapNode = CreateLabelMapNode(scene.GetPointer());
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+
+  // Without critical structure: the skin closest to the target is best
+  vtkSlicerPathExplorerLogic::EntryPointList entryPoints;
+  if (!logic->FindEntryPoints(Target, skinNode, 0, NumberOfEntryPoints, entryPoints))
+    {
+    std::cerr << "Line " << __LINE__ << ": FindEntryPoints failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int line = CheckEntryPoints(logic.GetPointer(), entryPoints);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Invalid entry points without label map" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const vtkSlicerPathExplorerLogic::EntryPoint best = entryPoints[0];
+  if (best.Position[0] < SkinRadius * 0.99 || best.NumberOfCrossedLabels != 0 ||
+      !vtkMath::IsNan(best.Clearance))
+    {
+    std::cerr << "Line " << __LINE__ << ": Best entry point at " << best.Position[0]
+              << " " << best.Position[1] << " " << best.Position[2] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Trajectories longer than the maximum length are rejected
+  logic->SetEntrySearchMaximumLength(45.0);
+  if (!logic->FindEntryPoints(Target, skinNode, 0, NumberOfEntryPoints, entryPoints) ||
+      CheckEntryPoints(logic.GetPointer(), entryPoints))
+    {
+    std::cerr << "Line " << __LINE__ << ": Invalid entry points within 45 mm" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->SetEntrySearchMaximumLength(150.0);
+
+  // The ball is avoided, clearance and labels are those of the trajectories
+  if (!logic->FindEntryPoints(Target, skinNode, labelMapNode, NumberOfEntryPoints, entryPoints))
+    {
+    std::cerr << "Line " << __LINE__ << ": FindEntryPoints failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  line = CheckEntryPoints(logic.GetPointer(), entryPoints);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Invalid entry points with label map" << std::endl;
+    return EXIT_FAILURE;
+    }
+  SetTrajectories(entryPoints, trajectoryList.GetPointer());
+  std::vector<vtkSlicerPathExplorerLogic::LabelIntervalList> intervals;
+  if (!logic->ComputeClearance(trajectoryList.GetPointer(), labelMapNode) ||
+      !logic->ComputeLabelIntervals(trajectoryList.GetPointer(), labelMapNode, intervals))
+    {
+    std::cerr << "Line " << __LINE__ << ": Unable to check the entry points" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int clearanceMetric = trajectoryList->GetMetricIndex("Clearance");
+  for (int e = 0; e < NumberOfEntryPoints; ++e)
+    {
+    double clearance = trajectoryList->GetMetricValue(e, clearanceMetric);
+    if (entryPoints[e].NumberOfCrossedLabels != 0 || !intervals[e].empty() ||
+        fabs(entryPoints[e].Clearance - clearance) > 1e-9 || clearance <= 0.0)
+      {
+      std::cerr << "Line " << __LINE__ << ": Entry point " << e << " crosses "
+                << entryPoints[e].NumberOfCrossedLabels << " labels, clearance "
+                << entryPoints[e].Clearance << " instead of " << intervals[e].size()
+                << " labels, clearance " << clearance << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  vtkSlicerPathExplorerLogic::EntryPointList bestOnly(1, best);
+  SetTrajectories(bestOnly, trajectoryList.GetPointer());
+  if (!logic->ComputeLabelIntervals(trajectoryList.GetPointer(), labelMapNode, intervals) ||
+      intervals[0].empty())
+    {
+    std::cerr << "Line " << __LINE__ << ": Best entry point doesn't cross the ball" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The skull hides the skin from the target
+  if (!logic->FindEntryPoints(Target, skullNode, 0, NumberOfEntryPoints, entryPoints))
+    {
+    std::cerr << "Line " << __LINE__ << ": FindEntryPoints failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (size_t e = 0; e < entryPoints.size(); ++e)
+    {
+    if (vtkMath::Norm(entryPoints[e].Position) > SkullRadius + 1e-9)
+      {
+      std::cerr << "Line " << __LINE__ << ": Entry point " << e << " behind the skull" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (static_cast<int>(entryPoints.size()) != NumberOfEntryPoints)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << entryPoints.size()
+              << " entry points on the skull" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Candidates are counted without scoring any
+  int numberOfCandidates = logic->GetNumberOfEntryCandidates();
+  if (!logic->FindEntryPoints(Target, skullNode, 0, 0, entryPoints) ||
+      !entryPoints.empty() || logic->GetNumberOfEntryCandidates() != numberOfCandidates)
+    {
+    std::cerr << "Line " << __LINE__ << ": Search without entry point" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  labelMapNode->Delete();
+  skullNode->Delete();
+  skinNode->Delete();
+  return EXIT_SUCCESS;
+}
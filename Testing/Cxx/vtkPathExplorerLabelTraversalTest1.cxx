@@ -0,0 +1,316 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLScalarVolumeNode.h>
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+
+const int Dimensions[3] = { 23, 17, 19 };
+const int NumberOfTrajectories = 2000;
+const double Tolerance = 1e-6;
+
+//----------------------------------------------------------------------------
+bool EnterLess(const vtkSlicerPathExplorerLogic::LabelInterval& a,
+               const vtkSlicerPathExplorerLogic::LabelInterval& b)
+{
+  return a.Enter < b.Enter;
+}
+
+//----------------------------------------------------------------------------
+// Reference: the part of the segment from start to end (IJK) in each voxel
+// [i - 0.5, i + 0.5], by slab intersection, in order along the segment.
+// Consecutive parts with the same label are merged and the background is
+// dropped, like vtkSlicerPathExplorerLogic::ComputeLabelIntervals.
+void BruteForceIntervals(const short* labels, const double start[3],
+                         const double end[3], double length,
+                         vtkSlicerPathExplorerLogic::LabelIntervalList& intervals)
+{
+  vtkSlicerPathExplorerLogic::LabelIntervalList parts;
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < Dimensions[1]; ++j)
+      {
+      for (int i = 0; i < Dimensions[0]; ++i)
+        {
+        int voxel[3] = { i, j, k };
+        double tEnter = 0.0;
+        double tExit = 1.0;
+        for (int a = 0; a < 3 && tEnter < tExit; ++a)
+          {
+          double direction = end[a] - start[a];
+          if (direction == 0.0)
+            {
+            if (start[a] < voxel[a] - 0.5 || start[a] >= voxel[a] + 0.5)
+              {
+              tExit = tEnter;
+              }
+            continue;
+            }
+          double t0 = (voxel[a] - 0.5 - start[a]) / direction;
+          double t1 = (voxel[a] + 0.5 - start[a]) / direction;
+          tEnter = std::max(tEnter, std::min(t0, t1));
+          tExit = std::min(tExit, std::max(t0, t1));
+          }
+        if (tExit <= tEnter)
+          {
+          continue;
+          }
+        vtkSlicerPathExplorerLogic::LabelInterval part;
+        part.Label = labels[(k * Dimensions[1] + j) * Dimensions[0] + i];
+        part.Enter = tEnter * length;
+        part.Exit = tExit * length;
+        parts.push_back(part);
+        }
+      }
+    }
+  std::sort(parts.begin(), parts.end(), EnterLess);
+
+  intervals.clear();
+  int previousLabel = 0;
+  for (size_t p = 0; p < parts.size(); ++p)
+    {
+    const vtkSlicerPathExplorerLogic::LabelInterval& part = parts[p];
+    if (part.Label != 0 && part.Label == previousLabel)
+      {
+      intervals.back().Exit = part.Exit;
+      }
+    else if (part.Label != 0)
+      {
+      intervals.push_back(part);
+      }
+    previousLabel = part.Label;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Intervals shorter than the tolerance are dropped (a segment grazing an
+// edge) and the neighbors they separated merged.
+void RemoveShortIntervals(vtkSlicerPathExplorerLogic::LabelIntervalList& intervals)
+{
+  vtkSlicerPathExplorerLogic::LabelIntervalList kept;
+  for (size_t i = 0; i < intervals.size(); ++i)
+    {
+    if (intervals[i].Exit - intervals[i].Enter < Tolerance)
+      {
+      continue;
+      }
+    if (!kept.empty() && kept.back().Label == intervals[i].Label &&
+        intervals[i].Enter - kept.back().Exit < Tolerance)
+      {
+      kept.back().Exit = intervals[i].Exit;
+      continue;
+      }
+    kept.push_back(intervals[i]);
+    }
+  intervals.swap(kept);
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerLabelTraversalTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // Blocks of labels 1 to 3 with some isolated voxels, on a background
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(Dimensions[0], Dimensions[1], Dimensions[2]);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  unsigned int seed = 1;
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < Dimensions[1]; ++j)
+      {
+      for (int i = 0; i < Dimensions[0]; ++i)
+        {
+        short label = static_cast<short>(((i / 4) + (j / 3) + (k / 5)) % 4);
+        if (Random(seed) < 0.1)
+          {
+          label = static_cast<short>(Random(seed) * 4.0);
+          }
+        labels[(k * Dimensions[1] + j) * Dimensions[0] + i] = label;
+        }
+      }
+    }
+
+  // Anisotropic spacing, rotation and origin
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  const double spacing[3] = { 0.8, 1.25, 2.0 };
+  const double c = cos(0.3);
+  const double s = sin(0.3);
+  const double rotation[3][3] = { { c, -s, 0.0 }, { s, c, 0.0 }, { 0.0, 0.0, 1.0 } };
+  const double origin[3] = { -12.5, 4.0, 30.0 };
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      ijkToRAS->SetElement(i, j, rotation[i][j] * spacing[j]);
+      }
+    ijkToRAS->SetElement(i, 3, origin[i]);
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> labelMapNode;
+  labelMapNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+  labelMapNode->SetAndObserveImageData(image.GetPointer());
+
+  // Random trajectories inside the label map and crossing its faces, some
+  // along the axes or through voxel corners, one of length 0
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  std::vector<double> ijkPoints;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    double entryIJK[3];
+    double targetIJK[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      entryIJK[i] = Random(seed) * (Dimensions[i] + 6) - 3.5;
+      targetIJK[i] = Random(seed) * (Dimensions[i] + 6) - 3.5;
+      }
+    if (t % 10 == 1)
+      {
+      // Along an axis
+      int axis = t % 3;
+      for (int i = 0; i < 3; ++i)
+        {
+        targetIJK[i] = i == axis ? targetIJK[i] : entryIJK[i];
+        }
+      }
+    else if (t % 10 == 2)
+      {
+      // Through voxel corners
+      for (int i = 0; i < 3; ++i)
+        {
+        entryIJK[i] = floor(entryIJK[i]) + 0.5;
+        targetIJK[i] = entryIJK[i] + 7.0;
+        }
+      }
+    else if (t == 3)
+      {
+      std::copy(entryIJK, entryIJK + 3, targetIJK);
+      }
+    ijkPoints.insert(ijkPoints.end(), entryIJK, entryIJK + 3);
+    ijkPoints.insert(ijkPoints.end(), targetIJK, targetIJK + 3);
+
+    double entry[4] = { entryIJK[0], entryIJK[1], entryIJK[2], 1.0 };
+    double target[4] = { targetIJK[0], targetIJK[1], targetIJK[2], 1.0 };
+    ijkToRAS->MultiplyPoint(entry, entry);
+    ijkToRAS->MultiplyPoint(target, target);
+    trajectoryList->AddTrajectory(entry, target, "", "", "",
+                                  vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    }
+
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+  std::vector<vtkSlicerPathExplorerLogic::LabelIntervalList> intervals;
+  if (!logic->ComputeLabelIntervals(trajectoryList.GetPointer(),
+                                    labelMapNode.GetPointer(), intervals) ||
+      static_cast<int>(intervals.size()) != NumberOfTrajectories)
+    {
+    std::cerr << "Line " << __LINE__ << ": ComputeLabelIntervals failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  int numberOfIntervals = 0;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    double entry[3];
+    double target[3];
+    trajectoryList->GetEntryPosition(t, entry);
+    trajectoryList->GetTargetPosition(t, target);
+    double length = sqrt((target[0] - entry[0]) * (target[0] - entry[0]) +
+                         (target[1] - entry[1]) * (target[1] - entry[1]) +
+                         (target[2] - entry[2]) * (target[2] - entry[2]));
+    if (length == 0.0)
+      {
+      continue;
+      }
+    vtkSlicerPathExplorerLogic::LabelIntervalList expected;
+    BruteForceIntervals(labels, &ijkPoints[6 * t], &ijkPoints[6 * t + 3],
+                        length, expected);
+    RemoveShortIntervals(expected);
+    vtkSlicerPathExplorerLogic::LabelIntervalList computed = intervals[t];
+    RemoveShortIntervals(computed);
+
+    if (computed.size() != expected.size())
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << t << " crosses "
+                << computed.size() << " intervals instead of " << expected.size()
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    for (size_t i = 0; i < computed.size(); ++i)
+      {
+      if (computed[i].Label != expected[i].Label ||
+          fabs(computed[i].Enter - expected[i].Enter) > Tolerance ||
+          fabs(computed[i].Exit - expected[i].Exit) > Tolerance)
+        {
+        std::cerr << "Line " << __LINE__ << ": Trajectory " << t << " interval " << i
+                  << " is label " << computed[i].Label << " [" << computed[i].Enter
+                  << ", " << computed[i].Exit << "] instead of label "
+                  << expected[i].Label << " [" << expected[i].Enter << ", "
+                  << expected[i].Exit << "]" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    numberOfIntervals += static_cast<int>(computed.size());
+    }
+  if (numberOfIntervals < NumberOfTrajectories)
+    {
+    std::cerr << "Line " << __LINE__ << ": Only " << numberOfIntervals
+              << " intervals crossed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The entry point inside a labeled voxel gives an empty interval there
+  vtkSlicerPathExplorerLogic::LabelIntervalList& point = intervals[3];
+  for (size_t i = 0; i < point.size(); ++i)
+    {
+    if (point[i].Label == 0 || point[i].Enter != 0.0 || point[i].Exit != 0.0)
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory of length 0 has interval "
+                << point[i].Enter << " " << point[i].Exit << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkSlicerPathExplorerLogic.h"
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkNew.h>
+#include <vtkObject.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+const char* const ModifiedCallback = "qSlicerPathExplorerFiducialTableModel::onFiducialModified";
+const char* const DeletedCallback = "qSlicerPathExplorerFiducialTableModel::onFiducialDeleted";
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerObserverRegistryTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkSlicerPathExplorerLogic* logic = vtkSlicerPathExplorerLogic::New();
+  vtkObject* object = vtkObject::New();
+  vtkObject* otherObject = vtkObject::New();
+  // Observers are only identified by their address
+  int observer = 0;
+  int otherObserver = 0;
+
+  // An observation is registered once: the second registration must not be
+  // connected
+  if (!logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, ModifiedCallback) ||
+      logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, ModifiedCallback) ||
+      logic->GetNumberOfObservers(object) != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Observation registered twice, "
+              << logic->GetNumberOfObservers(object) << " observers" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Observations differing by event, observer or callback are distinct
+  if (!logic->RegisterObserver(object, vtkCommand::DeleteEvent, &observer, ModifiedCallback) ||
+      !logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, DeletedCallback) ||
+      !logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &otherObserver, ModifiedCallback) ||
+      !logic->RegisterObserver(otherObject, vtkCommand::ModifiedEvent, &observer, ModifiedCallback) ||
+      logic->RegisterObserver(0, vtkCommand::ModifiedEvent, &observer, ModifiedCallback) ||
+      logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, 0))
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong registration" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (logic->GetNumberOfObservers(object) != 4 || logic->GetNumberOfObservers(otherObject) != 1 ||
+      logic->GetNumberOfObservers(0) != 0 || logic->GetNumberOfObservers() != 5 ||
+      logic->GetNumberOfObservedObjects() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfObservers()
+              << " observers of " << logic->GetNumberOfObservedObjects()
+              << " objects instead of 5 of 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Unknown observations are ignored
+  logic->UnregisterObserver(object, vtkCommand::ModifiedEvent, &observer, "Unknown");
+  logic->UnregisterObserver(object, vtkCommand::StartEvent, &observer, ModifiedCallback);
+  logic->UnregisterObserver(0, vtkCommand::ModifiedEvent, &observer, ModifiedCallback);
+  logic->UnregisterObserver(object, vtkCommand::ModifiedEvent, &observer, 0);
+  if (logic->GetNumberOfObservers() != 5)
+    {
+    std::cerr << "Line " << __LINE__ << ": Unknown observation unregistered" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An unregistered observation can be registered again
+  logic->UnregisterObserver(object, vtkCommand::ModifiedEvent, &observer, ModifiedCallback);
+  if (logic->GetNumberOfObservers(object) != 3 ||
+      !logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, ModifiedCallback))
+    {
+    std::cerr << "Line " << __LINE__ << ": Observation not unregistered" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An object is no longer observed by the registry when its last
+  // observation is unregistered
+  logic->UnregisterObserver(otherObject, vtkCommand::ModifiedEvent, &observer, ModifiedCallback);
+  if (logic->GetNumberOfObservedObjects() != 1 ||
+      otherObject->HasObserver(vtkCommand::DeleteEvent) ||
+      !object->HasObserver(vtkCommand::DeleteEvent))
+    {
+    std::cerr << "Line " << __LINE__ << ": Object still observed, "
+              << logic->GetNumberOfObservedObjects() << " objects" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A destroyed observer unregisters all its observations at once
+  logic->RegisterObserver(otherObject, vtkCommand::ModifiedEvent, &otherObserver, ModifiedCallback);
+  logic->UnregisterObservers(&observer);
+  if (logic->GetNumberOfObservers(object) != 1 || logic->GetNumberOfObservers(otherObject) != 1 ||
+      logic->GetNumberOfObservedObjects() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": Observer not unregistered, "
+              << logic->GetNumberOfObservers() << " observers" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->UnregisterObservers(&otherObserver);
+  if (logic->GetNumberOfObservers() != 0 || logic->GetNumberOfObservedObjects() != 0 ||
+      object->HasObserver(vtkCommand::DeleteEvent) ||
+      otherObject->HasObserver(vtkCommand::DeleteEvent))
+    {
+    std::cerr << "Line " << __LINE__ << ": Observers not unregistered, "
+              << logic->GetNumberOfObservers() << " observers" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Observations of a deleted object are dropped on its DeleteEvent
+  logic->RegisterObserver(object, vtkCommand::ModifiedEvent, &observer, ModifiedCallback);
+  logic->RegisterObserver(object, vtkCommand::DeleteEvent, &observer, DeletedCallback);
+  logic->RegisterObserver(otherObject, vtkCommand::ModifiedEvent, &observer, ModifiedCallback);
+  object->Delete();
+  object = 0;
+  if (logic->GetNumberOfObservers() != 1 || logic->GetNumberOfObservedObjects() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfObservers()
+              << " observers left after DeleteEvent instead of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Callbacks are counted and timed by name
+  logic->CallbackInvoked(ModifiedCallback, 0.5);
+  logic->CallbackInvoked(ModifiedCallback, 0.25);
+  logic->CallbackInvoked(ModifiedCallback, 0.25);
+  logic->CallbackInvoked(DeletedCallback, 0.125);
+  logic->CallbackInvoked(0, 1.0);
+  if (logic->GetNumberOfCallbacks(ModifiedCallback) != 3 ||
+      logic->GetCallbackTime(ModifiedCallback) != 1.0 ||
+      logic->GetNumberOfCallbacks(DeletedCallback) != 1 ||
+      logic->GetCallbackTime(DeletedCallback) != 0.125 ||
+      logic->GetNumberOfCallbacks("Unknown") != 0 || logic->GetCallbackTime("Unknown") != 0.0 ||
+      logic->GetNumberOfCallbacks(0) != 0 ||
+      logic->GetCallbacksPerSecond(ModifiedCallback) < 0.0 ||
+      logic->GetCallbacksPerSecond("Unknown") != 0.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfCallbacks(ModifiedCallback)
+              << " callbacks in " << logic->GetCallbackTime(ModifiedCallback)
+              << " s instead of 3 in 1 s" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->ResetCallbackCounters();
+  if (logic->GetNumberOfCallbacks(ModifiedCallback) != 0 ||
+      logic->GetCallbackTime(ModifiedCallback) != 0.0 ||
+      logic->GetCallbacksPerSecond(ModifiedCallback) != 0.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Callback counters not reset" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Objects outliving the logic are no longer observed by it
+  logic->Delete();
+  if (otherObject->HasObserver(vtkCommand::DeleteEvent))
+    {
+    std::cerr << "Line " << __LINE__ << ": Object still observed by the deleted logic" << std::endl;
+    return EXIT_FAILURE;
+    }
+  otherObject->Delete();
+  return EXIT_SUCCESS;
+}
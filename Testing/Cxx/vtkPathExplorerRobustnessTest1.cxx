@@ -0,0 +1,282 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTaskScheduler.h"
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::SameValue;
+
+const int Dimension = 40;
+const int NumberOfSamples = 2000;
+// Trajectories: ending 2 mm before the wall (label 1, from x = 29.5 mm),
+// through the ball (label 2) and far from both
+const double Entries[3][3] = { { 5.0, 5.0, 5.0 }, { 5.0, 20.0, 20.0 }, { 5.0, 35.0, 5.0 } };
+const double Targets[3][3] = { { 27.5, 5.0, 5.0 }, { 25.0, 20.0, 20.0 }, { 20.0, 35.0, 5.0 } };
+
+//----------------------------------------------------------------------------
+bool SameRobustness(const vtkSlicerPathExplorerLogic::TrajectoryRobustness& a,
+                    const vtkSlicerPathExplorerLogic::TrajectoryRobustness& b)
+{
+  return a.CollisionProbability == b.CollisionProbability &&
+         a.HitProbabilities == b.HitProbabilities &&
+         SameValue(a.MeanClearance, b.MeanClearance) &&
+         SameValue(a.RobustClearance, b.RobustClearance);
+}
+
+//----------------------------------------------------------------------------
+double GetHitProbability(const vtkSlicerPathExplorerLogic::TrajectoryRobustness& robustness,
+                         int label)
+{
+  for (size_t i = 0; i < robustness.HitProbabilities.size(); ++i)
+    {
+    if (robustness.HitProbabilities[i].first == label)
+      {
+      return robustness.HitProbabilities[i].second;
+      }
+    }
+  return 0.0;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerRobustnessTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+
+  // 1 mm voxels, the voxel centers are at integer RAS coordinates
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(Dimension, Dimension, Dimension);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  for (int k = 0; k < Dimension; ++k)
+    {
+    for (int j = 0; j < Dimension; ++j)
+      {
+      for (int i = 0; i < Dimension; ++i)
+        {
+        double y = j - 20.0;
+        double z = k - 20.0;
+        double x = i - 15.0;
+        labels[(k * Dimension + j) * Dimension + i] =
+          i >= 30 ? 1 : (x * x + y * y + z * z <= 25.0 ? 2 : 0);
+        }
+      }
+    }
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  vtkNew<vtkMRMLScalarVolumeNode> labelMapNode;
+  labelMapNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+  labelMapNode->SetAndObserveImageData(image.GetPointer());
+  scene->AddNode(labelMapNode.GetPointer());
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  for (int t = 0; t < 3; ++t)
+    {
+    trajectoryList->AddTrajectory(Entries[t], Targets[t]);
+    }
+
+  // Target errors only, 2 mm along x and 1 mm across
+  const double entryCovariance[9] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  const double targetCovariance[9] = { 4.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+  logic->SetEntryErrorCovariance(entryCovariance);
+  logic->SetTargetErrorCovariance(targetCovariance);
+  logic->SetRobustnessNumberOfSamples(NumberOfSamples);
+  logic->SetRobustnessSeed(1234);
+  logic->SetNumberOfSamplingThreads(1);
+  vtkSlicerPathExplorerLogic::TrajectoryRobustnessList results;
+  if (!logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(), results) ||
+      results.size() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << ": AnalyzeRobustness failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The wall is hit when the target moves by more than one standard
+  // deviation along x: 1 - Phi(1) = 0.159
+  if (fabs(results[0].CollisionProbability - 0.159) > 0.03 ||
+      results[0].HitProbabilities.size() != 1 ||
+      GetHitProbability(results[0], 1) != results[0].CollisionProbability)
+    {
+    std::cerr << "Line " << __LINE__ << ": Wall hit with probability "
+              << results[0].CollisionProbability << std::endl;
+    return EXIT_FAILURE;
+    }
+  // The ball is always hit, the wall 2.25 standard deviations away seldom
+  if (results[1].CollisionProbability != 1.0 || GetHitProbability(results[1], 2) != 1.0 ||
+      GetHitProbability(results[1], 1) > 0.03 || results[1].RobustClearance >= 0.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Ball hit with probability "
+              << GetHitProbability(results[1], 2) << ", wall "
+              << GetHitProbability(results[1], 1) << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (results[2].CollisionProbability != 0.0 || !results[2].HitProbabilities.empty() ||
+      !(results[2].RobustClearance > 5.0) ||
+      !(results[2].MeanClearance >= results[2].RobustClearance))
+    {
+    std::cerr << "Line " << __LINE__ << ": Far trajectory hit with probability "
+              << results[2].CollisionProbability << ", robust clearance "
+              << results[2].RobustClearance << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Results are stored in the metrics of the list
+  int collisionMetric = trajectoryList->GetMetricIndex("CollisionProbability");
+  int hitMetric = trajectoryList->GetMetricIndex("HitProbability_2");
+  int clearanceMetric = trajectoryList->GetMetricIndex("RobustClearance");
+  if (collisionMetric < 0 || hitMetric < 0 || clearanceMetric < 0 ||
+      trajectoryList->GetMetricValue(0, collisionMetric) != results[0].CollisionProbability ||
+      trajectoryList->GetMetricValue(1, hitMetric) != 1.0 ||
+      trajectoryList->GetMetricValue(2, clearanceMetric) != results[2].RobustClearance)
+    {
+    std::cerr << "Line " << __LINE__ << ": Robustness metrics not stored" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Same seed, same results whatever the number of threads
+  vtkSlicerPathExplorerLogic::TrajectoryRobustnessList otherResults;
+  logic->SetNumberOfSamplingThreads(4);
+  logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(), otherResults);
+  for (int t = 0; t < 3; ++t)
+    {
+    if (!SameRobustness(results[t], otherResults[t]))
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << t
+                << " not reproducible with 4 threads" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // In the background, the metrics are stored when the task is finished
+  vtkPathExplorerTaskScheduler* scheduler = logic->GetTaskScheduler();
+  trajectoryList->SetMetricValue(0, collisionMetric, -1.0);
+  if (!logic->StartRobustnessAnalysis(trajectoryList.GetPointer(), labelMapNode.GetPointer()) ||
+      !logic->IsAnalyzingRobustness(trajectoryList.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": Robustness analysis not started" << std::endl;
+    return EXIT_FAILURE;
+    }
+  scheduler->WaitAll();
+  scheduler->ProcessFinishedTasks();
+  if (logic->IsAnalyzingRobustness(trajectoryList.GetPointer()) ||
+      trajectoryList->GetMetricValue(0, collisionMetric) != results[0].CollisionProbability)
+    {
+    std::cerr << "Line " << __LINE__ << ": Background analysis stored "
+              << trajectoryList->GetMetricValue(0, collisionMetric) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A canceled analysis stores nothing
+  trajectoryList->SetMetricValue(0, collisionMetric, -1.0);
+  logic->StartRobustnessAnalysis(trajectoryList.GetPointer(), labelMapNode.GetPointer());
+  logic->CancelRobustnessAnalysis(trajectoryList.GetPointer());
+  scheduler->WaitAll();
+  scheduler->ProcessFinishedTasks();
+  if (logic->IsAnalyzingRobustness(trajectoryList.GetPointer()) ||
+      trajectoryList->GetMetricValue(0, collisionMetric) != -1.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Canceled analysis stored "
+              << trajectoryList->GetMetricValue(0, collisionMetric) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Another seed draws other perturbations
+  logic->SetRobustnessSeed(4321);
+  logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(), otherResults);
+  if (otherResults[0].CollisionProbability == results[0].CollisionProbability &&
+      otherResults[0].MeanClearance == results[0].MeanClearance)
+    {
+    std::cerr << "Line " << __LINE__ << ": Same results with another seed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (fabs(otherResults[0].CollisionProbability - 0.159) > 0.03)
+    {
+    std::cerr << "Line " << __LINE__ << ": Wall hit with probability "
+              << otherResults[0].CollisionProbability << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The perturbations of a trajectory follow its UID, not its row
+  logic->SetRobustnessSeed(1234);
+  trajectoryList->RemoveTrajectory(1);
+  logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(), otherResults);
+  if (otherResults.size() != 2 || !SameRobustness(results[0], otherResults[0]) ||
+      !SameRobustness(results[2], otherResults[1]))
+    {
+    std::cerr << "Line " << __LINE__ << ": Results depend on the rows" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without errors, the clearance is the clearance of the trajectory
+  logic->SetPositionErrorStandardDeviation(0.0);
+  logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(), otherResults);
+  logic->ComputeClearance(trajectoryList.GetPointer(), labelMapNode.GetPointer());
+  int clearance = trajectoryList->GetMetricIndex(vtkSlicerPathExplorerLogic::GetClearanceMetricName());
+  for (int t = 0; t < 2; ++t)
+    {
+    if (otherResults[t].CollisionProbability != 0.0 ||
+        otherResults[t].RobustClearance != trajectoryList->GetMetricValue(t, clearance) ||
+        otherResults[t].MeanClearance != otherResults[t].RobustClearance)
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << t << " robust clearance "
+                << otherResults[t].RobustClearance << " instead of "
+                << trajectoryList->GetMetricValue(t, clearance) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A covariance must be positive semi-definite
+  const double invalidCovariance[9] = { 1.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 1.0 };
+  logic->SetTargetErrorCovariance(invalidCovariance);
+  if (logic->AnalyzeRobustness(trajectoryList.GetPointer(), labelMapNode.GetPointer(),
+                               otherResults))
+    {
+    std::cerr << "Line " << __LINE__ << ": Invalid covariance accepted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
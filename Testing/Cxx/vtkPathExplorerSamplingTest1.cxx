@@ -0,0 +1,366 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLScalarVolumeNode.h>
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+using vtkPathExplorerTestingUtilities::SameValue;
+
+const int NumberOfTrajectories = 200;
+const double SamplingStep = 0.75;
+
+//----------------------------------------------------------------------------
+void CountModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(event),
+                   void* clientData, void* vtkNotUsed(callData))
+{
+  ++*reinterpret_cast<int*>(clientData);
+}
+
+//----------------------------------------------------------------------------
+// Reference: trilinear interpolation of the first component at an IJK
+// point, NaN outside the volume
+template <class T>
+double Interpolate(const T* scalars, const int dimensions[3], int numberOfComponents,
+                   const double point[3])
+{
+  int cell[3];
+  double weight[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    if (!(point[i] >= 0.0 && point[i] <= dimensions[i] - 1.0))
+      {
+      return std::numeric_limits<double>::quiet_NaN();
+      }
+    cell[i] = std::min(static_cast<int>(floor(point[i])), dimensions[i] - 2);
+    weight[i] = point[i] - cell[i];
+    }
+  double value = 0.0;
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    double cornerWeight = 1.0;
+    int index[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      int bit = (corner >> i) & 1;
+      cornerWeight *= bit ? weight[i] : 1.0 - weight[i];
+      index[i] = cell[i] + bit;
+      }
+    int voxel = index[0] + dimensions[0] * (index[1] + dimensions[1] * index[2]);
+    value += cornerWeight * scalars[voxel * numberOfComponents];
+    }
+  return value;
+}
+
+//----------------------------------------------------------------------------
+// Reference: volume interpolated every SamplingStep mm from entry to target
+void SampleVolume(vtkMRMLScalarVolumeNode* volumeNode, const double entry[3],
+                  const double target[3], std::vector<double>& profile)
+{
+  vtkImageData* image = volumeNode->GetImageData();
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+
+  double direction[3] =
+    { target[0] - entry[0], target[1] - entry[1], target[2] - entry[2] };
+  double length = sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                       direction[2] * direction[2]);
+  int numberOfSamples = static_cast<int>(floor(length / SamplingStep)) + 1;
+  profile.resize(numberOfSamples);
+  for (int sample = 0; sample < numberOfSamples; ++sample)
+    {
+    double point[4] = { entry[0], entry[1], entry[2], 1.0 };
+    for (int i = 0; length > 0.0 && i < 3; ++i)
+      {
+      point[i] += direction[i] * sample * SamplingStep / length;
+      }
+    rasToIJK->MultiplyPoint(point, point);
+    if (image->GetScalarType() == VTK_FLOAT)
+      {
+      profile[sample] = Interpolate(static_cast<float*>(image->GetScalarPointer()), dimensions,
+                                    image->GetNumberOfScalarComponents(), point);
+      }
+    else
+      {
+      profile[sample] = Interpolate(static_cast<short*>(image->GetScalarPointer()), dimensions,
+                                    image->GetNumberOfScalarComponents(), point);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Return the line of the first difference with the reference profiles, 0
+// if none. Samples of the volumes are interleaved.
+int CheckSamples(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                 const std::vector<vtkMRMLScalarVolumeNode*>& volumeNodes)
+{
+  int numberOfVolumes = static_cast<int>(volumeNodes.size());
+  for (int row = 0; row < trajectoryList->GetNumberOfTrajectories(); ++row)
+    {
+    double entry[3];
+    double target[3];
+    trajectoryList->GetEntryPosition(row, entry);
+    trajectoryList->GetTargetPosition(row, target);
+    const double* samples = trajectoryList->GetTrajectorySamples(row);
+    int numberOfSamples = trajectoryList->GetNumberOfTrajectorySamples(row);
+    if (!samples || trajectoryList->GetNumberOfTrajectorySampleComponents(row) != numberOfVolumes)
+      {
+      return __LINE__;
+      }
+    for (int v = 0; v < numberOfVolumes; ++v)
+      {
+      std::vector<double> expected;
+      SampleVolume(volumeNodes[v], entry, target, expected);
+      if (numberOfSamples != static_cast<int>(expected.size()))
+        {
+        return __LINE__;
+        }
+      for (int sample = 0; sample < numberOfSamples; ++sample)
+        {
+        double value = samples[sample * numberOfVolumes + v];
+        if ((value != value) != (expected[sample] != expected[sample]) ||
+            fabs(value - expected[sample]) > 1e-6 * (1.0 + fabs(expected[sample])))
+          {
+          std::cerr << "Trajectory " << row << ", volume " << v << ", sample " << sample
+                    << ": " << value << " instead of " << expected[sample] << std::endl;
+          return __LINE__;
+          }
+        }
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* CreateVolumeNode(vtkImageData* image, const double spacing[3],
+                                          double angle, const double origin[3])
+{
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  const double c = cos(angle);
+  const double s = sin(angle);
+  const double rotation[3][3] = { { c, -s, 0.0 }, { s, c, 0.0 }, { 0.0, 0.0, 1.0 } };
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      ijkToRAS->SetElement(i, j, rotation[i][j] * spacing[j]);
+      }
+    ijkToRAS->SetElement(i, 3, origin[i]);
+    }
+  vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::New();
+  volumeNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+  volumeNode->SetAndObserveImageData(image);
+  return volumeNode;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerSamplingTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+  logic->SetSamplingStep(SamplingStep);
+  unsigned int seed = 1;
+
+  // A CT-like volume and a two-component float volume, with different
+  // geometries: only the first component of the second one is sampled
+  vtkNew<vtkImageData> ctImage;
+  ctImage->SetDimensions(30, 25, 20);
+  ctImage->SetScalarTypeToShort();
+  ctImage->SetNumberOfScalarComponents(1);
+  ctImage->AllocateScalars();
+  short* ctScalars = static_cast<short*>(ctImage->GetScalarPointer());
+  for (int voxel = 0; voxel < 30 * 25 * 20; ++voxel)
+    {
+    ctScalars[voxel] = static_cast<short>(Random(seed) * 4000.0 - 1000.0);
+    }
+  const double ctSpacing[3] = { 0.9, 0.9, 2.0 };
+  const double ctOrigin[3] = { -12.0, -10.0, -18.0 };
+  vtkMRMLScalarVolumeNode* ctNode = CreateVolumeNode(ctImage.GetPointer(), ctSpacing, 0.0, ctOrigin);
+
+  vtkNew<vtkImageData> floatImage;
+  floatImage->SetDimensions(12, 17, 9);
+  floatImage->SetScalarTypeToFloat();
+  floatImage->SetNumberOfScalarComponents(2);
+  floatImage->AllocateScalars();
+  float* floatScalars = static_cast<float*>(floatImage->GetScalarPointer());
+  for (int value = 0; value < 2 * 12 * 17 * 9; ++value)
+    {
+    floatScalars[value] = static_cast<float>(value % 2 ? 1e6 : Random(seed) * 2.0 - 1.0);
+    }
+  const double floatSpacing[3] = { 2.5, 1.5, 3.0 };
+  const double floatOrigin[3] = { -5.0, -15.0, -12.0 };
+  vtkMRMLScalarVolumeNode* floatNode =
+    CreateVolumeNode(floatImage.GetPointer(), floatSpacing, 0.6, floatOrigin);
+
+  std::vector<vtkMRMLScalarVolumeNode*> volumeNodes;
+  volumeNodes.push_back(ctNode);
+  volumeNodes.push_back(floatNode);
+  vtkNew<vtkCollection> volumeCollection;
+  volumeCollection->AddItem(ctNode);
+  volumeCollection->AddItem(floatNode);
+
+  // Trajectories inside, crossing and outside the volumes, and a
+  // degenerate one with a single sample
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  for (int i = 0; i < NumberOfTrajectories; ++i)
+    {
+    double entry[3];
+    double target[3];
+    for (int j = 0; j < 3; ++j)
+      {
+      entry[j] = Random(seed) * 80.0 - 40.0;
+      target[j] = Random(seed) * 40.0 - 20.0;
+      }
+    trajectoryList->AddTrajectory(entry, target);
+    }
+  const double outsideEntry[3] = { 100.0, 100.0, 100.0 };
+  const double outsideTarget[3] = { 120.0, 90.0, 100.0 };
+  trajectoryList->AddTrajectory(outsideEntry, outsideTarget);
+  const double point[3] = { 1.3, -2.1, 0.7 };
+  trajectoryList->AddTrajectory(point, point);
+
+  // Profiles of all the volumes are stored at once
+  int modified = 0;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(CountModified);
+  callback->SetClientData(&modified);
+  trajectoryList->AddObserver(vtkCommand::ModifiedEvent, callback.GetPointer());
+  if (!logic->SampleTrajectories(trajectoryList.GetPointer(), volumeCollection.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": SampleTrajectories failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int line = CheckSamples(trajectoryList.GetPointer(), volumeNodes);
+  if (line || modified != 1)
+    {
+    std::cerr << "Line " << (line ? line : __LINE__) << ": Wrong profiles, "
+              << modified << " ModifiedEvent" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Samples outside the volumes are NaN
+  int outsideRow = NumberOfTrajectories;
+  int numberOfOutsideSamples = trajectoryList->GetNumberOfTrajectorySamples(outsideRow);
+  const double* outsideSamples = trajectoryList->GetTrajectorySamples(outsideRow);
+  if (numberOfOutsideSamples != static_cast<int>(floor(sqrt(500.0) / SamplingStep)) + 1 ||
+      trajectoryList->GetNumberOfTrajectorySamples(outsideRow + 1) != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << numberOfOutsideSamples
+              << " samples outside the volumes" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int sample = 0; sample < 2 * numberOfOutsideSamples; ++sample)
+    {
+    if (outsideSamples[sample] == outsideSamples[sample])
+      {
+      std::cerr << "Line " << __LINE__ << ": Sample " << sample << " outside the volumes is "
+                << outsideSamples[sample] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The number of threads doesn't change the profiles
+  logic->SetNumberOfSamplingThreads(1);
+  trajectoryList->SetTrajectorySamples(0, 0, 0, 0);
+  if (!logic->SampleTrajectories(trajectoryList.GetPointer(), volumeCollection.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": SampleTrajectories failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  line = CheckSamples(trajectoryList.GetPointer(), volumeNodes);
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Wrong profiles with a single thread" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->SetNumberOfSamplingThreads(0);
+
+  // A single volume gives single component profiles
+  if (!logic->SampleTrajectories(trajectoryList.GetPointer(), floatNode))
+    {
+    std::cerr << "Line " << __LINE__ << ": SampleTrajectories failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  line = CheckSamples(trajectoryList.GetPointer(), std::vector<vtkMRMLScalarVolumeNode*>(1, floatNode));
+  if (line)
+    {
+    std::cerr << "Line " << line << ": Wrong profiles of a single volume" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Nothing is sampled without a list, a volume, an image or a valid step,
+  // and the profiles are left untouched
+  std::vector<double> samples(trajectoryList->GetTrajectorySamples(0),
+                              trajectoryList->GetTrajectorySamples(0) +
+                              trajectoryList->GetNumberOfTrajectorySamples(0));
+  vtkNew<vtkCollection> emptyCollection;
+  vtkNew<vtkMRMLScalarVolumeNode> emptyVolumeNode;
+  vtkNew<vtkCollection> invalidCollection;
+  invalidCollection->AddItem(ctNode);
+  invalidCollection->AddItem(emptyVolumeNode.GetPointer());
+  if (logic->SampleTrajectories(0, ctNode) ||
+      logic->SampleTrajectories(trajectoryList.GetPointer(), static_cast<vtkMRMLVolumeNode*>(0)) ||
+      logic->SampleTrajectories(trajectoryList.GetPointer(), emptyCollection.GetPointer()) ||
+      logic->SampleTrajectories(trajectoryList.GetPointer(), invalidCollection.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << ": Invalid input sampled" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->SetSamplingStep(0.0);
+  if (logic->SampleTrajectories(trajectoryList.GetPointer(), ctNode) ||
+      trajectoryList->GetNumberOfTrajectorySampleComponents(0) != 1 ||
+      !std::equal(samples.begin(), samples.end(), trajectoryList->GetTrajectorySamples(0), SameValue))
+    {
+    std::cerr << "Line " << __LINE__ << ": Profiles modified by an invalid sampling" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ctNode->Delete();
+  floatNode->Delete();
+  return EXIT_SUCCESS;
+}
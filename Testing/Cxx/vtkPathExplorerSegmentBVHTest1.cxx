@@ -0,0 +1,369 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerSegmentBVH.h"
+#include "vtkPathExplorerTrajectorySpacing.h"
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+using vtkPathExplorerTestingUtilities::Dot;
+using vtkPathExplorerTestingUtilities::PointSegmentDistance;
+
+const int NumberOfSegments = 2000;
+const int NumberOfQueries = 300;
+const int NumberOfTrajectories = 200;
+const double Size = 100.0;
+const double Tolerance = 1e-6;
+
+//----------------------------------------------------------------------------
+// Reference: the distance from a point of p0 p1 to the segment a b is
+// convex along p0 p1, its minimum is found by golden-section search.
+double SegmentSegmentDistance(const double* p0, const double* p1,
+                              const double* a, const double* b)
+{
+  const double ratio = 0.5 * (sqrt(5.0) - 1.0);
+  double s0 = 0.0;
+  double s1 = 1.0;
+  double closest = std::min(PointSegmentDistance(p0, a, b), PointSegmentDistance(p1, a, b));
+  for (int iteration = 0; iteration < 80; ++iteration)
+    {
+    double sa = s1 - ratio * (s1 - s0);
+    double sb = s0 + ratio * (s1 - s0);
+    double pa[3];
+    double pb[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      pa[i] = p0[i] + sa * (p1[i] - p0[i]);
+      pb[i] = p0[i] + sb * (p1[i] - p0[i]);
+      }
+    double da = PointSegmentDistance(pa, a, b);
+    double db = PointSegmentDistance(pb, a, b);
+    closest = std::min(closest, std::min(da, db));
+    if (da < db)
+      {
+      s1 = sb;
+      }
+    else
+      {
+      s0 = sa;
+      }
+    }
+  return closest;
+}
+
+//----------------------------------------------------------------------------
+// Lower bound of the distance between two segments: distance between their
+// bounding boxes
+double BoxDistance(const double* p0, const double* p1, const double* a, const double* b)
+{
+  double distance2 = 0.0;
+  for (int i = 0; i < 3; ++i)
+    {
+    double gap = std::max(std::min(a[i], b[i]) - std::max(p0[i], p1[i]),
+                          std::min(p0[i], p1[i]) - std::max(a[i], b[i]));
+    if (gap > 0.0)
+      {
+      distance2 += gap * gap;
+      }
+    }
+  return sqrt(distance2);
+}
+
+//----------------------------------------------------------------------------
+// Random segments up to 30 mm long, a few of them degenerate or parallel
+void RandomSegments(unsigned int& seed, int numberOfSegments,
+                    std::vector<double>& starts, std::vector<double>& ends)
+{
+  starts.resize(3 * numberOfSegments);
+  ends.resize(3 * numberOfSegments);
+  for (int s = 0; s < numberOfSegments; ++s)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      starts[3 * s + i] = Size * Random(seed);
+      ends[3 * s + i] = starts[3 * s + i] + 30.0 * (Random(seed) - 0.5);
+      }
+    if (s % 50 == 7)
+      {
+      std::copy(&starts[3 * s], &starts[3 * s] + 3, &ends[3 * s]);
+      }
+    else if (s % 50 == 11 && s > 0)
+      {
+      for (int i = 0; i < 3; ++i)
+        {
+        ends[3 * s + i] = starts[3 * s + i] + ends[3 * s - 3 + i] - starts[3 * s - 3 + i];
+        }
+      }
+    }
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerSegmentBVHTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  unsigned int seed = 7;
+  std::vector<double> starts;
+  std::vector<double> ends;
+  RandomSegments(seed, NumberOfSegments, starts, ends);
+
+  vtkPathExplorerSegmentBVH bvh;
+  bvh.Build(&starts[0], &ends[0], NumberOfSegments);
+  if (bvh.GetNumberOfSegments() != NumberOfSegments)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << bvh.GetNumberOfSegments()
+              << " segments" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Queries: random segments, then segments of the hierarchy excluding
+  // themselves
+  std::vector<double> queryStarts;
+  std::vector<double> queryEnds;
+  RandomSegments(seed, NumberOfQueries, queryStarts, queryEnds);
+  for (int q = 0; q < 2 * NumberOfQueries; ++q)
+    {
+    bool own = q >= NumberOfQueries;
+    vtkIdType excluded = own ? (q - NumberOfQueries) * 5 : -1;
+    const double* p0 = own ? &starts[3 * excluded] : &queryStarts[3 * q];
+    const double* p1 = own ? &ends[3 * excluded] : &queryEnds[3 * q];
+
+    // Reference distances, only bounded below for the segments farther
+    // than within (which is more than the closest distance)
+    const double within = 10.0;
+    std::vector<double> reference(NumberOfSegments);
+    double closest = VTK_DOUBLE_MAX;
+    for (int s = 0; s < NumberOfSegments; ++s)
+      {
+      reference[s] = BoxDistance(p0, p1, &starts[3 * s], &ends[3 * s]);
+      if (reference[s] <= within)
+        {
+        reference[s] = SegmentSegmentDistance(p0, p1, &starts[3 * s], &ends[3 * s]);
+        }
+      if (s != excluded)
+        {
+        closest = std::min(closest, reference[s]);
+        }
+      }
+    if (closest > within - 2.0)
+      {
+      std::cerr << "Line " << __LINE__ << ": Query " << q << " too far from the segments"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    vtkIdType segment = -1;
+    double distance = bvh.FindClosestSegment(p0, p1, excluded, VTK_DOUBLE_MAX, segment);
+    if (segment < 0 || segment == excluded || fabs(distance - closest) > Tolerance ||
+        fabs(reference[segment] - closest) > Tolerance)
+      {
+      std::cerr << "Line " << __LINE__ << ": Query " << q << " closest segment "
+                << segment << " at " << distance << " instead of " << closest << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Bounded search: nothing found below the closest distance
+    double bound = closest + 2.0;
+    distance = bvh.FindClosestSegment(p0, p1, excluded, bound, segment);
+    if (segment < 0 || fabs(distance - closest) > Tolerance)
+      {
+      std::cerr << "Line " << __LINE__ << ": Query " << q << " closest segment "
+                << segment << " at " << distance << " below " << bound << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (closest > Tolerance)
+      {
+      bound = 0.5 * closest;
+      distance = bvh.FindClosestSegment(p0, p1, excluded, bound, segment);
+      if (segment != -1 || distance != bound)
+        {
+        std::cerr << "Line " << __LINE__ << ": Query " << q << " segment " << segment
+                  << " found below " << bound << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    // Segments within distance: every segment clearly closer is found,
+    // clearly farther are not
+    std::vector<vtkIdType> segments;
+    std::vector<double> distances;
+    bvh.FindSegmentsWithinDistance(p0, p1, excluded, within, segments, distances);
+    if (segments.size() != distances.size())
+      {
+      std::cerr << "Line " << __LINE__ << ": " << segments.size() << " segments, "
+                << distances.size() << " distances" << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::vector<bool> found(NumberOfSegments, false);
+    for (size_t i = 0; i < segments.size(); ++i)
+      {
+      vtkIdType s = segments[i];
+      if (s < 0 || s >= NumberOfSegments || s == excluded || found[s] ||
+          fabs(distances[i] - reference[s]) > Tolerance || reference[s] > within + Tolerance)
+        {
+        std::cerr << "Line " << __LINE__ << ": Query " << q << " segment " << s
+                  << " found at " << distances[i] << std::endl;
+        return EXIT_FAILURE;
+        }
+      found[s] = true;
+      }
+    for (int s = 0; s < NumberOfSegments; ++s)
+      {
+      if (s != excluded && !found[s] && reference[s] < within - Tolerance)
+        {
+        std::cerr << "Line " << __LINE__ << ": Query " << q << " segment " << s
+                  << " at " << reference[s] << " not found" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Empty hierarchy
+  vtkPathExplorerSegmentBVH empty;
+  empty.Build(0, 0, 0);
+  vtkIdType segment = 0;
+  std::vector<vtkIdType> segments;
+  std::vector<double> distances;
+  empty.FindSegmentsWithinDistance(&starts[0], &ends[0], -1, Size, segments, distances);
+  if (empty.FindClosestSegment(&starts[0], &ends[0], -1, Size, segment) != Size ||
+      segment != -1 || !segments.empty())
+    {
+    std::cerr << "Line " << __LINE__ << ": Segment " << segment
+              << " found in an empty hierarchy" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Trajectory spacing against all the pairs
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    trajectoryList->AddTrajectory(&starts[3 * t], &ends[3 * t]);
+    }
+  const double minimumSpacing = 5.0;
+  logic->SetMinimumTrajectorySpacing(minimumSpacing);
+  vtkSlicerPathExplorerLogic::TrajectoryPairList violations;
+  if (!logic->ComputeTrajectorySpacing(trajectoryList.GetPointer(), violations))
+    {
+    std::cerr << "Line " << __LINE__ << ": ComputeTrajectorySpacing failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int spacingMetric = trajectoryList->GetMetricIndex("Spacing");
+  int violationsMetric = trajectoryList->GetMetricIndex("SpacingViolations");
+  if (spacingMetric < 0 || violationsMetric < 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Spacing metrics not stored" << std::endl;
+    return EXIT_FAILURE;
+    }
+  size_t violation = 0;
+  std::vector<int> numberOfViolations(NumberOfTrajectories, 0);
+  std::vector<double> spacings(NumberOfTrajectories, VTK_DOUBLE_MAX);
+  for (int row1 = 0; row1 < NumberOfTrajectories; ++row1)
+    {
+    for (int row2 = row1 + 1; row2 < NumberOfTrajectories; ++row2)
+      {
+      double distance = SegmentSegmentDistance(&starts[3 * row1], &ends[3 * row1],
+                                               &starts[3 * row2], &ends[3 * row2]);
+      spacings[row1] = std::min(spacings[row1], distance);
+      spacings[row2] = std::min(spacings[row2], distance);
+      if (fabs(distance - minimumSpacing) < Tolerance)
+        {
+        std::cerr << "Line " << __LINE__ << ": Ambiguous pair " << row1 << " "
+                  << row2 << std::endl;
+        return EXIT_FAILURE;
+        }
+      if (distance >= minimumSpacing)
+        {
+        continue;
+        }
+      ++numberOfViolations[row1];
+      ++numberOfViolations[row2];
+      if (violation >= violations.size() || violations[violation].Row1 != row1 ||
+          violations[violation].Row2 != row2 ||
+          fabs(violations[violation].Distance - distance) > Tolerance)
+        {
+        std::cerr << "Line " << __LINE__ << ": Violation " << row1 << " " << row2
+                  << " at " << distance << " not found" << std::endl;
+        return EXIT_FAILURE;
+        }
+      ++violation;
+      }
+    }
+  if (violation != violations.size() || violations.empty())
+    {
+    std::cerr << "Line " << __LINE__ << ": " << violations.size() << " violations instead of "
+              << violation << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int row = 0; row < NumberOfTrajectories; ++row)
+    {
+    if (fabs(trajectoryList->GetMetricValue(row, spacingMetric) - spacings[row]) > Tolerance ||
+        trajectoryList->GetMetricValue(row, violationsMetric) != numberOfViolations[row])
+      {
+      std::cerr << "Line " << __LINE__ << ": Trajectory " << row << " spacing "
+                << trajectoryList->GetMetricValue(row, spacingMetric) << " instead of "
+                << spacings[row] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Names are quoted in the CSV file, pairs of unknown rows are skipped
+  vtkPathExplorerTrajectorySpacing::TrajectoryPairList pairs(2);
+  pairs[0].Row1 = 0;
+  pairs[0].Row2 = 1;
+  pairs[0].Distance = 0.5;
+  pairs[1].Row1 = 0;
+  pairs[1].Row2 = 2;
+  pairs[1].Distance = 1.0;
+  std::vector<std::string> names;
+  names.push_back("T1, left");
+  names.push_back("T2 \"deep\"");
+  std::ostringstream csv;
+  vtkPathExplorerTrajectorySpacing::WritePairs(csv, pairs, names);
+  if (csv.str() != "Trajectory1,Trajectory2,Distance\n\"T1, left\",\"T2 \"\"deep\"\"\",0.5\n")
+    {
+    std::cerr << "Line " << __LINE__ << ": Wrong CSV file:\n" << csv.str() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
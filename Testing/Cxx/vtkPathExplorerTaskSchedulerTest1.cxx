@@ -0,0 +1,258 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTaskScheduler.h"
+
+// VTK includes
+#include <vtkMutexLock.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// What happened to the tasks, shared with the workers
+struct TaskLog
+{
+  TaskLog() : NumberOfRuns(0), NumberOfDeletedTasks(0), NumberOfCallbacks(0) {}
+
+  int GetNumberOfRuns()
+    {
+    this->Lock.Lock();
+    int numberOfRuns = this->NumberOfRuns;
+    this->Lock.Unlock();
+    return numberOfRuns;
+    }
+
+  vtkSimpleMutexLock Lock;
+  int NumberOfRuns;
+  int NumberOfDeletedTasks;
+  int NumberOfCallbacks;
+  // Main thread only: names of the finished tasks, with a "~" when canceled
+  std::vector<std::string> Finished;
+};
+
+//----------------------------------------------------------------------------
+// Task running until it is released or canceled
+class TestTask : public vtkPathExplorerTask
+{
+public:
+  TestTask(TaskLog* log, const char* name, bool blocking = false)
+    : Log(log), Name(name), Blocking(blocking), Started(false), Released(false) {}
+  virtual ~TestTask()
+    {
+    this->Log->Lock.Lock();
+    ++this->Log->NumberOfDeletedTasks;
+    this->Log->Lock.Unlock();
+    }
+
+  virtual void Run()
+    {
+    this->Lock.Lock();
+    this->Started = true;
+    this->Lock.Unlock();
+    this->Log->Lock.Lock();
+    ++this->Log->NumberOfRuns;
+    this->Log->Lock.Unlock();
+    this->SetProgress(0.5);
+    while (this->Blocking && !this->IsReleased() && !this->IsCanceled())
+      {
+      }
+    this->SetProgress(1.0);
+    }
+  virtual void Finish()
+    {
+    this->Log->Finished.push_back(this->IsCanceled() ? "~" + this->Name : this->Name);
+    }
+
+  bool IsStarted()
+    {
+    this->Lock.Lock();
+    bool started = this->Started;
+    this->Lock.Unlock();
+    return started;
+    }
+  void WaitForStart()
+    {
+    while (!this->IsStarted())
+      {
+      }
+    }
+  bool IsReleased()
+    {
+    this->Lock.Lock();
+    bool released = this->Released;
+    this->Lock.Unlock();
+    return released;
+    }
+  void Release()
+    {
+    this->Lock.Lock();
+    this->Released = true;
+    this->Lock.Unlock();
+    }
+
+protected:
+  TaskLog* Log;
+  std::string Name;
+  bool Blocking;
+  bool Started;
+  bool Released;
+};
+
+//----------------------------------------------------------------------------
+void TaskFinished(void* clientData)
+{
+  TaskLog* log = static_cast<TaskLog*>(clientData);
+  log->Lock.Lock();
+  ++log->NumberOfCallbacks;
+  log->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+std::string Join(const std::vector<std::string>& names)
+{
+  std::string joined;
+  for (size_t i = 0; i < names.size(); ++i)
+    {
+    joined += (i ? " " : "") + names[i];
+    }
+  return joined;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTaskSchedulerTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  TaskLog log;
+  {
+  // A single worker: the tasks submitted while A runs stay queued
+  vtkPathExplorerTaskScheduler scheduler;
+  scheduler.SetNumberOfWorkers(1);
+  scheduler.SetTaskFinishedCallback(TaskFinished, &log);
+  TestTask* a = new TestTask(&log, "A", true);
+  int aID = scheduler.Submit(a);
+  a->WaitForStart();
+
+  // B and C are superseded by D, E is canceled before it runs
+  scheduler.Submit(new TestTask(&log, "B"), "key");
+  scheduler.Submit(new TestTask(&log, "C"), "key");
+  int dID = scheduler.Submit(new TestTask(&log, "D"), "key");
+  int eID = scheduler.Submit(new TestTask(&log, "E"));
+  scheduler.Cancel(eID);
+  if (scheduler.ProcessFinishedTasks() != 3 || Join(log.Finished) != "~B ~C ~E" ||
+      log.GetNumberOfRuns() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Finished " << Join(log.Finished)
+              << " after " << log.GetNumberOfRuns() << " runs" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (scheduler.GetNumberOfPendingTasks() != 2 || !scheduler.IsPending(aID) ||
+      !scheduler.IsPending(dID) || scheduler.IsPending(eID) ||
+      scheduler.GetProgress(aID) != 0.5 || scheduler.GetProgress(dID) != 0.0 ||
+      scheduler.GetProgress() != 0.25 || scheduler.GetProgress(12345) != -1.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << scheduler.GetNumberOfPendingTasks()
+              << " pending tasks, progress " << scheduler.GetProgress() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Once A is released, D runs
+  a->Release();
+  scheduler.WaitAll();
+  if (log.GetNumberOfRuns() != 2 || scheduler.GetProgress(dID) != 1.0 ||
+      scheduler.ProcessFinishedTasks() != 2 ||
+      Join(log.Finished) != "~B ~C ~E A D" || scheduler.GetNumberOfPendingTasks() != 0 ||
+      scheduler.GetProgress() != 1.0)
+    {
+    std::cerr << "Line " << __LINE__ << ": Finished " << Join(log.Finished)
+              << " after " << log.GetNumberOfRuns() << " runs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A running task is canceled through its token, a new submission with
+  // its key supersedes it as well
+  TestTask* f = new TestTask(&log, "F", true);
+  int fID = scheduler.Submit(f);
+  f->WaitForStart();
+  scheduler.Cancel(fID);
+  scheduler.Wait(fID);
+  TestTask* g = new TestTask(&log, "G", true);
+  scheduler.Submit(g, "key");
+  g->WaitForStart();
+  scheduler.Submit(new TestTask(&log, "H"), "key");
+  scheduler.WaitAll();
+  if (scheduler.ProcessFinishedTasks() != 3 ||
+      Join(log.Finished) != "~B ~C ~E A D ~F ~G H")
+    {
+    std::cerr << "Line " << __LINE__ << ": Finished " << Join(log.Finished) << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (log.NumberOfCallbacks != 8 || log.NumberOfDeletedTasks != 8)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << log.NumberOfCallbacks << " callbacks, "
+              << log.NumberOfDeletedTasks << " tasks deleted" << std::endl;
+    return EXIT_FAILURE;
+    }
+  }
+
+  // Several workers run every task; tasks left are deleted without Finish
+  log.Finished.clear();
+  log.NumberOfRuns = 0;
+  log.NumberOfDeletedTasks = 0;
+  {
+  vtkPathExplorerTaskScheduler scheduler;
+  scheduler.SetNumberOfWorkers(4);
+  for (int i = 0; i < 20; ++i)
+    {
+    scheduler.Submit(new TestTask(&log, "I"));
+    }
+  scheduler.WaitAll();
+  if (log.GetNumberOfRuns() != 20 || scheduler.ProcessFinishedTasks() != 20 ||
+      log.Finished.size() != 20)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << log.GetNumberOfRuns() << " runs, "
+              << log.Finished.size() << " finished" << std::endl;
+    return EXIT_FAILURE;
+    }
+  TestTask* j = new TestTask(&log, "J", true);
+  scheduler.Submit(j);
+  j->WaitForStart();
+  for (int i = 0; i < 5; ++i)
+    {
+    scheduler.Submit(new TestTask(&log, "K", true));
+    }
+  }
+  if (log.Finished.size() != 20 || log.NumberOfDeletedTasks != 26)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << log.Finished.size() << " finished, "
+              << log.NumberOfDeletedTasks << " tasks deleted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
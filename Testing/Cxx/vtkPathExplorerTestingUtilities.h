@@ -0,0 +1,86 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+#ifndef __vtkPathExplorerTestingUtilities_h
+#define __vtkPathExplorerTestingUtilities_h
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/// Helpers shared by the PathExplorer tests.
+namespace vtkPathExplorerTestingUtilities
+{
+//----------------------------------------------------------------------------
+// Deterministic pseudo-random numbers in [0, 1)
+inline double Random(unsigned int& seed)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return (seed >> 8) / 16777216.0;
+}
+
+//----------------------------------------------------------------------------
+// Equal values, NaN included
+inline bool SameValue(double a, double b)
+{
+  return (a != a && b != b) || a == b;
+}
+
+//----------------------------------------------------------------------------
+inline double Dot(const double a[3], const double b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+//----------------------------------------------------------------------------
+// Distance from a point to the segment a b, possibly degenerate
+inline double PointSegmentDistance(const double p[3], const double* a, const double* b)
+{
+  double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+  double length2 = Dot(ab, ab);
+  double t = length2 > 0.0 ? std::max(0.0, std::min(1.0, Dot(ap, ab) / length2)) : 0.0;
+  double d[3] = { ap[0] - t * ab[0], ap[1] - t * ab[1], ap[2] - t * ab[2] };
+  return sqrt(Dot(d, d));
+}
+
+//----------------------------------------------------------------------------
+// Split the attributes written by WriteXML into the name/value list
+// expected by ReadXMLAttributes.
+inline void SplitAttributes(const std::string& xml, std::vector<std::string>& attributes)
+{
+  size_t start = 0;
+  size_t equal;
+  while ((equal = xml.find("=\"", start)) != std::string::npos)
+    {
+    size_t nameStart = xml.find_last_of(" \t\n", equal) + 1;
+    size_t end = xml.find('"', equal + 2);
+    attributes.push_back(xml.substr(nameStart, equal - nameStart));
+    attributes.push_back(xml.substr(equal + 2, end - equal - 2));
+    start = end + 1;
+    }
+}
+}
+
+#endif
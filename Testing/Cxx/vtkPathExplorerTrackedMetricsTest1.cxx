@@ -0,0 +1,341 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkSlicerPathExplorerLogic.h"
+
+// MRML includes
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+
+const int Dimension = 40;
+const double Spacing = 2.0;
+const double Origin = -40.0;
+const int NumberOfTrajectories = 300;
+const char* const ModelDistanceMetricName = "ModelDistance";
+
+//----------------------------------------------------------------------------
+// Label the voxels within radius of center
+void AddBall(vtkImageData* image, const double center[3], double radius, short label)
+{
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  for (int k = 0; k < Dimension; ++k)
+    {
+    for (int j = 0; j < Dimension; ++j)
+      {
+      for (int i = 0; i < Dimension; ++i)
+        {
+        double x = Origin + i * Spacing - center[0];
+        double y = Origin + j * Spacing - center[1];
+        double z = Origin + k * Spacing - center[2];
+        if (x * x + y * y + z * z < radius * radius)
+          {
+          labels[(k * Dimension + j) * Dimension + i] = label;
+          }
+        }
+      }
+    }
+  image->Modified();
+}
+
+//----------------------------------------------------------------------------
+void SetGeometry(vtkMRMLScalarVolumeNode* labelMapNode, double shift)
+{
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  for (int i = 0; i < 3; ++i)
+    {
+    ijkToRAS->SetElement(i, i, Spacing);
+    ijkToRAS->SetElement(i, 3, Origin + shift);
+    }
+  labelMapNode->SetIJKToRASMatrix(ijkToRAS.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+// Octahedron of radius 20 mm around the origin
+vtkPolyData* CreateOctahedron()
+{
+  vtkNew<vtkPoints> points;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    for (int side = -1; side <= 1; side += 2)
+      {
+      double point[3] = { 0.0, 0.0, 0.0 };
+      point[axis] = side * 20.0;
+      points->InsertNextPoint(point);
+      }
+    }
+  vtkNew<vtkCellArray> polys;
+  for (int x = 0; x < 2; ++x)
+    {
+    for (int y = 2; y < 4; ++y)
+      {
+      for (int z = 4; z < 6; ++z)
+        {
+        vtkIdType triangle[3] = { x, y, z };
+        polys->InsertNextCell(3, triangle);
+        }
+      }
+    }
+  vtkPolyData* polyData = vtkPolyData::New();
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetPolys(polys.GetPointer());
+  return polyData;
+}
+
+//----------------------------------------------------------------------------
+// Compare the tracked metrics of the list with the metrics computed now
+// on a copy; the first differing row, -1 if none
+int FindDifference(vtkSlicerPathExplorerLogic* logic,
+                   vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                   vtkMRMLScalarVolumeNode* labelMapNode, vtkMRMLModelNode* modelNode,
+                   bool clearance, bool modelDistance)
+{
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> reference;
+  for (int row = 0; row < trajectoryList->GetNumberOfTrajectories(); ++row)
+    {
+    double entry[3];
+    double target[3];
+    trajectoryList->GetEntryPosition(row, entry);
+    trajectoryList->GetTargetPosition(row, target);
+    reference->AddTrajectory(entry, target, "", "", "",
+                             vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    }
+  std::vector<double> distances;
+  if (!logic->ComputeClearance(reference.GetPointer(), labelMapNode) ||
+      !logic->ComputeModelDistances(reference.GetPointer(), modelNode, distances))
+    {
+    return 0;
+    }
+  int referenceClearance =
+    reference->GetMetricIndex(vtkSlicerPathExplorerLogic::GetClearanceMetricName());
+  int trackedClearance =
+    trajectoryList->GetMetricIndex(vtkSlicerPathExplorerLogic::GetClearanceMetricName());
+  int trackedDistance = trajectoryList->GetMetricIndex(ModelDistanceMetricName);
+  for (int row = 0; row < trajectoryList->GetNumberOfTrajectories(); ++row)
+    {
+    if (clearance &&
+        (trackedClearance < 0 ||
+         trajectoryList->GetMetricValue(row, trackedClearance) !=
+         reference->GetMetricValue(row, referenceClearance)))
+      {
+      return row;
+      }
+    if (modelDistance &&
+        (trackedDistance < 0 ||
+         trajectoryList->GetMetricValue(row, trackedDistance) != distances[row]))
+      {
+      return row;
+      }
+    }
+  return -1;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTrackedMetricsTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerPathExplorerLogic> logic;
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(Dimension, Dimension, Dimension);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* labels = static_cast<short*>(image->GetScalarPointer());
+  std::fill(labels, labels + Dimension * Dimension * Dimension, static_cast<short>(0));
+  const double ballCenter[3] = { 5.0, -3.0, 8.0 };
+  AddBall(image.GetPointer(), ballCenter, 7.0, 1);
+  vtkNew<vtkMRMLScalarVolumeNode> labelMapNode;
+  SetGeometry(labelMapNode.GetPointer(), 0.0);
+  labelMapNode->SetAndObserveImageData(image.GetPointer());
+  scene->AddNode(labelMapNode.GetPointer());
+
+  vtkPolyData* polyData = CreateOctahedron();
+  vtkNew<vtkMRMLModelNode> modelNode;
+  modelNode->SetAndObservePolyData(polyData);
+  polyData->Delete();
+  scene->AddNode(modelNode.GetPointer());
+
+  vtkNew<vtkMRMLPathPlannerTrajectoryNode> trajectoryList;
+  scene->AddNode(trajectoryList.GetPointer());
+  unsigned int seed = 1;
+  for (int t = 0; t < NumberOfTrajectories; ++t)
+    {
+    double entry[3];
+    double target[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      entry[i] = Random(seed) * 80.0 - 40.0;
+      target[i] = Random(seed) * 40.0 - 20.0;
+      }
+    trajectoryList->AddTrajectory(entry, target, "", "", "",
+                                  vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+    }
+
+  // Every value is computed once tracked
+  logic->TrackMetric(trajectoryList.GetPointer(),
+                     vtkSlicerPathExplorerLogic::GetClearanceMetricName(),
+                     vtkSlicerPathExplorerLogic::ClearanceMetric, labelMapNode.GetPointer());
+  logic->TrackMetric(trajectoryList.GetPointer(), ModelDistanceMetricName,
+                     vtkSlicerPathExplorerLogic::ModelDistanceMetric, modelNode.GetPointer());
+  if (logic->GetNumberOfTrackedMetrics(trajectoryList.GetPointer()) != 2 ||
+      !logic->HasPendingMetrics())
+    {
+    std::cerr << "Line " << __LINE__ << ": Metrics not tracked" << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->UpdateMetrics(true);
+  int row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                           labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (logic->HasPendingMetrics() ||
+      logic->GetNumberOfUpdatedMetricValues() != 2 * NumberOfTrajectories || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A moved trajectory only recomputes its own values
+  const double entry[3] = { 30.0, 30.0, 30.0 };
+  const double target[3] = { 5.0, -3.0, 8.0 };
+  trajectoryList->SetEntryPosition(17, entry);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (logic->GetNumberOfUpdatedMetricValues() != 2 || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Moved again while its values are computed: the last position counts
+  trajectoryList->SetEntryPosition(18, entry);
+  trajectoryList->SetTargetPosition(18, target);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (row >= 0 || logic->HasPendingMetrics())
+    {
+    std::cerr << "Line " << __LINE__ << ": Row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An added trajectory gets its values
+  trajectoryList->AddTrajectory(entry, target, "", "", "",
+                                vtkMRMLPathPlannerTrajectoryNode::DefaultFlags);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (logic->GetNumberOfUpdatedMetricValues() != 2 || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int numberOfTrajectories = trajectoryList->GetNumberOfTrajectories();
+
+  // Modifying the label map only recomputes the clearance, twice in a row
+  // cancels the first computation
+  const double secondBallCenter[3] = { -15.0, 10.0, -5.0 };
+  AddBall(image.GetPointer(), secondBallCenter, 6.0, 2);
+  AddBall(image.GetPointer(), secondBallCenter, 8.0, 2);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (logic->GetNumberOfUpdatedMetricValues() != numberOfTrajectories || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // So does moving it, but not modifying it without moving it
+  SetGeometry(labelMapNode.GetPointer(), 3.0);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), true, true);
+  if (logic->GetNumberOfUpdatedMetricValues() != numberOfTrajectories || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+  labelMapNode->Modified();
+  if (logic->HasPendingMetrics())
+    {
+    std::cerr << "Line " << __LINE__ << ": Metrics invalidated by a modification "
+              << "without a new geometry" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Untracked metrics are not updated anymore
+  logic->UntrackMetric(trajectoryList.GetPointer(),
+                       vtkSlicerPathExplorerLogic::GetClearanceMetricName());
+  trajectoryList->SetTargetPosition(17, target);
+  logic->UpdateMetrics(true);
+  row = FindDifference(logic.GetPointer(), trajectoryList.GetPointer(),
+                       labelMapNode.GetPointer(), modelNode.GetPointer(), false, true);
+  if (logic->GetNumberOfTrackedMetrics(trajectoryList.GetPointer()) != 1 ||
+      logic->GetNumberOfUpdatedMetricValues() != 1 || row >= 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << logic->GetNumberOfUpdatedMetricValues()
+              << " values updated, row " << row << " differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+  trajectoryList->SetTargetPosition(18, entry);
+  logic->UntrackMetrics(trajectoryList.GetPointer());
+  logic->UpdateMetrics(true);
+  if (logic->GetNumberOfTrackedMetrics(trajectoryList.GetPointer()) != 0 ||
+      logic->HasPendingMetrics())
+    {
+    std::cerr << "Line " << __LINE__ << ": Metrics still tracked" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,370 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTriangleBVH.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+using vtkPathExplorerTestingUtilities::Dot;
+using vtkPathExplorerTestingUtilities::PointSegmentDistance;
+
+const int NumberOfTriangles = 3000;
+const int NumberOfSegments = 300;
+const double Size = 100.0;
+
+//----------------------------------------------------------------------------
+void Cross(const double a[3], const double b[3], double c[3])
+{
+  c[0] = a[1] * b[2] - a[2] * b[1];
+  c[1] = a[2] * b[0] - a[0] * b[2];
+  c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+//----------------------------------------------------------------------------
+// Reference: distance from p to the projection in the triangle plane if
+// it is inside the triangle, else to the closest edge.
+double PointTriangleDistance(const double p[3], const double* v)
+{
+  const double* a = v;
+  const double* b = v + 3;
+  const double* c = v + 6;
+  double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  double normal[3];
+  Cross(ab, ac, normal);
+  double ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+  double height = Dot(ap, normal) / Dot(normal, normal);
+  double projection[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    projection[i] = p[i] - height * normal[i];
+    }
+  bool inside = true;
+  for (int edge = 0; edge < 3; ++edge)
+    {
+    const double* e0 = v + 3 * edge;
+    const double* e1 = v + 3 * ((edge + 1) % 3);
+    double e[3] = { e1[0] - e0[0], e1[1] - e0[1], e1[2] - e0[2] };
+    double q[3] = { projection[0] - e0[0], projection[1] - e0[1], projection[2] - e0[2] };
+    double side[3];
+    Cross(e, q, side);
+    inside = inside && Dot(side, normal) >= 0.0;
+    }
+  if (inside)
+    {
+    return fabs(height) * sqrt(Dot(normal, normal));
+    }
+  return std::min(PointSegmentDistance(p, a, b),
+                  std::min(PointSegmentDistance(p, b, c), PointSegmentDistance(p, c, a)));
+}
+
+//----------------------------------------------------------------------------
+// Reference: first crossing of the triangle by p0 + t (p1 - p0), t in [0, 1]
+bool IntersectTriangle(const double p0[3], const double p1[3], const double* v, double& t)
+{
+  double direction[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+  double ab[3] = { v[3] - v[0], v[4] - v[1], v[5] - v[2] };
+  double ac[3] = { v[6] - v[0], v[7] - v[1], v[8] - v[2] };
+  double normal[3];
+  Cross(ab, ac, normal);
+  double denominator = Dot(direction, normal);
+  if (denominator == 0.0)
+    {
+    return false;
+    }
+  double ap[3] = { p0[0] - v[0], p0[1] - v[1], p0[2] - v[2] };
+  t = -Dot(ap, normal) / denominator;
+  if (t < 0.0 || t > 1.0)
+    {
+    return false;
+    }
+  double point[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    point[i] = p0[i] + t * direction[i];
+    }
+  return PointTriangleDistance(point, v) < 1e-9;
+}
+
+//----------------------------------------------------------------------------
+// Reference: the distance from a point of the segment to the triangle is
+// convex along the segment, its minimum is found by golden section search.
+double SegmentTriangleDistance(const double p0[3], const double p1[3], const double* v)
+{
+  double t;
+  if (IntersectTriangle(p0, p1, v, t))
+    {
+    return 0.0;
+    }
+  const double ratio = 0.5 * (sqrt(5.0) - 1.0);
+  double lower = 0.0;
+  double upper = 1.0;
+  while (upper - lower > 1e-12)
+    {
+    double t1 = upper - ratio * (upper - lower);
+    double t2 = lower + ratio * (upper - lower);
+    double q1[3];
+    double q2[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      q1[i] = p0[i] + t1 * (p1[i] - p0[i]);
+      q2[i] = p0[i] + t2 * (p1[i] - p0[i]);
+      }
+    if (PointTriangleDistance(q1, v) < PointTriangleDistance(q2, v))
+      {
+      upper = t2;
+      }
+    else
+      {
+      lower = t1;
+      }
+    }
+  double q[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    q[i] = p0[i] + lower * (p1[i] - p0[i]);
+    }
+  return std::min(PointTriangleDistance(q, v),
+                  std::min(PointTriangleDistance(p0, v), PointTriangleDistance(p1, v)));
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTriangleBVHTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // Small random triangles in a cube, denser in one corner, sharing their
+  // points with their neighbors in the list
+  unsigned int seed = 1;
+  std::vector<double> points;
+  std::vector<vtkIdType> triangles;
+  for (int t = 0; t < NumberOfTriangles; ++t)
+    {
+    double center[3];
+    double scale = t % 2 ? 1.0 : 0.3;
+    for (int i = 0; i < 3; ++i)
+      {
+      center[i] = Random(seed) * Size * scale;
+      }
+    for (int vertex = 0; vertex < 3; ++vertex)
+      {
+      if (vertex < 2 && t > 0 && t % 5 != 0)
+        {
+        triangles.push_back(triangles[3 * (t - 1) + 1 + vertex]);
+        continue;
+        }
+      for (int i = 0; i < 3; ++i)
+        {
+        points.push_back(center[i] + (Random(seed) - 0.5) * 8.0);
+        }
+      triangles.push_back(static_cast<vtkIdType>(points.size() / 3 - 1));
+      }
+    }
+  std::vector<double> vertices(9 * NumberOfTriangles);
+  for (int t = 0; t < 3 * NumberOfTriangles; ++t)
+    {
+    std::copy(&points[3 * triangles[t]], &points[3 * triangles[t]] + 3, &vertices[3 * t]);
+    }
+
+  vtkPathExplorerTriangleBVH hierarchy;
+  hierarchy.Build(&points[0], &triangles[0], NumberOfTriangles);
+  if (hierarchy.GetNumberOfTriangles() != NumberOfTriangles)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << hierarchy.GetNumberOfTriangles()
+              << " triangles in the hierarchy" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  double bounds[6];
+  if (!hierarchy.GetBounds(bounds))
+    {
+    std::cerr << "Line " << __LINE__ << ": No bounds" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (size_t p = 0; p < points.size(); ++p)
+    {
+    int i = static_cast<int>(p % 3);
+    if (points[p] < bounds[2 * i] || points[p] > bounds[2 * i + 1])
+      {
+      std::cerr << "Line " << __LINE__ << ": Point " << p / 3 << " out of bounds" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  int numberOfIntersections = 0;
+  int numberOfCloseSegments = 0;
+  for (int s = 0; s < NumberOfSegments; ++s)
+    {
+    double p0[3];
+    double p1[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      p0[i] = Random(seed) * Size * 1.2 - 0.1 * Size;
+      p1[i] = p0[i] + (Random(seed) - 0.5) * Size * (s % 2 ? 0.1 : 1.0);
+      }
+
+    // First intersection
+    double expectedT = 2.0;
+    vtkIdType expectedTriangle = -1;
+    double closestDistance = Size * 10.0;
+    vtkIdType closestTriangle = -1;
+    for (vtkIdType t = 0; t < NumberOfTriangles; ++t)
+      {
+      double tIntersection;
+      if (IntersectTriangle(p0, p1, &vertices[9 * t], tIntersection) &&
+          tIntersection < expectedT)
+        {
+        expectedT = tIntersection;
+        expectedTriangle = t;
+        }
+      // The distance between the bounding boxes is a lower bound
+      const double* v = &vertices[9 * t];
+      double gap2 = 0.0;
+      for (int i = 0; i < 3; ++i)
+        {
+        double gap = std::max(std::min(v[i], std::min(v[i + 3], v[i + 6])) - std::max(p0[i], p1[i]),
+                              std::min(p0[i], p1[i]) - std::max(v[i], std::max(v[i + 3], v[i + 6])));
+        gap2 += gap > 0.0 ? gap * gap : 0.0;
+        }
+      if (gap2 >= closestDistance * closestDistance)
+        {
+        continue;
+        }
+      double distance = SegmentTriangleDistance(p0, p1, v);
+      if (distance < closestDistance)
+        {
+        closestDistance = distance;
+        closestTriangle = t;
+        }
+      }
+    double t = 2.0;
+    vtkIdType triangle = -1;
+    bool intersects = hierarchy.IntersectSegment(p0, p1, t, triangle);
+    if (intersects != (expectedTriangle >= 0) ||
+        (intersects && (triangle != expectedTriangle || fabs(t - expectedT) > 1e-9)))
+      {
+      std::cerr << "Line " << __LINE__ << ": Segment " << s << " intersects triangle "
+                << triangle << " at " << t << " instead of " << expectedTriangle
+                << " at " << expectedT << std::endl;
+      return EXIT_FAILURE;
+      }
+    numberOfIntersections += intersects ? 1 : 0;
+
+    // Closest triangle, all of them or only the close ones
+    double maximumDistance = s % 3 ? Size * 10.0 : 2.0;
+    double distance = hierarchy.GetSegmentDistance(p0, p1, maximumDistance, triangle);
+    if (closestDistance < maximumDistance)
+      {
+      if (fabs(distance - closestDistance) > 1e-6 || triangle < 0 ||
+          fabs(SegmentTriangleDistance(p0, p1, &vertices[9 * triangle]) - closestDistance) > 1e-6)
+        {
+        std::cerr << "Line " << __LINE__ << ": Segment " << s << " at distance "
+                  << distance << " of triangle " << triangle << " instead of "
+                  << closestDistance << " of triangle " << closestTriangle << std::endl;
+        return EXIT_FAILURE;
+        }
+      ++numberOfCloseSegments;
+      }
+    else if (distance != maximumDistance || triangle != -1)
+      {
+      std::cerr << "Line " << __LINE__ << ": Segment " << s << " at distance "
+                << distance << " of triangle " << triangle << " beyond "
+                << maximumDistance << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Triangles within a sphere around the segment start
+    double radius = 2.0 + 10.0 * Random(seed);
+    std::vector<vtkIdType> expectedInSphere;
+    for (vtkIdType t = 0; t < NumberOfTriangles; ++t)
+      {
+      if (PointTriangleDistance(p0, &vertices[9 * t]) <= radius)
+        {
+        expectedInSphere.push_back(t);
+        }
+      }
+    std::vector<double> sphereVertices;
+    std::vector<vtkIdType> inSphere;
+    hierarchy.FindTrianglesInSphere(p0, radius, sphereVertices, inSphere);
+    if (sphereVertices.size() != 9 * inSphere.size())
+      {
+      std::cerr << "Line " << __LINE__ << ": " << sphereVertices.size()
+                << " vertex coordinates for " << inSphere.size() << " triangles" << std::endl;
+      return EXIT_FAILURE;
+      }
+    for (size_t i = 0; i < inSphere.size(); ++i)
+      {
+      if (!std::equal(sphereVertices.begin() + 9 * i, sphereVertices.begin() + 9 * (i + 1),
+                      vertices.begin() + 9 * inSphere[i]))
+        {
+        std::cerr << "Line " << __LINE__ << ": Wrong vertices for triangle "
+                  << inSphere[i] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    std::sort(inSphere.begin(), inSphere.end());
+    if (inSphere != expectedInSphere)
+      {
+      std::cerr << "Line " << __LINE__ << ": Segment " << s << " has " << inSphere.size()
+                << " triangles in its sphere instead of " << expectedInSphere.size()
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (numberOfIntersections == 0 || numberOfIntersections == NumberOfSegments ||
+      numberOfCloseSegments == 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": " << numberOfIntersections
+              << " intersections and " << numberOfCloseSegments
+              << " close segments" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // An empty hierarchy has nothing to find
+  hierarchy.Initialize();
+  double p0[3] = { 0.0, 0.0, 0.0 };
+  double p1[3] = { 1.0, 1.0, 1.0 };
+  double t;
+  vtkIdType triangle;
+  if (hierarchy.GetBounds(bounds) || hierarchy.IntersectSegment(p0, p1, t, triangle) ||
+      hierarchy.GetSegmentDistance(p0, p1, 5.0, triangle) != 5.0 || triangle != -1)
+    {
+    std::cerr << "Line " << __LINE__ << ": Empty hierarchy not empty" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+==============================================================================*/
+
+// PathExplorer Logic includes
+#include "vtkPathExplorerTrilinearInterpolation.h"
+
+// PathExplorer Testing includes
+#include "vtkPathExplorerTestingUtilities.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageInterpolator.h>
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+using vtkPathExplorerTestingUtilities::Random;
+using vtkPathExplorerTestingUtilities::SameValue;
+
+const int Dimensions[3] = { 97, 64, 50 };
+const int NumberOfPoints = 1000000;
+}
+
+//----------------------------------------------------------------------------
+int vtkPathExplorerTrilinearInterpolationTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // Unit spacing and zero origin: IJK and image coordinates are the same
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(Dimensions[0], Dimensions[1], Dimensions[2]);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* scalars = static_cast<short*>(image->GetScalarPointer());
+  unsigned int seed = 1;
+  vtkIdType numberOfVoxels = static_cast<vtkIdType>(Dimensions[0]) * Dimensions[1] * Dimensions[2];
+  for (vtkIdType i = 0; i < numberOfVoxels; ++i)
+    {
+    scalars[i] = static_cast<short>(Random(seed) * 4000.0 - 1000.0);
+    }
+
+  vtkPathExplorerTrilinearInterpolation::Volume volume;
+  volume.Scalars = scalars;
+  volume.ScalarType = image->GetScalarType();
+  for (int i = 0; i < 3; ++i)
+    {
+    volume.Dimensions[i] = Dimensions[i];
+    }
+  volume.Increments[0] = 1;
+  volume.Increments[1] = Dimensions[0];
+  volume.Increments[2] = Dimensions[0] * Dimensions[1];
+
+  // Points inside the volume, on its faces and outside
+  std::vector<double> points(3 * NumberOfPoints);
+  for (int p = 0; p < NumberOfPoints; ++p)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      points[3 * p + i] = Random(seed) * (Dimensions[i] - 1);
+      }
+    }
+  points[0] = Dimensions[0] - 1;
+  points[4] = Dimensions[1] - 1;
+  points[8] = Dimensions[2] - 1;
+  points[9] = -0.5;
+  points[13] = Dimensions[1] - 0.5;
+
+  vtkNew<vtkTimerLog> timer;
+
+  // Reference: vtkImageInterpolator on the same points
+  vtkNew<vtkImageInterpolator> interpolator;
+  interpolator->SetInterpolationModeToLinear();
+  interpolator->Initialize(image.GetPointer());
+  interpolator->Update();
+  std::vector<double> expected(NumberOfPoints);
+  timer->StartTimer();
+  for (int p = 0; p < NumberOfPoints; ++p)
+    {
+    if (!interpolator->Interpolate(&points[3 * p], &expected[p]))
+      {
+      expected[p] = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+  timer->StopTimer();
+  double referenceTime = timer->GetElapsedTime();
+  std::cout << NumberOfPoints << " points" << std::endl;
+  std::cout << "  vtkImageInterpolator: " << referenceTime << "s" << std::endl;
+
+  // Every instruction set up to the supported one gives the same values
+  int supportedInstructionSet = vtkPathExplorerTrilinearInterpolation::GetSupportedInstructionSet();
+  std::vector<double> scalarValues;
+  for (int instructionSet = vtkPathExplorerTrilinearInterpolation::Scalar;
+       instructionSet <= supportedInstructionSet; ++instructionSet)
+    {
+    vtkPathExplorerTrilinearInterpolation::SetMaximumInstructionSet(instructionSet);
+    std::vector<double> values(NumberOfPoints);
+    timer->StartTimer();
+    vtkPathExplorerTrilinearInterpolation::InterpolatePoints(
+      volume, &points[0], NumberOfPoints, &values[0]);
+    timer->StopTimer();
+    std::cout << "  " << vtkPathExplorerTrilinearInterpolation::GetInstructionSetName(instructionSet)
+              << ": " << timer->GetElapsedTime() << "s" << std::endl;
+
+    for (int p = 0; p < NumberOfPoints; ++p)
+      {
+      bool outside = values[p] != values[p];
+      if (outside != (expected[p] != expected[p]) ||
+          (!outside && fabs(values[p] - expected[p]) > 1e-6 * (1.0 + fabs(expected[p]))))
+        {
+        std::cerr << "Line " << __LINE__ << ": Point " << p << " interpolated to "
+                  << values[p] << " instead of " << expected[p] << std::endl;
+        return EXIT_FAILURE;
+        }
+      if (!scalarValues.empty() && !SameValue(values[p], scalarValues[p]))
+        {
+        std::cerr << "Line " << __LINE__ << ": Point " << p << " differs from scalar kernel" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    if (scalarValues.empty())
+      {
+      scalarValues = values;
+      }
+    }
+
+  // Line kernel matches the points on the line
+  const double start[3] = { -2.0, 1.5, 3.25 };
+  const double step[3] = { 0.75, 0.5, 0.375 };
+  const int numberOfLinePoints = 203;
+  std::vector<double> linePoints(3 * numberOfLinePoints);
+  for (int k = 0; k < numberOfLinePoints; ++k)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      linePoints[3 * k + i] = start[i] + k * step[i];
+      }
+    }
+  std::vector<double> pointValues(numberOfLinePoints);
+  vtkPathExplorerTrilinearInterpolation::InterpolatePoints(
+    volume, &linePoints[0], numberOfLinePoints, &pointValues[0]);
+  std::vector<double> lineValues(2 * numberOfLinePoints, 0.0);
+  vtkPathExplorerTrilinearInterpolation::LineKernel kernel =
+    vtkPathExplorerTrilinearInterpolation::GetLineKernel(volume.ScalarType);
+  kernel(volume, start, step, numberOfLinePoints, &lineValues[1], 2);
+  for (int k = 0; k < numberOfLinePoints; ++k)
+    {
+    if (!SameValue(lineValues[2 * k + 1], pointValues[k]) || lineValues[2 * k] != 0.0)
+      {
+      std::cerr << "Line " << __LINE__ << ": Line sample " << k << " mismatch" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,605 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+  ==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerFiducialTableModel.h"
+#include "qSlicerPathExplorerObserverRegistry.h"
+#include "qSlicerPathExplorerUpdateScheduler.h"
+
+// Qt includes
+#include <QBrush>
+#include <QHash>
+#include <QSet>
+#include <QTime>
+#include <QVector>
+
+// MRML includes
+#include "vtkMRMLAnnotationFiducialNode.h"
+#include "vtkMRMLAnnotationHierarchyNode.h"
+
+// VTK includes
+#include "vtkCommand.h"
+#include "vtkWeakPointer.h"
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_PathExplorer
+class qSlicerPathExplorerFiducialTableModelPrivate
+{
+  Q_DECLARE_PUBLIC(qSlicerPathExplorerFiducialTableModel);
+ protected:
+  qSlicerPathExplorerFiducialTableModel * const q_ptr;
+
+ public:
+  qSlicerPathExplorerFiducialTableModelPrivate(
+    qSlicerPathExplorerFiducialTableModel& object);
+
+  void clearRows();
+  void appendRow(vtkMRMLAnnotationFiducialNode* fiducialNode);
+  void observeFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode);
+  void unobserveFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode);
+  void updateRowIndex(int firstRow);
+  void rowsMoved(int firstRow);
+
+  struct Row
+    {
+    vtkMRMLAnnotationFiducialNode* FiducialNode;
+    QTime                          ModifiedTime;
+    };
+
+  vtkWeakPointer<vtkMRMLAnnotationHierarchyNode>  HierarchyNode;
+  QVector<Row>                                    Rows;
+  QHash<vtkMRMLAnnotationFiducialNode*, int>      RowIndex;
+  QColor                                          BackgroundColor;
+  qSlicerPathExplorerUpdateScheduler*             UpdateScheduler;
+  // Rows modified since the last flush, -1 if none
+  int                                             DirtyFirstRow;
+  int                                             DirtyLastRow;
+};
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerFiducialTableModelPrivate
+::qSlicerPathExplorerFiducialTableModelPrivate(
+  qSlicerPathExplorerFiducialTableModel& object)
+  : q_ptr(&object)
+{
+  this->UpdateScheduler = NULL;
+  this->DirtyFirstRow = -1;
+  this->DirtyLastRow = -1;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::clearRows()
+{
+  Q_Q(qSlicerPathExplorerFiducialTableModel);
+
+  foreach(const Row& row, this->Rows)
+    {
+    this->unobserveFiducial(row.FiducialNode);
+    }
+  this->Rows.clear();
+  this->RowIndex.clear();
+  this->DirtyFirstRow = -1;
+  this->DirtyLastRow = -1;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::appendRow(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  Q_Q(qSlicerPathExplorerFiducialTableModel);
+
+  if (!fiducialNode || this->RowIndex.contains(fiducialNode))
+    {
+    return;
+    }
+
+  Row row;
+  row.FiducialNode = fiducialNode;
+  row.ModifiedTime = QTime::currentTime();
+  this->RowIndex.insert(fiducialNode, this->Rows.size());
+  this->Rows.append(row);
+  this->observeFiducial(fiducialNode);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::observeFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  Q_Q(qSlicerPathExplorerFiducialTableModel);
+
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(
+        fiducialNode, vtkCommand::ModifiedEvent, q, "onFiducialModified"))
+    {
+    q->qvtkConnect(fiducialNode, vtkCommand::ModifiedEvent,
+                   q, SLOT(onFiducialModified(vtkObject*)));
+    }
+  // Rows never point to deleted fiducials
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(
+        fiducialNode, vtkCommand::DeleteEvent, q, "onFiducialDeleted"))
+    {
+    q->qvtkConnect(fiducialNode, vtkCommand::DeleteEvent,
+                   q, SLOT(onFiducialDeleted(vtkObject*)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::unobserveFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  Q_Q(qSlicerPathExplorerFiducialTableModel);
+
+  qSlicerPathExplorerObserverRegistry::unregisterObserver(
+    fiducialNode, vtkCommand::ModifiedEvent, q, "onFiducialModified");
+  q->qvtkDisconnect(fiducialNode, vtkCommand::ModifiedEvent,
+                    q, SLOT(onFiducialModified(vtkObject*)));
+  qSlicerPathExplorerObserverRegistry::unregisterObserver(
+    fiducialNode, vtkCommand::DeleteEvent, q, "onFiducialDeleted");
+  q->qvtkDisconnect(fiducialNode, vtkCommand::DeleteEvent,
+                    q, SLOT(onFiducialDeleted(vtkObject*)));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::updateRowIndex(int firstRow)
+{
+  for (int row = firstRow; row < this->Rows.size(); ++row)
+    {
+    this->RowIndex[this->Rows[row].FiducialNode] = row;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModelPrivate
+::rowsMoved(int firstRow)
+{
+  // Pending updates of the rows that moved cover them at their new place
+  if (this->DirtyFirstRow >= 0 && this->DirtyLastRow >= firstRow)
+    {
+    this->DirtyFirstRow = qMin(this->DirtyFirstRow, firstRow);
+    this->DirtyLastRow = this->Rows.size() - 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerFiducialTableModel
+::qSlicerPathExplorerFiducialTableModel(QObject *parentObject)
+  : Superclass(parentObject)
+    , d_ptr( new qSlicerPathExplorerFiducialTableModelPrivate(*this) )
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerFiducialTableModel
+::~qSlicerPathExplorerFiducialTableModel()
+{
+  qSlicerPathExplorerObserverRegistry::unregisterObservers(this);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::setHierarchyNode(vtkMRMLAnnotationHierarchyNode* hierarchyNode)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  this->beginResetModel();
+  d->clearRows();
+  d->HierarchyNode = hierarchyNode;
+  if (hierarchyNode)
+    {
+    int numberOfChildren = hierarchyNode->GetNumberOfChildrenNodes();
+    d->Rows.reserve(numberOfChildren);
+    for (int i = 0; i < numberOfChildren; ++i)
+      {
+      d->appendRow(vtkMRMLAnnotationFiducialNode::SafeDownCast(
+        hierarchyNode->GetNthChildNode(i)->GetAssociatedNode()));
+      }
+    }
+  this->endResetModel();
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLAnnotationHierarchyNode* qSlicerPathExplorerFiducialTableModel
+::hierarchyNode()
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+  return d->HierarchyNode;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::setBackgroundColor(const QColor& color)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  d->BackgroundColor = color;
+  if (!d->Rows.isEmpty())
+    {
+    emit dataChanged(this->index(0, 0),
+                     this->index(d->Rows.size() - 1, NumberOfColumns - 1));
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLAnnotationFiducialNode* qSlicerPathExplorerFiducialTableModel
+::fiducialNode(int row)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  if (row < 0 || row >= d->Rows.size())
+    {
+    return NULL;
+    }
+  return d->Rows[row].FiducialNode;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerFiducialTableModel
+::rowOf(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+  return d->RowIndex.value(fiducialNode, -1);
+}
+
+//-----------------------------------------------------------------------------
+QList<vtkMRMLAnnotationFiducialNode*> qSlicerPathExplorerFiducialTableModel
+::fiducials()
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  QList<vtkMRMLAnnotationFiducialNode*> fiducialNodes;
+  fiducialNodes.reserve(d->Rows.size());
+  foreach(const qSlicerPathExplorerFiducialTableModelPrivate::Row& row, d->Rows)
+    {
+    fiducialNodes << row.FiducialNode;
+    }
+  return fiducialNodes;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerFiducialTableModel
+::addFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  if (!fiducialNode)
+    {
+    return -1;
+    }
+
+  int row = this->rowOf(fiducialNode);
+  if (row >= 0)
+    {
+    return row;
+    }
+
+  row = d->Rows.size();
+  this->beginInsertRows(QModelIndex(), row, row);
+  d->appendRow(fiducialNode);
+  this->endInsertRows();
+  d->rowsMoved(row);
+  return row;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::removeFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode)
+{
+  this->removeFiducial(this->rowOf(fiducialNode));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::removeFiducial(int row)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  if (row < 0 || row >= d->Rows.size())
+    {
+    return;
+    }
+
+  this->beginRemoveRows(QModelIndex(), row, row);
+  vtkMRMLAnnotationFiducialNode* fiducialNode = d->Rows[row].FiducialNode;
+  d->unobserveFiducial(fiducialNode);
+  d->RowIndex.remove(fiducialNode);
+  d->Rows.remove(row);
+  d->updateRowIndex(row);
+  this->endRemoveRows();
+  d->rowsMoved(row);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::clear()
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  this->beginResetModel();
+  d->clearRows();
+  this->endResetModel();
+}
+
+//-----------------------------------------------------------------------------
+QList<vtkMRMLAnnotationFiducialNode*> qSlicerPathExplorerFiducialTableModel
+::updateFromHierarchy()
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  QList<vtkMRMLAnnotationFiducialNode*> addedFiducials;
+  if (!d->HierarchyNode)
+    {
+    return addedFiducials;
+    }
+
+  QList<vtkMRMLAnnotationFiducialNode*> children;
+  QSet<vtkMRMLAnnotationFiducialNode*> childSet;
+  int numberOfChildren = d->HierarchyNode->GetNumberOfChildrenNodes();
+  for (int i = 0; i < numberOfChildren; ++i)
+    {
+    vtkMRMLAnnotationFiducialNode* fiducialNode =
+      vtkMRMLAnnotationFiducialNode::SafeDownCast(
+        d->HierarchyNode->GetNthChildNode(i)->GetAssociatedNode());
+    if (fiducialNode)
+      {
+      children << fiducialNode;
+      childSet.insert(fiducialNode);
+      }
+    }
+
+  for (int row = d->Rows.size() - 1; row >= 0; --row)
+    {
+    if (!childSet.contains(d->Rows[row].FiducialNode))
+      {
+      this->removeFiducial(row);
+      }
+    }
+
+  foreach(vtkMRMLAnnotationFiducialNode* fiducialNode, children)
+    {
+    if (!d->RowIndex.contains(fiducialNode))
+      {
+      this->addFiducial(fiducialNode);
+      addedFiducials << fiducialNode;
+      }
+    }
+  return addedFiducials;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+  this->flushUpdates();
+  d->UpdateScheduler = scheduler;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::rowsModified(int firstRow, int lastRow)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  if (!d->UpdateScheduler)
+    {
+    emit dataChanged(this->index(firstRow, 0), this->index(lastRow, NumberOfColumns - 1));
+    return;
+    }
+
+  // Extend the range to update at the next flush
+  if (d->DirtyFirstRow < 0)
+    {
+    d->DirtyFirstRow = firstRow;
+    d->DirtyLastRow = lastRow;
+    }
+  else
+    {
+    d->DirtyFirstRow = qMin(d->DirtyFirstRow, firstRow);
+    d->DirtyLastRow = qMax(d->DirtyLastRow, lastRow);
+    }
+  d->UpdateScheduler->scheduleUpdate(this);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::flushUpdates()
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  int lastRow = qMin(d->DirtyLastRow, d->Rows.size() - 1);
+  if (d->DirtyFirstRow >= 0 && d->DirtyFirstRow <= lastRow)
+    {
+    emit dataChanged(this->index(d->DirtyFirstRow, 0), this->index(lastRow, NumberOfColumns - 1));
+    }
+  d->DirtyFirstRow = -1;
+  d->DirtyLastRow = -1;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerFiducialTableModel
+::rowCount(const QModelIndex& parentIndex) const
+{
+  Q_D(const qSlicerPathExplorerFiducialTableModel);
+  return parentIndex.isValid() ? 0 : d->Rows.size();
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerFiducialTableModel
+::columnCount(const QModelIndex& parentIndex) const
+{
+  return parentIndex.isValid() ? 0 : NumberOfColumns;
+}
+
+//-----------------------------------------------------------------------------
+QVariant qSlicerPathExplorerFiducialTableModel
+::data(const QModelIndex& index, int role) const
+{
+  Q_D(const qSlicerPathExplorerFiducialTableModel);
+
+  if (!index.isValid() || index.row() >= d->Rows.size())
+    {
+    return QVariant();
+    }
+
+  const qSlicerPathExplorerFiducialTableModelPrivate::Row& row = d->Rows[index.row()];
+  if (role == Qt::DisplayRole || role == Qt::EditRole)
+    {
+    switch (index.column())
+      {
+      case NameColumn:
+        return QString(row.FiducialNode->GetName());
+      case RColumn:
+      case AColumn:
+      case SColumn:
+        {
+        double position[4] = {0,0,0,0};
+        row.FiducialNode->GetFiducialWorldCoordinates(position);
+        return QString::number(position[index.column() - RColumn], 'f', 2);
+        }
+      case TimeColumn:
+        return row.ModifiedTime.toString();
+      default:
+        break;
+      }
+    }
+  else if (role == Qt::BackgroundRole && d->BackgroundColor.isValid())
+    {
+    return QBrush(d->BackgroundColor);
+    }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerFiducialTableModel
+::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+
+  if (role != Qt::EditRole || !index.isValid() || index.row() >= d->Rows.size())
+    {
+    return false;
+    }
+
+  // Views are updated when the fiducial invokes ModifiedEvent
+  vtkMRMLAnnotationFiducialNode* fiducialNode = d->Rows[index.row()].FiducialNode;
+  if (index.column() == NameColumn)
+    {
+    QString name = value.toString();
+    if (name.isEmpty())
+      {
+      return false;
+      }
+    fiducialNode->SetName(name.toStdString().c_str());
+    return true;
+    }
+  else if (index.column() >= RColumn && index.column() <= SColumn)
+    {
+    bool ok = false;
+    double coordinate = value.toDouble(&ok);
+    if (!ok)
+      {
+      return false;
+      }
+    double position[4] = {0,0,0,0};
+    fiducialNode->GetFiducialWorldCoordinates(position);
+    position[index.column() - RColumn] = coordinate;
+    fiducialNode->SetFiducialWorldCoordinates(position);
+    return true;
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+Qt::ItemFlags qSlicerPathExplorerFiducialTableModel
+::flags(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    {
+    return Qt::NoItemFlags;
+    }
+
+  Qt::ItemFlags itemFlags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+  if (index.column() != TimeColumn)
+    {
+    itemFlags |= Qt::ItemIsEditable;
+    }
+  return itemFlags;
+}
+
+//-----------------------------------------------------------------------------
+QVariant qSlicerPathExplorerFiducialTableModel
+::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (role != Qt::DisplayRole)
+    {
+    return QVariant();
+    }
+
+  if (orientation == Qt::Vertical)
+    {
+    return section + 1;
+    }
+
+  switch (section)
+    {
+    case NameColumn:
+      return tr("Name");
+    case RColumn:
+      return tr("R");
+    case AColumn:
+      return tr("A");
+    case SColumn:
+      return tr("S");
+    case TimeColumn:
+      return tr("Time");
+    default:
+      break;
+    }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::onFiducialModified(vtkObject* caller)
+{
+  Q_D(qSlicerPathExplorerFiducialTableModel);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onFiducialModified");
+
+  int row = this->rowOf(vtkMRMLAnnotationFiducialNode::SafeDownCast(caller));
+  if (row < 0)
+    {
+    return;
+    }
+
+  d->Rows[row].ModifiedTime = QTime::currentTime();
+  this->rowsModified(row, row);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerFiducialTableModel
+::onFiducialDeleted(vtkObject* caller)
+{
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onFiducialDeleted");
+
+  this->removeFiducial(vtkMRMLAnnotationFiducialNode::SafeDownCast(caller));
+}
@@ -0,0 +1,124 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+ 
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+ 
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ 
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+ 
+==============================================================================*/
+
+#ifndef __qSlicerPathExplorerFiducialTableModel_h
+#define __qSlicerPathExplorerFiducialTableModel_h
+
+// VTK includes
+#include <ctkVTKObject.h>
+
+// SlicerQt includes
+#include "qSlicerPathExplorerModuleWidgetsExport.h"
+
+// Qt includes
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QList>
+
+class qSlicerPathExplorerFiducialTableModelPrivate;
+class qSlicerPathExplorerUpdateScheduler;
+class vtkObject;
+class vtkMRMLAnnotationFiducialNode;
+class vtkMRMLAnnotationHierarchyNode;
+
+/// \brief Table model of the fiducials of an annotation hierarchy.
+///
+/// Only the fiducial pointers and their time of last modification are kept,
+/// names and coordinates are read from the nodes when the view asks for them.
+/// The row of a fiducial is removed as soon as the fiducial is deleted.
+class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerFiducialTableModel
+  : public QAbstractTableModel
+{
+  Q_OBJECT
+  QVTK_OBJECT
+
+public:
+  typedef QAbstractTableModel Superclass;
+  qSlicerPathExplorerFiducialTableModel(QObject *parent=0);
+  virtual ~qSlicerPathExplorerFiducialTableModel();
+
+  enum Column
+    {
+    NameColumn = 0,
+    RColumn,
+    AColumn,
+    SColumn,
+    TimeColumn,
+    NumberOfColumns
+    };
+
+  /// Set the hierarchy and list its fiducials
+  void setHierarchyNode(vtkMRMLAnnotationHierarchyNode* hierarchyNode);
+  vtkMRMLAnnotationHierarchyNode* hierarchyNode();
+
+  /// Background of all the cells
+  void setBackgroundColor(const QColor& color);
+
+  /// Fiducial displayed at a row, NULL if none
+  vtkMRMLAnnotationFiducialNode* fiducialNode(int row);
+  /// Row of a fiducial, -1 if it is not listed
+  int rowOf(vtkMRMLAnnotationFiducialNode* fiducialNode);
+  QList<vtkMRMLAnnotationFiducialNode*> fiducials();
+
+  /// List a fiducial at the end of the table and return its row
+  int addFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode);
+
+  /// Stop listing fiducials. The nodes are not removed from the scene.
+  void removeFiducial(int row);
+  void removeFiducial(vtkMRMLAnnotationFiducialNode* fiducialNode);
+  void clear();
+
+  /// Insert and remove rows so the table matches the hierarchy, without
+  /// resetting the rows that didn't change. Return the fiducials added.
+  QList<vtkMRMLAnnotationFiducialNode*> updateFromHierarchy();
+
+  /// Coalesce the updates of modified rows with a scheduler.
+  /// Without scheduler, views are updated on each event.
+  void setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler);
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+  virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation,
+                              int role = Qt::DisplayRole) const;
+
+public slots:
+  /// Update the views for the rows modified since the last flush
+  void flushUpdates();
+
+protected slots:
+  void onFiducialModified(vtkObject* caller);
+  void onFiducialDeleted(vtkObject* caller);
+
+protected:
+  void rowsModified(int firstRow, int lastRow);
+
+  QScopedPointer<qSlicerPathExplorerFiducialTableModelPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerPathExplorerFiducialTableModel);
+  Q_DISABLE_COPY(qSlicerPathExplorerFiducialTableModel);
+};
+
+#endif // __qSlicerPathExplorerFiducialTableModel_h
@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+  ==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerObserverRegistry.h"
+
+// Qt includes
+#include <QObject>
+
+// PathExplorer logic
+#include "vtkSlicerPathExplorerLogic.h"
+
+// SlicerQt includes
+#include "qSlicerAbstractCoreModule.h"
+#include "qSlicerCoreApplication.h"
+#include "qSlicerModuleManager.h"
+
+// VTK includes
+#include "vtkTimerLog.h"
+
+//-----------------------------------------------------------------------------
+vtkSlicerPathExplorerLogic* qSlicerPathExplorerObserverRegistry
+::logic()
+{
+  qSlicerCoreApplication* application = qSlicerCoreApplication::application();
+  if (!application || !application->moduleManager())
+    {
+    return NULL;
+    }
+
+  qSlicerAbstractCoreModule* pathExplorerModule =
+    application->moduleManager()->module("PathExplorer");
+  if (!pathExplorerModule)
+    {
+    return NULL;
+    }
+  return vtkSlicerPathExplorerLogic::SafeDownCast(pathExplorerModule->logic());
+}
+
+//-----------------------------------------------------------------------------
+std::string qSlicerPathExplorerObserverRegistry
+::callbackName(QObject* observer, const char* callback)
+{
+  return std::string(observer->metaObject()->className()) + "::" + callback;
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerObserverRegistry
+::registerObserver(vtkObject* object, unsigned long event,
+                   QObject* observer, const char* callback)
+{
+  vtkSlicerPathExplorerLogic* pathExplorerLogic = logic();
+  if (!object || !pathExplorerLogic)
+    {
+    return object != NULL;
+    }
+  return pathExplorerLogic->RegisterObserver(
+    object, event, observer, callbackName(observer, callback).c_str());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerObserverRegistry
+::unregisterObserver(vtkObject* object, unsigned long event,
+                     QObject* observer, const char* callback)
+{
+  vtkSlicerPathExplorerLogic* pathExplorerLogic = logic();
+  if (!object || !pathExplorerLogic)
+    {
+    return;
+    }
+  pathExplorerLogic->UnregisterObserver(
+    object, event, observer, callbackName(observer, callback).c_str());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerObserverRegistry
+::unregisterObservers(QObject* observer)
+{
+  vtkSlicerPathExplorerLogic* pathExplorerLogic = logic();
+  if (pathExplorerLogic)
+    {
+    pathExplorerLogic->UnregisterObservers(observer);
+    }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerObserverRegistry::CallbackTimer
+::CallbackTimer(QObject* observer, const char* callback)
+{
+  this->Logic = qSlicerPathExplorerObserverRegistry::logic();
+  this->StartTime = 0.0;
+  if (this->Logic)
+    {
+    this->Callback = callbackName(observer, callback);
+    this->StartTime = vtkTimerLog::GetUniversalTime();
+    }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerObserverRegistry::CallbackTimer
+::~CallbackTimer()
+{
+  if (this->Logic)
+    {
+    this->Logic->CallbackInvoked(
+      this->Callback.c_str(), vtkTimerLog::GetUniversalTime() - this->StartTime);
+    }
+}
@@ -0,0 +1,76 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+ 
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+ 
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ 
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+ 
+==============================================================================*/
+
+#ifndef __qSlicerPathExplorerObserverRegistry_h
+#define __qSlicerPathExplorerObserverRegistry_h
+
+// SlicerQt includes
+#include "qSlicerPathExplorerModuleWidgetsExport.h"
+
+// STD includes
+#include <string>
+
+class QObject;
+class vtkObject;
+class vtkSlicerPathExplorerLogic;
+
+/// \brief Access to the observer registry of vtkSlicerPathExplorerLogic.
+///
+/// Widgets register their MRML observations before connecting them, so an
+/// observation is never connected twice, and time their callbacks with
+/// CallbackTimer. Callbacks are named "<observer class>::<callback>".
+/// Without the PathExplorer logic, observations are always connected and
+/// callbacks are not counted.
+class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerObserverRegistry
+{
+public:
+  /// PathExplorer logic holding the registry, NULL if the module isn't loaded
+  static vtkSlicerPathExplorerLogic* logic();
+
+  /// Register an observation. Return false if it is already registered,
+  /// in which case it must not be connected again.
+  static bool registerObserver(vtkObject* object, unsigned long event,
+                               QObject* observer, const char* callback);
+  static void unregisterObserver(vtkObject* object, unsigned long event,
+                                 QObject* observer, const char* callback);
+  /// Unregister all the observations of an observer being destroyed
+  static void unregisterObservers(QObject* observer);
+
+  /// Count a callback and the time spent in it, from construction to
+  /// destruction of the timer.
+  class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT CallbackTimer
+  {
+  public:
+    CallbackTimer(QObject* observer, const char* callback);
+    ~CallbackTimer();
+
+  private:
+    vtkSlicerPathExplorerLogic* Logic;
+    std::string Callback;
+    double StartTime;
+  };
+
+protected:
+  static std::string callbackName(QObject* observer, const char* callback);
+};
+
+#endif // __qSlicerPathExplorerObserverRegistry_h
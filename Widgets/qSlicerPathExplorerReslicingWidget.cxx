@@ -21,20 +21,81 @@
   ==============================================================================*/
 
 // PathExplorer Widgets includes
+#include "qSlicerPathExplorerObserverRegistry.h"
 #include "qSlicerPathExplorerReslicingWidget.h"
-#include "qSlicerPathExplorerTrajectoryItem.h"
+#include "qSlicerPathExplorerUpdateScheduler.h"
 #include "ui_qSlicerPathExplorerReslicingWidget.h"
 
 #include <vtkMRMLAnnotationLineDisplayNode.h>
 #include <vtkMRMLAnnotationRulerNode.h>
+#include <vtkMRMLPathPlannerTrajectoryNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceCompositeNode.h>
+#include <vtkMRMLSliceLayerLogic.h>
+#include <vtkMRMLSliceLogic.h>
 #include <vtkMRMLSliceNode.h>
+#include <vtkMRMLVolumeNode.h>
 
 #include "ctkPopupWidget.h"
 
+// PathExplorer logic
+#include "vtkSlicerPathExplorerLogic.h"
+
+// SlicerQt includes
+#include "qMRMLSliceWidget.h"
+#include "qSlicerAbstractCoreModule.h"
+#include "qSlicerApplication.h"
+#include "qSlicerCoreApplication.h"
+#include "qSlicerLayoutManager.h"
+#include "qSlicerModuleManager.h"
+
 // VTK includes
 #include "vtkMath.h"
 #include "vtkNew.h"
 #include "vtkSmartPointer.h"
+#include "vtkWeakPointer.h"
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+// Straightened volumes have one plane per slider step of perpendicular
+// reslicing, and planes of at most MaximumPlaneDimension pixels aside
+const int NumberOfStraightenedPlanes = 101;
+const int MaximumPlaneDimension = 512;
+const int NumberOfLayers = 3;
+
+//-----------------------------------------------------------------------------
+const char* GetLayerVolumeID(vtkMRMLSliceCompositeNode* compositeNode, int layer)
+{
+  switch (layer)
+    {
+    case 0: return compositeNode->GetBackgroundVolumeID();
+    case 1: return compositeNode->GetForegroundVolumeID();
+    default: return compositeNode->GetLabelVolumeID();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SetLayerVolumeID(vtkMRMLSliceCompositeNode* compositeNode, int layer,
+                      const std::string& volumeID)
+{
+  const char* currentID = GetLayerVolumeID(compositeNode, layer);
+  if (volumeID == (currentID ? currentID : ""))
+    {
+    return;
+    }
+  const char* id = volumeID.empty() ? NULL : volumeID.c_str();
+  switch (layer)
+    {
+    case 0: compositeNode->SetBackgroundVolumeID(id); break;
+    case 1: compositeNode->SetForegroundVolumeID(id); break;
+    default: compositeNode->SetLabelVolumeID(id); break;
+    }
+}
+}
 
 class qSlicerPathExplorerReslicingWidget;
 
@@ -55,15 +116,53 @@ class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerReslicingWi
   void saveAttributesToViewer();
   void updateWidget();
 
+  // Trajectory currently handled by the widget
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryListNode();
+  int trajectoryRow();
+  std::string trajectoryKey();
+
+  // Straightened volumes or rotated planes of the trajectory, shown in the
+  // slice layers (background, foreground, label) instead of the volumes
+  // while slices are cached
+  vtkMRMLSliceCompositeNode* sliceCompositeNode();
+  vtkMRMLVolumeNode* straightenedVolume(int layer, vtkMRMLVolumeNode* volumeNode);
+  void updateStraightening();
+  void restoreLayers();
+  void removeStraightenedVolumes();
+  void removeStraightenedVolume(int layer);
+
+  // Reslice requested by the slider, applied at the next flush. Only the
+  // last request is kept.
+  void requestReslice();
+  void reslice();
+  // While the slider is dragged, volumes are resliced without interpolation
+  void setPreview(bool preview);
+  vtkMRMLSliceLogic* sliceLogic();
+
  protected:
   qSlicerPathExplorerReslicingWidget * const     q_ptr;
-  qSlicerPathExplorerTrajectoryItem*             TrajectoryItem;
-  vtkMRMLSliceNode*                             SliceNode;
+  vtkWeakPointer<vtkMRMLPathPlannerTrajectoryNode> TrajectoryListNode;
+  int                                           TrajectoryUID;
+  vtkWeakPointer<vtkMRMLSliceNode>              SliceNode;
+  // Scene of the slice node, kept to remove the straightened volumes once
+  // the slice node is removed from it
+  vtkWeakPointer<vtkMRMLScene>                  Scene;
   std::string                                   DrivingRulerNodeID;
   std::string                                   DrivingRulerNodeName;
   double                                        ResliceAngle;
   double                                        ReslicePosition;
   bool                                          ReslicePerpendicular;
+  vtkSlicerPathExplorerLogic*                   PathExplorerLogic;
+  std::string                                   LayerVolumeIDs[NumberOfLayers];
+  std::string                                   StraightenedVolumeIDs[NumberOfLayers];
+  qSlicerPathExplorerUpdateScheduler*           UpdateScheduler;
+  vtkWeakPointer<vtkMRMLPathPlannerTrajectoryNode> PendingTrajectoryListNode;
+  int                                           PendingTrajectoryUID;
+  bool                                          PendingPerpendicular;
+  double                                        PendingValue;
+  // Interpolation modes of the background and foreground reslices before
+  // the preview (-1 if the layer had no reslice), empty when not previewing
+  std::vector<int>                              PreviewInterpolationModes;
 };
 
 //-----------------------------------------------------------------------------
@@ -74,11 +173,15 @@ qSlicerPathExplorerReslicingWidgetPrivate
 {
   this->DrivingRulerNodeID.assign("");
   this->DrivingRulerNodeName.assign("");
-  this->TrajectoryItem       = NULL;
-  this->SliceNode            = NULL;
+  this->TrajectoryUID        = -1;
   this->ResliceAngle         = 0.0;
   this->ReslicePosition      = 0.0;
   this->ReslicePerpendicular = true;
+  this->PathExplorerLogic    = NULL;
+  this->UpdateScheduler      = NULL;
+  this->PendingTrajectoryUID = -1;
+  this->PendingPerpendicular = true;
+  this->PendingValue         = 0.0;
 }
 
 //-----------------------------------------------------------------------------
@@ -94,20 +197,335 @@ void qSlicerPathExplorerReslicingWidgetPrivate
   this->Ui_qSlicerPathExplorerReslicingWidget::setupUi(widget);
 }
 
+//-----------------------------------------------------------------------------
+vtkMRMLPathPlannerTrajectoryNode* qSlicerPathExplorerReslicingWidgetPrivate
+::trajectoryListNode()
+{
+  return this->TrajectoryListNode;
+}
+
 //-----------------------------------------------------------------------------
 int qSlicerPathExplorerReslicingWidgetPrivate
-::loadAttributesFromViewer()
+::trajectoryRow()
 {
-  if (!this->TrajectoryItem)
+  return this->TrajectoryListNode ?
+    this->TrajectoryListNode->GetTrajectoryRow(this->TrajectoryUID) : -1;
+}
+
+//-----------------------------------------------------------------------------
+std::string qSlicerPathExplorerReslicingWidgetPrivate
+::trajectoryKey()
+{
+  // Trajectories don't always have a ruler. Identify them by list node and UID.
+  std::stringstream key;
+  if (this->TrajectoryListNode)
     {
-    return 0;
+    key << this->TrajectoryListNode->GetID() << ":" << this->TrajectoryUID;
+    }
+  return key.str();
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLSliceCompositeNode* qSlicerPathExplorerReslicingWidgetPrivate
+::sliceCompositeNode()
+{
+  vtkMRMLScene* scene = this->Scene;
+  if (!scene || !this->SliceNode || !this->SliceNode->GetLayoutName())
+    {
+    return NULL;
+    }
+
+  int numberOfNodes = scene->GetNumberOfNodesByClass("vtkMRMLSliceCompositeNode");
+  for (int i = 0; i < numberOfNodes; ++i)
+    {
+    vtkMRMLSliceCompositeNode* compositeNode = vtkMRMLSliceCompositeNode::SafeDownCast(
+      scene->GetNthNodeByClass(i, "vtkMRMLSliceCompositeNode"));
+    if (compositeNode && compositeNode->GetLayoutName() &&
+        strcmp(compositeNode->GetLayoutName(), this->SliceNode->GetLayoutName()) == 0)
+      {
+      return compositeNode;
+      }
+    }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLVolumeNode* qSlicerPathExplorerReslicingWidgetPrivate
+::straightenedVolume(int layer, vtkMRMLVolumeNode* volumeNode)
+{
+  vtkMRMLScene* scene = this->Scene;
+  vtkMRMLVolumeNode* straightenedNode = vtkMRMLVolumeNode::SafeDownCast(
+    scene->GetNodeByID(this->StraightenedVolumeIDs[layer].c_str()));
+  const char* sourceID = straightenedNode ?
+    straightenedNode->GetAttribute("PathExplorer.StraightenedVolumeID") : NULL;
+  if (sourceID && strcmp(sourceID, volumeNode->GetID()) == 0)
+    {
+    return straightenedNode;
+    }
+
+  // The layer shows another volume
+  this->removeStraightenedVolume(layer);
+
+  // Same class and display as the volume, without image, storage or
+  // transform (planes are resampled in world coordinates)
+  vtkSmartPointer<vtkMRMLNode> node;
+  node.TakeReference(scene->CreateNodeByClass(volumeNode->GetClassName()));
+  straightenedNode = vtkMRMLVolumeNode::SafeDownCast(node);
+  if (!straightenedNode)
+    {
+    return NULL;
+    }
+  straightenedNode->Copy(volumeNode);
+  straightenedNode->SetAndObserveImageData(NULL);
+  straightenedNode->SetAndObserveStorageNodeID(NULL);
+  straightenedNode->SetAndObserveTransformNodeID(NULL);
+  std::string name = std::string(volumeNode->GetName() ? volumeNode->GetName() : "") +
+    "_Straightened";
+  straightenedNode->SetName(name.c_str());
+  straightenedNode->SetHideFromEditors(1);
+  straightenedNode->SetSaveWithScene(0);
+  straightenedNode->SetAttribute("PathExplorer.StraightenedVolumeID", volumeNode->GetID());
+  scene->AddNode(straightenedNode);
+  this->StraightenedVolumeIDs[layer] = straightenedNode->GetID();
+  return straightenedNode;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::updateStraightening()
+{
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = this->trajectoryListNode();
+  int row = this->trajectoryRow();
+  vtkMRMLSliceCompositeNode* compositeNode = this->sliceCompositeNode();
+  if (!this->PathExplorerLogic || !compositeNode || !trajectoryList || row < 0 ||
+      !this->CacheCheckBox->isChecked() || !this->ResliceButton->isChecked())
+    {
+    this->restoreLayers();
+    return;
+    }
+
+  // Planes cover the field of view at the resolution of the slice
+  int* sliceDimensions = this->SliceNode->GetDimensions();
+  double* fieldOfView = this->SliceNode->GetFieldOfView();
+  int planeDimensions[2];
+  double planeSpacing = 0.0;
+  for (int i = 0; i < 2; ++i)
+    {
+    planeDimensions[i] = std::max(std::min(sliceDimensions[i], MaximumPlaneDimension), 1);
+    planeSpacing = std::max(planeSpacing, fieldOfView[i] / planeDimensions[i]);
+    }
+
+  // The straightened volumes or rotated planes are shown once they are all
+  // resampled. Until then, Slicer reslices the volumes.
+  vtkMRMLScene* scene = this->Scene;
+  bool straightened = true;
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    // A volume selected meanwhile replaces the volume of the layer
+    const char* layerID = GetLayerVolumeID(compositeNode, layer);
+    if (!layerID || this->StraightenedVolumeIDs[layer] != layerID)
+      {
+      this->LayerVolumeIDs[layer] = layerID ? layerID : "";
+      }
+    vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(
+      scene->GetNodeByID(this->LayerVolumeIDs[layer].c_str()));
+    if (!volumeNode)
+      {
+      continue;
+      }
+    vtkMRMLVolumeNode* straightenedNode = this->straightenedVolume(layer, volumeNode);
+    if (!straightenedNode)
+      {
+      straightened = false;
+      }
+    else if (this->ReslicePerpendicular)
+      {
+      straightened = this->PathExplorerLogic->StartStraightening(
+          volumeNode, trajectoryList, row, NumberOfStraightenedPlanes,
+          planeDimensions, planeSpacing, straightenedNode) &&
+        this->PathExplorerLogic->IsStraightened(
+          volumeNode, trajectoryList, row, NumberOfStraightenedPlanes,
+          planeDimensions, planeSpacing, straightenedNode) &&
+        straightened;
+      }
+    else
+      {
+      straightened = this->PathExplorerLogic->StartRotation(
+          volumeNode, trajectoryList, row, planeDimensions, planeSpacing) &&
+        this->PathExplorerLogic->ShowRotatedPlane(
+          volumeNode, trajectoryList, row, planeDimensions, planeSpacing,
+          this->ResliceAngle, straightenedNode) &&
+        straightened;
+      }
+    }
+
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    SetLayerVolumeID(compositeNode, layer,
+                     straightened && !this->LayerVolumeIDs[layer].empty() ?
+                     this->StraightenedVolumeIDs[layer] :
+                     this->LayerVolumeIDs[layer]);
     }
+}
 
-  vtkMRMLAnnotationRulerNode* ruler = this->TrajectoryItem->trajectoryNode();
-  if (!ruler)
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::restoreLayers()
+{
+  vtkMRMLSliceCompositeNode* compositeNode = this->sliceCompositeNode();
+  if (!compositeNode)
+    {
+    return;
+    }
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    const char* layerID = GetLayerVolumeID(compositeNode, layer);
+    if (layerID && this->StraightenedVolumeIDs[layer] == layerID)
+      {
+      SetLayerVolumeID(compositeNode, layer, this->LayerVolumeIDs[layer]);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::removeStraightenedVolumes()
+{
+  this->restoreLayers();
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    this->removeStraightenedVolume(layer);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::removeStraightenedVolume(int layer)
+{
+  // Cleared first: the node removed event of the volume doesn't remove it again
+  std::string straightenedID;
+  straightenedID.swap(this->StraightenedVolumeIDs[layer]);
+  vtkMRMLNode* straightenedNode = this->Scene && !straightenedID.empty() ?
+    this->Scene->GetNodeByID(straightenedID.c_str()) : NULL;
+  if (straightenedNode)
+    {
+    this->Scene->RemoveNode(straightenedNode);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::requestReslice()
+{
+  Q_Q(qSlicerPathExplorerReslicingWidget);
+
+  this->PendingTrajectoryListNode = this->TrajectoryListNode;
+  this->PendingTrajectoryUID = this->TrajectoryUID;
+  this->PendingPerpendicular = this->ReslicePerpendicular;
+  this->PendingValue = this->ReslicePerpendicular ? this->ReslicePosition : this->ResliceAngle;
+  if (this->UpdateScheduler)
+    {
+    this->UpdateScheduler->scheduleUpdate(q);
+    }
+  else
+    {
+    this->reslice();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::reslice()
+{
+  Q_Q(qSlicerPathExplorerReslicingWidget);
+
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = this->PendingTrajectoryListNode;
+  this->PendingTrajectoryListNode = NULL;
+  // Requests for another trajectory are obsolete
+  if (!trajectoryList || trajectoryList != this->TrajectoryListNode ||
+      this->PendingTrajectoryUID != this->TrajectoryUID)
+    {
+    return;
+    }
+  int row = this->trajectoryRow();
+  if (row < 0)
+    {
+    return;
+    }
+
+  q->resliceWithTrajectory(trajectoryList, row,
+                           this->SliceNode,
+                           this->PendingPerpendicular,
+                           this->PendingValue);
+  this->updateStraightening();
+  // After the slice logic updated the reslices from the display nodes
+  this->setPreview(this->ResliceSlider->isSliderDown());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidgetPrivate
+::setPreview(bool preview)
+{
+  // Only the reslices of the view are changed, display nodes are left as the
+  // user set them. Label maps are never interpolated.
+  vtkMRMLSliceLogic* sliceLogic = this->sliceLogic();
+  vtkMRMLSliceLayerLogic* layerLogics[2] =
+    { sliceLogic ? sliceLogic->GetBackgroundLayer() : NULL,
+      sliceLogic ? sliceLogic->GetForegroundLayer() : NULL };
+  if (!preview)
+    {
+    for (size_t layer = 0; layer < this->PreviewInterpolationModes.size(); ++layer)
+      {
+      if (layerLogics[layer] && layerLogics[layer]->GetReslice() &&
+          this->PreviewInterpolationModes[layer] >= 0)
+        {
+        layerLogics[layer]->GetReslice()->SetInterpolationMode(
+          this->PreviewInterpolationModes[layer]);
+        }
+      }
+    this->PreviewInterpolationModes.clear();
+    return;
+    }
+
+  bool startPreview = this->PreviewInterpolationModes.empty();
+  this->PreviewInterpolationModes.resize(2, -1);
+  for (int layer = 0; layer < 2; ++layer)
+    {
+    if (!layerLogics[layer] || !layerLogics[layer]->GetReslice())
+      {
+      continue;
+      }
+    if (startPreview)
+      {
+      this->PreviewInterpolationModes[layer] =
+        layerLogics[layer]->GetReslice()->GetInterpolationMode();
+      }
+    layerLogics[layer]->GetReslice()->SetInterpolationModeToNearestNeighbor();
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLSliceLogic* qSlicerPathExplorerReslicingWidgetPrivate
+::sliceLogic()
+{
+  qSlicerApplication* application = qSlicerApplication::application();
+  qMRMLSliceWidget* sliceWidget =
+    application && application->layoutManager() && this->SliceNode ?
+    application->layoutManager()->sliceWidget(this->SliceNode->GetLayoutName()) : NULL;
+  return sliceWidget ? sliceWidget->sliceLogic() : NULL;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerReslicingWidgetPrivate
+::loadAttributesFromViewer()
+{
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = this->trajectoryListNode();
+  int row = this->trajectoryRow();
+  if (!trajectoryList || row < 0)
     {
     return 0;
     }
+  const char* trajectoryName = trajectoryList->GetTrajectoryName(row);
 
   const char* drivingID = this->SliceNode->GetAttribute("PathExplorer.DrivingPathID");
   if (!drivingID)
@@ -124,21 +542,21 @@ int qSlicerPathExplorerReslicingWidgetPrivate
   this->DrivingRulerNodeName.assign(drivingName);
 
   std::stringstream itemPosAttrStr;
-  itemPosAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Position";
+  itemPosAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Position";
   const char* posStr = this->SliceNode->GetAttribute(itemPosAttrStr.str().c_str());
   this->ReslicePosition = posStr ?
     atof(posStr) :
     0.0;
 
   std::stringstream itemAngleAttrStr;
-  itemAngleAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Angle";
+  itemAngleAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Angle";
   const char* angleStr = this->SliceNode->GetAttribute(itemAngleAttrStr.str().c_str());
   this->ResliceAngle = angleStr ?
     atof(angleStr) :
     0.0;
 
   std::stringstream itemPerpAttrStr;
-  itemPerpAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Perpendicular";
+  itemPerpAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Perpendicular";
   const char* perpStr = this->SliceNode->GetAttribute(itemPerpAttrStr.str().c_str());
   if (perpStr)
     {
@@ -152,31 +570,28 @@ int qSlicerPathExplorerReslicingWidgetPrivate
 void qSlicerPathExplorerReslicingWidgetPrivate
 ::saveAttributesToViewer()
 {
-  if (!this->TrajectoryItem)
-    {
-    return;
-    }
-
-  vtkMRMLAnnotationRulerNode* ruler = this->TrajectoryItem->trajectoryNode();
-  if (!ruler)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = this->trajectoryListNode();
+  int row = this->trajectoryRow();
+  if (!trajectoryList || row < 0)
     {
     return;
     }
+  const char* trajectoryName = trajectoryList->GetTrajectoryName(row);
 
   std::stringstream posAttrStr;
-  posAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Position";
+  posAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Position";
   std::stringstream posValStr;
   posValStr << this->ReslicePosition;
   this->SliceNode->SetAttribute(posAttrStr.str().c_str(), posValStr.str().c_str());
 
   std::stringstream angleAttrStr;
-  angleAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Angle";
+  angleAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Angle";
   std::stringstream angleValStr;
   angleValStr << this->ResliceAngle;
   this->SliceNode->SetAttribute(angleAttrStr.str().c_str(), angleValStr.str().c_str());
 
   std::stringstream perpAttrStr;
-  perpAttrStr << "PathExplorer." << ruler->GetName() << "_" << this->SliceNode->GetName() << "_Perpendicular";
+  perpAttrStr << "PathExplorer." << trajectoryName << "_" << this->SliceNode->GetName() << "_Perpendicular";
   this->SliceNode->SetAttribute(perpAttrStr.str().c_str(), this->ReslicePerpendicularRadioButton->isChecked() ?
                                 "ON" :
                                 "OFF");
@@ -185,17 +600,17 @@ void qSlicerPathExplorerReslicingWidgetPrivate
 void qSlicerPathExplorerReslicingWidgetPrivate
 ::updateWidget()
 {
-  if (!this->SliceNode || !this->TrajectoryItem)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = this->trajectoryListNode();
+  int row = this->trajectoryRow();
+  if (!this->SliceNode || !trajectoryList || row < 0)
     {
     return;
     }
 
-  vtkMRMLAnnotationRulerNode* ruler = this->TrajectoryItem->trajectoryNode();
-  if (!ruler)
-    {
-    return;
-    }
-  vtkMRMLAnnotationLineDisplayNode* rulerDisplayNode = ruler->GetAnnotationLineDisplayNode();
+  // Ruler only exists when trajectory is displayed
+  vtkMRMLAnnotationRulerNode* ruler = trajectoryList->GetRulerNode(row);
+  vtkMRMLAnnotationLineDisplayNode* rulerDisplayNode =
+    ruler ? ruler->GetAnnotationLineDisplayNode() : NULL;
 
   // block all signals while updating
   bool resliceOldState = this->ResliceButton->blockSignals(true);
@@ -212,7 +627,7 @@ void qSlicerPathExplorerReslicingWidgetPrivate
 
   // Update reslice button
   int enabled = 0;
-  if (!this->DrivingRulerNodeID.empty() && this->DrivingRulerNodeID.compare(ruler->GetID()) == 0)
+  if (!this->DrivingRulerNodeID.empty() && this->DrivingRulerNodeID.compare(this->trajectoryKey()) == 0)
     {
     enabled = 1;
     this->ResliceButton->setText(this->DrivingRulerNodeName.c_str());
@@ -234,7 +649,7 @@ void qSlicerPathExplorerReslicingWidgetPrivate
   QString decimalValue = QString::number(this->ResliceAngle);
   if (this->ReslicePerpendicular)
     {
-    double distanceValue = ruler->GetDistanceMeasurement() * this->ReslicePosition / 100;
+    double distanceValue = trajectoryList->GetTrajectoryLength(row) * this->ReslicePosition / 100;
     decimalValue.setNum(distanceValue, 'f', 2);
     }
   this->ResliceValueLabel->setText(decimalValue);
@@ -272,6 +687,30 @@ qSlicerPathExplorerReslicingWidget
 
   this->setEnabled(0);
   d->SliceNode = sliceNode;
+  d->Scene = sliceNode->GetScene();
+
+  // Straightened volumes are hidden: they are removed with the volumes,
+  // trajectories and views they are made for, and before the scene closes
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(
+        d->Scene, vtkMRMLScene::StartCloseEvent, this, "onMRMLSceneStartClose"))
+    {
+    qvtkConnect(d->Scene, vtkMRMLScene::StartCloseEvent,
+                this, SLOT(onMRMLSceneStartClose()));
+    }
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(
+        d->Scene, vtkMRMLScene::NodeRemovedEvent, this, "onMRMLSceneNodeRemoved"))
+    {
+    qvtkConnect(d->Scene, vtkMRMLScene::NodeRemovedEvent,
+                this, SLOT(onMRMLSceneNodeRemoved(vtkObject*, void*)));
+    }
+
+  qSlicerAbstractCoreModule* pathExplorerModule =
+    qSlicerCoreApplication::application()->moduleManager()->module("PathExplorer");
+  if (pathExplorerModule)
+    {
+    d->PathExplorerLogic =
+      vtkSlicerPathExplorerLogic::SafeDownCast(pathExplorerModule->logic());
+    }
 
   // Set text
   d->ResliceButton->setText(sliceNode->GetName());
@@ -306,46 +745,69 @@ qSlicerPathExplorerReslicingWidget
           this, SLOT(onResliceToggled(bool)));
   connect(d->ResliceSlider, SIGNAL(valueChanged(int)),
           this, SLOT(onResliceValueChanged(int)));
+  connect(d->ResliceSlider, SIGNAL(sliderReleased()),
+          this, SLOT(onResliceSliderReleased()));
   connect(d->ReslicePerpendicularRadioButton, SIGNAL(toggled(bool)),
           this, SLOT(onPerpendicularToggled(bool)));
+  connect(d->CacheCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(onCacheToggled(bool)));
 }
 
 //-----------------------------------------------------------------------------
 qSlicerPathExplorerReslicingWidget
 ::~qSlicerPathExplorerReslicingWidget()
 {
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  d->setPreview(false);
+  d->removeStraightenedVolumes();
+  qSlicerPathExplorerObserverRegistry::unregisterObservers(this);
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLSliceNode* qSlicerPathExplorerReslicingWidget
+::sliceNode() const
+{
+  Q_D(const qSlicerPathExplorerReslicingWidget);
+  return d->SliceNode;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler)
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  this->flushUpdates();
+  d->UpdateScheduler = scheduler;
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerReslicingWidget
-::setTrajectoryItem(qSlicerPathExplorerTrajectoryItem* item)
+::setTrajectory(vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int trajectoryUID)
 {
   Q_D(qSlicerPathExplorerReslicingWidget);
 
   // Disable everything except button
   this->setEnabled(1);
 
-  if (!d->SliceNode || !item)
+  if (!d->SliceNode || !trajectoryList || trajectoryUID < 0)
     {
     return;
     }
 
-  if (d->TrajectoryItem)
+  if (d->TrajectoryListNode)
     {
     // If previous trajectory, save values as attributes before changing it
     d->saveAttributesToViewer();
     }
 
   // Load previous values of new trajectory if exists
-  d->TrajectoryItem = item;
-  vtkMRMLAnnotationRulerNode* newRuler = d->TrajectoryItem->trajectoryNode();
-  if (newRuler)
+  d->TrajectoryListNode = trajectoryList;
+  d->TrajectoryUID = trajectoryUID;
+  if (d->loadAttributesFromViewer())
     {
-    if (d->loadAttributesFromViewer())
-      {
-      d->updateWidget();
-      }
+    d->updateWidget();
     }
+  d->updateStraightening();
 }
 
 //-----------------------------------------------------------------------------
@@ -354,13 +816,9 @@ void qSlicerPathExplorerReslicingWidget
 {
   Q_D(qSlicerPathExplorerReslicingWidget);
 
-  if (!d->SliceNode || !d->TrajectoryItem)
-    {
-    return;
-    }
-
-  vtkMRMLAnnotationRulerNode* ruler = d->TrajectoryItem->trajectoryNode();
-  if (!ruler)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->trajectoryListNode();
+  int row = d->trajectoryRow();
+  if (!d->SliceNode || !trajectoryList || row < 0)
     {
     return;
     }
@@ -372,16 +830,16 @@ void qSlicerPathExplorerReslicingWidget
     d->ReslicePerpendicularRadioButton->setEnabled(1);
     d->ResliceInPlaneRadioButton->setEnabled(1);
 
-    d->DrivingRulerNodeID.assign(ruler->GetID());
-    d->DrivingRulerNodeName.assign(ruler->GetName());
-    d->SliceNode->SetAttribute("PathExplorer.DrivingPathID",ruler->GetID());
-    d->SliceNode->SetAttribute("PathExplorer.DrivingPathName",ruler->GetName());
+    d->DrivingRulerNodeID.assign(d->trajectoryKey());
+    d->DrivingRulerNodeName.assign(trajectoryList->GetTrajectoryName(row));
+    d->SliceNode->SetAttribute("PathExplorer.DrivingPathID", d->DrivingRulerNodeID.c_str());
+    d->SliceNode->SetAttribute("PathExplorer.DrivingPathName", d->DrivingRulerNodeName.c_str());
     d->updateWidget();
 
-    this->resliceWithRuler(ruler,
-                           d->SliceNode,
-                           d->ReslicePerpendicular,
-                           d->ReslicePerpendicular ? d->ReslicePosition : d->ResliceAngle);
+    this->resliceWithTrajectory(trajectoryList, row,
+                                d->SliceNode,
+                                d->ReslicePerpendicular,
+                                d->ReslicePerpendicular ? d->ReslicePosition : d->ResliceAngle);
     }
   else
     {
@@ -390,6 +848,7 @@ void qSlicerPathExplorerReslicingWidget
     d->ReslicePerpendicularRadioButton->setEnabled(0);
     d->ResliceInPlaneRadioButton->setEnabled(0);
     }
+  d->updateStraightening();
 }
 
 //-----------------------------------------------------------------------------
@@ -398,12 +857,9 @@ void qSlicerPathExplorerReslicingWidget
 {
   Q_D(qSlicerPathExplorerReslicingWidget);
 
-  if (!d->TrajectoryItem)
-    {
-    return;
-    }
-  vtkMRMLAnnotationRulerNode* ruler = d->TrajectoryItem->trajectoryNode();
-  if (!ruler)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->trajectoryListNode();
+  int row = d->trajectoryRow();
+  if (!trajectoryList || row < 0)
     {
     return;
     }
@@ -411,10 +867,11 @@ void qSlicerPathExplorerReslicingWidget
   d->ReslicePerpendicular = status;
   d->updateWidget();
 
-  this->resliceWithRuler(ruler,
-                         d->SliceNode,
-                         d->ReslicePerpendicular,
-                         d->ReslicePerpendicular ? d->ReslicePosition : d->ResliceAngle);
+  this->resliceWithTrajectory(trajectoryList, row,
+                              d->SliceNode,
+                              d->ReslicePerpendicular,
+                              d->ReslicePerpendicular ? d->ReslicePosition : d->ResliceAngle);
+  d->updateStraightening();
 }
 
 //-----------------------------------------------------------------------------
@@ -423,12 +880,9 @@ void qSlicerPathExplorerReslicingWidget
 {
   Q_D(qSlicerPathExplorerReslicingWidget);
 
-  if (!d->TrajectoryItem)
-    {
-    return;
-    }
-  vtkMRMLAnnotationRulerNode* ruler = d->TrajectoryItem->trajectoryNode();
-  if (!ruler)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->trajectoryListNode();
+  int row = d->trajectoryRow();
+  if (!trajectoryList || row < 0)
     {
     return;
     }
@@ -437,7 +891,7 @@ void qSlicerPathExplorerReslicingWidget
     {
     d->ReslicePosition = resliceValue;
     QString decimalValue;
-    double distanceValue = ruler->GetDistanceMeasurement() * d->ReslicePosition / 100;
+    double distanceValue = trajectoryList->GetTrajectoryLength(row) * d->ReslicePosition / 100;
     decimalValue = decimalValue.setNum(distanceValue, 'f', 2);
     d->ResliceValueLabel->setText(decimalValue);
     }
@@ -449,87 +903,164 @@ void qSlicerPathExplorerReslicingWidget
 
   if (d->ResliceButton->isChecked())
     {
-    this->resliceWithRuler(ruler,
-                           d->SliceNode,
-                           d->ReslicePerpendicular,
-                           d->ReslicePerpendicular ? d->ReslicePosition : d->ResliceAngle);
+    d->requestReslice();
     }
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerReslicingWidget
-::resliceWithRuler(vtkMRMLAnnotationRulerNode* ruler,
-                   vtkMRMLSliceNode* viewer,
-                   bool perpendicular,
-                   double resliceValue)
+::flushUpdates()
 {
-  if (!ruler || !viewer)
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  d->reslice();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::onResliceSliderReleased()
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+
+  // The slider settled: reslice the last value with full quality now
+  d->setPreview(false);
+  if (d->ResliceButton->isChecked())
     {
-    return;
+    d->requestReslice();
+    d->reslice();
     }
+}
 
-  // Get ruler points
-  double point1[4] = {0,0,0,0};
-  double point2[4] = {0,0,0,0};
-  ruler->GetPositionWorldCoordinates1(point1);
-  ruler->GetPositionWorldCoordinates2(point2);
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::refreshCache()
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  d->updateStraightening();
+}
 
-  // Compute vectors
-  double t[3];
-  double n[3];
-  double pos[3];
-  if (perpendicular)
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::onCacheToggled(bool cache)
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  if (cache)
+    {
+    d->updateStraightening();
+    }
+  else
     {
-    // Ruler vector is normal vector
-    n[0] = point2[0] - point1[0];
-    n[1] = point2[1] - point1[1];
-    n[2] = point2[2] - point1[2];
+    d->removeStraightenedVolumes();
+    }
+}
 
-    // Reslice at chosen position
-    pos[0] = point1[0] + n[0] * resliceValue / 100;
-    pos[1] = point1[1] + n[1] * resliceValue / 100;
-    pos[2] = point1[2] + n[2] * resliceValue / 100;
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::onMRMLSceneStartClose()
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onMRMLSceneStartClose");
 
-    // Normalize
-    double nlen = vtkMath::Normalize(n);
-    n[0] /= nlen;
-    n[1] /= nlen;
-    n[2] /= nlen;
+  d->setPreview(false);
+  d->removeStraightenedVolumes();
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    d->LayerVolumeIDs[layer].clear();
+    }
+  d->TrajectoryListNode = NULL;
+  d->PendingTrajectoryListNode = NULL;
+}
 
-    // angle in radian
-    vtkMath::Perpendiculars(n, t, NULL, 0);
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::onMRMLSceneNodeRemoved(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerReslicingWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onMRMLSceneNodeRemoved");
+  Q_UNUSED(caller);
+
+  vtkMRMLNode* node = reinterpret_cast<vtkMRMLNode*>(callData);
+  if (!node || !node->GetID())
+    {
+    return;
     }
-  else
+  if (node == d->SliceNode.GetPointer() || node == d->TrajectoryListNode.GetPointer())
+    {
+    d->removeStraightenedVolumes();
+    return;
+    }
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
     {
-    // Ruler vector is transverse vector
-    t[0] = point2[0] - point1[0];
-    t[1] = point2[1] - point1[1];
-    t[2] = point2[2] - point1[2];
+    if (d->StraightenedVolumeIDs[layer] == node->GetID())
+      {
+      // Removed by another module
+      d->StraightenedVolumeIDs[layer].clear();
+      }
+    else if (d->LayerVolumeIDs[layer] == node->GetID())
+      {
+      d->removeStraightenedVolume(layer);
+      d->LayerVolumeIDs[layer].clear();
+      }
+    }
+}
 
-    // Reslice at target position
-    pos[0] = point2[0];
-    pos[1] = point2[1];
-    pos[2] = point2[2];
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::resliceWithTrajectory(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                        int trajectoryRow,
+                        vtkMRMLSliceNode* viewer,
+                        bool perpendicular,
+                        double resliceValue)
+{
+  if (!trajectoryList || trajectoryRow < 0 || !viewer)
+    {
+    return;
+    }
 
-    // Normalize
-    double tlen = vtkMath::Normalize(t);
-    t[0] /= tlen;
-    t[1] /= tlen;
-    t[2] /= tlen;
+  // Get trajectory points
+  // Convention: Point1 -> Entry Point
+  //             Point2 -> Target Point
+  double point1[3] = {0,0,0};
+  double point2[3] = {0,0,0};
+  trajectoryList->GetEntryPosition(trajectoryRow, point1);
+  trajectoryList->GetTargetPosition(trajectoryRow, point2);
 
-    // angle in radian
-    vtkMath::Perpendiculars(t, n, NULL, resliceValue*vtkMath::Pi()/180);
-    }
+  double n[3];
+  double t[3];
+  double pos[3];
+  computeSliceAxes(point1, point2, perpendicular, resliceValue, n, t, pos);
+  viewer->SetSliceToRASByNTP(n[0], n[1], n[2], t[0], t[1], t[2], pos[0], pos[1], pos[2], 0);
+}
 
-  double nx = n[0];
-  double ny = n[1];
-  double nz = n[2];
-  double tx = t[0];
-  double ty = t[1];
-  double tz = t[2];
-  double px = pos[0];
-  double py = pos[1];
-  double pz = pos[2];
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerReslicingWidget
+::computeSliceAxes(const double entry[3], const double target[3],
+                   bool perpendicular, double resliceValue,
+                   double normal[3], double transverse[3], double position[3])
+{
+  double direction[3];
+  vtkMath::Subtract(target, entry, direction);
+  if (perpendicular)
+    {
+    // Ruler vector is normal vector. Reslice at chosen position.
+    for (int i = 0; i < 3; ++i)
+      {
+      normal[i] = direction[i];
+      position[i] = entry[i] + direction[i] * resliceValue / 100;
+      }
+    vtkMath::Normalize(normal);
+    vtkMath::Perpendiculars(normal, transverse, NULL, 0);
+    }
+  else
+    {
+    // Ruler vector is transverse vector. Reslice at target position.
+    for (int i = 0; i < 3; ++i)
+      {
+      transverse[i] = direction[i];
+      position[i] = target[i];
+      }
+    vtkMath::Normalize(transverse);
 
-  viewer->SetSliceToRASByNTP(nx, ny, nz, tx, ty, tz, px, py, pz, 0);
+    // angle in radian
+    vtkMath::Perpendiculars(transverse, normal, NULL, resliceValue*vtkMath::Pi()/180);
+    }
 }
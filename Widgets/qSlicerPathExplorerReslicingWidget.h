@@ -31,11 +31,12 @@
 #include "qSlicerWidget.h"
 
 class qSlicerPathExplorerReslicingWidgetPrivate;
-class qSlicerPathExplorerTrajectoryItem;
+class qSlicerPathExplorerUpdateScheduler;
 class vtkMRMLNode;
+class vtkObject;
 class vtkMRMLScene;
 class vtkMRMLSliceNode;
-class vtkMRMLAnnotationRulerNode;
+class vtkMRMLPathPlannerTrajectoryNode;
 
 class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerReslicingWidget
 : public qSlicerWidget
@@ -49,15 +50,48 @@ class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerReslicingWi
   qSlicerPathExplorerReslicingWidget(vtkMRMLSliceNode* sliceNode, QWidget *parent=0);
   virtual ~qSlicerPathExplorerReslicingWidget();
 
+  /// Coalesce the reslices requested by the slider with a scheduler: only
+  /// the last value is resliced at each flush, with a preview quality
+  /// while the slider is dragged. Without scheduler, each value is
+  /// resliced.
+  void setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler);
+
+  vtkMRMLSliceNode* sliceNode() const;
+
+  /// Slice normal, transverse vector and position reslicing with a
+  /// trajectory, as given to vtkMRMLSliceNode::SetSliceToRASByNTP.
+  /// Perpendicular slices are at resliceValue % of the trajectory from the
+  /// entry. In-plane slices contain the trajectory, rotated around it by
+  /// resliceValue degrees, and are centered on the target.
+  static void computeSliceAxes(const double entry[3], const double target[3],
+                               bool perpendicular, double resliceValue,
+                               double normal[3], double transverse[3],
+                               double position[3]);
+
  public slots:
-  void setTrajectoryItem(qSlicerPathExplorerTrajectoryItem* item);
+  void setTrajectory(vtkMRMLPathPlannerTrajectoryNode* trajectoryList, int trajectoryUID);
   void onResliceToggled(bool buttonStatus);
   void onPerpendicularToggled(bool status);
   void onResliceValueChanged(int resliceValue);
-  void resliceWithRuler(vtkMRMLAnnotationRulerNode* ruler,
-                        vtkMRMLSliceNode* viewer,
-                        bool perpendicular,
-                        double resliceValue);
+  void resliceWithTrajectory(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                             int trajectoryRow,
+                             vtkMRMLSliceNode* viewer,
+                             bool perpendicular,
+                             double resliceValue);
+
+  // Description:
+  // Show the straightened volumes or rotated planes once they are
+  // resampled. Called when background tasks are finished.
+  void refreshCache();
+  void onCacheToggled(bool cache);
+
+  /// Reslice with the last value requested by the slider
+  void flushUpdates();
+  void onResliceSliderReleased();
+
+ protected slots:
+  void onMRMLSceneStartClose();
+  void onMRMLSceneNodeRemoved(vtkObject* caller, void* callData);
 
  protected:
   QScopedPointer<qSlicerPathExplorerReslicingWidgetPrivate> d_ptr;
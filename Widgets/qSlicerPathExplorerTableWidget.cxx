@@ -23,12 +23,19 @@
 #include "vtkSlicerVersionConfigure.h"
 
 // PathExplorer Widgets includes
+#include "qSlicerPathExplorerFiducialTableModel.h"
 #include "qSlicerPathExplorerTableWidget.h"
 #include "ui_qSlicerPathExplorerTableWidget.h"
 
+// Qt includes
+#include <QHeaderView>
+
 // Annotation logic
 #include "vtkSlicerAnnotationModuleLogic.h"
 
+// PathExplorer logic
+#include "vtkSlicerPathExplorerLogic.h"
+
 // VTK includes
 #include "vtkMRMLAnnotationHierarchyNode.h"
 #include "vtkMRMLAnnotationPointDisplayNode.h"
@@ -41,7 +48,6 @@
 #include "qSlicerAbstractCoreModule.h"
 #include "qSlicerCoreApplication.h"
 #include "qSlicerModuleManager.h"
-#include "qSlicerPathExplorerFiducialItem.h"
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_PathExplorer
@@ -53,6 +59,8 @@ class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerTableWidget
   qSlicerPathExplorerTableWidget * const q_ptr;
   vtkMRMLAnnotationHierarchyNode* selectedHierarchyNode;
   vtkSlicerAnnotationModuleLogic* annotationLogic;
+  vtkSlicerPathExplorerLogic* pathExplorerLogic;
+  qSlicerPathExplorerFiducialTableModel* model;
 
  public:
   qSlicerPathExplorerTableWidgetPrivate(
@@ -68,6 +76,8 @@ qSlicerPathExplorerTableWidgetPrivate
 {
   this->selectedHierarchyNode = NULL;
   this->annotationLogic = NULL;
+  this->pathExplorerLogic = NULL;
+  this->model = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -75,6 +85,11 @@ void qSlicerPathExplorerTableWidgetPrivate
 ::setupUi(qSlicerPathExplorerTableWidget* widget)
 {
   this->Ui_qSlicerPathExplorerTableWidget::setupUi(widget);
+
+  // Rows have the same height, so the view doesn't measure them
+  this->model = new qSlicerPathExplorerFiducialTableModel(widget);
+  this->TableView->setModel(this->model);
+  this->TableView->verticalHeader()->setResizeMode(QHeaderView::Fixed);
 }
 
 //-----------------------------------------------------------------------------
@@ -94,6 +109,14 @@ qSlicerPathExplorerTableWidget
       vtkSlicerAnnotationModuleLogic::SafeDownCast(annotationModule->logic());
     }
 
+  qSlicerAbstractCoreModule* pathExplorerModule =
+    qSlicerCoreApplication::application()->moduleManager()->module("PathExplorer");
+  if (pathExplorerModule)
+    {
+    d->pathExplorerLogic =
+      vtkSlicerPathExplorerLogic::SafeDownCast(pathExplorerModule->logic());
+    }
+
   connect(d->AddButton, SIGNAL(toggled(bool)),
           this, SLOT(onAddButtonToggled(bool)));
 
@@ -103,12 +126,10 @@ qSlicerPathExplorerTableWidget
   connect(d->ClearButton, SIGNAL(clicked()),
           this, SLOT(onClearButtonClicked()));
 
-  connect(d->TableWidget, SIGNAL(itemSelectionChanged()),
+  connect(d->TableView->selectionModel(),
+          SIGNAL(currentRowChanged(const QModelIndex&, const QModelIndex&)),
           this, SLOT(onSelectionChanged()));
 
-  connect(d->TableWidget, SIGNAL(cellChanged(int,int)),
-          this, SLOT(onCellChanged(int,int)));
-
   this->addButtonStatus = false;
 }
 
@@ -119,15 +140,27 @@ qSlicerPathExplorerTableWidget
 }
 
 //-----------------------------------------------------------------------------
-QTableWidget* qSlicerPathExplorerTableWidget
-::getTableWidget()
+QTableView* qSlicerPathExplorerTableWidget
+::getTableView()
 {
   Q_D(qSlicerPathExplorerTableWidget);
-  if (d->TableWidget)
-    {
-    return d->TableWidget;
-    }
-  return NULL;
+  return d->TableView;
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerFiducialTableModel* qSlicerPathExplorerTableWidget
+::getModel()
+{
+  Q_D(qSlicerPathExplorerTableWidget);
+  return d->model;
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLAnnotationFiducialNode* qSlicerPathExplorerTableWidget
+::currentFiducialNode()
+{
+  Q_D(qSlicerPathExplorerTableWidget);
+  return d->model->fiducialNode(d->TableView->currentIndex().row());
 }
 
 //-----------------------------------------------------------------------------
@@ -210,41 +243,28 @@ void qSlicerPathExplorerTableWidget
 {
   Q_D(qSlicerPathExplorerTableWidget);
 
-  if (!d->annotationLogic->GetMRMLScene())
+  if (!d->annotationLogic->GetMRMLScene() || !d->pathExplorerLogic)
     {
     return;
     }
 
-  int selectedRow = d->TableWidget->currentRow();
-  if (selectedRow < 0)
+  int selectedRow = d->TableView->currentIndex().row();
+  vtkMRMLAnnotationFiducialNode* nodeToDelete = d->model->fiducialNode(selectedRow);
+  if (!nodeToDelete)
     {
     return;
     }
 
-  // Remove fiducial from scene
-  qSlicerPathExplorerFiducialItem* itemToRemove =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TableWidget->item(selectedRow, 0));
+  // Remove the row before the fiducial, the selection moves to another row
+  // and the view must not access the removed fiducial
+  d->model->removeFiducial(selectedRow);
 
-  if (itemToRemove)
-    {
-    vtkMRMLAnnotationFiducialNode* nodeToDelete = itemToRemove->getFiducialNode();
-
-    // ISSUE: removeRow first change the selection to +or- 1 row
-    // Which trigger the SLOT onSelectionChanged with the new row selected
-    // If fiducial node has been removed before, then it crashes
-    // As removeRow also delete items, itemToRemove is no longer accessible
-    // after removeRow.
-    // FIX: Get fiducial node before calling removeRow, then call removeRow
-    // then delete fiducial
-    d->TableWidget->removeRow(selectedRow);
-
-    if (nodeToDelete)
-      {
-      // Signal to remove all trajectories with this fiducial
-      emit itemDeleted(nodeToDelete);
-      d->annotationLogic->GetMRMLScene()->RemoveNode(nodeToDelete);
-      }
-    }
+  // Signal to remove all trajectories with this fiducial
+  d->pathExplorerLogic->StartBatch();
+  emit itemDeleted(nodeToDelete);
+  d->annotationLogic->GetMRMLScene()->RemoveNode(nodeToDelete);
+  d->pathExplorerLogic->HierarchyModified(d->selectedHierarchyNode);
+  d->pathExplorerLogic->EndBatch();
 }
 
 //-----------------------------------------------------------------------------
@@ -253,42 +273,42 @@ void qSlicerPathExplorerTableWidget
 {
   Q_D(qSlicerPathExplorerTableWidget);
 
-  if (!d->selectedHierarchyNode)
+  if (!d->selectedHierarchyNode || !d->annotationLogic->GetMRMLScene() ||
+      !d->pathExplorerLogic)
     {
     return;
     }
 
-  int numberOfRows = d->TableWidget->rowCount();
-  for (int i = 0; i < numberOfRows; ++i)
-    {
-    this->onDeleteButtonClicked();
-    }
-}
+  // Collect fiducials before the rows are removed
+  QList<vtkMRMLAnnotationFiducialNode*> nodesToDelete = d->model->fiducials();
+  d->model->clear();
 
-//-----------------------------------------------------------------------------
-void qSlicerPathExplorerTableWidget
-::onSelectionChanged()
-{
-  Q_D(qSlicerPathExplorerTableWidget);
-
-  int selectedRow = d->TableWidget->currentRow();
-  if (selectedRow < 0)
+  if (nodesToDelete.isEmpty())
     {
     return;
     }
 
-  // Get fiducial
-  qSlicerPathExplorerFiducialItem* selectedItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TableWidget->item(selectedRow,0));
+  // Signal once to remove all trajectories with these fiducials,
+  // then remove the fiducials, all in the same batch
+  d->pathExplorerLogic->StartBatch();
+  emit itemsDeleted(nodesToDelete);
 
-  if (!selectedItem)
+  vtkMRMLScene* scene = d->annotationLogic->GetMRMLScene();
+  foreach(vtkMRMLAnnotationFiducialNode* node, nodesToDelete)
     {
-    return;
+    scene->RemoveNode(node);
     }
+  d->pathExplorerLogic->HierarchyModified(d->selectedHierarchyNode);
+  d->pathExplorerLogic->EndBatch();
+}
 
-  vtkMRMLAnnotationFiducialNode* selectedFiducial =
-    selectedItem->getFiducialNode();
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTableWidget
+::onSelectionChanged()
+{
+  Q_D(qSlicerPathExplorerTableWidget);
 
+  vtkMRMLAnnotationFiducialNode* selectedFiducial = this->currentFiducialNode();
   if (!selectedFiducial ||
       !selectedFiducial->GetAnnotationPointDisplayNode())
     {
@@ -299,77 +319,16 @@ void qSlicerPathExplorerTableWidget
   selectedFiducial->GetAnnotationPointDisplayNode()->SetOpacity(1.0);
 
   // Set opacity of non-selected fiducials to 0.3
-  for(int i = 0; i < d->TableWidget->rowCount(); i++)
+  foreach(vtkMRMLAnnotationFiducialNode* currentFiducial, d->model->fiducials())
     {
-    if (i != selectedRow)
+    if (currentFiducial != selectedFiducial &&
+        currentFiducial->GetAnnotationPointDisplayNode())
       {
-      qSlicerPathExplorerFiducialItem* currentItem =
-        dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TableWidget->item(i,0));
-      if (currentItem)
-        {
-        vtkMRMLAnnotationFiducialNode* currentFiducial =
-          currentItem->getFiducialNode();
-        if (currentFiducial)
-          {
-          if (currentFiducial->GetAnnotationPointDisplayNode())
-            {
-            currentFiducial->GetAnnotationPointDisplayNode()->SetOpacity(0.3);
-            }
-          }
-        }
+      currentFiducial->GetAnnotationPointDisplayNode()->SetOpacity(0.3);
       }
     }
 }
 
-//-----------------------------------------------------------------------------
-void qSlicerPathExplorerTableWidget
-::onCellChanged(int row, int column)
-{
-  Q_D(qSlicerPathExplorerTableWidget);
-  Q_UNUSED(column);
-
-  if (!d->TableWidget->item(row,0) ||
-      !d->TableWidget->item(row,1) ||
-      !d->TableWidget->item(row,2) ||
-      !d->TableWidget->item(row,3))
-    {
-    return;
-    }
-
-  qSlicerPathExplorerFiducialItem* currentItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TableWidget->item(row,0));
-  if (!currentItem)
-    {
-    return;
-    }
-
-  // Get coordinates
-  QString xCoord = QString(d->TableWidget->item(row, 1)->text());
-  QString yCoord = QString(d->TableWidget->item(row, 2)->text());
-  QString zCoord = QString(d->TableWidget->item(row, 3)->text());
-
-  if (xCoord.isEmpty() || yCoord.isEmpty() || zCoord.isEmpty())
-    {
-    return;
-    }
-
-  // Convert coordinates from QString to double
-  double newFiducialCoordinates[3] = {
-    xCoord.toDouble(),
-    yCoord.toDouble(),
-    zCoord.toDouble() };
-
-  // Get fiducial and set new coordinates
-  vtkMRMLAnnotationFiducialNode* currentFiducial =
-    currentItem->getFiducialNode();
-  if (!currentFiducial)
-    {
-    return;
-    }
-
-  currentFiducial->SetFiducialWorldCoordinates(newFiducialCoordinates);
-}
-
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerTableWidget
 ::setAddButtonState(bool state)
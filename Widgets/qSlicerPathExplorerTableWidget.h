@@ -31,8 +31,10 @@
 #include "qSlicerWidget.h"
 
 // Qt includes
-#include <QTableWidget>
+#include <QList>
+#include <QTableView>
 
+class qSlicerPathExplorerFiducialTableModel;
 class qSlicerPathExplorerTableWidgetPrivate;
 class vtkMRMLNode;
 class vtkMRMLScene;
@@ -50,7 +52,9 @@ public:
   qSlicerPathExplorerTableWidget(QWidget *parent=0);
   virtual ~qSlicerPathExplorerTableWidget();
 
-  QTableWidget* getTableWidget();
+  QTableView* getTableView();
+  qSlicerPathExplorerFiducialTableModel* getModel();
+  vtkMRMLAnnotationFiducialNode* currentFiducialNode();
   void setSelectedHierarchyNode(vtkMRMLAnnotationHierarchyNode* selectedNode);
   vtkMRMLAnnotationHierarchyNode* selectedHierarchyNode();
   bool addButtonStatus;
@@ -61,7 +65,6 @@ public slots:
   void onDeleteButtonClicked();
   void onClearButtonClicked();
   void onSelectionChanged();
-  void onCellChanged(int row, int column);
 
 protected:
   QScopedPointer<qSlicerPathExplorerTableWidgetPrivate> d_ptr;
@@ -72,6 +75,7 @@ private:
 
 signals:
   void itemDeleted(vtkMRMLAnnotationFiducialNode*);
+  void itemsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>&);
   void addButtonToggled(bool);
 };
 
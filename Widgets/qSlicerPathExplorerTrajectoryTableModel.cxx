@@ -0,0 +1,465 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+  ==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerObserverRegistry.h"
+#include "qSlicerPathExplorerTrajectoryTableModel.h"
+#include "qSlicerPathExplorerUpdateScheduler.h"
+
+// MRML includes
+#include "vtkMRMLAnnotationFiducialNode.h"
+#include "vtkMRMLPathPlannerTrajectoryNode.h"
+
+// VTK includes
+#include "vtkCommand.h"
+#include "vtkMath.h"
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_PathExplorer
+class qSlicerPathExplorerTrajectoryTableModelPrivate
+{
+  Q_DECLARE_PUBLIC(qSlicerPathExplorerTrajectoryTableModel);
+ protected:
+  qSlicerPathExplorerTrajectoryTableModel * const q_ptr;
+
+ public:
+  qSlicerPathExplorerTrajectoryTableModelPrivate(
+    qSlicerPathExplorerTrajectoryTableModel& object);
+
+  vtkMRMLPathPlannerTrajectoryNode* TrajectoryListNode;
+  // Number of rows and metric columns known by the views
+  int RowCount;
+  int NumberOfMetrics;
+  qSlicerPathExplorerUpdateScheduler* UpdateScheduler;
+  // Rows modified since the last flush, -1 if none
+  int DirtyFirstRow;
+  int DirtyLastRow;
+
+  void rowsMoved(int firstRow);
+  void reconnect(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+                 unsigned long event, const char* slot, const char* callback);
+};
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerTrajectoryTableModelPrivate
+::qSlicerPathExplorerTrajectoryTableModelPrivate(
+  qSlicerPathExplorerTrajectoryTableModel& object)
+  : q_ptr(&object)
+{
+  this->TrajectoryListNode = NULL;
+  this->RowCount = 0;
+  this->NumberOfMetrics = 0;
+  this->UpdateScheduler = NULL;
+  this->DirtyFirstRow = -1;
+  this->DirtyLastRow = -1;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModelPrivate
+::rowsMoved(int firstRow)
+{
+  // Pending updates of the rows that moved cover them at their new place
+  if (this->DirtyFirstRow >= 0 && this->DirtyLastRow >= firstRow)
+    {
+    this->DirtyFirstRow = qMin(this->DirtyFirstRow, firstRow);
+    this->DirtyLastRow = this->RowCount - 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModelPrivate
+::reconnect(vtkMRMLPathPlannerTrajectoryNode* trajectoryList,
+            unsigned long event, const char* slot, const char* callback)
+{
+  Q_Q(qSlicerPathExplorerTrajectoryTableModel);
+
+  qSlicerPathExplorerObserverRegistry::unregisterObserver(
+    this->TrajectoryListNode, event, q, callback);
+  q->qvtkDisconnect(this->TrajectoryListNode, event, q, slot);
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(
+        trajectoryList, event, q, callback))
+    {
+    q->qvtkConnect(trajectoryList, event, q, slot);
+    }
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerTrajectoryTableModel
+::qSlicerPathExplorerTrajectoryTableModel(QObject *parentObject)
+  : Superclass(parentObject)
+    , d_ptr( new qSlicerPathExplorerTrajectoryTableModelPrivate(*this) )
+{
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerTrajectoryTableModel
+::~qSlicerPathExplorerTrajectoryTableModel()
+{
+  qSlicerPathExplorerObserverRegistry::unregisterObservers(this);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::setTrajectoryListNode(vtkMRMLPathPlannerTrajectoryNode* trajectoryList)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+
+  // Same list: observations are already connected
+  if (trajectoryList != d->TrajectoryListNode)
+    {
+    d->reconnect(trajectoryList, vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent,
+                 SLOT(onTrajectoryAdded(vtkObject*, void*)), "onTrajectoryAdded");
+    d->reconnect(trajectoryList, vtkMRMLPathPlannerTrajectoryNode::TrajectoryRemovedEvent,
+                 SLOT(onTrajectoryRemoved(vtkObject*, void*)), "onTrajectoryRemoved");
+    d->reconnect(trajectoryList, vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent,
+                 SLOT(onTrajectoryModified(vtkObject*, void*)), "onTrajectoryModified");
+    d->reconnect(trajectoryList, vtkCommand::ModifiedEvent,
+                 SLOT(onTrajectoryListModified()), "onTrajectoryListModified");
+    }
+
+  this->beginResetModel();
+  d->TrajectoryListNode = trajectoryList;
+  d->RowCount = trajectoryList ? trajectoryList->GetNumberOfTrajectories() : 0;
+  d->NumberOfMetrics = trajectoryList ? trajectoryList->GetNumberOfMetrics() : 0;
+  d->DirtyFirstRow = -1;
+  d->DirtyLastRow = -1;
+  this->endResetModel();
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLPathPlannerTrajectoryNode* qSlicerPathExplorerTrajectoryTableModel
+::trajectoryListNode()
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  return d->TrajectoryListNode;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  this->flushUpdates();
+  d->UpdateScheduler = scheduler;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::rowsModified(int firstRow, int lastRow)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+
+  if (!d->UpdateScheduler)
+    {
+    emit dataChanged(this->index(firstRow, 0), this->index(lastRow, this->columnCount() - 1));
+    return;
+    }
+
+  // Extend the range to update at the next flush
+  if (d->DirtyFirstRow < 0)
+    {
+    d->DirtyFirstRow = firstRow;
+    d->DirtyLastRow = lastRow;
+    }
+  else
+    {
+    d->DirtyFirstRow = qMin(d->DirtyFirstRow, firstRow);
+    d->DirtyLastRow = qMax(d->DirtyLastRow, lastRow);
+    }
+  d->UpdateScheduler->scheduleUpdate(this);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::flushUpdates()
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+
+  int lastRow = qMin(d->DirtyLastRow, d->RowCount - 1);
+  if (d->DirtyFirstRow >= 0 && d->DirtyFirstRow <= lastRow)
+    {
+    emit dataChanged(this->index(d->DirtyFirstRow, 0), this->index(lastRow, this->columnCount() - 1));
+    }
+  d->DirtyFirstRow = -1;
+  d->DirtyLastRow = -1;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerTrajectoryTableModel
+::rowCount(const QModelIndex& parentIndex) const
+{
+  Q_D(const qSlicerPathExplorerTrajectoryTableModel);
+  return parentIndex.isValid() ? 0 : d->RowCount;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerTrajectoryTableModel
+::columnCount(const QModelIndex& parentIndex) const
+{
+  Q_D(const qSlicerPathExplorerTrajectoryTableModel);
+  return parentIndex.isValid() ? 0 : NumberOfColumns + d->NumberOfMetrics;
+}
+
+//-----------------------------------------------------------------------------
+QVariant qSlicerPathExplorerTrajectoryTableModel
+::data(const QModelIndex& index, int role) const
+{
+  Q_D(const qSlicerPathExplorerTrajectoryTableModel);
+
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->TrajectoryListNode;
+  if (!index.isValid() || !trajectoryList ||
+      index.row() >= trajectoryList->GetNumberOfTrajectories())
+    {
+    return QVariant();
+    }
+
+  int row = index.row();
+  if (role == Qt::DisplayRole || role == Qt::EditRole)
+    {
+    switch (index.column())
+      {
+      case NameColumn:
+        return QString(trajectoryList->GetTrajectoryName(row));
+      case EntryColumn:
+        {
+        vtkMRMLAnnotationFiducialNode* entry = trajectoryList->GetEntryNode(row);
+        return QString(entry ? entry->GetName() : "");
+        }
+      case TargetColumn:
+        {
+        vtkMRMLAnnotationFiducialNode* target = trajectoryList->GetTargetNode(row);
+        return QString(target ? target->GetName() : "");
+        }
+      default:
+        break;
+      }
+    // Metrics are not known (NaN) until they are computed
+    if (index.column() >= NumberOfColumns)
+      {
+      double value = trajectoryList->GetMetricValue(row, index.column() - NumberOfColumns);
+      return vtkMath::IsNan(value) ? QString() : QString::number(value, 'f', 2);
+      }
+    }
+  else if (role == Qt::TextAlignmentRole && index.column() >= NumberOfColumns)
+    {
+    return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+    }
+  else if (role == Qt::CheckStateRole && index.column() == DisplayColumn)
+    {
+    return trajectoryList->GetTrajectoryFlag(row, vtkMRMLPathPlannerTrajectoryNode::PathVisible) ?
+      Qt::Checked : Qt::Unchecked;
+    }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerTrajectoryTableModel
+::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->TrajectoryListNode;
+  if (!index.isValid() || !trajectoryList ||
+      index.row() >= trajectoryList->GetNumberOfTrajectories())
+    {
+    return false;
+    }
+
+  int row = index.row();
+  if (role == Qt::EditRole && index.column() == NameColumn)
+    {
+    QString oldName(trajectoryList->GetTrajectoryName(row));
+    QString newName = value.toString();
+    if (newName == oldName)
+      {
+      return false;
+      }
+    // Ruler is renamed as well. Views are updated on TrajectoryModifiedEvent.
+    trajectoryList->SetTrajectoryName(row, newName.toStdString().c_str());
+    emit trajectoryRenamed(row, oldName);
+    return true;
+    }
+  else if (role == Qt::CheckStateRole && index.column() == DisplayColumn)
+    {
+    trajectoryList->SetTrajectoryFlag(row, vtkMRMLPathPlannerTrajectoryNode::PathVisible,
+                                      value.toInt() == Qt::Checked);
+    return true;
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+Qt::ItemFlags qSlicerPathExplorerTrajectoryTableModel
+::flags(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    {
+    return Qt::NoItemFlags;
+    }
+
+  // Only name is editable
+  Qt::ItemFlags itemFlags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+  if (index.column() == NameColumn)
+    {
+    itemFlags |= Qt::ItemIsEditable;
+    }
+  else if (index.column() == DisplayColumn)
+    {
+    itemFlags |= Qt::ItemIsUserCheckable;
+    }
+  return itemFlags;
+}
+
+//-----------------------------------------------------------------------------
+QVariant qSlicerPathExplorerTrajectoryTableModel
+::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  Q_D(const qSlicerPathExplorerTrajectoryTableModel);
+
+  if (role != Qt::DisplayRole)
+    {
+    return QVariant();
+    }
+
+  if (orientation == Qt::Vertical)
+    {
+    return section + 1;
+    }
+
+  switch (section)
+    {
+    case NameColumn:
+      return tr("Name");
+    case EntryColumn:
+      return tr("Entry Name");
+    case TargetColumn:
+      return tr("Target Name");
+    case DisplayColumn:
+      return tr("Display");
+    default:
+      break;
+    }
+  if (d->TrajectoryListNode && section >= NumberOfColumns)
+    {
+    return QString(d->TrajectoryListNode->GetMetricName(section - NumberOfColumns));
+    }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::onTrajectoryAdded(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryAdded");
+
+  if (caller != d->TrajectoryListNode || !callData)
+    {
+    return;
+    }
+
+  // Rows may already be known if the list was modified in between
+  int row = *reinterpret_cast<int*>(callData);
+  if (d->TrajectoryListNode->GetNumberOfTrajectories() != d->RowCount + 1)
+    {
+    this->onTrajectoryListModified();
+    return;
+    }
+
+  this->beginInsertRows(QModelIndex(), row, row);
+  ++d->RowCount;
+  this->endInsertRows();
+  d->rowsMoved(row);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::onTrajectoryRemoved(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryRemoved");
+
+  if (caller != d->TrajectoryListNode || !callData)
+    {
+    return;
+    }
+
+  int row = *reinterpret_cast<int*>(callData);
+  if (d->TrajectoryListNode->GetNumberOfTrajectories() != d->RowCount - 1)
+    {
+    this->onTrajectoryListModified();
+    return;
+    }
+
+  this->beginRemoveRows(QModelIndex(), row, row);
+  --d->RowCount;
+  this->endRemoveRows();
+  d->rowsMoved(row);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::onTrajectoryModified(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryModified");
+
+  if (caller != d->TrajectoryListNode || !callData)
+    {
+    return;
+    }
+
+  int row = *reinterpret_cast<int*>(callData);
+  if (row < 0 || row >= d->RowCount)
+    {
+    return;
+    }
+  this->rowsModified(row, row);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerTrajectoryTableModel
+::onTrajectoryListModified()
+{
+  Q_D(qSlicerPathExplorerTrajectoryTableModel);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryListModified");
+
+  // Batch modification: rows can't be tracked individually.
+  // Metrics added to the list are new columns.
+  int numberOfTrajectories =
+    d->TrajectoryListNode ? d->TrajectoryListNode->GetNumberOfTrajectories() : 0;
+  int numberOfMetrics =
+    d->TrajectoryListNode ? d->TrajectoryListNode->GetNumberOfMetrics() : 0;
+  if (numberOfTrajectories != d->RowCount || numberOfMetrics != d->NumberOfMetrics)
+    {
+    this->beginResetModel();
+    d->RowCount = numberOfTrajectories;
+    d->NumberOfMetrics = numberOfMetrics;
+    d->DirtyFirstRow = -1;
+    d->DirtyLastRow = -1;
+    this->endResetModel();
+    }
+  else if (d->RowCount > 0)
+    {
+    this->rowsModified(0, d->RowCount - 1);
+    }
+}
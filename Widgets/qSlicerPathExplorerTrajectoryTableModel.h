@@ -0,0 +1,103 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+ 
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+ 
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ 
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+ 
+==============================================================================*/
+
+#ifndef __qSlicerPathExplorerTrajectoryTableModel_h
+#define __qSlicerPathExplorerTrajectoryTableModel_h
+
+// VTK includes
+#include <ctkVTKObject.h>
+
+// SlicerQt includes
+#include "qSlicerPathExplorerModuleWidgetsExport.h"
+
+// Qt includes
+#include <QAbstractTableModel>
+
+class qSlicerPathExplorerTrajectoryTableModelPrivate;
+class qSlicerPathExplorerUpdateScheduler;
+class vtkObject;
+class vtkMRMLPathPlannerTrajectoryNode;
+
+/// \brief Table model of the trajectories of a vtkMRMLPathPlannerTrajectoryNode.
+///
+/// Rows are the rows of the trajectory list node; nothing is copied, cells
+/// are formatted when the view asks for them. The metrics of the list
+/// (e.g. clearance) are shown in columns after NumberOfColumns.
+class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerTrajectoryTableModel
+  : public QAbstractTableModel
+{
+  Q_OBJECT
+  QVTK_OBJECT
+
+public:
+  typedef QAbstractTableModel Superclass;
+  qSlicerPathExplorerTrajectoryTableModel(QObject *parent=0);
+  virtual ~qSlicerPathExplorerTrajectoryTableModel();
+
+  enum Column
+    {
+    NameColumn = 0,
+    EntryColumn,
+    TargetColumn,
+    DisplayColumn,
+    NumberOfColumns
+    };
+
+  void setTrajectoryListNode(vtkMRMLPathPlannerTrajectoryNode* trajectoryList);
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryListNode();
+
+  /// Coalesce the updates of modified rows with a scheduler.
+  /// Without scheduler, views are updated on each event.
+  void setUpdateScheduler(qSlicerPathExplorerUpdateScheduler* scheduler);
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+  virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation,
+                              int role = Qt::DisplayRole) const;
+
+public slots:
+  /// Update the views for the rows modified since the last flush
+  void flushUpdates();
+
+protected slots:
+  void onTrajectoryAdded(vtkObject* caller, void* callData);
+  void onTrajectoryRemoved(vtkObject* caller, void* callData);
+  void onTrajectoryModified(vtkObject* caller, void* callData);
+  void onTrajectoryListModified();
+
+protected:
+  void rowsModified(int firstRow, int lastRow);
+
+  QScopedPointer<qSlicerPathExplorerTrajectoryTableModelPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerPathExplorerTrajectoryTableModel);
+  Q_DISABLE_COPY(qSlicerPathExplorerTrajectoryTableModel);
+
+signals:
+  void trajectoryRenamed(int row, const QString& oldName);
+};
+
+#endif // __qSlicerPathExplorerTrajectoryTableModel_h
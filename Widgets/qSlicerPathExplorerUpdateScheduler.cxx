@@ -0,0 +1,158 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+
+  ==============================================================================*/
+
+// PathExplorer Widgets includes
+#include "qSlicerPathExplorerUpdateScheduler.h"
+
+// Qt includes
+#include <QList>
+#include <QMetaObject>
+#include <QPointer>
+#include <QSet>
+#include <QTime>
+#include <QTimer>
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_PathExplorer
+class qSlicerPathExplorerUpdateSchedulerPrivate
+{
+  Q_DECLARE_PUBLIC(qSlicerPathExplorerUpdateScheduler);
+ protected:
+  qSlicerPathExplorerUpdateScheduler * const q_ptr;
+
+ public:
+  qSlicerPathExplorerUpdateSchedulerPrivate(
+    qSlicerPathExplorerUpdateScheduler& object);
+
+  QTimer                   Timer;
+  QTime                    LastFlush;
+  int                      Interval;
+  // Objects to update, in the order they were scheduled
+  QList<QPointer<QObject> > Pending;
+  QSet<QObject*>           PendingSet;
+};
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerUpdateSchedulerPrivate
+::qSlicerPathExplorerUpdateSchedulerPrivate(
+  qSlicerPathExplorerUpdateScheduler& object)
+  : q_ptr(&object)
+{
+  this->Interval = 16;
+  this->Timer.setSingleShot(true);
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerUpdateScheduler
+::qSlicerPathExplorerUpdateScheduler(QObject *parentObject)
+  : Superclass(parentObject)
+    , d_ptr( new qSlicerPathExplorerUpdateSchedulerPrivate(*this) )
+{
+  Q_D(qSlicerPathExplorerUpdateScheduler);
+  connect(&d->Timer, SIGNAL(timeout()),
+          this, SLOT(flush()));
+}
+
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerUpdateScheduler
+::~qSlicerPathExplorerUpdateScheduler()
+{
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerUpdateScheduler
+::setInterval(int msec)
+{
+  Q_D(qSlicerPathExplorerUpdateScheduler);
+  d->Interval = msec > 0 ? msec : 0;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerPathExplorerUpdateScheduler
+::interval() const
+{
+  Q_D(const qSlicerPathExplorerUpdateScheduler);
+  return d->Interval;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerUpdateScheduler
+::scheduleUpdate(QObject* object)
+{
+  Q_D(qSlicerPathExplorerUpdateScheduler);
+
+  if (!object || d->PendingSet.contains(object))
+    {
+    return;
+    }
+  d->PendingSet.insert(object);
+  d->Pending << QPointer<QObject>(object);
+
+  if (d->Timer.isActive())
+    {
+    return;
+    }
+
+  // Flush right away if the last flush is old enough, otherwise wait for
+  // the end of the interval. Events arriving meanwhile are coalesced.
+  int delay = 0;
+  if (d->LastFlush.isValid())
+    {
+    int elapsed = d->LastFlush.elapsed();
+    if (elapsed >= 0 && elapsed < d->Interval)
+      {
+      delay = d->Interval - elapsed;
+      }
+    }
+  d->Timer.start(delay);
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerUpdateScheduler
+::hasPendingUpdates() const
+{
+  Q_D(const qSlicerPathExplorerUpdateScheduler);
+  return !d->Pending.isEmpty();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerUpdateScheduler
+::flush()
+{
+  Q_D(qSlicerPathExplorerUpdateScheduler);
+
+  d->Timer.stop();
+  d->LastFlush.start();
+
+  // Objects scheduled while flushing are updated at the next flush
+  QList<QPointer<QObject> > pending = d->Pending;
+  d->Pending.clear();
+  d->PendingSet.clear();
+
+  foreach(const QPointer<QObject>& object, pending)
+    {
+    if (object)
+      {
+      QMetaObject::invokeMethod(object, "flushUpdates", Qt::DirectConnection);
+      }
+    }
+}
@@ -0,0 +1,72 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+ 
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+ 
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ 
+  This file was originally developed by Laurent Chauvin, Brigham and Women's
+  Hospital. The project was supported by grants 5P01CA067165,
+  5R01CA124377, 5R01CA138586, 2R44DE019322, 7R01CA124377,
+  5R42CA137886, 8P41EB015898
+ 
+==============================================================================*/
+
+#ifndef __qSlicerPathExplorerUpdateScheduler_h
+#define __qSlicerPathExplorerUpdateScheduler_h
+
+// SlicerQt includes
+#include "qSlicerPathExplorerModuleWidgetsExport.h"
+
+// Qt includes
+#include <QObject>
+
+class qSlicerPathExplorerUpdateSchedulerPrivate;
+
+/// \brief Coalesce the UI updates requested by MRML observers.
+///
+/// Objects observing MRML nodes mark themselves dirty with scheduleUpdate()
+/// instead of updating the UI on each event. Their flushUpdates() slot is
+/// called once per flush, and flushes are at least interval() ms apart,
+/// however many events arrive in between.
+class Q_SLICER_MODULE_PATHEXPLORER_WIDGETS_EXPORT qSlicerPathExplorerUpdateScheduler
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+  typedef QObject Superclass;
+  qSlicerPathExplorerUpdateScheduler(QObject *parent=0);
+  virtual ~qSlicerPathExplorerUpdateScheduler();
+
+  /// Minimum time between two flushes in ms. 16 by default (60 Hz).
+  /// With 0, updates are flushed when control returns to the event loop.
+  void setInterval(int msec);
+  int interval() const;
+
+  /// Call the flushUpdates() slot of the object at the next flush.
+  void scheduleUpdate(QObject* object);
+
+  bool hasPendingUpdates() const;
+
+public slots:
+  /// Flush the pending updates now
+  void flush();
+
+protected:
+  QScopedPointer<qSlicerPathExplorerUpdateSchedulerPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerPathExplorerUpdateScheduler);
+  Q_DISABLE_COPY(qSlicerPathExplorerUpdateScheduler);
+};
+
+#endif // __qSlicerPathExplorerUpdateScheduler_h
@@ -20,8 +20,12 @@
 
   ==============================================================================*/
 
+#include "vtkSlicerVersionConfigure.h"
+
 // Qt includes
 #include <QDebug>
+#include <QFileDialog>
+#include <QHeaderView>
 
 // SlicerQt includes
 #include "qSlicerPathExplorerModuleWidget.h"
@@ -30,22 +34,68 @@
 // Annotation logic
 #include "vtkSlicerAnnotationModuleLogic.h"
 
+// PathExplorer logic
+#include "vtkPathExplorerTaskScheduler.h"
+#include "vtkSlicerPathExplorerLogic.h"
+
 // Slicer
+#include "qMRMLSliceView.h"
+#include "qMRMLSliceWidget.h"
 #include "qSlicerAbstractCoreModule.h"
+#include "qSlicerApplication.h"
 #include "qSlicerCoreApplication.h"
+#include "qSlicerLayoutManager.h"
 #include "qSlicerModuleManager.h"
-#include "qSlicerPathExplorerFiducialItem.h"
-#include "qSlicerPathExplorerTrajectoryItem.h"
+#include "qSlicerPathExplorerFiducialTableModel.h"
+#include "qSlicerPathExplorerObserverRegistry.h"
 #include "qSlicerPathExplorerReslicingWidget.h"
+#include "qSlicerPathExplorerTrajectoryTableModel.h"
+#include "qSlicerPathExplorerUpdateScheduler.h"
 
 // MRML
+#include "vtkMRMLAnnotationFiducialNode.h"
 #include "vtkMRMLAnnotationHierarchyNode.h"
 #include "vtkMRMLAnnotationPointDisplayNode.h"
 #include "vtkMRMLAnnotationRulerNode.h"
 #include "vtkMRMLMarkupsFiducialNode.h"
 #include "vtkMRMLMarkupsDisplayNode.h"
+#include "vtkMRMLModelNode.h"
 #include "vtkMRMLPathPlannerTrajectoryNode.h"
+#include "vtkMRMLScene.h"
 #include "vtkMRMLSliceNode.h"
+#include "vtkMRMLVolumeNode.h"
+
+// VTK includes
+#include "vtkCommand.h"
+#include "vtkMatrix4x4.h"
+#include "vtkWeakPointer.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// True if the slice is already set by SetSliceToRASByNTP(normal, transverse,
+// position, 0)
+bool HasSliceAxes(vtkMRMLSliceNode* sliceNode, const double normal[3],
+                  const double transverse[3], const double position[3])
+{
+  const double tolerance = 1e-6;
+  vtkMatrix4x4* sliceToRAS = sliceNode->GetSliceToRAS();
+  for (int i = 0; i < 3; ++i)
+    {
+    if (fabs(sliceToRAS->GetElement(i, 0) - transverse[i]) > tolerance ||
+        fabs(sliceToRAS->GetElement(i, 2) - normal[i]) > tolerance ||
+        fabs(sliceToRAS->GetElement(i, 3) - position[i]) > tolerance)
+      {
+      return false;
+      }
+    }
+  return true;
+}
+}
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_ExtensionTemplate
@@ -55,10 +105,27 @@ public:
   qSlicerPathExplorerModuleWidgetPrivate();
 
   vtkMRMLPathPlannerTrajectoryNode *selectedTrajectoryNode;
+  vtkMRMLVolumeNode *criticalStructuresNode;
+  // Scene whose events are observed, to disconnect them on scene change
+  vtkWeakPointer<vtkMRMLScene> observedScene;
+  qSlicerPathExplorerTrajectoryTableModel *trajectoryModel;
+  // Table updates requested by MRML events are flushed once per frame
+  qSlicerPathExplorerUpdateScheduler *updateScheduler;
   double targetTableWidgetItemColor[3];
   double entryTableWidgetItemColor[3];
   typedef std::vector<qSlicerPathExplorerReslicingWidget*> ReslicerVector;
   ReslicerVector reslicerList;
+  // Reslicers are added for the slice views shown in the layout at the
+  // next flush
+  bool reslicersModified;
+  // The linked views are resliced at the next flush
+  bool linkedViewsModified;
+  qSlicerPathExplorerReslicingWidget* reslicer(vtkMRMLSliceNode* sliceNode);
+  qMRMLSliceWidget* sliceWidget(vtkMRMLSliceNode* sliceNode);
+  bool isSliceViewVisible(vtkMRMLSliceNode* sliceNode);
+  // Fiducial tables are updated once at the end of a scene batch
+  bool entryViewModified;
+  bool targetViewModified;
 };
 
 //-----------------------------------------------------------------------------
@@ -69,6 +136,13 @@ qSlicerPathExplorerModuleWidgetPrivate::
 qSlicerPathExplorerModuleWidgetPrivate()
 {
   this->selectedTrajectoryNode = NULL;
+  this->criticalStructuresNode = NULL;
+  this->trajectoryModel = NULL;
+  this->updateScheduler = NULL;
+  this->entryViewModified = false;
+  this->targetViewModified = false;
+  this->reslicersModified = false;
+  this->linkedViewsModified = false;
 
   this->targetTableWidgetItemColor[0] = 68;
   this->targetTableWidgetItemColor[1] = 172;
@@ -79,6 +153,45 @@ qSlicerPathExplorerModuleWidgetPrivate()
   this->entryTableWidgetItemColor[2] = 205;
 }
 
+//-----------------------------------------------------------------------------
+qSlicerPathExplorerReslicingWidget* qSlicerPathExplorerModuleWidgetPrivate::
+reslicer(vtkMRMLSliceNode* sliceNode)
+{
+  for (ReslicerVector::iterator it = this->reslicerList.begin();
+       it != this->reslicerList.end(); ++it)
+    {
+    if ((*it)->sliceNode() == sliceNode)
+      {
+      return *it;
+      }
+    }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+qMRMLSliceWidget* qSlicerPathExplorerModuleWidgetPrivate::
+sliceWidget(vtkMRMLSliceNode* sliceNode)
+{
+  qSlicerApplication* application = qSlicerApplication::application();
+  qSlicerLayoutManager* layoutManager = application ? application->layoutManager() : NULL;
+  return layoutManager && sliceNode->GetLayoutName() ?
+    layoutManager->sliceWidget(sliceNode->GetLayoutName()) : NULL;
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerModuleWidgetPrivate::
+isSliceViewVisible(vtkMRMLSliceNode* sliceNode)
+{
+  // Without layout (no main window), all the slice nodes are resliceable
+  qSlicerApplication* application = qSlicerApplication::application();
+  if (!application || !application->layoutManager())
+    {
+    return true;
+    }
+  qMRMLSliceWidget* sliceWidget = this->sliceWidget(sliceNode);
+  return sliceWidget && sliceWidget->isVisible();
+}
+
 //-----------------------------------------------------------------------------
 // qSlicerPathExplorerModuleWidget methods
 
@@ -94,6 +207,27 @@ qSlicerPathExplorerModuleWidget(QWidget* _parent)
 qSlicerPathExplorerModuleWidget::
 ~qSlicerPathExplorerModuleWidget()
 {
+  qSlicerPathExplorerObserverRegistry::unregisterObservers(this);
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (pathExplorerLogic)
+    {
+    pathExplorerLogic->GetTaskScheduler()->SetTaskFinishedCallback(NULL, NULL);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+reconnectObserver(vtkObject* oldObject, vtkObject* newObject, unsigned long event,
+                  const char* slot, const char* callback)
+{
+  qSlicerPathExplorerObserverRegistry::unregisterObserver(oldObject, event, this, callback);
+  qvtkDisconnect(oldObject, event, this, slot);
+  if (qSlicerPathExplorerObserverRegistry::registerObserver(newObject, event, this, callback))
+    {
+    qvtkConnect(newObject, event, this, slot);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -104,16 +238,35 @@ setup()
   d->setupUi(this);
   this->Superclass::setup();
 
+  d->updateScheduler = new qSlicerPathExplorerUpdateScheduler(this);
+
+  // Background tasks finish in the logic workers: their results are
+  // published in the GUI thread
+  connect(this, SIGNAL(tasksFinished()),
+          this, SLOT(onTasksFinished()), Qt::QueuedConnection);
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (pathExplorerLogic)
+    {
+    pathExplorerLogic->GetTaskScheduler()->SetTaskFinishedCallback(
+      qSlicerPathExplorerModuleWidget::notifyTasksFinished, this);
+    }
+  d->TaskProgressBar->setVisible(false);
+
   // Entry table widget
   connect(d->EntryPointListNodeSelector, SIGNAL(nodeActivated(vtkMRMLNode*)),
           this, SLOT(onEntryListNodeChanged(vtkMRMLNode*)));
 
-  connect(d->EntryPointWidget->getTableWidget(), SIGNAL(itemSelectionChanged()),
+  connect(d->EntryPointWidget->getTableView()->selectionModel(),
+          SIGNAL(currentRowChanged(const QModelIndex&, const QModelIndex&)),
           this, SLOT(onEntrySelectionChanged()));
 
   connect(d->EntryPointWidget, SIGNAL(itemDeleted(vtkMRMLAnnotationFiducialNode*)),
           this, SLOT(onEntryPointDeleted(vtkMRMLAnnotationFiducialNode*)));
 
+  connect(d->EntryPointWidget, SIGNAL(itemsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>&)),
+          this, SLOT(onEntryPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>&)));
+
   connect(d->EntryPointWidget, SIGNAL(addButtonToggled(bool)),
           this, SLOT(onEntryTableWidgetAddButtonToggled(bool)));
 
@@ -122,18 +275,28 @@ setup()
                        << d->entryTableWidgetItemColor[0] << ","
                        << d->entryTableWidgetItemColor[1] << ","
                        << d->entryTableWidgetItemColor[2] << ");";
-  d->EntryPointWidget->getTableWidget()->setStyleSheet(entryBackgroundColor.str().c_str());
+  d->EntryPointWidget->getTableView()->setStyleSheet(entryBackgroundColor.str().c_str());
+  d->EntryPointWidget->getModel()->setBackgroundColor(
+    QColor(d->entryTableWidgetItemColor[0],
+           d->entryTableWidgetItemColor[1],
+           d->entryTableWidgetItemColor[2],
+           180));
+  d->EntryPointWidget->getModel()->setUpdateScheduler(d->updateScheduler);
 
   // Target table widget
   connect(d->TargetPointListNodeSelector, SIGNAL(nodeActivated(vtkMRMLNode*)),
           this, SLOT(onTargetListNodeChanged(vtkMRMLNode*)));
 
-  connect(d->TargetPointWidget->getTableWidget(), SIGNAL(itemSelectionChanged()),
+  connect(d->TargetPointWidget->getTableView()->selectionModel(),
+          SIGNAL(currentRowChanged(const QModelIndex&, const QModelIndex&)),
           this, SLOT(onTargetSelectionChanged()));
 
   connect(d->TargetPointWidget, SIGNAL(itemDeleted(vtkMRMLAnnotationFiducialNode*)),
           this, SLOT(onTargetPointDeleted(vtkMRMLAnnotationFiducialNode*)));
 
+  connect(d->TargetPointWidget, SIGNAL(itemsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>&)),
+          this, SLOT(onTargetPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>&)));
+
   connect(d->TargetPointWidget, SIGNAL(addButtonToggled(bool)),
           this, SLOT(onTargetTableWidgetAddButtonToggled(bool)));
 
@@ -142,9 +305,20 @@ setup()
                         << d->targetTableWidgetItemColor[0] << ","
                         << d->targetTableWidgetItemColor[1] << ","
                         << d->targetTableWidgetItemColor[2] << ");";
-  d->TargetPointWidget->getTableWidget()->setStyleSheet(targetBackgroundColor.str().c_str());
+  d->TargetPointWidget->getTableView()->setStyleSheet(targetBackgroundColor.str().c_str());
+  d->TargetPointWidget->getModel()->setBackgroundColor(
+    QColor(d->targetTableWidgetItemColor[0],
+           d->targetTableWidgetItemColor[1],
+           d->targetTableWidgetItemColor[2],
+           180));
+  d->TargetPointWidget->getModel()->setUpdateScheduler(d->updateScheduler);
+
+  // Trajectory table view (rows have the same height)
+  d->trajectoryModel = new qSlicerPathExplorerTrajectoryTableModel(this);
+  d->trajectoryModel->setUpdateScheduler(d->updateScheduler);
+  d->TrajectoryTableView->setModel(d->trajectoryModel);
+  d->TrajectoryTableView->verticalHeader()->setResizeMode(QHeaderView::Fixed);
 
-  // Trajectory table widget
   connect(d->TrajectoryListNodeSelector, SIGNAL(nodeActivated(vtkMRMLNode*)),
           this, SLOT(onTrajectoryListNodeChanged(vtkMRMLNode*)));
 
@@ -160,13 +334,35 @@ setup()
   connect(d->ClearButton, SIGNAL(clicked()),
           this, SLOT(onClearButtonClicked()));
 
-  connect(d->TrajectoryTableWidget->selectionModel(),
+  connect(d->TrajectoryTableView->selectionModel(),
           SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
           this,
           SLOT(onTrajectorySelectionChanged(const QItemSelection&, const QItemSelection&)));
 
-  connect(d->TrajectoryTableWidget, SIGNAL(cellChanged(int,int)),
-          this, SLOT(onTrajectoryCellChanged(int,int)));
+  connect(d->trajectoryModel, SIGNAL(trajectoryRenamed(int,const QString&)),
+          this, SLOT(onTrajectoryRenamed(int,const QString&)));
+
+  // Clearance of the trajectories from the critical structures
+#if (Slicer_VERSION_MAJOR == 4 && Slicer_VERSION_MINOR <= 4)
+  d->CriticalStructuresSelector->addAttribute("vtkMRMLScalarVolumeNode", "LabelMap", "1");
+#else
+  d->CriticalStructuresSelector->setNodeTypes(QStringList("vtkMRMLLabelMapVolumeNode"));
+#endif
+  connect(d->CriticalStructuresSelector, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
+          this, SLOT(onCriticalStructuresChanged(vtkMRMLNode*)));
+
+  connect(d->FindEntryPointsButton, SIGNAL(clicked()),
+          this, SLOT(onFindEntryPointsButtonClicked()));
+  connect(d->AnalyzeRobustnessButton, SIGNAL(clicked()),
+          this, SLOT(onAnalyzeRobustnessButtonClicked()));
+  connect(d->CheckSpacingButton, SIGNAL(clicked()),
+          this, SLOT(onCheckSpacingButtonClicked()));
+  connect(d->ExportSpacingButton, SIGNAL(clicked()),
+          this, SLOT(onExportSpacingButtonClicked()));
+  connect(d->LinkedViewsCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(onLinkedViewsToggled(bool)));
+  connect(d->LinkedViewsSlider, SIGNAL(valueChanged(int)),
+          this, SLOT(onLinkedViewsValueChanged(int)));
 
   // mrmlScene
   connect(this, SIGNAL(mrmlSceneChanged(vtkMRMLScene*)),
@@ -194,11 +390,17 @@ onEntryListNodeChanged(vtkMRMLNode* newList)
     return;
     }
 
-  // Observe new hierarchy node
-  qvtkConnect(entryList, vtkMRMLAnnotationHierarchyNode::ChildNodeAddedEvent,
-              this, SLOT(refreshEntryView()));
-  qvtkConnect(entryList, vtkMRMLAnnotationHierarchyNode::ChildNodeRemovedEvent,
-              this, SLOT(refreshEntryView()));
+  // Observe new hierarchy node only
+  vtkMRMLAnnotationHierarchyNode* oldEntryList =
+    d->EntryPointWidget->selectedHierarchyNode();
+  this->reconnectObserver(oldEntryList, entryList,
+                          vtkMRMLAnnotationHierarchyNode::ChildNodeAddedEvent,
+                          SLOT(onEntryChildNodeAdded(vtkObject*, void*)),
+                          "onEntryChildNodeAdded");
+  this->reconnectObserver(oldEntryList, entryList,
+                          vtkMRMLAnnotationHierarchyNode::ChildNodeRemovedEvent,
+                          SLOT(onEntryChildNodeRemoved(vtkObject*, void*)),
+                          "onEntryChildNodeRemoved");
 
   // Update groupbox name
   std::stringstream groupBoxName;
@@ -231,11 +433,17 @@ onTargetListNodeChanged(vtkMRMLNode* newList)
     return;
     }
 
-  // Observe new hierarchy node
-  qvtkConnect(targetList, vtkMRMLAnnotationHierarchyNode::ChildNodeAddedEvent,
-              this, SLOT(refreshTargetView()));
-  qvtkConnect(targetList, vtkMRMLAnnotationHierarchyNode::ChildNodeRemovedEvent,
-              this, SLOT(refreshTargetView()));
+  // Observe new hierarchy node only
+  vtkMRMLAnnotationHierarchyNode* oldTargetList =
+    d->TargetPointWidget->selectedHierarchyNode();
+  this->reconnectObserver(oldTargetList, targetList,
+                          vtkMRMLAnnotationHierarchyNode::ChildNodeAddedEvent,
+                          SLOT(onTargetChildNodeAdded(vtkObject*, void*)),
+                          "onTargetChildNodeAdded");
+  this->reconnectObserver(oldTargetList, targetList,
+                          vtkMRMLAnnotationHierarchyNode::ChildNodeRemovedEvent,
+                          SLOT(onTargetChildNodeRemoved(vtkObject*, void*)),
+                          "onTargetChildNodeRemoved");
 
   // Update groupbox name
   std::stringstream groupBoxName;
@@ -251,7 +459,8 @@ onTargetListNodeChanged(vtkMRMLNode* newList)
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-addNewFiducialItem(QTableWidget* tableWidget, vtkMRMLAnnotationFiducialNode* fiducialNode)
+initializeFiducial(qSlicerPathExplorerTableWidget* tableWidget,
+                   vtkMRMLAnnotationFiducialNode* fiducialNode, int row)
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
@@ -261,234 +470,629 @@ addNewFiducialItem(QTableWidget* tableWidget, vtkMRMLAnnotationFiducialNode* fid
     }
 
   // Set fiducial properties
+  // Color: blue for entry points, green for target points
   // Opacity: 0.3 by default
-  fiducialNode->GetAnnotationPointDisplayNode()->SetOpacity(0.3);
+  bool target = (tableWidget == d->TargetPointWidget);
+  vtkMRMLAnnotationPointDisplayNode* displayNode =
+    fiducialNode->GetAnnotationPointDisplayNode();
+  if (displayNode)
+    {
+    if (target)
+      {
+      displayNode->SetColor(0,1,0);
+      }
+    else
+      {
+      displayNode->SetColor(0,0,1);
+      }
+    displayNode->SetOpacity(0.3);
+    }
+
+  // Set fiducial name
+  std::stringstream fiducialName;
+  fiducialName << (target ? "T" : "E") << row+1;
+  fiducialNode->SetName(fiducialName.str().c_str());
+}
 
-  // Set fiducial name and define background color
-  QColor* newColor = new QColor();
-  if (tableWidget == d->TargetPointWidget->getTableWidget())
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+selectLastFiducial(qSlicerPathExplorerTableWidget* tableWidget)
+{
+  if (!tableWidget)
     {
-    std::stringstream targetName;
-    targetName << "T" << d->TargetPointWidget->getTableWidget()->rowCount()+1;
-    fiducialNode->SetName(targetName.str().c_str());
-    newColor->setRgb(d->targetTableWidgetItemColor[0],
-                     d->targetTableWidgetItemColor[1],
-                     d->targetTableWidgetItemColor[2],
-                     180);
+    return;
     }
-  else if (tableWidget == d->EntryPointWidget->getTableWidget())
+
+  // Automatic scroll and select last item added
+  QAbstractItemModel* model = tableWidget->getModel();
+  if (model->rowCount() > 0)
     {
-    std::stringstream entryName;
-    entryName << "E" << d->EntryPointWidget->getTableWidget()->rowCount()+1;
-    fiducialNode->SetName(entryName.str().c_str());
-    newColor->setRgb(d->entryTableWidgetItemColor[0],
-                     d->entryTableWidgetItemColor[1],
-                     d->entryTableWidgetItemColor[2],
-                     180);
+    QModelIndex lastIndex = model->index(model->rowCount()-1, 0);
+    tableWidget->getTableView()->scrollTo(lastIndex);
+    tableWidget->getTableView()->setCurrentIndex(lastIndex);
     }
+}
 
-  int numberOfItems = tableWidget->rowCount();
-  tableWidget->insertRow(numberOfItems);
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+refreshEntryView()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  this->refreshFiducialView(d->EntryPointWidget);
+}
 
-  // Add row
-  qSlicerPathExplorerFiducialItem* newItem =
-    new qSlicerPathExplorerFiducialItem();
-  tableWidget->setItem(numberOfItems, 0, newItem);
-  tableWidget->setItem(numberOfItems, 1, new QTableWidgetItem());
-  tableWidget->setItem(numberOfItems, 2, new QTableWidgetItem());
-  tableWidget->setItem(numberOfItems, 3, new QTableWidgetItem());
-  tableWidget->setItem(numberOfItems, 4, new QTableWidgetItem());
-  newItem->setFiducialNode(fiducialNode);
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+refreshTargetView()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  this->refreshFiducialView(d->TargetPointWidget);
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerPathExplorerModuleWidget::
+deferFiducialView(qSlicerPathExplorerTableWidget* tableWidget)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
 
-  // Set background color
-  for (int i = 0; i < 5; ++i)
+  // Fiducial tables are updated once at the end of a scene batch
+  if (!this->mrmlScene() || !this->mrmlScene()->IsBatchProcessing())
     {
-    tableWidget->item(numberOfItems, i)->setBackground(QBrush(*newColor));
+    return false;
     }
 
-  // Automatic scroll and select last item added
-  tableWidget->scrollToItem(tableWidget->item(numberOfItems,1));
-  tableWidget->setCurrentCell(tableWidget->rowCount()-1,0);
+  if (tableWidget == d->EntryPointWidget)
+    {
+    d->entryViewModified = true;
+    }
+  else
+    {
+    d->targetViewModified = true;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+refreshFiducialView(qSlicerPathExplorerTableWidget* tableWidget)
+{
+  vtkMRMLAnnotationHierarchyNode* fiducialList =
+    tableWidget->selectedHierarchyNode();
 
-  // Update item if changed
-  connect(tableWidget, SIGNAL(itemChanged(QTableWidgetItem*)),
-          this, SLOT(onItemChanged(QTableWidgetItem*)));
+  if (!fiducialList || this->deferFiducialView(tableWidget))
+    {
+    return;
+    }
+
+  // Initialize the fiducials of the list, then list them
+  int numberOfFiducials = 0;
+  for(int i = 0; i < fiducialList->GetNumberOfChildrenNodes(); i++)
+    {
+    vtkMRMLAnnotationFiducialNode* fiducialPoint =
+      vtkMRMLAnnotationFiducialNode::SafeDownCast(fiducialList->GetNthChildNode(i)->GetAssociatedNode());
+    if (fiducialPoint)
+      {
+      this->initializeFiducial(tableWidget, fiducialPoint, numberOfFiducials++);
+      }
+    }
+
+  tableWidget->getModel()->setHierarchyNode(fiducialList);
+  this->selectLastFiducial(tableWidget);
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-onItemChanged(QTableWidgetItem *item)
+updateFiducialView(qSlicerPathExplorerTableWidget* tableWidget)
 {
-  if (!item)
+  qSlicerPathExplorerFiducialTableModel* model = tableWidget->getModel();
+  if (!tableWidget->selectedHierarchyNode() || this->deferFiducialView(tableWidget))
     {
     return;
     }
 
-  qSlicerPathExplorerFiducialItem *itemChanged
-    = dynamic_cast<qSlicerPathExplorerFiducialItem*>(item);
+  if (model->hierarchyNode() != tableWidget->selectedHierarchyNode())
+    {
+    this->refreshFiducialView(tableWidget);
+    return;
+    }
 
-  if (!itemChanged)
+  // Only rows of the fiducials added or removed are touched
+  QList<vtkMRMLAnnotationFiducialNode*> addedFiducials = model->updateFromHierarchy();
+  foreach(vtkMRMLAnnotationFiducialNode* fiducialPoint, addedFiducials)
+    {
+    this->initializeFiducial(tableWidget, fiducialPoint, model->rowOf(fiducialPoint));
+    }
+  if (!addedFiducials.isEmpty())
+    {
+    this->selectLastFiducial(tableWidget);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+addFiducialRow(qSlicerPathExplorerTableWidget* tableWidget, void* callData)
+{
+  qSlicerPathExplorerFiducialTableModel* model = tableWidget->getModel();
+  if (this->deferFiducialView(tableWidget))
     {
     return;
     }
 
-  itemChanged->updateItem();
+  // Call data is the hierarchy node of the child added
+  vtkMRMLHierarchyNode* childNode =
+    vtkMRMLHierarchyNode::SafeDownCast(reinterpret_cast<vtkObject*>(callData));
+  vtkMRMLAnnotationFiducialNode* fiducialPoint = childNode ?
+    vtkMRMLAnnotationFiducialNode::SafeDownCast(childNode->GetAssociatedNode()) : NULL;
+  if (!fiducialPoint || model->hierarchyNode() != tableWidget->selectedHierarchyNode())
+    {
+    this->updateFiducialView(tableWidget);
+    return;
+    }
+
+  if (model->rowOf(fiducialPoint) >= 0)
+    {
+    return;
+    }
+
+  this->initializeFiducial(tableWidget, fiducialPoint, model->rowCount());
+  model->addFiducial(fiducialPoint);
+  this->selectLastFiducial(tableWidget);
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-refreshEntryView()
+removeFiducialRow(qSlicerPathExplorerTableWidget* tableWidget, void* callData)
+{
+  qSlicerPathExplorerFiducialTableModel* model = tableWidget->getModel();
+  if (this->deferFiducialView(tableWidget))
+    {
+    return;
+    }
+
+  // The fiducial may already be removed from the scene, in which case
+  // it can't be found from the child and the rows are compared instead
+  vtkMRMLHierarchyNode* childNode =
+    vtkMRMLHierarchyNode::SafeDownCast(reinterpret_cast<vtkObject*>(callData));
+  vtkMRMLAnnotationFiducialNode* fiducialPoint = childNode ?
+    vtkMRMLAnnotationFiducialNode::SafeDownCast(childNode->GetAssociatedNode()) : NULL;
+  if (!fiducialPoint)
+    {
+    this->updateFiducialView(tableWidget);
+    return;
+    }
+
+  model->removeFiducial(fiducialPoint);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onEntryChildNodeAdded(vtkObject* caller, void* callData)
 {
   Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onEntryChildNodeAdded");
+  Q_UNUSED(caller);
+  this->addFiducialRow(d->EntryPointWidget, callData);
+}
 
-  vtkMRMLAnnotationHierarchyNode* entryList =
-    d->EntryPointWidget->selectedHierarchyNode();
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onEntryChildNodeRemoved(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onEntryChildNodeRemoved");
+  Q_UNUSED(caller);
+  this->removeFiducialRow(d->EntryPointWidget, callData);
+}
 
-  if (!entryList)
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTargetChildNodeAdded(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTargetChildNodeAdded");
+  Q_UNUSED(caller);
+  this->addFiducialRow(d->TargetPointWidget, callData);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTargetChildNodeRemoved(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTargetChildNodeRemoved");
+  Q_UNUSED(caller);
+  this->removeFiducialRow(d->TargetPointWidget, callData);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTrajectoryListNodeChanged(vtkMRMLNode* newList)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  if (!newList)
     {
     return;
     }
 
-  // Clear entry table widget
-  d->EntryPointWidget->getTableWidget()->clearContents();
-  d->EntryPointWidget->getTableWidget()->setRowCount(0);
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList =
+    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(newList);
 
-  // Populate table with new items in the new list
-  for(int i = 0; i < entryList->GetNumberOfChildrenNodes(); i++)
+  if (!trajectoryList)
     {
-    vtkMRMLAnnotationFiducialNode* fiducialPoint =
-      vtkMRMLAnnotationFiducialNode::SafeDownCast(entryList->GetNthChildNode(i)->GetAssociatedNode());
-    if (fiducialPoint)
-      {
-      // Set color to blue for entry points
-      fiducialPoint->GetAnnotationPointDisplayNode()->SetColor(0,0,1);
+    return;
+    }
 
-      // Add fiducial
-      this->addNewFiducialItem(d->EntryPointWidget->getTableWidget(), fiducialPoint);
-      }
+  // The logic keeps the clearance up to date: its values are published
+  // at the next flush
+  this->untrackClearance();
+  this->reconnectObserver(d->selectedTrajectoryNode, trajectoryList,
+                          vtkMRMLPathPlannerTrajectoryNode::TrajectoryAddedEvent,
+                          SLOT(onTrajectoryModified(vtkObject*, void*)),
+                          "onTrajectoryModified");
+  this->reconnectObserver(d->selectedTrajectoryNode, trajectoryList,
+                          vtkMRMLPathPlannerTrajectoryNode::TrajectoryModifiedEvent,
+                          SLOT(onTrajectoryModified(vtkObject*, void*)),
+                          "onTrajectoryModified");
+  this->reconnectObserver(d->selectedTrajectoryNode, trajectoryList,
+                          vtkCommand::ModifiedEvent,
+                          SLOT(onTrajectoryListModified()),
+                          "onTrajectoryListModified");
+
+  // Update selected node. The view reads the trajectories from the node.
+  d->selectedTrajectoryNode = trajectoryList;
+  d->trajectoryModel->setTrajectoryListNode(trajectoryList);
+  this->trackClearance();
+  this->updateRobustnessButton();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTrajectoryModified(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryModified");
+
+  if (caller != d->selectedTrajectoryNode || !callData || !d->updateScheduler)
+    {
+    return;
     }
+  d->updateScheduler->scheduleUpdate(this);
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-refreshTargetView()
+onTrajectoryListModified()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onTrajectoryListModified");
+  if (d->updateScheduler)
+    {
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
 
-  vtkMRMLAnnotationHierarchyNode* targetList =
-    d->TargetPointWidget->selectedHierarchyNode();
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onCriticalStructuresChanged(vtkMRMLNode* labelMap)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!targetList)
+  // Label map edits change the distance map
+  vtkMRMLNode* oldLabelMap = d->criticalStructuresNode;
+  d->criticalStructuresNode = vtkMRMLVolumeNode::SafeDownCast(labelMap);
+  this->reconnectObserver(oldLabelMap, d->criticalStructuresNode,
+                          vtkMRMLVolumeNode::ImageDataModifiedEvent,
+                          SLOT(onCriticalStructuresModified()),
+                          "onCriticalStructuresModified");
+  this->trackClearance();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onCriticalStructuresModified()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onCriticalStructuresModified");
+  if (d->updateScheduler)
+    {
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onFindEntryPointsButtonClicked()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkMRMLAnnotationFiducialNode* targetPoint = d->TargetPointWidget->currentFiducialNode();
+  vtkMRMLAnnotationHierarchyNode* entryList = d->EntryPointWidget->selectedHierarchyNode();
+  vtkMRMLModelNode* skinSurface =
+    vtkMRMLModelNode::SafeDownCast(d->SkinSurfaceSelector->currentNode());
+  if (!targetPoint || !entryList || !skinSurface || !d->selectedTrajectoryNode ||
+      !this->mrmlScene())
     {
     return;
     }
 
-  // Clear target table widget
-  d->TargetPointWidget->getTableWidget()->clearContents();
-  d->TargetPointWidget->getTableWidget()->setRowCount(0);
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  qSlicerAbstractCoreModule* annotationModule =
+    qSlicerCoreApplication::application()->moduleManager()->module("Annotations");
+  vtkSlicerAnnotationModuleLogic* annotationLogic = annotationModule ?
+    vtkSlicerAnnotationModuleLogic::SafeDownCast(annotationModule->logic()) : NULL;
+  if (!pathExplorerLogic || !annotationLogic)
+    {
+    return;
+    }
 
-  // Populate table with new items in the new list
-  for(int i = 0; i < targetList->GetNumberOfChildrenNodes(); i++)
+  vtkSlicerPathExplorerLogic::EntryPointList entryPoints;
+  if (!pathExplorerLogic->FindEntryPoints(targetPoint, skinSurface, d->criticalStructuresNode,
+                                          d->NumberOfEntryPointsSpinBox->value(),
+                                          entryPoints))
     {
-    vtkMRMLAnnotationFiducialNode* fiducialPoint =
-      vtkMRMLAnnotationFiducialNode::SafeDownCast(targetList->GetNthChildNode(i)->GetAssociatedNode());
-    if (fiducialPoint)
-      {
-      // Set color to blue for entry points
-      fiducialPoint->GetAnnotationPointDisplayNode()->SetColor(0,1,0);
+    return;
+    }
 
-      // Add fiducial
-      this->addNewFiducialItem(d->TargetPointWidget->getTableWidget(), fiducialPoint);
-      }
+  // The annotation logic parents the new fiducials to the active hierarchy
+  pathExplorerLogic->StartBatch();
+  if (annotationLogic->GetActiveHierarchyNode() != entryList)
+    {
+    annotationLogic->SetActiveHierarchyNodeID(entryList->GetID());
     }
+  QList<vtkMRMLAnnotationFiducialNode*> entryFiducials;
+  for (size_t i = 0; i < entryPoints.size(); ++i)
+    {
+    vtkMRMLAnnotationFiducialNode* entryPoint = vtkMRMLAnnotationFiducialNode::New();
+    std::stringstream entryName;
+    entryName << targetPoint->GetName() << "_Entry";
+    std::string uniqueName = this->mrmlScene()->GetUniqueNameByString(entryName.str().c_str());
+    entryPoint->SetName(uniqueName.c_str());
+    entryPoint->SetFiducialWorldCoordinates(entryPoints[i].Position);
+    entryPoint->Initialize(this->mrmlScene());
+    entryFiducials.append(entryPoint);
+    entryPoint->Delete();
+    }
+  foreach(vtkMRMLAnnotationFiducialNode* entryPoint, entryFiducials)
+    {
+    this->addNewRulerItem(entryPoint, targetPoint);
+    }
+  pathExplorerLogic->EndBatch();
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-onTrajectoryListNodeChanged(vtkMRMLNode* newList)
+onAnalyzeRobustnessButtonClicked()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!newList)
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic || !d->selectedTrajectoryNode || !d->criticalStructuresNode)
     {
     return;
     }
 
-  vtkMRMLPathPlannerTrajectoryNode* trajectoryList =
-    vtkMRMLPathPlannerTrajectoryNode::SafeDownCast(newList);
+  // The analysis runs in the background, the button cancels it meanwhile.
+  // Probabilities and robust clearance are stored in metrics of the list
+  // when it is finished (see onTasksFinished).
+  if (pathExplorerLogic->IsAnalyzingRobustness(d->selectedTrajectoryNode))
+    {
+    pathExplorerLogic->CancelRobustnessAnalysis(d->selectedTrajectoryNode);
+    }
+  else
+    {
+    pathExplorerLogic->SetPositionErrorStandardDeviation(d->TargetingErrorSpinBox->value());
+    pathExplorerLogic->StartRobustnessAnalysis(d->selectedTrajectoryNode,
+                                               d->criticalStructuresNode);
+    }
+  this->updateRobustnessButton();
 
-  if (!trajectoryList)
+  // Progress is polled while the task is pending
+  if (d->updateScheduler)
+    {
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+updateRobustnessButton()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  bool analyzing = pathExplorerLogic &&
+    pathExplorerLogic->IsAnalyzingRobustness(d->selectedTrajectoryNode);
+  d->AnalyzeRobustnessButton->setText(analyzing ? tr("Cancel Analysis") :
+                                      tr("Analyze Robustness"));
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onCheckSpacingButtonClicked()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic || !d->selectedTrajectoryNode)
     {
     return;
     }
 
-  // Update selected node
-  d->selectedTrajectoryNode = trajectoryList;
+  // Spacing and violations are stored in metrics of the list
+  pathExplorerLogic->SetMinimumTrajectorySpacing(d->MinimumSpacingSpinBox->value());
+  vtkSlicerPathExplorerLogic::TrajectoryPairList violations;
+  pathExplorerLogic->ComputeTrajectorySpacing(d->selectedTrajectoryNode, violations);
+}
 
-  // Clear widget
-  d->TrajectoryTableWidget->clearContents();
-  d->TrajectoryTableWidget->setRowCount(0);
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onExportSpacingButtonClicked()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
 
-  // TODO: Populate table with trajectory in new node
-  // How to know which fiducials have been used to create ruler ?
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic || !d->selectedTrajectoryNode)
+    {
+    return;
+    }
+
+  QString fileName = QFileDialog::getSaveFileName(
+    this, tr("Export Spacing Violations"), QString(), tr("CSV files (*.csv)"));
+  if (fileName.isEmpty())
+    {
+    return;
+    }
+  pathExplorerLogic->SetMinimumTrajectorySpacing(d->MinimumSpacingSpinBox->value());
+  vtkSlicerPathExplorerLogic::TrajectoryPairList violations;
+  if (pathExplorerLogic->ComputeTrajectorySpacing(d->selectedTrajectoryNode, violations))
+    {
+    pathExplorerLogic->WriteTrajectoryPairs(d->selectedTrajectoryNode, violations,
+                                            fileName.toLatin1().constData());
+    }
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-onAddButtonClicked()
+trackClearance()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->EntryPointWidget || !d->TargetPointWidget ||
-      !d->TrajectoryTableWidget)
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic || !d->selectedTrajectoryNode)
     {
     return;
     }
 
-  if (!d->EntryPointWidget->getTableWidget() ||
-      !d->TargetPointWidget->getTableWidget())
+  // Only the trajectories moved since the last update are recomputed, in
+  // the background
+  if (!d->criticalStructuresNode)
     {
+    this->untrackClearance();
     return;
     }
+  pathExplorerLogic->TrackMetric(d->selectedTrajectoryNode,
+                                 vtkSlicerPathExplorerLogic::GetClearanceMetricName(),
+                                 vtkSlicerPathExplorerLogic::ClearanceMetric,
+                                 d->criticalStructuresNode);
+  if (d->updateScheduler)
+    {
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+untrackClearance()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (pathExplorerLogic && d->selectedTrajectoryNode)
+    {
+    pathExplorerLogic->UntrackMetric(d->selectedTrajectoryNode,
+                                     vtkSlicerPathExplorerLogic::GetClearanceMetricName());
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+notifyTasksFinished(void* clientData)
+{
+  // Called in a worker thread: only the queued signal crosses over
+  qSlicerPathExplorerModuleWidget* self =
+    reinterpret_cast<qSlicerPathExplorerModuleWidget*>(clientData);
+  emit self->tasksFinished();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTasksFinished()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic)
+    {
+    return;
+    }
+
+  // Publish the computed values (tracked metrics, robustness analyses) and
+  // start the computation of the values invalidated meanwhile
+  pathExplorerLogic->UpdateMetrics();
+  this->updateRobustnessButton();
+  for (qSlicerPathExplorerModuleWidgetPrivate::ReslicerVector::iterator it = d->reslicerList.begin();
+       it != d->reslicerList.end(); ++it)
+    {
+    (*it)->refreshCache();
+    }
+  if (d->updateScheduler)
+    {
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+flushUpdates()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
 
-  // Get target position
-  double targetRow = d->TargetPointWidget->getTableWidget()->currentRow();
-  if (targetRow < 0)
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic)
     {
     return;
     }
 
-  qSlicerPathExplorerFiducialItem* targetItem
-    = dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TargetPointWidget->getTableWidget()->item(targetRow, 0));
-  if (!targetItem)
+  // Progress is polled while tasks are pending
+  vtkPathExplorerTaskScheduler* taskScheduler = pathExplorerLogic->GetTaskScheduler();
+  bool pending = taskScheduler->GetNumberOfPendingTasks() > 0;
+  d->TaskProgressBar->setVisible(pending);
+  d->TaskProgressBar->setValue(qRound(100.0 * taskScheduler->GetProgress()));
+  if (pending && d->updateScheduler)
     {
-    return;
+    d->updateScheduler->scheduleUpdate(this);
     }
 
-  vtkMRMLAnnotationFiducialNode* targetFiducial
-    = targetItem->getFiducialNode();
-  if (!targetFiducial)
+  if (d->reslicersModified)
     {
-    return;
+    d->reslicersModified = false;
+    this->updateReslicers();
     }
-
-  // Get entry position
-  double entryRow = d->EntryPointWidget->getTableWidget()->currentRow();
-  if (entryRow < 0)
+  if (d->linkedViewsModified)
     {
-    return;
+    d->linkedViewsModified = false;
+    this->resliceLinkedViews();
     }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onAddButtonClicked()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
 
-  qSlicerPathExplorerFiducialItem* entryItem
-    = dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->EntryPointWidget->getTableWidget()->item(entryRow, 0));
-  if (!entryItem)
+  if (!d->EntryPointWidget || !d->TargetPointWidget ||
+      !d->TrajectoryTableView)
     {
     return;
     }
 
-  vtkMRMLAnnotationFiducialNode* entryFiducial
-    = entryItem->getFiducialNode();
-  if (!entryFiducial)
+  // Get target and entry points
+  vtkMRMLAnnotationFiducialNode* targetFiducial =
+    d->TargetPointWidget->currentFiducialNode();
+  vtkMRMLAnnotationFiducialNode* entryFiducial =
+    d->EntryPointWidget->currentFiducialNode();
+  if (!targetFiducial || !entryFiducial)
     {
     return;
     }
@@ -497,8 +1101,8 @@ onAddButtonClicked()
   this->addNewRulerItem(entryFiducial, targetFiducial);
 
   // Automatically select last trajectory created
-  double rowCount = d->TrajectoryTableWidget->rowCount();
-  d->TrajectoryTableWidget->selectRow(rowCount-1);
+  int rowCount = d->trajectoryModel->rowCount();
+  d->TrajectoryTableView->selectRow(rowCount-1);
 }
 
 //-----------------------------------------------------------------------------
@@ -507,7 +1111,7 @@ onDeleteButtonClicked()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  int selectedRow = d->TrajectoryTableWidget->currentRow();
+  int selectedRow = d->TrajectoryTableView->currentIndex().row();
   if (selectedRow < 0)
     {
     return;
@@ -519,36 +1123,57 @@ onDeleteButtonClicked()
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
 deleteTrajectory(int trajectoryRow)
+{
+  std::vector<int> trajectoryRows(1, trajectoryRow);
+  this->deleteTrajectories(trajectoryRows);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+deleteTrajectories(std::vector<int>& trajectoryRows)
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!this->mrmlScene())
+  if (!this->mrmlScene() || !d->selectedTrajectoryNode || trajectoryRows.empty())
+    {
+    return;
+    }
+
+  std::sort(trajectoryRows.begin(), trajectoryRows.end());
+  trajectoryRows.erase(std::unique(trajectoryRows.begin(), trajectoryRows.end()),
+                       trajectoryRows.end());
+
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic)
     {
     return;
     }
 
-  // Remove ruler from scene
-  qSlicerPathExplorerTrajectoryItem* itemToRemove =
-    dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(trajectoryRow,0));
-  if (itemToRemove)
+  // Remove trajectories (and their rulers) from list node in one pass.
+  // A single row is removed on its own so the view keeps its state.
+  pathExplorerLogic->StartBatch();
+  if (trajectoryRows.size() == 1)
+    {
+    d->selectedTrajectoryNode->RemoveTrajectory(trajectoryRows.front());
+    }
+  else
     {
-    this->mrmlScene()->RemoveNode(itemToRemove->trajectoryNode());
+    d->selectedTrajectoryNode->RemoveTrajectories(trajectoryRows);
     }
 
-  // BUG: ModifiedEvent seems not to be triggered when removing a child node of hierarchy
-  // Workaround: Call it manually
   qSlicerAbstractCoreModule* annotationModule =
     qSlicerCoreApplication::application()->moduleManager()->module("Annotations");
-  vtkSlicerAnnotationModuleLogic* annotationLogic;
   if (annotationModule)
     {
-    annotationLogic =
+    vtkSlicerAnnotationModuleLogic* annotationLogic =
       vtkSlicerAnnotationModuleLogic::SafeDownCast(annotationModule->logic());
+    if (annotationLogic)
+      {
+      pathExplorerLogic->HierarchyModified(annotationLogic->GetActiveHierarchyNode());
+      }
     }
-  annotationLogic->GetActiveHierarchyNode()->Modified();
-
-  // Remove from widget
-  d->TrajectoryTableWidget->removeRow(trajectoryRow);
+  pathExplorerLogic->EndBatch();
 }
 
 //-----------------------------------------------------------------------------
@@ -557,7 +1182,7 @@ onUpdateButtonClicked()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
+  if (!d->TrajectoryTableView || !d->selectedTrajectoryNode)
     {
     return;
     }
@@ -568,57 +1193,45 @@ onUpdateButtonClicked()
     return;
     }
 
-  QTableWidget* targetTable = d->TargetPointWidget->getTableWidget();
-  QTableWidget* entryTable = d->EntryPointWidget->getTableWidget();
-
-  if (!targetTable ||
-      !entryTable)
-    {
-    return;
-    }
-
-  // Get selected rows
-  int trajectoryRow = d->TrajectoryTableWidget->currentRow();
-  int targetRow = targetTable->currentRow();
-  int entryRow = entryTable->currentRow();
+  // Get selected trajectory and points
+  int trajectoryRow = d->TrajectoryTableView->currentIndex().row();
+  vtkMRMLAnnotationFiducialNode* targetPoint = d->TargetPointWidget->currentFiducialNode();
+  vtkMRMLAnnotationFiducialNode* entryPoint = d->EntryPointWidget->currentFiducialNode();
 
   if ((trajectoryRow < 0) ||
-      (targetRow < 0) ||
-      (entryRow < 0))
+      !targetPoint ||
+      !entryPoint)
     {
     return;
     }
 
-  // Get items
-  qSlicerPathExplorerFiducialItem *targetItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(targetTable->item(targetRow,0));
-  qSlicerPathExplorerFiducialItem *entryItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(entryTable->item(entryRow,0));
-  qSlicerPathExplorerTrajectoryItem *trajectoryItem =
-    dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(trajectoryRow,0));
-
-  if (!targetItem ||
-      !entryItem ||
-      !trajectoryItem)
+  vtkSlicerPathExplorerLogic* pathExplorerLogic =
+    vtkSlicerPathExplorerLogic::SafeDownCast(this->logic());
+  if (!pathExplorerLogic)
     {
     return;
     }
 
-  // Update trajectory
-  if (trajectoryItem->entryPoint() != entryItem->getFiducialNode())
+  // Update trajectory (ruler moved and renamed in a single batch)
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->selectedTrajectoryNode;
+  pathExplorerLogic->StartBatch();
+  if (trajectoryList->GetEntryNode(trajectoryRow) != entryPoint)
     {
-    trajectoryItem->setEntryPoint(entryItem->getFiducialNode());
+    entryPoint->GetAnnotationPointDisplayNode()->SetGlyphType(vtkMRMLAnnotationPointDisplayNode::Sphere3D);
+    trajectoryList->SetEntryNodeID(trajectoryRow, entryPoint->GetID());
     }
 
-  if (trajectoryItem->targetPoint() != targetItem->getFiducialNode())
+  if (trajectoryList->GetTargetNode(trajectoryRow) != targetPoint)
     {
-    trajectoryItem->setTargetPoint(targetItem->getFiducialNode());
+    targetPoint->GetAnnotationPointDisplayNode()->SetGlyphType(vtkMRMLAnnotationPointDisplayNode::Sphere3D);
+    trajectoryList->SetTargetNodeID(trajectoryRow, targetPoint->GetID());
     }
 
   // Update trajectory name
   std::stringstream trajectoryName;
-  trajectoryName << trajectoryItem->entryPoint()->GetName() << trajectoryItem->targetPoint()->GetName();
-  trajectoryItem->setText(trajectoryName.str().c_str());
+  trajectoryName << entryPoint->GetName() << targetPoint->GetName();
+  trajectoryList->SetTrajectoryName(trajectoryRow, trajectoryName.str().c_str());
+  pathExplorerLogic->EndBatch();
 
   d->UpdateButton->setEnabled(0);
 }
@@ -634,11 +1247,12 @@ onClearButtonClicked()
     return;
     }
 
-  int numberOfRows = d->TrajectoryTableWidget->rowCount();
-  for (int i = 0; i < numberOfRows; i++)
+  std::vector<int> trajectoryRows(d->selectedTrajectoryNode->GetNumberOfTrajectories());
+  for (size_t row = 0; row < trajectoryRows.size(); ++row)
     {
-    this->deleteTrajectory(0);
+    trajectoryRows[row] = static_cast<int>(row);
     }
+  this->deleteTrajectories(trajectoryRows);
 }
 
 //-----------------------------------------------------------------------------
@@ -657,68 +1271,25 @@ addNewRulerItem(vtkMRMLAnnotationFiducialNode* entryPoint, vtkMRMLAnnotationFidu
     return;
     }
 
-  double rowCount = d->TrajectoryTableWidget->rowCount();
-
-  // Check ruler not already existing
-  for (int i = 0; i < rowCount; i++)
-    {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(i,0));
-    if (currentItem)
-      {
-      if (currentItem->entryPoint() == entryPoint)
-        {
-        if (currentItem->targetPoint() == targetPoint)
-          {
-          // Trajectory alread exists
-          return;
-          }
-        }
-      }
-    }
-
-  // Set active hierachy node
-  qSlicerAbstractCoreModule* annotationModule =
-    qSlicerCoreApplication::application()->moduleManager()->module("Annotations");
-  vtkSlicerAnnotationModuleLogic* annotationLogic;
-  if (annotationModule)
-    {
-    annotationLogic =
-      vtkSlicerAnnotationModuleLogic::SafeDownCast(annotationModule->logic());
-    }
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->selectedTrajectoryNode;
 
-  if (annotationLogic->GetActiveHierarchyNode() != d->selectedTrajectoryNode)
+  // Check trajectory not already existing
+  if (trajectoryList->FindTrajectory(entryPoint->GetID(), targetPoint->GetID()) >= 0)
     {
-    annotationLogic->SetActiveHierarchyNodeID(d->selectedTrajectoryNode->GetID());
+    return;
     }
 
-  // Insert new row
-  d->TrajectoryTableWidget->insertRow(rowCount);
-
-  // Populate row
-  QTableWidgetItem* checkboxItem = new QTableWidgetItem();
-  checkboxItem->setCheckState(Qt::Checked);
-
-  qSlicerPathExplorerTrajectoryItem* newTrajectory = new qSlicerPathExplorerTrajectoryItem();
-  d->TrajectoryTableWidget->setItem(rowCount, 0, newTrajectory);
-  d->TrajectoryTableWidget->setItem(rowCount, 1, new QTableWidgetItem());
-  d->TrajectoryTableWidget->setItem(rowCount, 2, new QTableWidgetItem());
-  d->TrajectoryTableWidget->setItem(rowCount, 3, checkboxItem);
-
-  newTrajectory->setEntryPoint(entryPoint);
-  newTrajectory->setTargetPoint(targetPoint);
+  // Add trajectory to the list node (ruler is created there)
+  entryPoint->GetAnnotationPointDisplayNode()->SetGlyphType(vtkMRMLAnnotationPointDisplayNode::Sphere3D);
+  targetPoint->GetAnnotationPointDisplayNode()->SetGlyphType(vtkMRMLAnnotationPointDisplayNode::Sphere3D);
 
-  // Set only name editable
-  d->TrajectoryTableWidget->item(rowCount,1)->setFlags(d->TrajectoryTableWidget->item(rowCount,1)->flags() & ~Qt::ItemIsEditable);
-  d->TrajectoryTableWidget->item(rowCount,2)->setFlags(d->TrajectoryTableWidget->item(rowCount,2)->flags() & ~Qt::ItemIsEditable);
-
-  // Automatic scroll to last item added
-  d->TrajectoryTableWidget->scrollToItem(d->TrajectoryTableWidget->item(rowCount,0));
-
-  // Update trajectory name
   std::stringstream trajectoryName;
   trajectoryName << entryPoint->GetName() << targetPoint->GetName();
-  newTrajectory->setText(trajectoryName.str().c_str());
+  int trajectoryRow =
+    trajectoryList->AddTrajectory(entryPoint, targetPoint, trajectoryName.str().c_str());
+
+  // Automatic scroll to last item added
+  d->TrajectoryTableView->scrollTo(d->trajectoryModel->index(trajectoryRow, 0));
 }
 
 //-----------------------------------------------------------------------------
@@ -729,66 +1300,42 @@ onTrajectorySelectionChanged(const QItemSelection& selected, const QItemSelectio
   Q_UNUSED(deselected);
   Q_UNUSED(selected);
 
-  if (!d->TrajectoryTableWidget ||
+  if (!d->TrajectoryTableView ||
       !d->EntryPointWidget ||
-      !d->TargetPointWidget)
+      !d->TargetPointWidget ||
+      !d->selectedTrajectoryNode)
     {
     return;
     }
 
-  int row = d->TrajectoryTableWidget->currentRow();
-
-  //  Get item selected
-  qSlicerPathExplorerTrajectoryItem* selectedTrajectory
-    = dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-  if (!selectedTrajectory)
+  int row = d->TrajectoryTableView->currentIndex().row();
+  if (row < 0)
     {
     return;
     }
 
-  // Find target point
+  // Find target point. Select it.
   vtkMRMLAnnotationFiducialNode* targetFiducial =
-    selectedTrajectory->targetPoint();
-  if (targetFiducial)
+    d->selectedTrajectoryNode->GetTargetNode(row);
+  int targetRow = d->TargetPointWidget->getModel()->rowOf(targetFiducial);
+  if (targetRow >= 0)
     {
-    for (int i = 0; i < d->TargetPointWidget->getTableWidget()->rowCount(); i++)
-      {
-      qSlicerPathExplorerFiducialItem* currentFiducial =
-        dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TargetPointWidget->getTableWidget()->item(i,0));
-      if (currentFiducial)
-        {
-        if (currentFiducial->getFiducialNode() == targetFiducial)
-          {
-          // Target found. Select it.
-          d->TargetPointWidget->getTableWidget()->setCurrentCell(i,0);
-          break;
-          }
-        }
-      }
+    d->TargetPointWidget->getTableView()->setCurrentIndex(
+      d->TargetPointWidget->getModel()->index(targetRow, 0));
     }
 
-  // Find entry point
+  // Find entry point. Select it.
   vtkMRMLAnnotationFiducialNode* entryFiducial =
-    selectedTrajectory->entryPoint();
-  if (entryFiducial)
+    d->selectedTrajectoryNode->GetEntryNode(row);
+  int entryRow = d->EntryPointWidget->getModel()->rowOf(entryFiducial);
+  if (entryRow >= 0)
     {
-    for (int i = 0; i < d->EntryPointWidget->getTableWidget()->rowCount(); i++)
-      {
-      qSlicerPathExplorerFiducialItem* currentFiducial =
-        dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->EntryPointWidget->getTableWidget()->item(i,0));
-      if (currentFiducial)
-        {
-        if (currentFiducial->getFiducialNode() == entryFiducial)
-          {
-          // Entry found. Select it.
-          d->EntryPointWidget->getTableWidget()->setCurrentCell(i,0);
-          break;
-          }
-        }
-      }
+    d->EntryPointWidget->getTableView()->setCurrentIndex(
+      d->EntryPointWidget->getModel()->index(entryRow, 0));
     }
 
-  // Set trajectory items to all reslicer widgets
+  // Set trajectory to all reslicer widgets
+  int trajectoryUID = d->selectedTrajectoryNode->GetTrajectoryUID(row);
   for (qSlicerPathExplorerModuleWidgetPrivate::ReslicerVector::iterator it = d->reslicerList.begin();
        it != d->reslicerList.end(); ++it)
     {
@@ -796,9 +1343,13 @@ onTrajectorySelectionChanged(const QItemSelection& selected, const QItemSelectio
       = *it;
     if (currentReslicer)
       {
-      currentReslicer->setTrajectoryItem(selectedTrajectory);
+      currentReslicer->setTrajectory(d->selectedTrajectoryNode, trajectoryUID);
       }
     }
+  if (d->LinkedViewsCheckBox->isChecked())
+    {
+    this->onLinkedViewsValueChanged(d->LinkedViewsSlider->value());
+    }
 }
 
 
@@ -850,6 +1401,10 @@ onMRMLSceneChanged(vtkMRMLScene* newScene)
       }
     }
 
+  // Fiducial tables modified during a batch are refreshed at its end
+  this->reconnectObserver(d->observedScene, newScene, vtkMRMLScene::EndBatchProcessEvent,
+                          SLOT(onMRMLSceneEndBatchProcess()), "onMRMLSceneEndBatchProcess");
+
   // Create new PathPlannerTrajectory Node
   d->TrajectoryListNodeSelector->addNode();
 
@@ -860,14 +1415,241 @@ onMRMLSceneChanged(vtkMRMLScene* newScene)
     delete item->widget();
     delete item;
     }
+  d->reslicerList.clear();
+
+  // Slice views come and go with the layout: reslicing widgets follow
+  this->reconnectObserver(d->observedScene, newScene, vtkMRMLScene::NodeAddedEvent,
+                          SLOT(onMRMLSceneNodeAdded(vtkObject*, void*)), "onMRMLSceneNodeAdded");
+  this->reconnectObserver(d->observedScene, newScene, vtkMRMLScene::NodeRemovedEvent,
+                          SLOT(onMRMLSceneNodeRemoved(vtkObject*, void*)), "onMRMLSceneNodeRemoved");
+  d->observedScene = newScene;
+  qSlicerApplication* application = qSlicerApplication::application();
+  if (application && application->layoutManager())
+    {
+    connect(application->layoutManager(), SIGNAL(layoutChanged(int)),
+            this, SLOT(onLayoutChanged()), Qt::UniqueConnection);
+    }
+  this->updateReslicers();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+updateReslicers()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  vtkMRMLScene* scene = this->mrmlScene();
+  if (!scene)
+    {
+    return;
+    }
+
+  // Reslicing widgets are created the first time their view is shown, and
+  // hidden with it
+  int numberOfSliceNodes = scene->GetNumberOfNodesByClass("vtkMRMLSliceNode");
+  for (int i = 0; i < numberOfSliceNodes; ++i)
+    {
+    vtkMRMLSliceNode* sliceNode =
+      vtkMRMLSliceNode::SafeDownCast(scene->GetNthNodeByClass(i, "vtkMRMLSliceNode"));
+    if (!sliceNode)
+      {
+      continue;
+      }
+    bool visible = d->isSliceViewVisible(sliceNode);
+    qSlicerPathExplorerReslicingWidget* reslicer = d->reslicer(sliceNode);
+    if (reslicer)
+      {
+      reslicer->setVisible(visible);
+      }
+    else if (visible)
+      {
+      this->addNewReslicer(sliceNode);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onMRMLSceneNodeAdded(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onMRMLSceneNodeAdded");
+  Q_UNUSED(caller);
+
+  // Views are shown once the layout is updated: reslicers are added at the
+  // next flush, once for all the nodes of a batch
+  if (vtkMRMLSliceNode::SafeDownCast(reinterpret_cast<vtkObject*>(callData)) &&
+      d->updateScheduler)
+    {
+    d->reslicersModified = true;
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onMRMLSceneNodeRemoved(vtkObject* caller, void* callData)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onMRMLSceneNodeRemoved");
+  Q_UNUSED(caller);
+
+  vtkMRMLSliceNode* sliceNode =
+    vtkMRMLSliceNode::SafeDownCast(reinterpret_cast<vtkObject*>(callData));
+  qSlicerPathExplorerReslicingWidget* reslicer = sliceNode ? d->reslicer(sliceNode) : NULL;
+  if (!reslicer)
+    {
+    return;
+    }
+  d->reslicerList.erase(std::find(d->reslicerList.begin(), d->reslicerList.end(), reslicer));
+  d->ReslicingWidgetLayout->removeWidget(reslicer);
+  delete reslicer;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onLinkedViewsToggled(bool linked)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  d->LinkedViewsSlider->setEnabled(linked);
+  if (linked)
+    {
+    this->onLinkedViewsValueChanged(d->LinkedViewsSlider->value());
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onLinkedViewsValueChanged(int value)
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  Q_UNUSED(value);
+
+  // Only the last value is resliced
+  if (!d->updateScheduler)
+    {
+    this->resliceLinkedViews();
+    return;
+    }
+  d->linkedViewsModified = true;
+  d->updateScheduler->scheduleUpdate(this);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+resliceLinkedViews()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+
+  int row = d->TrajectoryTableView->currentIndex().row();
+  if (!d->LinkedViewsCheckBox->isChecked() || !d->selectedTrajectoryNode || row < 0)
+    {
+    return;
+    }
+
+  // Views of the first three reslicing widgets shown: perpendicular to the
+  // trajectory, then in-plane at 0 and 90 degrees
+  const int numberOfLinkedViews = 3;
+  vtkMRMLSliceNode* sliceNodes[numberOfLinkedViews];
+  int numberOfSliceNodes = 0;
+  for (qSlicerPathExplorerModuleWidgetPrivate::ReslicerVector::iterator it = d->reslicerList.begin();
+       it != d->reslicerList.end() && numberOfSliceNodes < numberOfLinkedViews; ++it)
+    {
+    if (!(*it)->isHidden() && (*it)->sliceNode())
+      {
+      sliceNodes[numberOfSliceNodes++] = (*it)->sliceNode();
+      }
+    }
+
+  // All the slices are computed first, then committed together so that
+  // the views are updated in the same pass
+  double entry[3];
+  double target[3];
+  d->selectedTrajectoryNode->GetEntryPosition(row, entry);
+  d->selectedTrajectoryNode->GetTargetPosition(row, target);
+  double position = d->LinkedViewsSlider->value();
+  double normals[numberOfLinkedViews][3];
+  double transverses[numberOfLinkedViews][3];
+  double positions[numberOfLinkedViews][3];
+  qSlicerPathExplorerReslicingWidget::computeSliceAxes(
+    entry, target, true, position, normals[0], transverses[0], positions[0]);
+  for (int i = 1; i < numberOfLinkedViews; ++i)
+    {
+    // In-plane views contain the trajectory and are centered on the slider
+    // position too, so the three views follow the same point
+    qSlicerPathExplorerReslicingWidget::computeSliceAxes(
+      entry, target, false, (i - 1) * 90.0, normals[i], transverses[i], positions[i]);
+    std::copy(positions[0], positions[0] + 3, positions[i]);
+    }
+
+  // Rendering of the views is paused until all the slices are set, a
+  // slider step renders each moved view once
+  std::vector<vtkMRMLSliceNode*> movedSliceNodes;
+  std::vector<qMRMLSliceView*> pausedViews;
+  for (int i = 0; i < numberOfSliceNodes; ++i)
+    {
+    if (HasSliceAxes(sliceNodes[i], normals[i], transverses[i], positions[i]))
+      {
+      continue;
+      }
+    movedSliceNodes.push_back(sliceNodes[i]);
+    qMRMLSliceWidget* sliceWidget = d->sliceWidget(sliceNodes[i]);
+    if (sliceWidget && sliceWidget->sliceView()->renderEnabled())
+      {
+      sliceWidget->sliceView()->setRenderEnabled(false);
+      pausedViews.push_back(sliceWidget->sliceView());
+      }
+    }
+  for (int i = 0; i < numberOfSliceNodes; ++i)
+    {
+    if (std::find(movedSliceNodes.begin(), movedSliceNodes.end(), sliceNodes[i]) !=
+        movedSliceNodes.end())
+      {
+      sliceNodes[i]->SetSliceToRASByNTP(
+        normals[i][0], normals[i][1], normals[i][2],
+        transverses[i][0], transverses[i][1], transverses[i][2],
+        positions[i][0], positions[i][1], positions[i][2], 0);
+      }
+    }
+  for (size_t i = 0; i < pausedViews.size(); ++i)
+    {
+    pausedViews[i]->setRenderEnabled(true);
+    pausedViews[i]->scheduleRender();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onLayoutChanged()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onLayoutChanged");
+
+  if (d->updateScheduler)
+    {
+    d->reslicersModified = true;
+    d->updateScheduler->scheduleUpdate(this);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onMRMLSceneEndBatchProcess()
+{
+  Q_D(qSlicerPathExplorerModuleWidget);
+  qSlicerPathExplorerObserverRegistry::CallbackTimer timer(this, "onMRMLSceneEndBatchProcess");
 
-  // Add reslicing widgets
-  vtkMRMLSliceNode* redViewer = vtkMRMLSliceNode::SafeDownCast(newScene->GetNodeByID("vtkMRMLSliceNodeRed"));
-  this->addNewReslicer(redViewer);
-  vtkMRMLSliceNode* yellowViewer = vtkMRMLSliceNode::SafeDownCast(newScene->GetNodeByID("vtkMRMLSliceNodeYellow"));
-  this->addNewReslicer(yellowViewer);
-  vtkMRMLSliceNode* greenViewer = vtkMRMLSliceNode::SafeDownCast(newScene->GetNodeByID("vtkMRMLSliceNodeGreen"));
-  this->addNewReslicer(greenViewer);
+  if (d->entryViewModified)
+    {
+    d->entryViewModified = false;
+    this->updateFiducialView(d->EntryPointWidget);
+    }
+  if (d->targetViewModified)
+    {
+    d->targetViewModified = false;
+    this->updateFiducialView(d->TargetPointWidget);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -882,8 +1664,17 @@ addNewReslicer(vtkMRMLSliceNode* sliceNode)
       new qSlicerPathExplorerReslicingWidget(sliceNode, d->CollapsibleButton);
     if (reslicer)
       {
+      reslicer->setUpdateScheduler(d->updateScheduler);
       d->ReslicingWidgetLayout->addWidget(reslicer);
       d->reslicerList.push_back(reslicer);
+
+      // Views shown later drive the selected trajectory too
+      int row = d->TrajectoryTableView->currentIndex().row();
+      if (d->selectedTrajectoryNode && row >= 0)
+        {
+        reslicer->setTrajectory(d->selectedTrajectoryNode,
+                                d->selectedTrajectoryNode->GetTrajectoryUID(row));
+        }
       }
     }
 }
@@ -894,25 +1685,19 @@ onTargetSelectionChanged()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TargetPointWidget->getTableWidget() ||
-      !d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode ||
+      !d->TrajectoryTableView)
     {
     return;
     }
 
   // Check if same fiducial
-  int targetRow = d->TargetPointWidget->getTableWidget()->currentRow();
-  int trajectoryRow = d->TrajectoryTableWidget->currentRow();
-
-  // Get nodes
-  qSlicerPathExplorerFiducialItem* targetItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->TargetPointWidget->getTableWidget()->item(targetRow,0));
-  qSlicerPathExplorerTrajectoryItem* trajectoryItem =
-    dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(trajectoryRow,0));
+  vtkMRMLAnnotationFiducialNode* targetPoint = d->TargetPointWidget->currentFiducialNode();
+  int trajectoryRow = d->TrajectoryTableView->currentIndex().row();
 
-  if (targetItem && trajectoryItem)
+  if (targetPoint && trajectoryRow >= 0)
     {
-    if (targetItem->getFiducialNode() == trajectoryItem->targetPoint())
+    if (targetPoint == d->selectedTrajectoryNode->GetTargetNode(trajectoryRow))
       {
       // Same. No update.
       d->UpdateButton->setEnabled(0);
@@ -931,25 +1716,19 @@ onEntrySelectionChanged()
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->EntryPointWidget->getTableWidget() ||
-      !d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode ||
+      !d->TrajectoryTableView)
     {
     return;
     }
 
   // Check if same fiducial
-  int entryRow = d->EntryPointWidget->getTableWidget()->currentRow();
-  int trajectoryRow = d->TrajectoryTableWidget->currentRow();
+  vtkMRMLAnnotationFiducialNode* entryPoint = d->EntryPointWidget->currentFiducialNode();
+  int trajectoryRow = d->TrajectoryTableView->currentIndex().row();
 
-  // Get nodes
-  qSlicerPathExplorerFiducialItem* entryItem =
-    dynamic_cast<qSlicerPathExplorerFiducialItem*>(d->EntryPointWidget->getTableWidget()->item(entryRow,0));
-  qSlicerPathExplorerTrajectoryItem* trajectoryItem =
-    dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(trajectoryRow,0));
-
-  if (entryItem && trajectoryItem)
+  if (entryPoint && trajectoryRow >= 0)
     {
-    if (entryItem->getFiducialNode() == trajectoryItem->entryPoint())
+    if (entryPoint == d->selectedTrajectoryNode->GetEntryNode(trajectoryRow))
       {
       // Same. No update.
       d->UpdateButton->setEnabled(0);
@@ -964,160 +1743,113 @@ onEntrySelectionChanged()
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-onTrajectoryCellChanged(int row, int column)
+onTrajectoryRenamed(int trajectoryRow, const QString& oldName)
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget || !d->selectedTrajectoryNode ||
-      !this->mrmlScene())
+  if (!d->selectedTrajectoryNode || !this->mrmlScene() ||
+      trajectoryRow < 0)
     {
     return;
     }
 
-  // -- Trajectory name changed
-  if (column == 0)
-    {
-    // Get item
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (!currentItem)
-      {
-      return;
-      }
-
-    // Get ruler
-    vtkMRMLAnnotationRulerNode* currentRuler =
-      currentItem->trajectoryNode();
-    if (!currentRuler)
-      {
-      return;
-      }
+  // Rename offset for VisuaLine compatibility
+  std::stringstream offsetName;
+  offsetName << oldName.toStdString() << "_offset";
+  vtkCollection* visuaLineOffsetNodes =
+    this->mrmlScene()->GetNodesByClassByName("vtkMRMLAnnotationRulerNode",offsetName.str().c_str());
 
-    // VisuaLine compatibility
-    std::stringstream offsetName;
-    offsetName << currentRuler->GetName() << "_offset";
-    vtkCollection* visuaLineOffsetNodes =
-      this->mrmlScene()->GetNodesByClassByName("vtkMRMLAnnotationRulerNode",offsetName.str().c_str());
-
-    // Set new name
-    currentRuler->SetName(currentItem->text().toStdString().c_str());
+  int numberOfNodes = visuaLineOffsetNodes->GetNumberOfItems();
+  if (numberOfNodes > 0)
+    {
+    vtkMRMLNode* offsetNode =
+      vtkMRMLNode::SafeDownCast(visuaLineOffsetNodes->GetItemAsObject(numberOfNodes-1));
 
-    // Rename offset for VisuaLine compatibility
-    int numberOfNodes = visuaLineOffsetNodes->GetNumberOfItems();
-    if (numberOfNodes > 0)
+    if (offsetNode)
       {
-      vtkMRMLNode* offsetNode =
-        vtkMRMLNode::SafeDownCast(visuaLineOffsetNodes->GetItemAsObject(numberOfNodes-1));
+      // Clear stringstream
+      offsetName.str(std::string());
+      offsetName.clear();
 
-      if (offsetNode)
-        {
-        // Clear stringstream
-        offsetName.str(std::string());
-        offsetName.clear();
-
-        // New name
-        offsetName << currentRuler->GetName() << "_offset";
-        offsetNode->SetName(offsetName.str().c_str());
-        }
+      // New name
+      offsetName << d->selectedTrajectoryNode->GetTrajectoryName(trajectoryRow) << "_offset";
+      offsetNode->SetName(offsetName.str().c_str());
       }
-
-    // Update hierarchy node
-    d->selectedTrajectoryNode->Modified();
-
-    visuaLineOffsetNodes->Delete();
     }
 
-  // -- Trajectory visibility changed
-  else if (column == 3)
-    {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (!currentItem)
-      {
-      return;
-      }
+  // Update hierarchy node
+  d->selectedTrajectoryNode->Modified();
 
-    bool checked = d->TrajectoryTableWidget->item(row, 3)->checkState() == Qt::Checked;
-    currentItem->setDisplayPath(checked);
-    }
+  visuaLineOffsetNodes->Delete();
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
 onEntryPointDeleted(vtkMRMLAnnotationFiducialNode* itemDeleted)
 {
-  Q_D(qSlicerPathExplorerModuleWidget);
+  QList<vtkMRMLAnnotationFiducialNode*> itemsDeleted;
+  itemsDeleted << itemDeleted;
+  this->deleteFiducialTrajectories(itemsDeleted, true);
+}
 
-  if (!d->TrajectoryTableWidget)
-    {
-    return;
-    }
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onEntryPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>& itemsDeleted)
+{
+  this->deleteFiducialTrajectories(itemsDeleted, true);
+}
 
-  int rowCount = d->TrajectoryTableWidget->rowCount();
-  if (rowCount <= 0)
-    {
-    return;
-    }
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTargetPointDeleted(vtkMRMLAnnotationFiducialNode* itemDeleted)
+{
+  QList<vtkMRMLAnnotationFiducialNode*> itemsDeleted;
+  itemsDeleted << itemDeleted;
+  this->deleteFiducialTrajectories(itemsDeleted, false);
+}
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
-    {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
-      {
-      if (currentItem->entryPoint() == itemDeleted)
-        {
-        // Remove trajectory
-        this->deleteTrajectory(row);
-        }
-      else
-        {
-        // Only increment row here, because when removing row 6 for example
-        // row 7 will become row 6, so we have to test row 6 again, and so on...
-        row++;
-        }
-      }
-    }
+//-----------------------------------------------------------------------------
+void qSlicerPathExplorerModuleWidget::
+onTargetPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>& itemsDeleted)
+{
+  this->deleteFiducialTrajectories(itemsDeleted, false);
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerPathExplorerModuleWidget::
-onTargetPointDeleted(vtkMRMLAnnotationFiducialNode* itemDeleted)
+deleteFiducialTrajectories(const QList<vtkMRMLAnnotationFiducialNode*>& fiducials,
+                           bool entry)
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
-    {
-    return;
-    }
-
-  int rowCount = d->TrajectoryTableWidget->rowCount();
-  if (rowCount <= 0)
+  if (!d->selectedTrajectoryNode)
     {
     return;
     }
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
+  // Only visit the trajectories using the deleted fiducials
+  vtkMRMLPathPlannerTrajectoryNode* trajectoryList = d->selectedTrajectoryNode;
+  std::vector<int> trajectoryRows;
+  std::vector<int> fiducialRows;
+  foreach(vtkMRMLAnnotationFiducialNode* fiducial, fiducials)
     {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
+    if (!fiducial || !fiducial->GetID())
       {
-      if (currentItem->targetPoint() == itemDeleted)
-        {
-        // Remove trajectory
-        this->deleteTrajectory(row);
-        }
-      else
+      continue;
+      }
+    trajectoryList->GetTrajectoriesUsingFiducial(fiducial->GetID(), fiducialRows);
+    for (std::vector<int>::iterator it = fiducialRows.begin(); it != fiducialRows.end(); ++it)
+      {
+      const char* nodeID = entry ?
+        trajectoryList->GetEntryNodeID(*it) : trajectoryList->GetTargetNodeID(*it);
+      if (nodeID && strcmp(nodeID, fiducial->GetID()) == 0)
         {
-        // Only increment row here, because when removing row 6 for example
-        // row 7 will become row 6, so we have to test row 6 again, and so on...
-        row++;
+        trajectoryRows.push_back(*it);
         }
       }
     }
+
+  this->deleteTrajectories(trajectoryRows);
 }
 
 //-----------------------------------------------------------------------------
@@ -1126,24 +1858,20 @@ onEntryDisplayModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool visibil
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode || !modifiedNode)
     {
     return;
     }
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
+  // Only visit the trajectories using the fiducial
+  std::vector<int> rows;
+  d->selectedTrajectoryNode->GetTrajectoriesUsingFiducial(modifiedNode->GetID(), rows);
+  for (std::vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
     {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
+    if (d->selectedTrajectoryNode->GetEntryNode(*it) == modifiedNode)
       {
-      if (currentItem->entryPoint() == modifiedNode)
-        {
-        currentItem->setDisplayEntry(visibility);
-        }
+      d->selectedTrajectoryNode->SetTrajectoryFlag(*it, vtkMRMLPathPlannerTrajectoryNode::EntryVisible, visibility);
       }
-    row++;
     }
 }
 
@@ -1153,24 +1881,20 @@ onTargetDisplayModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool visibi
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode || !modifiedNode)
     {
     return;
     }
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
+  // Only visit the trajectories using the fiducial
+  std::vector<int> rows;
+  d->selectedTrajectoryNode->GetTrajectoriesUsingFiducial(modifiedNode->GetID(), rows);
+  for (std::vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
     {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
+    if (d->selectedTrajectoryNode->GetTargetNode(*it) == modifiedNode)
       {
-      if (currentItem->targetPoint() == modifiedNode)
-        {
-        currentItem->setDisplayTarget(visibility);
-        }
+      d->selectedTrajectoryNode->SetTrajectoryFlag(*it, vtkMRMLPathPlannerTrajectoryNode::TargetVisible, visibility);
       }
-    row++;
     }
 }
 
@@ -1180,24 +1904,20 @@ onEntryProjectionModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool proj
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode || !modifiedNode)
     {
     return;
     }
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
+  // Only visit the trajectories using the fiducial
+  std::vector<int> rows;
+  d->selectedTrajectoryNode->GetTrajectoriesUsingFiducial(modifiedNode->GetID(), rows);
+  for (std::vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
     {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
+    if (d->selectedTrajectoryNode->GetEntryNode(*it) == modifiedNode)
       {
-      if (currentItem->entryPoint() == modifiedNode)
-        {
-        currentItem->setProjectionEntry(projection);
-        }
+      d->selectedTrajectoryNode->SetTrajectoryFlag(*it, vtkMRMLPathPlannerTrajectoryNode::EntryProjected, projection);
       }
-    row++;
     }
 }
 
@@ -1207,24 +1927,20 @@ onTargetProjectionModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool pro
 {
   Q_D(qSlicerPathExplorerModuleWidget);
 
-  if (!d->TrajectoryTableWidget)
+  if (!d->selectedTrajectoryNode || !modifiedNode)
     {
     return;
     }
 
-  int row = 0;
-  while(row < d->TrajectoryTableWidget->rowCount())
+  // Only visit the trajectories using the fiducial
+  std::vector<int> rows;
+  d->selectedTrajectoryNode->GetTrajectoriesUsingFiducial(modifiedNode->GetID(), rows);
+  for (std::vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
     {
-    qSlicerPathExplorerTrajectoryItem* currentItem =
-      dynamic_cast<qSlicerPathExplorerTrajectoryItem*>(d->TrajectoryTableWidget->item(row,0));
-    if (currentItem)
+    if (d->selectedTrajectoryNode->GetTargetNode(*it) == modifiedNode)
       {
-      if (currentItem->targetPoint() == modifiedNode)
-        {
-        currentItem->setProjectionTarget(projection);
-        }
+      d->selectedTrajectoryNode->SetTrajectoryFlag(*it, vtkMRMLPathPlannerTrajectoryNode::TargetProjected, projection);
       }
-    row++;
     }
 }
 
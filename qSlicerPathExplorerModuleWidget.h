@@ -31,11 +31,17 @@
 #include <ctkVTKObject.h>
 
 // Qt includes
-#include <QTableWidget>
+#include <QItemSelection>
+#include <QList>
+
+// STD includes
+#include <vector>
 
 class qSlicerPathExplorerModuleWidgetPrivate;
+class qSlicerPathExplorerTableWidget;
 class vtkMRMLAnnotationFiducialNode;
 class vtkMRMLNode;
+class vtkObject;
 class vtkMRMLSliceNode;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
@@ -54,22 +60,42 @@ public:
 public slots:
   void onEntryListNodeChanged(vtkMRMLNode* newList);
   void onTargetListNodeChanged(vtkMRMLNode* newList);
-  void onItemChanged(QTableWidgetItem *item);
   void refreshEntryView();
   void refreshTargetView();
+  void onEntryChildNodeAdded(vtkObject* caller, void* callData);
+  void onEntryChildNodeRemoved(vtkObject* caller, void* callData);
+  void onTargetChildNodeAdded(vtkObject* caller, void* callData);
+  void onTargetChildNodeRemoved(vtkObject* caller, void* callData);
   void onAddButtonClicked();
   void onDeleteButtonClicked();
   void onUpdateButtonClicked();
   void onClearButtonClicked();
   void onTrajectoryListNodeChanged(vtkMRMLNode* newList);
+  void onTrajectoryModified(vtkObject* caller, void* callData);
+  void onTrajectoryListModified();
+  void onCriticalStructuresChanged(vtkMRMLNode* labelMap);
+  void onCriticalStructuresModified();
+  void onFindEntryPointsButtonClicked();
+  void onAnalyzeRobustnessButtonClicked();
+  void onCheckSpacingButtonClicked();
+  void onExportSpacingButtonClicked();
   void onTrajectorySelectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
   void onMRMLSceneChanged(vtkMRMLScene* newScene);
+  void onMRMLSceneEndBatchProcess();
   void addNewReslicer(vtkMRMLSliceNode* sliceNode);
+  void updateReslicers();
+  void onMRMLSceneNodeAdded(vtkObject* caller, void* callData);
+  void onMRMLSceneNodeRemoved(vtkObject* caller, void* callData);
+  void onLayoutChanged();
+  void onLinkedViewsToggled(bool linked);
+  void onLinkedViewsValueChanged(int value);
   void onTargetSelectionChanged();
   void onEntrySelectionChanged();
-  void onTrajectoryCellChanged(int row, int column);
+  void onTrajectoryRenamed(int trajectoryRow, const QString& oldName);
   void onEntryPointDeleted(vtkMRMLAnnotationFiducialNode* itemDeleted);
   void onTargetPointDeleted(vtkMRMLAnnotationFiducialNode* itemDeleted);
+  void onEntryPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>& itemsDeleted);
+  void onTargetPointsDeleted(const QList<vtkMRMLAnnotationFiducialNode*>& itemsDeleted);
   void deleteTrajectory(int trajectoryRow);
   void onEntryDisplayModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool visibility);
   void onTargetDisplayModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool visibility);
@@ -77,13 +103,37 @@ public slots:
   void onTargetProjectionModified(vtkMRMLAnnotationFiducialNode* modifiedNode, bool projection);
   void onEntryTableWidgetAddButtonToggled(bool state);
   void onTargetTableWidgetAddButtonToggled(bool state);
+  void onTasksFinished();
+  void flushUpdates();
+
+signals:
+  /// Emitted by the logic workers when background tasks finished, connected
+  /// with a queued connection to onTasksFinished()
+  void tasksFinished();
 
 protected:
   QScopedPointer<qSlicerPathExplorerModuleWidgetPrivate> d_ptr;
   
   virtual void setup();
-  void addNewFiducialItem(QTableWidget* tableWidget, vtkMRMLAnnotationFiducialNode* fiducialNode);
+  void reconnectObserver(vtkObject* oldObject, vtkObject* newObject, unsigned long event,
+                         const char* slot, const char* callback);
+  void initializeFiducial(qSlicerPathExplorerTableWidget* tableWidget,
+                          vtkMRMLAnnotationFiducialNode* fiducialNode, int row);
+  void selectLastFiducial(qSlicerPathExplorerTableWidget* tableWidget);
+  bool deferFiducialView(qSlicerPathExplorerTableWidget* tableWidget);
+  void refreshFiducialView(qSlicerPathExplorerTableWidget* tableWidget);
+  void updateFiducialView(qSlicerPathExplorerTableWidget* tableWidget);
+  void addFiducialRow(qSlicerPathExplorerTableWidget* tableWidget, void* callData);
+  void removeFiducialRow(qSlicerPathExplorerTableWidget* tableWidget, void* callData);
   void addNewRulerItem(vtkMRMLAnnotationFiducialNode* entryPoint, vtkMRMLAnnotationFiducialNode* targetPoint);
+  void deleteTrajectories(std::vector<int>& trajectoryRows);
+  void trackClearance();
+  void resliceLinkedViews();
+  void untrackClearance();
+  void updateRobustnessButton();
+  static void notifyTasksFinished(void* clientData);
+  void deleteFiducialTrajectories(const QList<vtkMRMLAnnotationFiducialNode*>& fiducials,
+                                  bool entry);
 
 private:
   Q_DECLARE_PRIVATE(qSlicerPathExplorerModuleWidget);